@@ -0,0 +1,60 @@
+#include "ibl.hlsli"
+
+#define GROUP_SIZE 8 // must match EnvironmentMap::GROUP_SIZE
+#define SAMPLE_COUNT 1024
+
+// Precomputation resources (set 0, see EnvironmentMap::Generate)
+[[vk::binding(3, 0)]]
+RWStructuredBuffer<uint> brdfLut; // packed half2 (scale, bias), nDotV along x and roughness along y
+
+struct LutPushConst
+{
+    uint size;
+};
+
+[[vk::push_constant]]
+LutPushConst pushConst;
+
+// Smith G2 for GGX (height correlated, see shading.hlsli) multiplied back by 4 * nDotL * nDotV
+float getVisibility(float alphaSquared, float nDotL, float nDotV)
+{
+    float a = nDotV * sqrt(alphaSquared + nDotL * (nDotL - alphaSquared * nDotL));
+    float b = nDotL * sqrt(alphaSquared + nDotV * (nDotV - alphaSquared * nDotV));
+    return 2.0 * nDotL * nDotV / (a + b);
+}
+
+// Split-sum environment BRDF: the specular reflectance is f0 * scale + bias
+// (independent of the skybox, cached with the rest of the IBL data anyway)
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID)
+{
+    if (any(dispatchId.xy >= pushConst.size))
+        return;
+
+    float nDotV = max((float(dispatchId.x) + 0.5) / float(pushConst.size), 0.001);
+    float roughness = (float(dispatchId.y) + 0.5) / float(pushConst.size);
+    float alpha = roughness * roughness;
+    float alphaSquared = alpha * alpha;
+
+    float3 n = float3(0.0, 0.0, 1.0);
+    float3 v = float3(sqrt(1.0 - nDotV * nDotV), 0.0, nDotV);
+    float2 scaleBias = float2(0.0, 0.0);
+    for (uint i = 0; i < SAMPLE_COUNT; i++)
+    {
+        float3 h = importanceSampleGGX(hammersley(i, SAMPLE_COUNT), alpha, n);
+        float3 l = 2.0 * dot(v, h) * h - v;
+        float nDotL = saturate(l.z);
+        float nDotH = saturate(h.z);
+        float vDotH = saturate(dot(v, h));
+        if (nDotL <= 0.0)
+            continue;
+
+        // G * vDotH / (nDotH * nDotV), the D term cancels with the pdf
+        float g = getVisibility(alphaSquared, nDotL, nDotV) * vDotH / (nDotH * nDotV);
+        float fresnel = pow(1.0 - vDotH, 5.0);
+        scaleBias += float2((1.0 - fresnel) * g, fresnel * g);
+    }
+    scaleBias /= float(SAMPLE_COUNT);
+
+    brdfLut[dispatchId.y * pushConst.size + dispatchId.x] = f32tof16(scaleBias.x) | (f32tof16(scaleBias.y) << 16);
+}
@@ -0,0 +1,54 @@
+// Camera uniform buffer
+struct CameraData
+{
+    float3 position;
+    float4x4 view;
+    float4x4 proj;
+    float4x4 invViewProj;
+};
+
+[[vk::binding(0, 0)]]
+ConstantBuffer<CameraData> cameraData;
+
+// Per-object data (the buffer addresses are only used by the visibility buffer resolve)
+struct ObjectData
+{
+    float4x4 model;
+    float3x3 normal;
+    uint2 vertexAddress;
+    uint2 indexAddress;
+    uint materialIndex;
+    uint vertexFormat; // see vertex.hlsli
+    uint indexSize;    // 2 or 4 bytes
+    uint firstIndex;   // of the selected LOD
+    uint2 culledIndexAddress; // meshlet culling output (32-bit indices), 0 if not culled per meshlet
+    uint culledFirstIndex;
+    float4 uvDequantization; // offset (xy) and scale (zw) of the quantized uvs
+};
+
+[[vk::binding(0, 1)]]
+StructuredBuffer<ObjectData> objectBuffer;
+
+// Push constant used to access the objectBuffer
+struct PushConsts
+{
+    uint objectIndex;
+    uint materialIndex;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+// Position-only stream (see Vertex::Position)
+struct VertexInput
+{
+    [[vk::location(0)]] float3 position : POSITION;
+};
+
+// NOTE: no fragment shader, only the depth is written
+// The position must be computed exactly like in geometry_pass.vert.hlsl
+// (same operations, `precise`) since the geometry pass then tests for EQUAL depth
+float4 main(VertexInput input) : SV_Position
+{
+    float4x4 model = objectBuffer[pushConsts.objectIndex].model;
+    precise float4 position = mul(cameraData.proj, mul(cameraData.view, mul(model, float4(input.position, 1.0))));
+    return position;
+}
@@ -0,0 +1,76 @@
+// G-buffer encoding helpers shared by the geometry and lighting passes
+// NOTE: must match GBuffer::Encoding in GBuffer.hpp
+#define GBUFFER_ENCODING_STANDARD 0       // RGBA8 material info + RGBA16F normal
+#define GBUFFER_ENCODING_OCTAHEDRAL16 1   // RGBA16 unorm (octahedral normal, roughness, metalness)
+#define GBUFFER_ENCODING_OCTAHEDRAL8 2    // RGBA8 unorm (octahedral normal, roughness, metalness)
+
+[[vk::constant_id(0)]] const uint GBUFFER_ENCODING = GBUFFER_ENCODING_STANDARD;
+
+struct SurfaceData
+{
+    float3 normal;
+    float roughness;
+    float metalness;
+};
+
+float2 signNotZero(float2 v)
+{
+    return float2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+/**
+ *  Octahedral normal encoding
+ *
+ *  REFERENCE: Cigolle et al., "A Survey of Efficient Representations
+ *  for Independent Unit Vectors", JCGT 2014
+**/
+float2 encodeOctahedral(float3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+    float2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return e * 0.5 + 0.5; // [-1, 1] -> [0, 1] (unorm targets)
+}
+
+float3 decodeOctahedral(float2 e)
+{
+    e = e * 2.0 - 1.0;
+    float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
+
+// In the compact encodings the second target holds everything
+// and there is no third one (the output is discarded)
+void encodeSurface(float3 normal, float4 materialInfo, out float4 target1, out float4 target2)
+{
+    if (GBUFFER_ENCODING == GBUFFER_ENCODING_STANDARD)
+    {
+        target1 = materialInfo;
+        target2 = float4(normal, 1.0);
+    }
+    else
+    {
+        target1 = float4(encodeOctahedral(normal), materialInfo.g, materialInfo.b);
+        target2 = float4(0.0, 0.0, 0.0, 0.0);
+    }
+}
+
+// `rawNormal` is ignored by the compact encodings
+SurfaceData decodeSurface(float4 rawMaterialInfo, float4 rawNormal)
+{
+    SurfaceData s;
+    if (GBUFFER_ENCODING == GBUFFER_ENCODING_STANDARD)
+    {
+        s.normal = normalize(rawNormal.rgb);
+        s.roughness = rawMaterialInfo.g;
+        s.metalness = rawMaterialInfo.b;
+    }
+    else
+    {
+        s.normal = decodeOctahedral(rawMaterialInfo.xy);
+        s.roughness = rawMaterialInfo.z;
+        s.metalness = rawMaterialInfo.w;
+    }
+    return s;
+}
@@ -1,6 +1,8 @@
-#define MAX_TEXTURES 10 // must match the one in Renderer.hpp
+#define MAX_TEXTURES 30 // must match the one in Renderer.hpp
 #define MAX_SAMPLERS 2
 
+#include "gbuffer.hlsli"
+
 // Material data
 struct MaterialData
 {
@@ -34,8 +36,8 @@ struct VertexOutput
 struct FragmentOutput 
 {
 	float4 baseColor : SV_TARGET0;
-    float4 materialInfo : SV_TARGET1;
-	float4 normal : SV_TARGET2;
+    float4 materialInfo : SV_TARGET1; // packed normal and material info in the compact encodings
+	float4 normal : SV_TARGET2;       // standard encoding only
 };
 
 FragmentOutput main(VertexOutput inVert)
@@ -50,13 +52,14 @@ FragmentOutput main(VertexOutput inVert)
         output.baseColor = float4(m.baseColor, 1.0);
     
     // Material Info
+    float4 materialInfo;
     if (m.materialInfoTex != -1)
-        output.materialInfo = textures[m.materialInfoTex].Sample(samplers[0], inVert.uv);
+        materialInfo = textures[m.materialInfoTex].Sample(samplers[0], inVert.uv);
     else
-        output.materialInfo = m.materialInfo;
+        materialInfo = m.materialInfo;
     
-    // Normal
-    output.normal = float4(normalize(inVert.normal), 1.0);
+    // Normal and material info (see gbuffer.hlsli)
+    encodeSurface(normalize(inVert.normal), materialInfo, output.materialInfo, output.normal);
 	
     return output;
 }
\ No newline at end of file
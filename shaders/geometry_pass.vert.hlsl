@@ -1,3 +1,6 @@
+#include "gbuffer.hlsli"
+#include "vertex.hlsli"
+
 // Camera uniform buffer
 struct CameraData
 {
@@ -10,11 +13,20 @@ struct CameraData
 [[vk::binding(0, 0)]]
 ConstantBuffer<CameraData> cameraData;
 
-// Per-object data
+// Per-object data (the buffer addresses are only used by the visibility buffer resolve)
 struct ObjectData
 {
     float4x4 model;
     float3x3 normal;
+    uint2 vertexAddress;
+    uint2 indexAddress;
+    uint materialIndex;
+    uint vertexFormat; // see vertex.hlsli
+    uint indexSize;    // 2 or 4 bytes
+    uint firstIndex;   // of the selected LOD
+    uint2 culledIndexAddress; // meshlet culling output (32-bit indices), 0 if not culled per meshlet
+    uint culledFirstIndex;
+    float4 uvDequantization; // offset (xy) and scale (zw) of the quantized uvs
 };
 
 [[vk::binding(0, 1)]]
@@ -31,7 +43,7 @@ struct PushConsts
 struct VertexInput
 {
     [[vk::location(0)]] float3 position : POSITION;
-    [[vk::location(1)]] float3 normal : NORMAL;
+    [[vk::location(1)]] float3 normal : NORMAL; // octahedral in xy with the quantized formats
     [[vk::location(2)]] float2 uv : TEXCOORD0;
 };
 
@@ -49,9 +61,13 @@ VertexOutput main(VertexInput input, uint vertexId : SV_VertexID)
     float4x4 model = objectBuffer[pushConsts.objectIndex].model;
     float3x3 normalMatrix = objectBuffer[pushConsts.objectIndex].normal;
     
-    output.position = mul(cameraData.proj, mul(cameraData.view, mul(model, float4(input.position, 1.0)))); // canonical view-volume
-    output.normal = normalize(mul(normalMatrix, input.normal)); // world-space normal
-    output.uv = input.uv;
+    // NOTE: `precise` keeps the depth bit-identical to the depth pre-pass (EQUAL depth test)
+    precise float4 position = mul(cameraData.proj, mul(cameraData.view, mul(model, float4(input.position, 1.0)))); // canonical view-volume
+    output.position = position;
+    float3 normal = VERTEX_FORMAT == VERTEX_FORMAT_FLOAT ? input.normal : decodeVertexNormal(input.normal.xy);
+    output.normal = normalize(mul(normalMatrix, normal)); // world-space normal
+    float4 uvDequantization = objectBuffer[pushConsts.objectIndex].uvDequantization;
+    output.uv = input.uv * uvDequantization.zw + uvDequantization.xy;
     output.materialIndex = pushConsts.materialIndex;
     return output;
 }
\ No newline at end of file
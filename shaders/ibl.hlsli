@@ -0,0 +1,98 @@
+// Image-based lighting from the skybox (see EnvironmentMap)
+// The precomputation shaders (ibl_*.comp, brdf_lut.comp) and the lighting passes share these helpers
+#ifndef PI // already defined when included by shading.hlsli
+#define PI 3.14159265358979323846
+#endif
+
+#define IBL_SH_COEFFICIENTS 9
+
+// Environment uniform buffer of the lighting passes: irradiance as order 2 spherical harmonics
+// NOTE: the coefficients are already convolved with the clamped cosine and divided by PI,
+// so the evaluation gives the diffuse radiance of a white Lambertian surface
+struct EnvironmentData
+{
+    float4 irradianceSH[IBL_SH_COEFFICIENTS]; // rgb coefficient, w unused
+    float4 params;                            // x specular mip count
+};
+
+// World direction through the texel `uv` ([0, 1]) of a cubemap face (Vulkan face order +X, -X, +Y, -Y, +Z, -Z)
+float3 getCubeDirection(uint face, float2 uv)
+{
+    float2 st = uv * 2.0 - 1.0;
+    float3 direction;
+    switch (face)
+    {
+    case 0: direction = float3(1.0, -st.y, -st.x); break;
+    case 1: direction = float3(-1.0, -st.y, st.x); break;
+    case 2: direction = float3(st.x, 1.0, st.y); break;
+    case 3: direction = float3(st.x, -1.0, -st.y); break;
+    case 4: direction = float3(st.x, -st.y, 1.0); break;
+    default: direction = float3(-st.x, -st.y, -1.0); break;
+    }
+    return normalize(direction);
+}
+
+// Real spherical harmonics basis up to l = 2
+void getSHBasis(float3 d, out float basis[IBL_SH_COEFFICIENTS])
+{
+    basis[0] = 0.282095;
+    basis[1] = 0.488603 * d.y;
+    basis[2] = 0.488603 * d.z;
+    basis[3] = 0.488603 * d.x;
+    basis[4] = 1.092548 * d.x * d.y;
+    basis[5] = 1.092548 * d.y * d.z;
+    basis[6] = 0.315392 * (3.0 * d.z * d.z - 1.0);
+    basis[7] = 1.092548 * d.x * d.z;
+    basis[8] = 0.546274 * (d.x * d.x - d.y * d.y);
+}
+
+float3 getIrradiance(float4 irradianceSH[IBL_SH_COEFFICIENTS], float3 n)
+{
+    float basis[IBL_SH_COEFFICIENTS];
+    getSHBasis(n, basis);
+    float3 irradiance = float3(0.0, 0.0, 0.0);
+    for (uint i = 0; i < IBL_SH_COEFFICIENTS; i++)
+        irradiance += irradianceSH[i].rgb * basis[i];
+    return max(irradiance, 0.0);
+}
+
+// Low-discrepancy sequence for the importance sampling
+float2 hammersley(uint i, uint sampleCount)
+{
+    return float2(float(i) / float(sampleCount), float(reversebits(i)) * 2.3283064365386963e-10);
+}
+
+// GGX distribution importance sampling, returns the half vector around `n`
+float3 importanceSampleGGX(float2 xi, float alpha, float3 n)
+{
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha * alpha - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    float3 h = float3(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+
+    float3 up = abs(n.z) < 0.999 ? float3(0.0, 0.0, 1.0) : float3(1.0, 0.0, 0.0);
+    float3 tangent = normalize(cross(up, n));
+    float3 bitangent = cross(n, tangent);
+    return normalize(tangent * h.x + bitangent * h.y + n * h.z);
+}
+
+// Split-sum ambient lighting (Karis, "Real Shading in Unreal Engine 4"):
+// SH irradiance for the diffuse part, prefiltered radiance scaled by the BRDF LUT for the specular part
+float3 shadeAmbient(
+    EnvironmentData environment,
+    TextureCube specularMap, SamplerState specularSampler,
+    Texture2D brdfLut, SamplerState brdfLutSampler,
+    float3 n, float3 v, float3 baseColor, float roughness, float metalness)
+{
+    float nDotV = max(dot(n, v), 0.0);
+    float3 f0 = lerp(float3(0.04, 0.04, 0.04), baseColor, metalness);
+    float2 scaleBias = brdfLut.SampleLevel(brdfLutSampler, float2(nDotV, roughness), 0).rg;
+    float3 specularColor = f0 * scaleBias.x + scaleBias.y;
+
+    // The mips are spread linearly in roughness (see ibl_prefilter.comp.hlsl)
+    float mip = roughness * (environment.params.x - 1.0);
+    float3 prefiltered = specularMap.SampleLevel(specularSampler, reflect(-v, n), mip).rgb;
+
+    float3 diffuse = (1.0 - specularColor) * (1.0 - metalness) * baseColor * getIrradiance(environment.irradianceSH, n);
+    return diffuse + prefiltered * specularColor;
+}
@@ -0,0 +1,69 @@
+#include "ibl.hlsli"
+
+#define GROUP_SIZE 256
+#define FACE_SIZE 32 // texels per face side integrated (read from the matching source mip)
+
+// Precomputation resources (set 0, see EnvironmentMap::Generate)
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+TextureCube sourceMap;
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState sourceSampler;
+
+[[vk::binding(2, 0)]]
+RWStructuredBuffer<float4> irradianceSH; // IBL_SH_COEFFICIENTS entries
+
+groupshared float3 sharedSums[GROUP_SIZE];
+
+// Clamped cosine convolution of each band divided by PI (Ramamoorthi and Hanrahan, 2001)
+static const float BAND_FACTORS[3] = { 1.0, 2.0 / 3.0, 1.0 / 4.0 };
+
+// Single group: every thread projects a strided subset of the 6 * 32 * 32 texels on the SH basis
+// (weighted by their solid angle), then the 9 coefficients are reduced one after the other
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint groupIndex : SV_GroupIndex)
+{
+    uint sourceSize, sourceHeight, sourceMipCount;
+    sourceMap.GetDimensions(0, sourceSize, sourceHeight, sourceMipCount);
+    float sourceMip = max(log2(float(sourceSize) / float(FACE_SIZE)), 0.0);
+
+    float3 sums[IBL_SH_COEFFICIENTS];
+    for (uint c = 0; c < IBL_SH_COEFFICIENTS; c++)
+        sums[c] = float3(0.0, 0.0, 0.0);
+
+    for (uint texel = groupIndex; texel < 6 * FACE_SIZE * FACE_SIZE; texel += GROUP_SIZE)
+    {
+        uint face = texel / (FACE_SIZE * FACE_SIZE);
+        uint2 xy = uint2(texel % FACE_SIZE, (texel / FACE_SIZE) % FACE_SIZE);
+        float2 uv = (float2(xy) + 0.5) / float(FACE_SIZE);
+
+        // Solid angle of the texel: (2 / size)^2 / (1 + s^2 + t^2)^(3/2)
+        float2 st = uv * 2.0 - 1.0;
+        float solidAngle = 4.0 / (float(FACE_SIZE * FACE_SIZE) * pow(1.0 + dot(st, st), 1.5));
+
+        float3 direction = getCubeDirection(face, uv);
+        float3 radiance = sourceMap.SampleLevel(sourceSampler, direction, sourceMip).rgb;
+        float basis[IBL_SH_COEFFICIENTS];
+        getSHBasis(direction, basis);
+        for (uint c = 0; c < IBL_SH_COEFFICIENTS; c++)
+            sums[c] += radiance * basis[c] * solidAngle;
+    }
+
+    for (uint c = 0; c < IBL_SH_COEFFICIENTS; c++)
+    {
+        sharedSums[groupIndex] = sums[c];
+        GroupMemoryBarrierWithGroupSync();
+        for (uint stride = GROUP_SIZE / 2; stride > 0; stride /= 2)
+        {
+            if (groupIndex < stride)
+                sharedSums[groupIndex] += sharedSums[groupIndex + stride];
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        if (groupIndex == 0)
+        {
+            uint band = c == 0 ? 0 : (c < 4 ? 1 : 2);
+            irradianceSH[c] = float4(sharedSums[0] * BAND_FACTORS[band], 0.0);
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
@@ -0,0 +1,74 @@
+#include "ibl.hlsli"
+
+#define GROUP_SIZE 8 // must match EnvironmentMap::GROUP_SIZE
+
+// Precomputation resources (set 0, see EnvironmentMap::Generate)
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+TextureCube sourceMap; // skybox copy with a full mip chain
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState sourceSampler;
+
+[[vk::binding(1, 0)]]
+RWTexture2DArray<float4> outputMip; // one mip of the specular cubemap, one layer per face
+
+struct PrefilterPushConst
+{
+    uint mipLevel;
+    uint mipCount;
+    uint sampleCount;
+};
+
+[[vk::push_constant]]
+PrefilterPushConst pushConst;
+
+// GGX prefiltered radiance with the split-sum assumption (n = v = r), roughness grows linearly with the mip
+// The samples read a source mip matching their solid angle (filtered importance sampling,
+// GPU Gems 3, chapter 20) so that few samples are enough without aliasing
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID)
+{
+    uint3 outputSize;
+    outputMip.GetDimensions(outputSize.x, outputSize.y, outputSize.z);
+    if (any(dispatchId.xy >= outputSize.xy))
+        return;
+
+    uint sourceSize, sourceHeight, sourceMipCount;
+    sourceMap.GetDimensions(0, sourceSize, sourceHeight, sourceMipCount);
+
+    float3 n = getCubeDirection(dispatchId.z, (float2(dispatchId.xy) + 0.5) / float2(outputSize.xy));
+    float roughness = float(pushConst.mipLevel) / float(max(pushConst.mipCount - 1, 1));
+
+    // Mirror reflection: a single tap from the source mip with the same resolution
+    if (pushConst.mipLevel == 0)
+    {
+        float sourceMip = log2(float(sourceSize) / float(outputSize.x));
+        outputMip[dispatchId] = float4(sourceMap.SampleLevel(sourceSampler, n, sourceMip).rgb, 1.0);
+        return;
+    }
+
+    float alpha = roughness * roughness;
+    float alphaSquared = alpha * alpha;
+    float texelSolidAngle = 4.0 * PI / (6.0 * float(sourceSize) * float(sourceSize));
+
+    float3 radiance = float3(0.0, 0.0, 0.0);
+    float weight = 0.0;
+    for (uint i = 0; i < pushConst.sampleCount; i++)
+    {
+        float3 h = importanceSampleGGX(hammersley(i, pushConst.sampleCount), alpha, n);
+        float3 l = 2.0 * dot(n, h) * h - n;
+        float nDotL = dot(n, l);
+        if (nDotL <= 0.0)
+            continue;
+
+        // pdf of l = D * nDotH / (4 * hDotV), with v = n it's D / 4
+        float nDotH = saturate(dot(n, h));
+        float b = (alphaSquared - 1.0) * nDotH * nDotH + 1.0;
+        float pdf = alphaSquared / (PI * b * b) * 0.25;
+        float sampleSolidAngle = 1.0 / (float(pushConst.sampleCount) * pdf + 0.0001);
+        float sourceMip = clamp(0.5 * log2(sampleSolidAngle / texelSolidAngle) + 1.0, 0.0, float(sourceMipCount - 1));
+
+        radiance += sourceMap.SampleLevel(sourceSampler, l, sourceMip).rgb * nDotL;
+        weight += nDotL;
+    }
+    outputMip[dispatchId] = float4(radiance / max(weight, 0.0001), 1.0);
+}
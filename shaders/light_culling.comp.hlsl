@@ -0,0 +1,100 @@
+#include "lights.hlsli"
+
+#define GROUP_SIZE 128 // must match Renderer::LIGHT_CULLING_GROUP_SIZE
+
+// Camera uniform buffer (set 0)
+struct CameraData
+{
+    float3 position;
+    float4x4 view;
+    float4x4 proj;
+    float4x4 invViewProj;
+};
+
+[[vk::binding(0, 0)]]
+ConstantBuffer<CameraData> cameraData;
+
+// Lights and clusters (set 1)
+[[vk::binding(0, 1)]]
+StructuredBuffer<LightData> lights;
+
+[[vk::binding(1, 1)]]
+RWStructuredBuffer<uint> clusterLightCounts;
+
+[[vk::binding(2, 1)]]
+RWStructuredBuffer<uint> clusterLightIndices; // MAX_LIGHTS_PER_CLUSTER slots per cluster
+
+struct LightCountPushConst
+{
+    uint lightCount;
+};
+
+[[vk::push_constant]]
+LightCountPushConst pushConst;
+
+// View-space bounding spheres of the batch of lights being tested
+groupshared float4 sharedLightSpheres[GROUP_SIZE];
+
+float squaredDistanceToAABB(float3 p, float3 aabbMin, float3 aabbMax)
+{
+    float3 d = max(max(aabbMin - p, 0.0), p - aabbMax);
+    return dot(d, d);
+}
+
+// One thread per cluster: the lights are loaded in batches in group shared memory
+// (one light per thread) and every thread tests its cluster against the whole batch
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    uint clusterIndex = dispatchId.x;
+    bool isValidCluster = clusterIndex < CLUSTER_COUNT;
+
+    // View-space AABB of the cluster (camera looking down -Z)
+    uint3 cluster = uint3(
+        clusterIndex % CLUSTER_COUNT_X,
+        (clusterIndex / CLUSTER_COUNT_X) % CLUSTER_COUNT_Y,
+        clusterIndex / (CLUSTER_COUNT_X * CLUSTER_COUNT_Y)
+    );
+    float2 ndcMin = float2(cluster.xy) / float2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y) * 2.0 - 1.0;
+    float2 ndcMax = float2(cluster.xy + 1) / float2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y) * 2.0 - 1.0;
+    float nearDepth = getSliceDepth(cluster.z, cameraData.proj);
+    float farDepth = getSliceDepth(cluster.z + 1, cameraData.proj);
+
+    // NDC to view space at a given depth (the Y axis may be flipped)
+    float2 ndcToView = 1.0 / float2(cameraData.proj[0][0], cameraData.proj[1][1]);
+    float2 nearMin = ndcMin * nearDepth * ndcToView;
+    float2 nearMax = ndcMax * nearDepth * ndcToView;
+    float2 farMin = ndcMin * farDepth * ndcToView;
+    float2 farMax = ndcMax * farDepth * ndcToView;
+    float3 aabbMin = float3(min(min(nearMin, nearMax), min(farMin, farMax)), -farDepth);
+    float3 aabbMax = float3(max(max(nearMin, nearMax), max(farMin, farMax)), -nearDepth);
+
+    uint count = 0;
+    for (uint batch = 0; batch < pushConst.lightCount; batch += GROUP_SIZE)
+    {
+        uint lightIndex = batch + groupIndex;
+        if (lightIndex < pushConst.lightCount)
+        {
+            float4 positionRange = lights[lightIndex].positionRange;
+            float3 viewPosition = mul(cameraData.view, float4(positionRange.xyz, 1.0)).xyz;
+            sharedLightSpheres[groupIndex] = float4(viewPosition, positionRange.w);
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        // NOTE: spot lights are culled with their bounding sphere (conservative)
+        uint batchSize = min(GROUP_SIZE, pushConst.lightCount - batch);
+        for (uint i = 0; i < batchSize && isValidCluster && count < MAX_LIGHTS_PER_CLUSTER; i++)
+        {
+            float4 sphere = sharedLightSpheres[i];
+            if (squaredDistanceToAABB(sphere.xyz, aabbMin, aabbMax) <= sphere.w * sphere.w)
+            {
+                clusterLightIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + count] = batch + i;
+                ++count;
+            }
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (isValidCluster)
+        clusterLightCounts[clusterIndex] = count;
+}
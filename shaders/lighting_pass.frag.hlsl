@@ -1,6 +1,5 @@
-#define MAX_TEXTURES 10 // must match the one in Renderer.hpp
-#define MAX_SAMPLERS 2
-#define PI 3.14159265358979323846
+#include "gbuffer.hlsli"
+#include "shading.hlsli"
 
 struct VertexOutput
 {
@@ -15,6 +14,7 @@ struct CameraData
     float4x4 view;
     float4x4 proj;
     float4x4 invViewProj;
+    float4 renderExtent; // xy rendered area of the G-buffer in pixels, zw its inverse
 };
 
 [[vk::binding(0, 0)]]
@@ -31,6 +31,7 @@ Texture2D gMaterialInfo;
 [[vk::combinedImageSampler]][[vk::binding(1, 1)]]
 SamplerState gMaterialInfoSampler;
 
+// NOTE: aliases gMaterialInfo in the compact encodings
 [[vk::combinedImageSampler]][[vk::binding(2, 1)]]
 Texture2D gNormal;
 [[vk::combinedImageSampler]][[vk::binding(2, 1)]]
@@ -41,18 +42,38 @@ Texture2D gDepth;
 [[vk::combinedImageSampler]][[vk::binding(3, 1)]]
 SamplerState gDepthSampler;
 
+// Lights and clusters (set 2, see light_culling.comp.hlsl)
 [[vk::binding(0, 2)]]
-SamplerState samplers[MAX_SAMPLERS]; // NOTE: currently always defaulting to samplers[0]
+StructuredBuffer<LightData> lights;
 
 [[vk::binding(1, 2)]]
-Texture2D textures[MAX_TEXTURES];
+StructuredBuffer<uint> clusterLightCounts;
 
 [[vk::binding(2, 2)]]
-TextureCube skybox;
+StructuredBuffer<uint> clusterLightIndices;
 
-// Hardcoded DIRECTIONAL LIGHT
-static const float3 LIGHT_DIR = float3(1.0, 1.0, -1.0);
-static const float3 LIGHT_COL = float3(1.0, 1.0, 1.0);
+// Sun and its cascaded shadow map (set 3)
+[[vk::binding(0, 3)]]
+ConstantBuffer<SunData> sunData;
+
+[[vk::combinedImageSampler]][[vk::binding(1, 3)]]
+Texture2DArray shadowMap;
+[[vk::combinedImageSampler]][[vk::binding(1, 3)]]
+SamplerComparisonState shadowSampler;
+
+// Image-based lighting precomputed from the skybox (set 4, see EnvironmentMap)
+[[vk::binding(0, 4)]]
+ConstantBuffer<EnvironmentData> environmentData;
+
+[[vk::combinedImageSampler]][[vk::binding(1, 4)]]
+TextureCube specularMap;
+[[vk::combinedImageSampler]][[vk::binding(1, 4)]]
+SamplerState specularMapSampler;
+
+[[vk::combinedImageSampler]][[vk::binding(2, 4)]]
+Texture2D brdfLut;
+[[vk::combinedImageSampler]][[vk::binding(2, 4)]]
+SamplerState brdfLutSampler;
 
 float3 reconstructWorldPosition(float depth, float2 uv)
 {
@@ -62,92 +83,52 @@ float3 reconstructWorldPosition(float depth, float2 uv)
     return (worldPosH.xyz / worldPosH.w); // De-homogenization
 }
 
-// Metalness-weighted Lambertian diffuse BRDF
-float3 diffuseBRDF(const float3 albedo, const float metalness)
-{
-    return (1.0 - metalness) * (float3) (1.0 / PI) * albedo;
-}
-
-/** 
- *  Schlick's approximation of Fresnel equations
- * 
- *  NOTES:
- *  - hDotV is the cosine of the angle between the 
- *    sampled microfacet normal and the view direction
- *    (clamped between 0 and 1)
- *  - metals should provide the base color as f0, while
- *    dielectrics should use a value of 0.04 as a good
- *    approximation of their behaviour (see Real
- *    Time Rendering)
- *
- * OPTIMIZATIONS:
- * - S. Lagarde, "Spherical Gaussian approximation for
- *   Blinn-Phong, Phong and Fresnel", 2012
-**/ 
-float3 F(float3 f0, float hDotV)
-{
-    float3 f90 = float3(1.0, 1.0, 1.0);
-    return f0 + (f90 - f0) * pow(1 - hDotV, 5.0);
-}
-
-// GGX normal distribution function
-float D(float alphaSquared, float nDotH)
-{
-    float b = ((alphaSquared - 1.0f) * nDotH * nDotH + 1.0f);
-    return alphaSquared / (PI * b * b);
-}
-
-// Smith G2 term (masking-shadowing function) for GGX distribution
-// Height correlated version - optimized by substituing 
-// G_Lambda for G_Lambda_GGX and dividing by (4 * NdotL * NdotV) to cancel out 
-// the terms in specular BRDF denominator
-// Source: "Moving Frostbite to Physically Based Rendering" by Lagarde & de Rousiers
-// Note that returned value is G2 / (4 * NdotL * NdotV) and therefore includes division by specular BRDF denominator
-// 
-// REFERENCE: https://boksajak.github.io/files/CrashCourseBRDF.pdf
-float G(float alphaSquared, float nDotL, float nDotV)
-{
-    float a = nDotV * sqrt(alphaSquared + nDotL * (nDotL - alphaSquared * nDotL));
-    float b = nDotL * sqrt(alphaSquared + nDotV * (nDotV - alphaSquared * nDotV));
-    return 0.5f / (a + b);
-}
-
+// NOTE: only runs on geometry pixels, the background ones are rejected by the depth test
+// and filled by the skybox pass (see skybox.frag.hlsl)
+// The G-buffer is fetched per pixel: with dynamic resolution only its top-left part is rendered,
+// inVert.uv spans that part (the viewport) and is only used for the reconstruction
 float4 main(VertexOutput inVert) : SV_TARGET0
 {
-    float depth = gDepth.Sample(gDepthSampler, inVert.uv).r;
+    int3 pixel = int3(inVert.position.xy, 0);
+    float depth = gDepth.Load(pixel).r;
     float3 fragWorldPosition = reconstructWorldPosition(depth, inVert.uv);
     float3 v = normalize(cameraData.position - fragWorldPosition);
     
-    // If the fragment belongs to the background then the skybox will be sampled
-    // TODO: add a separate skybox pass
-    if (depth >= 1.0)
+    float3 baseColor = gBaseColor.Load(pixel).rgb;
+    float4 rawMaterialInfo = gMaterialInfo.Load(pixel);
+    float4 rawNormal = float4(0.0, 0.0, 0.0, 0.0);
+    if (GBUFFER_ENCODING == GBUFFER_ENCODING_STANDARD)
+        rawNormal = gNormal.Load(pixel);
+    SurfaceData surface = decodeSurface(rawMaterialInfo, rawNormal);
+    float roughness = surface.roughness;
+    float metalness = surface.metalness;
+    float3 n = surface.normal;
+    float viewDepth = linearizeDepth(depth, cameraData.proj);
+
+    // Sun (shadowed)
+    float shadow = 1.0;
+    uint cascade = getShadowCascade(sunData.cascadeSplits, (uint) sunData.direction.w, viewDepth);
+    if (cascade < (uint) sunData.direction.w)
     {
-        return skybox.Sample(samplers[1], -v);
+        shadow = getSunShadow(
+            shadowMap, shadowSampler, sunData.cascadeViewProj[cascade], cascade,
+            sunData.cascadeTexelSizes[cascade], sunData.color.w, fragWorldPosition, n
+        );
     }
-    
-    // Else lighting computation will be executed
-    float3 baseColor = gBaseColor.Sample(gBaseColorSampler, inVert.uv).rgb;
-    float4 rawMaterialInfo = gMaterialInfo.Sample(gMaterialInfoSampler, inVert.uv);
-    float roughness = rawMaterialInfo.g;
-    float metalness = rawMaterialInfo.b;
-    float ambient = 0.01;
-    float3 n = normalize(gNormal.Sample(gNormalSampler, inVert.uv).rgb);
-    float3 l = -normalize(LIGHT_DIR);
-    float3 h = normalize(l + v);
-    float nDotL = max(dot(l, n), 0.0);
-    float nDotH = max(dot(n, h), 0.0);
-    float nDotV = max(dot(n, v), 0.0);
-    float hDotV = max(dot(h, v), 0.0);
-    
-    // BRDF evaluation
-    float alpha = roughness * roughness;
-    float alphaSquared = alpha * alpha;
-    float3 f0 = lerp(float3(0.04, 0.04, 0.04), baseColor, metalness);
-    float3 fresnel = F(f0, hDotV);
-    float3 specularBRDF = fresnel * D(alphaSquared, nDotH) * G(alphaSquared, nDotL, nDotV);
-    float3 combinedBRDF = (float3(1.0, 1.0, 1.0) - fresnel) * diffuseBRDF(baseColor, metalness) + specularBRDF;
-    float3 directLighting = LIGHT_COL * combinedBRDF * nDotL;
-    
-    // TODO: add environment mapping instead of ambient
-    return float4(directLighting + (1.0 - metalness) * ambient * baseColor, 1.0);
-}
\ No newline at end of file
+    float3 directLighting = shadow * shade(n, v, -sunData.direction.xyz, sunData.color.rgb, baseColor, roughness, metalness);
+
+    // Punctual lights: only the ones binned in the fragment cluster are evaluated
+    uint clusterIndex = getClusterIndex(inVert.uv, viewDepth, cameraData.proj);
+    uint lightCount = clusterLightCounts[clusterIndex];
+    for (uint i = 0; i < lightCount; i++)
+    {
+        LightData light = lights[clusterLightIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]];
+        directLighting += shadePunctualLight(light, fragWorldPosition, n, v, baseColor, roughness, metalness);
+    }
+
+    float3 ambientLighting = shadeAmbient(
+        environmentData, specularMap, specularMapSampler, brdfLut, brdfLutSampler,
+        n, v, baseColor, roughness, metalness
+    );
+    return float4(directLighting + ambientLighting, 1.0);
+}
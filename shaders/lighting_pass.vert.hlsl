@@ -8,9 +8,10 @@ VertexOutput main(uint vertexId : SV_VertexID)
 {
     VertexOutput output;
     
-    // Draw a full screen triangle
+    // Draw a full screen triangle at the far plane: with a depth test against the G-buffer depth
+    // GREATER only keeps the geometry pixels (lighting) and EQUAL only the background ones (skybox)
     output.uv = float2((vertexId << 1) & 2, vertexId & 2);
-    output.position = float4(output.uv * 2.0 + -1.0, 0.0, 1.0);
+    output.position = float4(output.uv * 2.0 + -1.0, 1.0, 1.0);
     
     return output;
 }
\ No newline at end of file
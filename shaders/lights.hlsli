@@ -0,0 +1,81 @@
+// Punctual lights and clustered shading helpers shared by the light culling and lighting passes
+// NOTE: must match Renderer::LightData and the cluster constants in Renderer.hpp
+#define LIGHT_TYPE_POINT 0
+#define LIGHT_TYPE_SPOT 1
+
+// View frustum split in screen-space tiles and exponential depth slices
+#define CLUSTER_COUNT_X 16
+#define CLUSTER_COUNT_Y 9
+#define CLUSTER_COUNT_Z 24
+#define CLUSTER_COUNT (CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z)
+#define MAX_LIGHTS_PER_CLUSTER 256
+
+struct LightData
+{
+    float4 positionRange;   // xyz world position, w range
+    float4 colorType;       // rgb color * intensity, w type
+    float4 direction;       // xyz world direction (spot only)
+    float4 spotParams;      // x angle scale, y angle offset (spot only)
+};
+
+// NOTE: the projection is a standard (not reversed) [0, 1] depth perspective,
+// see Camera::GetProjectionMatrix
+float getNearPlane(float4x4 proj)
+{
+    return proj[2][3] / proj[2][2];
+}
+
+float getFarPlane(float4x4 proj)
+{
+    return proj[2][3] / (1.0 + proj[2][2]);
+}
+
+// View-space distance along the camera axis of a depth buffer value
+float linearizeDepth(float depth, float4x4 proj)
+{
+    return proj[2][3] / (depth + proj[2][2]);
+}
+
+// Slice k spans [near * (far / near)^(k / Z), near * (far / near)^((k + 1) / Z)]
+// so that clusters keep roughly the same proportions at every depth
+float getSliceDepth(uint slice, float4x4 proj)
+{
+    float near = getNearPlane(proj);
+    float far = getFarPlane(proj);
+    return near * pow(far / near, slice / (float) CLUSTER_COUNT_Z);
+}
+
+uint getSlice(float viewDepth, float4x4 proj)
+{
+    float near = getNearPlane(proj);
+    float far = getFarPlane(proj);
+    int slice = (int) floor(log(viewDepth / near) / log(far / near) * CLUSTER_COUNT_Z);
+    return (uint) clamp(slice, 0, CLUSTER_COUNT_Z - 1);
+}
+
+uint getClusterIndex(uint3 cluster)
+{
+    return cluster.x + cluster.y * CLUSTER_COUNT_X + cluster.z * CLUSTER_COUNT_X * CLUSTER_COUNT_Y;
+}
+
+uint getClusterIndex(float2 uv, float viewDepth, float4x4 proj)
+{
+    uint2 tile = min((uint2) (uv * float2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y)), uint2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));
+    return getClusterIndex(uint3(tile, getSlice(viewDepth, proj)));
+}
+
+// Windowed inverse-square falloff (see KHR_lights_punctual specs)
+float getRangeAttenuation(float distance, float range)
+{
+    float ratio = distance / range;
+    float window = saturate(1.0 - ratio * ratio * ratio * ratio);
+    return window * window / max(distance * distance, 0.0001);
+}
+
+// `l` points from the surface towards the light
+float getSpotAttenuation(LightData light, float3 l)
+{
+    float cd = dot(light.direction.xyz, -l);
+    float attenuation = saturate(cd * light.spotParams.x + light.spotParams.y);
+    return attenuation * attenuation;
+}
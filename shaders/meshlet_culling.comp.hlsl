@@ -0,0 +1,143 @@
+#include "gbuffer.hlsli"
+#include "vertex.hlsli"
+
+#define GROUP_SIZE 64 // one thread per meshlet of the batch
+
+// Camera uniform buffer (set 0)
+struct CameraData
+{
+    float3 position;
+    float4x4 view;
+    float4x4 proj;
+    float4x4 invViewProj;
+};
+
+[[vk::binding(0, 0)]]
+ConstantBuffer<CameraData> cameraData;
+
+// NOTE: must match Meshlet in Mesh.hpp (read through the buffer address, 48 bytes)
+struct Meshlet
+{
+    float4 boundingSphere;  // xyz center, w radius (mesh space)
+    float4 cone;            // xyz axis, w cutoff
+    uint firstIndex;
+    uint indexCount;
+};
+
+#define MESHLET_STRIDE 48
+
+// NOTE: must match Renderer::ClusterDrawData
+struct ClusterDraw
+{
+    float4x4 model;
+    uint64_t meshletAddress;
+    uint64_t indexAddress;
+    uint meshletCount;
+    uint indexSize;         // 2 or 4 bytes
+    uint outputFirstIndex;  // region of culledIndices
+    float maxScale;
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+// Draws and outputs (set 1)
+[[vk::binding(0, 1)]]
+StructuredBuffer<ClusterDraw> clusterDraws;
+
+[[vk::binding(1, 1)]]
+RWStructuredBuffer<DrawCommand> drawCommands; // one per cluster draw, the rest is written by the CPU
+
+[[vk::binding(2, 1)]]
+RWStructuredBuffer<uint> culledIndices;
+
+// Indices of the draw output reserved by the visible meshlets so far
+groupshared uint sharedIndexCount;
+
+Meshlet loadMeshlet(uint64_t address, uint i)
+{
+    uint64_t meshletAddress = address + uint64_t(i) * MESHLET_STRIDE;
+    Meshlet meshlet;
+    meshlet.boundingSphere = vk::RawBufferLoad<float4>(meshletAddress, 16);
+    meshlet.cone = vk::RawBufferLoad<float4>(meshletAddress + 16, 16);
+    uint2 range = vk::RawBufferLoad<uint2>(meshletAddress + 32, 8);
+    meshlet.firstIndex = range.x;
+    meshlet.indexCount = range.y;
+    return meshlet;
+}
+
+float4 normalizePlane(float4 plane)
+{
+    return plane / length(plane.xyz);
+}
+
+/**
+ *  Frustum test of the bounding sphere, then normal cone test: the meshlet is back-facing
+ *  when the camera is inside the cone of positions every triangle faces away from
+ *
+ *  REFERENCE: meshoptimizer, meshopt_computeMeshletBounds
+ *  NOTE: the cone axis is transformed like a direction, approximate under non-uniform scale
+**/
+bool isMeshletVisible(Meshlet meshlet, ClusterDraw draw, float4 planes[6])
+{
+    float3 center = mul(draw.model, float4(meshlet.boundingSphere.xyz, 1.0)).xyz;
+    float radius = meshlet.boundingSphere.w * draw.maxScale;
+
+    for (uint p = 0; p < 6; p++)
+    {
+        if (dot(planes[p].xyz, center) + planes[p].w < -radius)
+            return false;
+    }
+
+    float3 axis = normalize(mul((float3x3) draw.model, meshlet.cone.xyz));
+    float3 view = center - cameraData.position;
+    return dot(view, axis) < meshlet.cone.w * length(view) + radius;
+}
+
+// One group per cluster draw, the meshlets are tested in batches (one per thread): the visible ones reserve
+// their range of the draw output in group shared memory and copy their indices, the total is the index count
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    uint drawIndex = groupId.x;
+    ClusterDraw draw = clusterDraws[drawIndex];
+
+    if (groupIndex == 0)
+        sharedIndexCount = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    // World-space frustum planes from the rows of the view-projection matrix (Vulkan depth range [0, 1])
+    float4x4 viewProj = mul(cameraData.proj, cameraData.view);
+    float4 planes[6] = {
+        normalizePlane(viewProj[3] + viewProj[0]),
+        normalizePlane(viewProj[3] - viewProj[0]),
+        normalizePlane(viewProj[3] + viewProj[1]),
+        normalizePlane(viewProj[3] - viewProj[1]),
+        normalizePlane(viewProj[2]),
+        normalizePlane(viewProj[3] - viewProj[2])
+    };
+
+    for (uint i = groupIndex; i < draw.meshletCount; i += GROUP_SIZE)
+    {
+        Meshlet meshlet = loadMeshlet(draw.meshletAddress, i);
+        if (!isMeshletVisible(meshlet, draw, planes))
+            continue;
+
+        uint offset;
+        InterlockedAdd(sharedIndexCount, meshlet.indexCount, offset);
+        uint outputIndex = draw.outputFirstIndex + offset;
+        for (uint j = 0; j < meshlet.indexCount; j++)
+            culledIndices[outputIndex + j] = fetchIndex(draw.indexAddress, meshlet.firstIndex + j, draw.indexSize);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (groupIndex == 0)
+        drawCommands[drawIndex].indexCount = sharedIndexCount;
+}
@@ -0,0 +1,90 @@
+// Surface shading shared by the raster (lighting_pass.frag) and compute (tiled_lighting.comp) lighting passes
+#define PI 3.14159265358979323846
+
+#include "lights.hlsli"
+#include "shadows.hlsli"
+#include "ibl.hlsli"
+
+// Metalness-weighted Lambertian diffuse BRDF
+float3 diffuseBRDF(const float3 albedo, const float metalness)
+{
+    return (1.0 - metalness) * (float3) (1.0 / PI) * albedo;
+}
+
+/** 
+ *  Schlick's approximation of Fresnel equations
+ * 
+ *  NOTES:
+ *  - hDotV is the cosine of the angle between the 
+ *    sampled microfacet normal and the view direction
+ *    (clamped between 0 and 1)
+ *  - metals should provide the base color as f0, while
+ *    dielectrics should use a value of 0.04 as a good
+ *    approximation of their behaviour (see Real
+ *    Time Rendering)
+ *
+ * OPTIMIZATIONS:
+ * - S. Lagarde, "Spherical Gaussian approximation for
+ *   Blinn-Phong, Phong and Fresnel", 2012
+**/ 
+float3 F(float3 f0, float hDotV)
+{
+    float3 f90 = float3(1.0, 1.0, 1.0);
+    return f0 + (f90 - f0) * pow(1 - hDotV, 5.0);
+}
+
+// GGX normal distribution function
+float D(float alphaSquared, float nDotH)
+{
+    float b = ((alphaSquared - 1.0f) * nDotH * nDotH + 1.0f);
+    return alphaSquared / (PI * b * b);
+}
+
+// Smith G2 term (masking-shadowing function) for GGX distribution
+// Height correlated version - optimized by substituing 
+// G_Lambda for G_Lambda_GGX and dividing by (4 * NdotL * NdotV) to cancel out 
+// the terms in specular BRDF denominator
+// Source: "Moving Frostbite to Physically Based Rendering" by Lagarde & de Rousiers
+// Note that returned value is G2 / (4 * NdotL * NdotV) and therefore includes division by specular BRDF denominator
+// 
+// REFERENCE: https://boksajak.github.io/files/CrashCourseBRDF.pdf
+float G(float alphaSquared, float nDotL, float nDotV)
+{
+    float a = nDotV * sqrt(alphaSquared + nDotL * (nDotL - alphaSquared * nDotL));
+    float b = nDotL * sqrt(alphaSquared + nDotV * (nDotV - alphaSquared * nDotV));
+    return 0.5f / (a + b);
+}
+
+// Radiance reflected towards `v` from a light in direction `l` (both pointing away from the surface)
+float3 shade(float3 n, float3 v, float3 l, float3 radiance, float3 baseColor, float roughness, float metalness)
+{
+    float3 h = normalize(l + v);
+    float nDotL = max(dot(l, n), 0.0);
+    float nDotH = max(dot(n, h), 0.0);
+    float nDotV = max(dot(n, v), 0.0);
+    float hDotV = max(dot(h, v), 0.0);
+    
+    // BRDF evaluation
+    float alpha = roughness * roughness;
+    float alphaSquared = alpha * alpha;
+    float3 f0 = lerp(float3(0.04, 0.04, 0.04), baseColor, metalness);
+    float3 fresnel = F(f0, hDotV);
+    float3 specularBRDF = fresnel * D(alphaSquared, nDotH) * G(alphaSquared, nDotL, nDotV);
+    float3 combinedBRDF = (float3(1.0, 1.0, 1.0) - fresnel) * diffuseBRDF(baseColor, metalness) + specularBRDF;
+    return radiance * combinedBRDF * nDotL;
+}
+
+// Radiance reflected towards `v` by a punctual light
+float3 shadePunctualLight(LightData light, float3 worldPosition, float3 n, float3 v, float3 baseColor, float roughness, float metalness)
+{
+    float3 toLight = light.positionRange.xyz - worldPosition;
+    float distance = length(toLight);
+    float3 l = toLight / max(distance, 0.0001);
+
+    float attenuation = getRangeAttenuation(distance, light.positionRange.w);
+    if (light.colorType.w == LIGHT_TYPE_SPOT)
+        attenuation *= getSpotAttenuation(light, l);
+    if (attenuation <= 0.0)
+        return float3(0.0, 0.0, 0.0);
+    return shade(n, v, l, light.colorType.rgb * attenuation, baseColor, roughness, metalness);
+}
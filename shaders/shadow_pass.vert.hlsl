@@ -0,0 +1,46 @@
+#include "shadows.hlsli"
+
+// Sun and cascades uniform buffer (set 0)
+[[vk::binding(0, 0)]]
+ConstantBuffer<SunData> sunData;
+
+// Per-object data (the buffer addresses are only used by the visibility buffer resolve)
+struct ObjectData
+{
+    float4x4 model;
+    float3x3 normal;
+    uint2 vertexAddress;
+    uint2 indexAddress;
+    uint materialIndex;
+    uint vertexFormat; // see vertex.hlsli
+    uint indexSize;    // 2 or 4 bytes
+    uint firstIndex;   // of the selected LOD
+    uint2 culledIndexAddress; // meshlet culling output (32-bit indices), 0 if not culled per meshlet
+    uint culledFirstIndex;
+    float4 uvDequantization; // offset (xy) and scale (zw) of the quantized uvs
+};
+
+[[vk::binding(0, 1)]]
+StructuredBuffer<ObjectData> objectBuffer;
+
+// Object push constants followed by the cascade being drawn
+struct PushConsts
+{
+    uint objectIndex;
+    uint materialIndex;
+    uint cascadeIndex;
+};
+[[vk::push_constant]] PushConsts pushConsts;
+
+// Position-only stream (see Vertex::Position)
+struct VertexInput
+{
+    [[vk::location(0)]] float3 position : POSITION;
+};
+
+// NOTE: no fragment shader, only the depth is written (with a slope-scaled bias, see Renderer::CreateShadowPipeline)
+float4 main(VertexInput input) : SV_Position
+{
+    float4x4 model = objectBuffer[pushConsts.objectIndex].model;
+    return mul(sunData.cascadeViewProj[pushConsts.cascadeIndex], mul(model, float4(input.position, 1.0)));
+}
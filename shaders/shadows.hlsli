@@ -0,0 +1,42 @@
+// Cascaded shadow map of the sun (see ShadowMap)
+// NOTE: must match Renderer::SunData and ShadowMap::MAX_CASCADES
+#define MAX_SHADOW_CASCADES 4
+
+struct SunData
+{
+    float4x4 cascadeViewProj[MAX_SHADOW_CASCADES];
+    float4 cascadeSplits;       // view-space distance of the far bound of each cascade
+    float4 cascadeTexelSizes;   // world-space size of a shadow map texel in each cascade
+    float4 direction;           // xyz direction the light travels, w cascade count
+    float4 color;               // rgb color * intensity, w 1 / shadow map resolution
+};
+
+// First cascade containing the view depth, `cascadeCount` beyond the shadow distance
+uint getShadowCascade(float4 cascadeSplits, uint cascadeCount, float viewDepth)
+{
+    uint cascade = 0;
+    while (cascade < cascadeCount && viewDepth > cascadeSplits[cascade])
+        ++cascade;
+    return cascade;
+}
+
+// Lit fraction of a surface point in [0, 1] with 3x3 PCF (each tap is bilinearly filtered when supported)
+// The point is pushed along the normal by a texel and a half against the acne on slopes
+float getSunShadow(
+    Texture2DArray shadowMap, SamplerComparisonState shadowSampler,
+    float4x4 cascadeViewProj, uint cascade, float texelSize, float invResolution,
+    float3 worldPosition, float3 n)
+{
+    float4 lightClip = mul(cascadeViewProj, float4(worldPosition + n * texelSize * 1.5, 1.0));
+    float2 uv = lightClip.xy * 0.5 + 0.5;
+    if (any(uv < 0.0) || any(uv > 1.0) || lightClip.z > 1.0)
+        return 1.0;
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+            lit += shadowMap.SampleCmpLevelZero(shadowSampler, float3(uv + float2(x, y) * invResolution, cascade), lightClip.z);
+    }
+    return lit / 9.0;
+}
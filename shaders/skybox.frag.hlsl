@@ -0,0 +1,36 @@
+#define MAX_SAMPLERS 2
+
+struct VertexOutput
+{
+    float4 position : SV_Position;
+    float2 uv : TEXCOORD0;
+};
+
+// Camera uniform buffer (set 0)
+struct CameraData
+{
+    float3 position;
+    float4x4 view;
+    float4x4 proj;
+    float4x4 invViewProj;
+};
+
+[[vk::binding(0, 0)]]
+ConstantBuffer<CameraData> cameraData;
+
+// Samplers and skybox (set 1, the texture array isn't used)
+[[vk::binding(0, 1)]]
+SamplerState samplers[MAX_SAMPLERS];
+
+[[vk::binding(2, 1)]]
+TextureCube skybox;
+
+// Drawn with the fullscreen triangle at the far plane (see lighting_pass.vert.hlsl) and an EQUAL
+// depth test, so only the background pixels (depth still cleared to 1) are shaded
+float4 main(VertexOutput inVert) : SV_TARGET0
+{
+    float2 ndc = inVert.uv * 2.0 - 1.0; // Convert [0, 1] to [-1, 1]
+    float4 worldPosH = mul(cameraData.invViewProj, float4(ndc.x, ndc.y, 1.0, 1.0)); // Clip to world-space
+    float3 direction = worldPosH.xyz / worldPosH.w - cameraData.position;
+    return skybox.Sample(samplers[1], normalize(direction));
+}
@@ -0,0 +1,211 @@
+#define TILE_SIZE 16 // must match Renderer::LIGHTING_TILE_SIZE
+#define MAX_LIGHTS_PER_TILE 256
+
+#include "gbuffer.hlsli"
+#include "shading.hlsli"
+
+// Camera uniform buffer (set 0)
+struct CameraData
+{
+    float3 position;
+    float4x4 view;
+    float4x4 proj;
+    float4x4 invViewProj;
+    float4 renderExtent; // xy rendered area of the G-buffer in pixels, zw its inverse
+};
+
+[[vk::binding(0, 0)]]
+ConstantBuffer<CameraData> cameraData;
+
+// G-buffer (set 1)
+[[vk::combinedImageSampler]][[vk::binding(0, 1)]]
+Texture2D gBaseColor;
+[[vk::combinedImageSampler]][[vk::binding(0, 1)]]
+SamplerState gBaseColorSampler;
+
+[[vk::combinedImageSampler]][[vk::binding(1, 1)]]
+Texture2D gMaterialInfo;
+[[vk::combinedImageSampler]][[vk::binding(1, 1)]]
+SamplerState gMaterialInfoSampler;
+
+// NOTE: aliases gMaterialInfo in the compact encodings
+[[vk::combinedImageSampler]][[vk::binding(2, 1)]]
+Texture2D gNormal;
+[[vk::combinedImageSampler]][[vk::binding(2, 1)]]
+SamplerState gNormalSampler;
+
+[[vk::combinedImageSampler]][[vk::binding(3, 1)]]
+Texture2D gDepth;
+[[vk::combinedImageSampler]][[vk::binding(3, 1)]]
+SamplerState gDepthSampler;
+
+// Lights (set 2, the clusters aren't used)
+[[vk::binding(0, 2)]]
+StructuredBuffer<LightData> lights;
+
+// Lighting output (set 3)
+[[vk::binding(0, 3)]]
+RWTexture2D<float4> outputImage;
+
+// Sun and its cascaded shadow map (set 4)
+[[vk::binding(0, 4)]]
+ConstantBuffer<SunData> sunData;
+
+[[vk::combinedImageSampler]][[vk::binding(1, 4)]]
+Texture2DArray shadowMap;
+[[vk::combinedImageSampler]][[vk::binding(1, 4)]]
+SamplerComparisonState shadowSampler;
+
+// Image-based lighting precomputed from the skybox (set 5, see EnvironmentMap)
+[[vk::binding(0, 5)]]
+ConstantBuffer<EnvironmentData> environmentData;
+
+[[vk::combinedImageSampler]][[vk::binding(1, 5)]]
+TextureCube specularMap;
+[[vk::combinedImageSampler]][[vk::binding(1, 5)]]
+SamplerState specularMapSampler;
+
+[[vk::combinedImageSampler]][[vk::binding(2, 5)]]
+Texture2D brdfLut;
+[[vk::combinedImageSampler]][[vk::binding(2, 5)]]
+SamplerState brdfLutSampler;
+
+struct LightCountPushConst
+{
+    uint lightCount;
+};
+
+[[vk::push_constant]]
+LightCountPushConst pushConst;
+
+groupshared uint tileMinDepth;
+groupshared uint tileMaxDepth;
+groupshared uint tileLightCount;
+groupshared uint tileLightIndices[MAX_LIGHTS_PER_TILE];
+
+float3 reconstructWorldPosition(float depth, float2 uv)
+{
+    float2 ndc = uv * 2.0 - 1.0; // Convert [0, 1] to [-1, 1]
+    float4 clipPos = float4(ndc.x, ndc.y, depth, 1.0);
+    float4 worldPosH = mul(cameraData.invViewProj, clipPos); // Clip to world-space
+    return (worldPosH.xyz / worldPosH.w); // De-homogenization
+}
+
+// Plane through the camera (view space origin) containing the rays `a` and `b`,
+// oriented so that `inside` is on its positive side
+float3 getSidePlane(float3 a, float3 b, float3 inside)
+{
+    float3 n = normalize(cross(a, b));
+    return dot(n, inside) < 0.0 ? -n : n;
+}
+
+// One group per 16x16 tile:
+// 1. min/max depth of the tile geometry pixels
+// 2. lights culled against the tile frustum (side planes + depth bounds), one light per thread
+// 3. each thread shades its (geometry) pixel with the lights of the tile
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID, uint3 groupId : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    // Rendered area (dynamic resolution), the output image may be larger
+    uint2 extent = uint2(cameraData.renderExtent.xy);
+    bool isInside = all(dispatchId.xy < extent);
+    float2 uv = (float2(dispatchId.xy) + 0.5) * cameraData.renderExtent.zw;
+    int3 pixel = int3(dispatchId.xy, 0);
+    float depth = isInside ? gDepth.Load(pixel).r : 1.0;
+
+    if (groupIndex == 0)
+    {
+        tileMinDepth = 0xFFFFFFFF;
+        tileMaxDepth = 0;
+        tileLightCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Background pixels don't receive any light
+    // NOTE: depths are positive so their bit patterns have the same ordering
+    if (depth < 1.0)
+    {
+        InterlockedMin(tileMinDepth, asuint(depth));
+        InterlockedMax(tileMaxDepth, asuint(depth));
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Tiles without geometry skip the culling
+    if (tileMaxDepth != 0)
+    {
+        float nearDepth = linearizeDepth(asfloat(tileMinDepth), cameraData.proj);
+        float farDepth = linearizeDepth(asfloat(tileMaxDepth), cameraData.proj);
+
+        // Rays through the tile corners (view space, camera looking down -Z)
+        float2 ndcToView = 1.0 / float2(cameraData.proj[0][0], cameraData.proj[1][1]);
+        float2 ndcMin = float2(groupId.xy * TILE_SIZE) / float2(extent) * 2.0 - 1.0;
+        float2 ndcMax = float2(min((groupId.xy + 1) * TILE_SIZE, extent)) / float2(extent) * 2.0 - 1.0;
+        float3 corners[4] = {
+            float3(float2(ndcMin.x, ndcMin.y) * ndcToView, -1.0),
+            float3(float2(ndcMax.x, ndcMin.y) * ndcToView, -1.0),
+            float3(float2(ndcMax.x, ndcMax.y) * ndcToView, -1.0),
+            float3(float2(ndcMin.x, ndcMax.y) * ndcToView, -1.0)
+        };
+        float3 center = float3((ndcMin + ndcMax) * 0.5 * ndcToView, -1.0);
+        float3 planes[4];
+        for (uint p = 0; p < 4; p++)
+            planes[p] = getSidePlane(corners[p], corners[(p + 1) % 4], center);
+
+        for (uint lightIndex = groupIndex; lightIndex < pushConst.lightCount; lightIndex += TILE_SIZE * TILE_SIZE)
+        {
+            float4 positionRange = lights[lightIndex].positionRange;
+            float3 viewPosition = mul(cameraData.view, float4(positionRange.xyz, 1.0)).xyz;
+            float radius = positionRange.w;
+
+            bool isVisible = -viewPosition.z + radius >= nearDepth && -viewPosition.z - radius <= farDepth;
+            for (uint p = 0; p < 4 && isVisible; p++)
+                isVisible = dot(planes[p], viewPosition) >= -radius;
+
+            if (isVisible)
+            {
+                uint slot;
+                InterlockedAdd(tileLightCount, 1, slot);
+                if (slot < MAX_LIGHTS_PER_TILE)
+                    tileLightIndices[slot] = lightIndex;
+            }
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // The background pixels are left untouched, the skybox pass fills them after the blit
+    if (!isInside || depth >= 1.0)
+        return;
+
+    float3 worldPosition = reconstructWorldPosition(depth, uv);
+    float3 v = normalize(cameraData.position - worldPosition);
+
+    float3 baseColor = gBaseColor.Load(pixel).rgb;
+    float4 rawMaterialInfo = gMaterialInfo.Load(pixel);
+    float4 rawNormal = float4(0.0, 0.0, 0.0, 0.0);
+    if (GBUFFER_ENCODING == GBUFFER_ENCODING_STANDARD)
+        rawNormal = gNormal.Load(pixel);
+    SurfaceData surface = decodeSurface(rawMaterialInfo, rawNormal);
+    float3 n = surface.normal;
+
+    // Sun (shadowed)
+    float shadow = 1.0;
+    uint cascade = getShadowCascade(sunData.cascadeSplits, (uint) sunData.direction.w, linearizeDepth(depth, cameraData.proj));
+    if (cascade < (uint) sunData.direction.w)
+    {
+        shadow = getSunShadow(
+            shadowMap, shadowSampler, sunData.cascadeViewProj[cascade], cascade,
+            sunData.cascadeTexelSizes[cascade], sunData.color.w, worldPosition, n
+        );
+    }
+    float3 directLighting = shadow * shade(n, v, -sunData.direction.xyz, sunData.color.rgb, baseColor, surface.roughness, surface.metalness);
+
+    uint lightCount = min(tileLightCount, MAX_LIGHTS_PER_TILE);
+    for (uint i = 0; i < lightCount; i++)
+        directLighting += shadePunctualLight(lights[tileLightIndices[i]], worldPosition, n, v, baseColor, surface.roughness, surface.metalness);
+
+    float3 ambientLighting = shadeAmbient(
+        environmentData, specularMap, specularMapSampler, brdfLut, brdfLutSampler,
+        n, v, baseColor, surface.roughness, surface.metalness
+    );
+    outputImage[dispatchId.xy] = float4(directLighting + ambientLighting, 1.0);
+}
@@ -0,0 +1,46 @@
+struct VertexOutput
+{
+    float4 position : SV_Position;
+    float2 uv : TEXCOORD0;
+};
+
+// Lighting output (set 0), only its top-left part is rendered with dynamic resolution
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+Texture2D lightingOutput;
+[[vk::combinedImageSampler]][[vk::binding(0, 0)]]
+SamplerState lightingOutputSampler; // bilinear
+
+struct UpscalePushConst
+{
+    float2 uvScale;     // rendered area over the lighting output extent
+    float2 texelSize;   // of the lighting output
+    float sharpness;    // 0 -> plain bilinear
+};
+
+[[vk::push_constant]]
+UpscalePushConst pushConst;
+
+// Bilinear upscale, optionally followed by an unsharp mask on the 4 neighbours
+// NOTE: the sharpened color is clamped to the neighbourhood range to avoid halos around edges
+float4 main(VertexOutput inVert) : SV_TARGET0
+{
+    // Clamped so that the filter never reads the texels outside of the rendered area
+    float2 halfTexel = 0.5 * pushConst.texelSize;
+    float2 uv = clamp(inVert.uv * pushConst.uvScale, halfTexel, pushConst.uvScale - halfTexel);
+
+    float3 color = lightingOutput.SampleLevel(lightingOutputSampler, uv, 0).rgb;
+    if (pushConst.sharpness <= 0.0)
+        return float4(color, 1.0);
+
+    float2 maxUv = pushConst.uvScale - halfTexel;
+    float3 left = lightingOutput.SampleLevel(lightingOutputSampler, max(uv - float2(pushConst.texelSize.x, 0.0), halfTexel), 0).rgb;
+    float3 right = lightingOutput.SampleLevel(lightingOutputSampler, min(uv + float2(pushConst.texelSize.x, 0.0), maxUv), 0).rgb;
+    float3 up = lightingOutput.SampleLevel(lightingOutputSampler, max(uv - float2(0.0, pushConst.texelSize.y), halfTexel), 0).rgb;
+    float3 down = lightingOutput.SampleLevel(lightingOutputSampler, min(uv + float2(0.0, pushConst.texelSize.y), maxUv), 0).rgb;
+
+    float3 average = 0.25 * (left + right + up + down);
+    float3 minColor = min(color, min(min(left, right), min(up, down)));
+    float3 maxColor = max(color, max(max(left, right), max(up, down)));
+    float3 sharpened = clamp(color + (color - average) * pushConst.sharpness, minColor, maxColor);
+    return float4(sharpened, 1.0);
+}
@@ -0,0 +1,75 @@
+// Vertex formats (see VertexFormat in Mesh.hpp) and index fetch
+// NOTE: requires gbuffer.hlsli (octahedral decoding)
+
+#define VERTEX_FORMAT_FLOAT 0               // Vertex, 48 bytes
+#define VERTEX_FORMAT_QUANTIZED 1           // QuantizedVertex, 16 bytes
+
+// Format of the vertex input, one pipeline variant per format (see PipelineBuilder::BuildVertexFormatPipelines)
+[[vk::constant_id(1)]] const uint VERTEX_FORMAT = VERTEX_FORMAT_FLOAT;
+
+// Vertex layout (see Vertex in Mesh.hpp, vec3s are 16 bytes aligned)
+#define VERTEX_STRIDE 48
+#define VERTEX_POSITION_OFFSET 0
+#define VERTEX_NORMAL_OFFSET 16
+#define VERTEX_UV_OFFSET 32
+
+// Quantized vertex layout (see QuantizedVertex in Mesh.hpp)
+#define QUANTIZED_VERTEX_STRIDE 16
+#define QUANTIZED_VERTEX_POSITION_OFFSET 0  // 4x unorm16 (w unused)
+#define QUANTIZED_VERTEX_NORMAL_OFFSET 8    // 2x snorm16 octahedral
+#define QUANTIZED_VERTEX_UV_OFFSET 12       // 2x unorm16 in the mesh uv bounds
+
+// Octahedral normal of the quantized formats, `e` in [-1, 1] as read from the snorm attribute
+float3 decodeVertexNormal(float2 e)
+{
+    return decodeOctahedral(e * 0.5 + 0.5);
+}
+
+struct FetchedVertex
+{
+    float3 position;    // before the model matrix, which also dequantizes (see Mesh::GetDequantization)
+    float3 normal;
+    float2 uv;          // before the uv dequantization (see Mesh::GetUvDequantization)
+};
+
+float snorm16ToFloat(uint v)
+{
+    int s = int(v << 16) >> 16; // sign extension
+    return max(float(s) / 32767.0, -1.0);
+}
+
+// Raw fetch of a vertex of any format (the visibility buffer resolve has no vertex input)
+FetchedVertex fetchVertex(uint64_t address, uint index, uint format)
+{
+    FetchedVertex v;
+    if (format == VERTEX_FORMAT_FLOAT)
+    {
+        uint64_t vertexAddress = address + uint64_t(index) * VERTEX_STRIDE;
+        v.position = vk::RawBufferLoad<float3>(vertexAddress + VERTEX_POSITION_OFFSET);
+        v.normal = vk::RawBufferLoad<float3>(vertexAddress + VERTEX_NORMAL_OFFSET);
+        v.uv = vk::RawBufferLoad<float2>(vertexAddress + VERTEX_UV_OFFSET);
+        return v;
+    }
+
+    uint64_t vertexAddress = address + uint64_t(index) * QUANTIZED_VERTEX_STRIDE;
+    uint2 pos = vk::RawBufferLoad<uint2>(vertexAddress + QUANTIZED_VERTEX_POSITION_OFFSET);
+    uint normal = vk::RawBufferLoad<uint>(vertexAddress + QUANTIZED_VERTEX_NORMAL_OFFSET);
+    uint uv = vk::RawBufferLoad<uint>(vertexAddress + QUANTIZED_VERTEX_UV_OFFSET);
+
+    v.position = float3(pos.x & 0xFFFF, pos.x >> 16, pos.y & 0xFFFF) / 65535.0;
+    v.normal = decodeVertexNormal(float2(snorm16ToFloat(normal & 0xFFFF), snorm16ToFloat(normal >> 16)));
+    v.uv = float2(uv & 0xFFFF, uv >> 16) / 65535.0;
+    return v;
+}
+
+// Raw fetch of the index buffer, 16 or 32-bit indices (see Mesh::GetIndexType)
+// NOTE: the 16-bit ones are extracted from the aligned 32-bit word holding them, no 16-bit types needed
+uint fetchIndex(uint64_t address, uint i, uint indexSize)
+{
+    if (indexSize == 4)
+        return vk::RawBufferLoad<uint>(address + uint64_t(i) * 4);
+
+    uint64_t indexAddress = address + uint64_t(i) * 2;
+    uint word = vk::RawBufferLoad<uint>(indexAddress & ~uint64_t(3));
+    return (uint(indexAddress) & 2) != 0 ? word >> 16 : word & 0xFFFF;
+}
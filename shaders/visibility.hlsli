@@ -0,0 +1,17 @@
+// Visibility buffer packing shared by the visibility and resolve passes
+// One R32_UINT per pixel: object index (10 bits) | triangle index (22 bits)
+// NOTE: must match the attachment format in GBuffer.cpp and the limits in Renderer.hpp
+#define VISIBILITY_TRIANGLE_BITS 22
+#define VISIBILITY_TRIANGLE_MASK ((1u << VISIBILITY_TRIANGLE_BITS) - 1u)
+#define VISIBILITY_EMPTY 0xFFFFFFFF // clear value, no geometry
+
+uint packVisibility(uint objectIndex, uint triangleIndex)
+{
+    return (objectIndex << VISIBILITY_TRIANGLE_BITS) | (triangleIndex & VISIBILITY_TRIANGLE_MASK);
+}
+
+void unpackVisibility(uint visibility, out uint objectIndex, out uint triangleIndex)
+{
+    objectIndex = visibility >> VISIBILITY_TRIANGLE_BITS;
+    triangleIndex = visibility & VISIBILITY_TRIANGLE_MASK;
+}
@@ -0,0 +1,13 @@
+#include "visibility.hlsli"
+
+struct VertexOutput
+{
+    float4 position : SV_Position;
+    nointerpolation uint objectIndex : TEXCOORD0;
+};
+
+// SV_PrimitiveID is the index of the triangle within the draw call (counted from its first index)
+uint main(VertexOutput inVert, uint primitiveId : SV_PrimitiveID) : SV_TARGET0
+{
+    return packVisibility(inVert.objectIndex, primitiveId);
+}
@@ -0,0 +1,210 @@
+#define MAX_TEXTURES 30 // must match the one in Renderer.hpp
+#define MAX_SAMPLERS 2
+
+#include "gbuffer.hlsli"
+#include "vertex.hlsli"
+#include "visibility.hlsli"
+
+struct VertexOutput
+{
+    float4 position : SV_Position;
+    float2 uv : TEXCOORD0;
+};
+
+// Camera uniform buffer (set 0)
+struct CameraData
+{
+    float3 position;
+    float4x4 view;
+    float4x4 proj;
+    float4x4 invViewProj;
+    float4 renderExtent; // xy rendered area of the G-buffer in pixels, zw its inverse
+};
+
+[[vk::binding(0, 0)]]
+ConstantBuffer<CameraData> cameraData;
+
+// Per-object data (set 1)
+struct ObjectData
+{
+    float4x4 model;
+    float3x3 normal;
+    uint64_t vertexAddress;
+    uint64_t indexAddress;
+    uint materialIndex;
+    uint vertexFormat; // see vertex.hlsli
+    uint indexSize;    // 2 or 4 bytes
+    uint firstIndex;   // of the selected LOD
+    uint64_t culledIndexAddress; // meshlet culling output (32-bit indices), 0 if not culled per meshlet
+    uint culledFirstIndex;
+    float4 uvDequantization; // offset (xy) and scale (zw) of the quantized uvs
+};
+
+[[vk::binding(0, 1)]]
+StructuredBuffer<ObjectData> objectBuffer;
+
+// Material data (set 2)
+struct MaterialData
+{
+    float3       baseColor;
+    float4    materialInfo;
+    
+    uint      baseColorTex;   // index to address textures[]
+    uint   materialInfoTex;   // index to address textures[]  
+};
+
+[[vk::binding(0, 2)]]
+StructuredBuffer<MaterialData> materialBuffer;
+
+// Textures and samplers (set 3)
+[[vk::binding(0, 3)]]
+SamplerState samplers[MAX_SAMPLERS]; // NOTE: currently always defaulting to samplers[0]
+
+[[vk::binding(1, 3)]]
+Texture2D textures[MAX_TEXTURES];
+
+// Visibility buffer (set 4)
+[[vk::combinedImageSampler]][[vk::binding(0, 4)]]
+Texture2D<uint> gVisibility;
+[[vk::combinedImageSampler]][[vk::binding(0, 4)]]
+SamplerState gVisibilitySampler;
+
+struct FragmentOutput 
+{
+	float4 baseColor : SV_TARGET0;
+    float4 materialInfo : SV_TARGET1; // packed normal and material info in the compact encodings
+	float4 normal : SV_TARGET2;       // standard encoding only
+};
+
+// Perspective-correct barycentrics of the pixel and their screen-space derivatives
+struct BarycentricDeriv
+{
+    float3 lambda;
+    float3 ddx;
+    float3 ddy;
+};
+
+/**
+ *  Analytic barycentrics from the clip-space vertices of the triangle
+ *
+ *  REFERENCE: Schied and Dachsbacher, "Deferred Attribute Interpolation for
+ *  Memory-Efficient Deferred Shading", HPG 2015
+**/
+BarycentricDeriv computeBarycentrics(float4 pt0, float4 pt1, float4 pt2, float2 pixelNdc, float2 screenSize)
+{
+    BarycentricDeriv result;
+
+    float3 invW = 1.0 / float3(pt0.w, pt1.w, pt2.w);
+
+    float2 ndc0 = pt0.xy * invW.x;
+    float2 ndc1 = pt1.xy * invW.y;
+    float2 ndc2 = pt2.xy * invW.z;
+
+    float invDet = 1.0 / determinant(float2x2(ndc2 - ndc1, ndc0 - ndc1));
+    result.ddx = float3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+    result.ddy = float3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+    float ddxSum = dot(result.ddx, float3(1.0, 1.0, 1.0));
+    float ddySum = dot(result.ddy, float3(1.0, 1.0, 1.0));
+
+    float2 deltaVec = pixelNdc - ndc0;
+    float interpInvW = invW.x + deltaVec.x * ddxSum + deltaVec.y * ddySum;
+    float interpW = 1.0 / interpInvW;
+
+    result.lambda.x = interpW * (invW.x + deltaVec.x * result.ddx.x + deltaVec.y * result.ddy.x);
+    result.lambda.y = interpW * (deltaVec.x * result.ddx.y + deltaVec.y * result.ddy.y);
+    result.lambda.z = interpW * (deltaVec.x * result.ddx.z + deltaVec.y * result.ddy.z);
+
+    // NDC -> pixels (Vulkan NDC y already points down like the framebuffer)
+    result.ddx *= 2.0 / screenSize.x;
+    result.ddy *= 2.0 / screenSize.y;
+    ddxSum *= 2.0 / screenSize.x;
+    ddySum *= 2.0 / screenSize.y;
+
+    float interpWddx = 1.0 / (interpInvW + ddxSum);
+    float interpWddy = 1.0 / (interpInvW + ddySum);
+    result.ddx = interpWddx * (result.lambda * interpInvW + result.ddx) - result.lambda;
+    result.ddy = interpWddy * (result.lambda * interpInvW + result.ddy) - result.lambda;
+
+    return result;
+}
+
+float3 interpolate(float3 lambda, float3 v0, float3 v1, float3 v2)
+{
+    return lambda.x * v0 + lambda.y * v1 + lambda.z * v2;
+}
+
+float2 interpolate(float3 lambda, float2 v0, float2 v1, float2 v2)
+{
+    return lambda.x * v0 + lambda.y * v1 + lambda.z * v2;
+}
+
+FragmentOutput main(VertexOutput inVert)
+{
+    FragmentOutput output;
+
+    uint2 pixel = uint2(inVert.position.xy);
+    uint visibility = gVisibility.Load(int3(pixel, 0));
+    if (visibility == VISIBILITY_EMPTY)
+        discard; // background, the lighting pass only looks at the depth
+
+    uint objectIndex, triangleIndex;
+    unpackVisibility(visibility, objectIndex, triangleIndex);
+    ObjectData object = objectBuffer[objectIndex];
+
+    // Vertex fetch
+    float4x4 viewProj = mul(cameraData.proj, cameraData.view);
+    float4 clipPositions[3];
+    float3 normals[3];
+    float2 uvs[3];
+    // The primitive IDs restart at the first index of the draw (LOD or meshlet culling output)
+    uint64_t indexAddress = object.indexAddress;
+    uint firstIndex = object.firstIndex;
+    uint indexSize = object.indexSize;
+    if (object.culledIndexAddress != 0)
+    {
+        indexAddress = object.culledIndexAddress;
+        firstIndex = object.culledFirstIndex;
+        indexSize = 4;
+    }
+    for (uint i = 0; i < 3; i++)
+    {
+        uint index = fetchIndex(indexAddress, firstIndex + triangleIndex * 3 + i, indexSize);
+        FetchedVertex v = fetchVertex(object.vertexAddress, index, object.vertexFormat);
+
+        clipPositions[i] = mul(viewProj, mul(object.model, float4(v.position, 1.0)));
+        normals[i] = v.normal;
+        uvs[i] = v.uv * object.uvDequantization.zw + object.uvDequantization.xy;
+    }
+
+    // Attributes interpolation
+    // Rendered area, the visibility attachment may be larger (dynamic resolution)
+    float2 screenSize = cameraData.renderExtent.xy;
+    float2 pixelNdc = (float2(pixel) + 0.5) / screenSize * 2.0 - 1.0;
+    BarycentricDeriv bary = computeBarycentrics(clipPositions[0], clipPositions[1], clipPositions[2], pixelNdc, screenSize);
+
+    float3 normal = normalize(mul(object.normal, interpolate(bary.lambda, normals[0], normals[1], normals[2])));
+    float2 uv = interpolate(bary.lambda, uvs[0], uvs[1], uvs[2]);
+    float2 uvDdx = interpolate(bary.ddx, uvs[0], uvs[1], uvs[2]);
+    float2 uvDdy = interpolate(bary.ddy, uvs[0], uvs[1], uvs[2]);
+
+    // Material evaluation (once per pixel, explicit gradients since there are no quads to derive them from)
+    MaterialData m = materialBuffer[object.materialIndex];
+
+    // Base Color
+    if (m.baseColorTex != -1)
+        output.baseColor = textures[m.baseColorTex].SampleGrad(samplers[0], uv, uvDdx, uvDdy);
+    else
+        output.baseColor = float4(m.baseColor, 1.0);
+
+    // Material Info
+    float4 materialInfo;
+    if (m.materialInfoTex != -1)
+        materialInfo = textures[m.materialInfoTex].SampleGrad(samplers[0], uv, uvDdx, uvDdy);
+    else
+        materialInfo = m.materialInfo;
+
+    // Normal and material info (see gbuffer.hlsli)
+    encodeSurface(normal, materialInfo, output.materialInfo, output.normal);
+
+    return output;
+}
@@ -9,6 +9,7 @@
 #include "Input.hpp"
 
 #include <GLFW/glfw3.h>
+#include <thread>
 #include <imgui.h>
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_vulkan.h>
@@ -31,6 +32,11 @@ namespace Felina
 		glfwSetWindowUserPointer(m_window->GetHandle(), this);
 		glfwSetFramebufferSizeCallback(m_window->GetHandle(), Application::FramebufferResizeCallback);
 		glfwSetScrollCallback(m_window->GetHandle(), Application::ScrollCallback);
+		glfwSetCursorPosCallback(m_window->GetHandle(), Application::CursorPosCallback);
+		glfwSetMouseButtonCallback(m_window->GetHandle(), Application::MouseButtonCallback);
+		glfwSetKeyCallback(m_window->GetHandle(), Application::KeyCallback);
+		glfwSetCharCallback(m_window->GetHandle(), Application::CharCallback);
+		glfwSetWindowRefreshCallback(m_window->GetHandle(), Application::WindowRefreshCallback);
 
 		m_input = std::make_unique<Input>();
 		m_UI = std::make_unique<UI>();
@@ -38,8 +44,18 @@ namespace Felina
 		m_renderer = std::make_unique<Renderer>(*this, *m_window, *m_scene);
 
 		InitImGui();
+
+		LOG("[Application] Loading skybox...");
+		m_renderer->LoadSkybox(SKYBOX_DIR);
+		LOG("[Application] Skybox loaded successfully!");
 		LoadScene();
 
+		if (m_isBenchmarkMode)
+		{
+			LOG("[Application] Benchmark mode enabled, mouse events will be traced.");
+			m_renderer->EnableLatencyTrace();
+		}
+
 		LOG("[Application] Done.");
 	}
 
@@ -47,13 +63,31 @@ namespace Felina
 	{
 		// MAIN LOOP
 		while (!m_window->ShouldClose()) {
-			glfwPollEvents();
+			// When rendering on demand and nothing invalidated the last frame,
+			// block until an event arrives instead of spinning at the present rate
+			bool isIdle = m_isOnDemandRendering && m_pendingRedraws == 0;
+			if (isIdle)
+				glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+			else
+				glfwPollEvents();
+
+			// The callbacks invoked while processing the events may have requested a redraw
+			if (m_isOnDemandRendering && m_pendingRedraws == 0)
+				continue;
+
 			Update();
 			m_renderer->DrawFrame();
+			LimitFrameRate();
+
+			if (m_pendingRedraws > 0)
+				--m_pendingRedraws;
 		}
 
 		LOG("[Application] Waiting for pending GPU operations to finish...");
 		m_renderer->WaitIdle();
+
+		if (m_isBenchmarkMode)
+			m_renderer->SaveLatencyTrace(LATENCY_TRACE_FILE);
 	}
 
 	void Application::CleanUp()
@@ -95,6 +129,7 @@ namespace Felina
 
 		// Signal the renderer
 		app->SignalFramebufferResized();
+		app->RequestRedraw();
 	}
 
 	// For a classic vertical mouse-wheel xOffset should be ignored 
@@ -104,6 +139,56 @@ namespace Felina
 		assert(app != nullptr && "[Application] glfwGetWindowUserPointer hasn't been set.");
 
 		app->GetInput().SetMouseScroll(0.35f * yOffset); // WIP
+		app->GetInput().OnMouseEvent();
+		app->RequestRedraw();
+	}
+
+	void Application::CursorPosCallback(GLFWwindow* window, double xPos, double yPos)
+	{
+		Application* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+		assert(app != nullptr && "[Application] glfwGetWindowUserPointer hasn't been set.");
+
+		// Only camera-driving motions are timestamped (see Application::LatchCamera)
+		GLFWwindow* win = app->GetWindow().GetHandle();
+		if (glfwGetMouseButton(win, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS || glfwGetMouseButton(win, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
+			app->GetInput().OnMouseEvent();
+
+		// Any motion may change the UI hover state
+		app->RequestRedraw();
+	}
+
+	void Application::MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+	{
+		Application* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+		assert(app != nullptr && "[Application] glfwGetWindowUserPointer hasn't been set.");
+
+		app->GetInput().OnMouseEvent();
+		app->RequestRedraw();
+	}
+
+	void Application::KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+	{
+		Application* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+		assert(app != nullptr && "[Application] glfwGetWindowUserPointer hasn't been set.");
+
+		app->RequestRedraw();
+	}
+
+	void Application::CharCallback(GLFWwindow* window, unsigned int codepoint)
+	{
+		Application* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+		assert(app != nullptr && "[Application] glfwGetWindowUserPointer hasn't been set.");
+
+		app->RequestRedraw();
+	}
+
+	// Called when the window content is damaged (e.g. uncovered by another window)
+	void Application::WindowRefreshCallback(GLFWwindow* window)
+	{
+		Application* app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(window));
+		assert(app != nullptr && "[Application] glfwGetWindowUserPointer hasn't been set.");
+
+		app->RequestRedraw();
 	}
 
 	void Application::InitGlfw() 
@@ -125,35 +210,38 @@ namespace Felina
 		ImGui_ImplVulkan_Init(&vkInitInfo);
 	}
 
-	void Application::LoadScene(const std::filesystem::path& filepath)
+	void Application::LoadScene(const std::filesystem::path& filepath, const GltfLoadOptions& options)
 	{	
 		// Wait for GPU operations to finish
 		m_renderer->WaitIdle();
 
-		// Unload previous resources (if a scene was already loaded)
+		// Release the previous resources (if a scene was already loaded) to the cache of the
+		// ResourceManager: the ones the new scene shares with it are reused instead of uploaded again
 		m_scene->ClearObjects();
-		ResourceManager::GetInstance().UnloadAll();
-
-		// TODO: I can avoid reloading the skybox each time I reload the scene
-		LOG("[Application] Loading skybox...");
-		m_renderer->LoadSkybox(SKYBOX_DIR);
-		LOG("[Application] Skybox loaded successfully!");
+		m_scene->ClearLights();
+		m_scene->ClearResources();
+		auto& rm = ResourceManager::GetInstance();
+		rm.BeginSceneLoad();
 
 		LOG("[Application] Loading scene from " + filepath.string() + "...");
 		
-		LoadSceneFromGlTF(filepath, *m_scene, *m_renderer);
+		LoadSceneFromGlTF(filepath, *m_scene, *m_renderer, options);
+		rm.EndSceneLoad();
 		// TODO: include camera in the glTF
 		m_scene->GetCamera().SetPosition(glm::vec3(0.0f, -6.0f, 3.0f));
 
 		// Binding the descriptors to the new textures
 		m_renderer->UpdateDescriptorSets();
+		RequestRedraw();
 		
 		LOG("[Application] Scene loaded successfully!");
 	}
 
-	void Application::Update()
+	std::optional<std::chrono::steady_clock::time_point> Application::LatchCamera()
 	{
 		// Update user input
+		// NOTE: glfwGetCursorPos queries the current cursor position, so the
+		// delta includes any motion that happened while the frame was being recorded
 		m_input->Update(*m_window);
 
 		// Camera control
@@ -177,6 +265,45 @@ namespace Felina
 				camera.Dolly(mouseScroll);
 		}
 
+		return m_input->ConsumeMouseEventTime();
+	}
+
+	// Sleep until the next frame slot when a frame rate limit is set
+	// NOTE: the sleep happens before input is polled again so it doesn't add input latency
+	void Application::LimitFrameRate()
+	{
+		using Clock = std::chrono::steady_clock;
+
+		if (m_frameRateLimit == 0)
+		{
+			m_nextFrameTime = Clock::now();
+			return;
+		}
+
+		auto frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_frameRateLimit));
+		m_nextFrameTime += frameDuration;
+
+		// Running late (or the limiter has just been enabled), don't try to catch up
+		auto now = Clock::now();
+		if (m_nextFrameTime < now)
+		{
+			m_nextFrameTime = now;
+			return;
+		}
+
+		// Coarse sleep followed by a short spin, since OS sleep granularity can exceed 1 ms
+		constexpr auto spinThreshold = std::chrono::milliseconds(1);
+		if (m_nextFrameTime - now > spinThreshold)
+			std::this_thread::sleep_until(m_nextFrameTime - spinThreshold);
+		while (Clock::now() < m_nextFrameTime)
+			std::this_thread::yield();
+	}
+
+	void Application::Update()
+	{
+		// NOTE: camera control is not handled here but late-latched
+		// by the renderer right before submission (see LatchCamera)
+
 		// Update UI
 		m_UI->Update(*m_scene, *this);
 	}
@@ -2,8 +2,11 @@
 
 #include <memory>
 #include <utility>
+#include <chrono>
+#include <optional>
 
 #include "Common.hpp"
+#include "GltfLoader.hpp"
 
 struct GLFWwindow;
 
@@ -26,26 +29,61 @@ namespace Felina
 			void Run();
 			void CleanUp();
 
-			void LoadScene(const std::filesystem::path& filepath = DEFAULT_SCENE);
+			void LoadScene(const std::filesystem::path& filepath = DEFAULT_SCENE, const GltfLoadOptions& options = {});
+
+			// Late latching: called by the renderer right before queue submission,
+			// so that the camera reflects the most recent mouse state
+			std::optional<std::chrono::steady_clock::time_point> LatchCamera();
+
+			inline void SetBenchmarkMode(bool enabled) { m_isBenchmarkMode = enabled; }
+			inline bool IsBenchmarkMode() const { return m_isBenchmarkMode; }
+
+			// On-demand rendering: when enabled the main loop sleeps until an event
+			// (input, UI interaction, resize, scene load) invalidates the frame
+			inline void SetOnDemandRendering(bool enabled) { m_isOnDemandRendering = enabled; RequestRedraw(); }
+			inline bool IsOnDemandRendering() const { return m_isOnDemandRendering; }
+			inline void RequestRedraw() { m_pendingRedraws = REDRAW_FRAME_COUNT; }
+
+			// CPU-side frame limiter (0 means unlimited)
+			inline void SetFrameRateLimit(uint32_t fps) { m_frameRateLimit = fps; }
+			inline uint32_t GetFrameRateLimit() const { return m_frameRateLimit; }
 
 			const std::string& GetName() const { return m_name; }
 			inline Window& GetWindow() { return *m_window; }
 			inline Input& GetInput() { return *m_input; }
 			inline Scene& GetScene() { return *m_scene; }
+			inline Renderer& GetRenderer() { return *m_renderer; }
 			
 			// NOTE: it "consumes" the value when called (see Renderer.cpp)
 			inline bool IsFramebufferResized() { return std::exchange(m_isFramebufferResized, false); }
 			inline void SignalFramebufferResized() { m_isFramebufferResized = true; }
 
 		private:
+			// Number of frames drawn after an invalidation, Dear ImGui needs
+			// a couple of frames to settle (hover states, window layout, etc.)
+			static constexpr uint32_t REDRAW_FRAME_COUNT = 3;
+			// Upper bound for the time spent blocked waiting for events (in seconds)
+			static constexpr double IDLE_WAIT_TIMEOUT = 0.25;
+
 			static void FramebufferResizeCallback(GLFWwindow* window, int width, int height);
 			static void ScrollCallback(GLFWwindow* window, double xOffset, double yOffset);
+			static void CursorPosCallback(GLFWwindow* window, double xPos, double yPos);
+			static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+			static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+			static void CharCallback(GLFWwindow* window, unsigned int codepoint);
+			static void WindowRefreshCallback(GLFWwindow* window);
 
 			void InitGlfw();
 			void InitImGui();
 			void Update();
+			void LimitFrameRate();
 
 			bool m_isFramebufferResized{ false };
+			bool m_isBenchmarkMode{ false };
+			bool m_isOnDemandRendering{ false };
+			uint32_t m_pendingRedraws{ REDRAW_FRAME_COUNT };
+			uint32_t m_frameRateLimit{ 0 };
+			std::chrono::steady_clock::time_point m_nextFrameTime{};
 
 			std::unique_ptr<Window> m_window = nullptr;
 			std::unique_ptr<Input> m_input = nullptr;
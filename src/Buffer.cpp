@@ -46,4 +46,21 @@ namespace Felina
 			vmaUnmapMemory(m_allocator, m_allocation);
 		}
 	}
+
+	void Buffer::ReadData(void* data, const size_t size) const
+	{
+		// Written by the device: the memory may not be host-coherent
+		vmaInvalidateAllocation(m_allocator, m_allocation, 0, size);
+		if (m_isPersistent)
+		{
+			memcpy(data, m_persistentMappedMemory, size);
+		}
+		else
+		{
+			void* mappedMemory = nullptr;
+			vmaMapMemory(m_allocator, m_allocation, &mappedMemory);
+			memcpy(data, mappedMemory, size);
+			vmaUnmapMemory(m_allocator, m_allocation);
+		}
+	}
 }
\ No newline at end of file
@@ -16,6 +16,8 @@ namespace Felina
 			~Buffer();
 
 			void LoadData(const void* data, const size_t size);
+			// Host-visible buffers only (e.g. GPU read-backs)
+			void ReadData(void* data, const size_t size) const;
 			const vk::Buffer& GetHandle() const { return m_buffer; };
 
 		private:
@@ -24,6 +24,8 @@ namespace Felina
 
 			inline glm::vec3 GetPosition() const { return m_position; }
 			inline glm::vec3 GetTarget() const { return m_target; }
+			inline float GetNearPlane() const { return m_near; }
+			inline float GetFarPlane() const { return m_far; }
 
 			glm::mat4 GetProjectionMatrix() const;
 			glm::mat4 GetViewMatrix() const;
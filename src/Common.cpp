@@ -1,6 +1,7 @@
 #include "Common.hpp"
 
 #include <fstream>
+#include <cstring>
 
 namespace Felina
 {
@@ -19,4 +20,28 @@ namespace Felina
 
         return buffer;
     }
+
+    uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed ^ (size * 0x9E3779B97F4A7C15ull);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 32;
+        }
+        for (; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull; // FNV-1a for the tail
+
+        // Final avalanche (MurmurHash3 fmix64)
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 33;
+        return hash;
+    }
 }
\ No newline at end of file
@@ -16,8 +16,14 @@ namespace Felina
 	const std::filesystem::path DEFAULT_SCENE{ "./assets/complex_hierarchy.glb" };
 	const std::filesystem::path SKYBOX_DIR{ "./assets/skybox/" };
 	const std::filesystem::path ASSETS_DIR{ "./assets/" };
+	const std::filesystem::path LATENCY_TRACE_FILE{ "./latency_trace.csv" };
+	const std::filesystem::path IBL_CACHE_DIR{ "./cache/ibl/" }; // see EnvironmentMap
 
 	// NOTE: originally designed to read SPIR-V file, so it
 	// may need adjustments reading other file formats is required
 	std::vector<char> ReadFile(const std::string& filepath);
+
+	// Fast non-cryptographic 64-bit hash of raw bytes (8 bytes per step), chained through `seed`
+	// NOTE: for content comparisons only (see ResourceManager), padding bytes must not be hashed
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
 }
\ No newline at end of file
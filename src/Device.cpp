@@ -129,6 +129,32 @@ namespace Felina
         m_graphicsQueue.waitIdle();
     }
 
+    void Device::ImmediateSubmit(const std::function<void(const vk::raii::CommandBuffer&)>& record) const
+    {
+        // Short-lived command buffer allocation
+        vk::CommandBufferAllocateInfo allocInfo
+        {
+            .commandPool = m_immediateCommandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+        vk::raii::CommandBuffer cmdBuffer = std::move(m_device.allocateCommandBuffers(allocInfo).front());
+
+        cmdBuffer.begin(vk::CommandBufferBeginInfo{ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        record(cmdBuffer);
+        cmdBuffer.end();
+
+        // Submit to queue and wait for completion
+        m_graphicsQueue.submit(
+            vk::SubmitInfo{
+            .commandBufferCount = 1,
+            .pCommandBuffers = &*cmdBuffer
+            },
+            nullptr
+        );
+        m_graphicsQueue.waitIdle();
+    }
+
     void Device::SelectPhysicalDevice(vk::raii::Instance& instance, const vk::raii::SurfaceKHR& surface)
     {
         for (const auto& physicalDevice : vk::raii::PhysicalDevices(instance))
@@ -208,15 +234,35 @@ namespace Felina
             queueCreateInfos.push_back(deviceQueueCreateInfo);
         }
 
+        // Optional features
+        // 64-bit integers for the buffer addresses read by the shaders (meshlet culling, visibility buffer resolve)
+        auto supportedFeatures = m_physicalDevice.getFeatures2().features;
+        m_supportsShaderInt64 = supportedFeatures.shaderInt64;
+        // The visibility buffer resolve fetches vertices through 64-bit buffer addresses
+        // and the visibility pass reads SV_PrimitiveID in the fragment shader
+        m_supportsVisibilityBuffer = m_supportsShaderInt64 && supportedFeatures.geometryShader;
+        // Exact sample counts are needed to measure the overdraw (depth pre-pass heuristic)
+        m_supportsPreciseOcclusionQueries = supportedFeatures.occlusionQueryPrecise;
+        // GPU frame time (dynamic resolution), the graphics queue must support timestamps
+        auto queueFamilies = m_physicalDevice.getQueueFamilyProperties();
+        if (queueFamilies[m_graphicsQueueFamilyIndex].timestampValidBits > 0)
+            m_timestampPeriod = m_physicalDevice.getProperties().limits.timestampPeriod;
+
         // Create a chain of feature structures to enable multiple new FEATURES (on top of those of Vulkan 1.0) all at once
         vk::StructureChain<
             vk::PhysicalDeviceFeatures2,
+            vk::PhysicalDeviceVulkan12Features,
             vk::PhysicalDeviceVulkan13Features,
             vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT,
             vk::PhysicalDeviceRobustness2FeaturesKHR
         > // To be able to change dinamically some pipeline properties
             featureChain = {
-                {},
+                {.features = {
+                    .geometryShader = m_supportsVisibilityBuffer,
+                    .occlusionQueryPrecise = m_supportsPreciseOcclusionQueries,
+                    .shaderInt64 = m_supportsShaderInt64
+                }},
+                {.bufferDeviceAddress = true}, // core since Vulkan 1.3
                 {.synchronization2 = true, .dynamicRendering = true},
                 {.extendedDynamicState = true},
                 { .nullDescriptor = true }
@@ -268,6 +314,7 @@ namespace Felina
     {
         VmaAllocatorCreateInfo allocatorCreateInfo
         {
+            .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT, // see Mesh::Load
             .physicalDevice = *m_physicalDevice,
             .device = *m_device,
             .instance = *instance,
@@ -3,6 +3,8 @@
 #include <vulkan/vulkan_raii.hpp>
 #include <vk_mem_alloc.h>
 
+#include <functional>
+
 namespace Felina
 {
 	class Buffer;
@@ -16,6 +18,8 @@ namespace Felina
 
 			void CopyBuffer(const Buffer& srcBuffer, const Buffer& dstBuffer, vk::DeviceSize size);
 			void CopyBufferToImage(const Buffer& src, const Texture& dst, vk::DeviceSize size);
+			// Records the commands in a short-lived command buffer, submits it and waits for completion
+			void ImmediateSubmit(const std::function<void(const vk::raii::CommandBuffer&)>& record) const;
 
 			const vk::raii::Device& GetDevice() const { return m_device; }
 			const vk::raii::PhysicalDevice& GetPhysicalDevice() const { return m_physicalDevice; }
@@ -24,6 +28,12 @@ namespace Felina
 			uint32_t GetGraphicsQueueFamilyIndex() const { return m_graphicsQueueFamilyIndex; }
 			const vk::raii::Queue& GetPresentQueue() const { return m_presentQueue; }
 			uint32_t GetPresentQueueFamilyIndex() const { return m_presentQueueFamilyIndex; }
+			bool IsShaderInt64Supported() const { return m_supportsShaderInt64; }
+			bool IsVisibilityBufferSupported() const { return m_supportsVisibilityBuffer; }
+			bool IsPreciseOcclusionQuerySupported() const { return m_supportsPreciseOcclusionQueries; }
+			bool IsTimestampQuerySupported() const { return m_timestampPeriod > 0.0f; }
+			// Nanoseconds per timestamp tick
+			float GetTimestampPeriod() const { return m_timestampPeriod; }
 
 		private:
 			void SelectPhysicalDevice(vk::raii::Instance& instance, const vk::raii::SurfaceKHR& surface);
@@ -42,5 +52,10 @@ namespace Felina
 			uint32_t m_presentQueueFamilyIndex;
 
 			vk::raii::CommandPool m_immediateCommandPool = nullptr;
+
+			bool m_supportsShaderInt64 = false;
+			bool m_supportsVisibilityBuffer = false;
+			bool m_supportsPreciseOcclusionQueries = false;
+			float m_timestampPeriod = 0.0f; // 0 if timestamps aren't supported
 	};
 }
\ No newline at end of file
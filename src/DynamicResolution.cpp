@@ -0,0 +1,37 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Felina
+{
+	// The frame time is assumed to grow with the pixel count (scale squared): the fixed costs
+	// (shadows, culling) make the estimate pessimistic at low scales, the feedback corrects it
+	void DynamicResolution::Update(float gpuTime, float scale)
+	{
+		if (gpuTime <= 0.0f || scale <= 0.0f)
+			return;
+
+		m_gpuTime = gpuTime;
+		float fullResolutionTime = gpuTime / (scale * scale);
+		m_fullResolutionTime = m_fullResolutionTime == 0.0f
+			? fullResolutionTime
+			: m_fullResolutionTime + SMOOTHING * (fullResolutionTime - m_fullResolutionTime);
+
+		float desiredScale = std::sqrt(m_targetFrameTime * HEADROOM / m_fullResolutionTime);
+		desiredScale = std::clamp(std::floor(desiredScale / SCALE_STEP) * SCALE_STEP, MIN_SCALE, MAX_SCALE);
+
+		// Over budget: drops right away, under budget: grows one step per frame
+		if (desiredScale < m_scale)
+			m_scale = desiredScale;
+		else if (desiredScale > m_scale)
+			m_scale = std::min(m_scale + SCALE_STEP, desiredScale);
+	}
+
+	void DynamicResolution::Reset()
+	{
+		m_scale = MAX_SCALE;
+		m_gpuTime = 0.0f;
+		m_fullResolutionTime = 0.0f;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Felina
+{
+	// Picks the render scale (fraction of the swapchain extent on each axis) from the
+	// measured GPU frame time, so that it stays under the target frame time
+	// NOTE: the measured frames are MAX_FRAMES_IN_FLIGHT frames old, the cost is
+	// normalized to the full resolution so that the scale they used doesn't matter
+	class DynamicResolution
+	{
+		public:
+			static constexpr float MIN_SCALE = 0.5f;
+			static constexpr float MAX_SCALE = 1.0f;
+			// The scale moves by whole steps, the extent doesn't change by a few pixels every frame
+			static constexpr float SCALE_STEP = 1.0f / 32.0f;
+			// Fraction of the target aimed at, leaves room for the frame time noise
+			static constexpr float HEADROOM = 0.9f;
+			// Weight of the newest sample in the smoothed cost
+			static constexpr float SMOOTHING = 0.1f;
+
+			DynamicResolution() = default;
+
+			// `gpuTime` (milliseconds) was measured on a frame rendered at `scale`
+			void Update(float gpuTime, float scale);
+			// Back to the full resolution, the history is discarded
+			void Reset();
+
+			void SetTargetFrameTime(float targetFrameTime) { m_targetFrameTime = targetFrameTime; }
+			float GetTargetFrameTime() const { return m_targetFrameTime; }
+			float GetScale() const { return m_scale; }
+			// Last measured GPU frame time (milliseconds)
+			float GetGpuTime() const { return m_gpuTime; }
+
+		private:
+			float m_targetFrameTime = 1000.0f / 60.0f;
+			float m_scale = MAX_SCALE;
+			float m_gpuTime = 0.0f;
+			// Smoothed GPU time of a frame at full resolution (0 until the first sample)
+			float m_fullResolutionTime = 0.0f;
+	};
+}
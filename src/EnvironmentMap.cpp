@@ -0,0 +1,585 @@
+#include "EnvironmentMap.hpp"
+
+#include "Device.hpp"
+#include "Texture.hpp"
+#include "Buffer.hpp"
+#include "PipelineBuilder.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace Felina
+{
+	// Cache file layout: header, SH coefficients, specular mips, BRDF LUT
+	struct IBLCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t skyboxHash;
+		uint32_t specularSize;
+		uint32_t specularMipCount;
+		uint32_t brdfLutSize;
+		uint32_t padding;
+		uint64_t specularDataSize;
+		uint64_t brdfLutDataSize;
+	};
+	constexpr uint32_t IBL_CACHE_MAGIC = 0x4C424946; // "FIBL"
+
+	constexpr size_t SPECULAR_TEXEL_SIZE = 8; // RGBA16F
+	constexpr size_t BRDF_LUT_TEXEL_SIZE = 4; // RG16F
+
+	EnvironmentMap::EnvironmentMap(const Device& device, const Texture& skybox, uint64_t skyboxHash)
+		: m_skyboxHash(skyboxHash)
+	{
+		PrecomputedData data;
+		m_isLoadedFromCache = LoadCache(data);
+		if (m_isLoadedFromCache)
+		{
+			LOG("[EnvironmentMap] Loaded from " + GetCachePath().string());
+		}
+		else
+		{
+			auto start = std::chrono::steady_clock::now();
+			data = Generate(device, skybox);
+			auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			LOG("[EnvironmentMap] Precomputed in " + std::to_string(elapsed) + " ms");
+			SaveCache(data);
+		}
+
+		Upload(device, data);
+		CreateSampler(device);
+	}
+
+	EnvironmentMap::~EnvironmentMap()
+	{
+		m_specularMap.reset();
+		m_brdfLut.reset();
+		m_uniformBuffer.reset();
+	}
+
+	size_t EnvironmentMap::GetSpecularDataSize()
+	{
+		size_t size = 0;
+		for (uint32_t mip = 0; mip < SPECULAR_MIP_COUNT; mip++)
+		{
+			size_t mipSize = SPECULAR_SIZE >> mip;
+			size += mipSize * mipSize * 6 * SPECULAR_TEXEL_SIZE;
+		}
+		return size;
+	}
+
+	std::filesystem::path EnvironmentMap::GetCachePath() const
+	{
+		std::ostringstream name;
+		name << std::hex << std::setw(16) << std::setfill('0') << m_skyboxHash << ".ibl";
+		return IBL_CACHE_DIR / name.str();
+	}
+
+	// Any mismatch (missing file, older version, other settings) is a cache miss
+	bool EnvironmentMap::LoadCache(PrecomputedData& data) const
+	{
+		std::ifstream file(GetCachePath(), std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		IBLCacheHeader header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		bool isValid = file.good()
+			&& header.magic == IBL_CACHE_MAGIC
+			&& header.version == CACHE_VERSION
+			&& header.skyboxHash == m_skyboxHash
+			&& header.specularSize == SPECULAR_SIZE
+			&& header.specularMipCount == SPECULAR_MIP_COUNT
+			&& header.brdfLutSize == BRDF_LUT_SIZE
+			&& header.specularDataSize == GetSpecularDataSize()
+			&& header.brdfLutDataSize == BRDF_LUT_SIZE * BRDF_LUT_SIZE * BRDF_LUT_TEXEL_SIZE;
+		if (!isValid)
+		{
+			LOG("[EnvironmentMap] Ignoring outdated cache " + GetCachePath().string());
+			return false;
+		}
+
+		data.specular.resize(header.specularDataSize);
+		data.brdfLut.resize(header.brdfLutDataSize);
+		file.read(reinterpret_cast<char*>(data.irradianceSH.data()), sizeof(data.irradianceSH));
+		file.read(reinterpret_cast<char*>(data.specular.data()), static_cast<std::streamsize>(data.specular.size()));
+		file.read(reinterpret_cast<char*>(data.brdfLut.data()), static_cast<std::streamsize>(data.brdfLut.size()));
+		return file.good();
+	}
+
+	// NOTE: failing to write the cache isn't fatal, the data is simply generated again next time
+	void EnvironmentMap::SaveCache(const PrecomputedData& data) const
+	{
+		std::error_code error;
+		std::filesystem::create_directories(IBL_CACHE_DIR, error);
+
+		// Written to a temporary file first so that an interrupted write never leaves a truncated cache
+		std::filesystem::path cachePath = GetCachePath();
+		std::filesystem::path tempPath = cachePath;
+		tempPath += ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				LOG("[EnvironmentMap] Couldn't write the cache to " + cachePath.string());
+				return;
+			}
+
+			IBLCacheHeader header{
+				.magic = IBL_CACHE_MAGIC,
+				.version = CACHE_VERSION,
+				.skyboxHash = m_skyboxHash,
+				.specularSize = SPECULAR_SIZE,
+				.specularMipCount = SPECULAR_MIP_COUNT,
+				.brdfLutSize = BRDF_LUT_SIZE,
+				.padding = 0,
+				.specularDataSize = data.specular.size(),
+				.brdfLutDataSize = data.brdfLut.size()
+			};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(data.irradianceSH.data()), sizeof(data.irradianceSH));
+			file.write(reinterpret_cast<const char*>(data.specular.data()), static_cast<std::streamsize>(data.specular.size()));
+			file.write(reinterpret_cast<const char*>(data.brdfLut.data()), static_cast<std::streamsize>(data.brdfLut.size()));
+			if (!file.good())
+			{
+				LOG("[EnvironmentMap] Couldn't write the cache to " + cachePath.string());
+				return;
+			}
+		}
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error)
+			LOG("[EnvironmentMap] Couldn't write the cache to " + cachePath.string());
+		else
+			LOG("[EnvironmentMap] Cached to " + cachePath.string());
+	}
+
+	static vk::ImageMemoryBarrier2 MakeImageBarrier(
+		vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+		vk::PipelineStageFlags2 srcStage, vk::AccessFlags2 srcAccess,
+		vk::PipelineStageFlags2 dstStage, vk::AccessFlags2 dstAccess,
+		uint32_t baseMip, uint32_t mipCount
+	)
+	{
+		return vk::ImageMemoryBarrier2{
+			.srcStageMask = srcStage,
+			.srcAccessMask = srcAccess,
+			.dstStageMask = dstStage,
+			.dstAccessMask = dstAccess,
+			.oldLayout = oldLayout,
+			.newLayout = newLayout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = image,
+			.subresourceRange = {
+				.aspectMask = vk::ImageAspectFlagBits::eColor,
+				.baseMipLevel = baseMip,
+				.levelCount = mipCount,
+				.baseArrayLayer = 0,
+				.layerCount = vk::RemainingArrayLayers
+			}
+		};
+	}
+
+	static void PipelineBarrier(const vk::raii::CommandBuffer& cmdBuf, const vk::ImageMemoryBarrier2& barrier)
+	{
+		cmdBuf.pipelineBarrier2(vk::DependencyInfo{ .imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &barrier });
+	}
+
+	// All the convolutions are recorded in a single immediate submission, the results are read back
+	EnvironmentMap::PrecomputedData EnvironmentMap::Generate(const Device& device, const Texture& skybox) const
+	{
+		using Stage = vk::PipelineStageFlagBits2;
+		using Access = vk::AccessFlagBits2;
+		using Layout = vk::ImageLayout;
+
+		// ---- Resources ----
+		// Linear half float copy of the skybox with a full mip chain (filtered importance sampling)
+		uint32_t sourceMipCount = static_cast<uint32_t>(std::log2(SOURCE_SIZE)) + 1;
+		vk::ImageCreateInfo sourceInfo{
+			.flags = vk::ImageCreateFlagBits::eCubeCompatible,
+			.imageType = vk::ImageType::e2D,
+			.format = SPECULAR_FORMAT,
+			.extent = vk::Extent3D{ SOURCE_SIZE, SOURCE_SIZE, 1 },
+			.mipLevels = sourceMipCount,
+			.arrayLayers = 6,
+			.samples = vk::SampleCountFlagBits::e1,
+			.tiling = vk::ImageTiling::eOptimal,
+			.usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+			.sharingMode = vk::SharingMode::eExclusive,
+			.initialLayout = vk::ImageLayout::eUndefined
+		};
+		VmaAllocationCreateInfo gpuAllocInfo{ .usage = VMA_MEMORY_USAGE_GPU_ONLY };
+		Texture source{ device, sourceInfo, gpuAllocInfo };
+
+		vk::ImageCreateInfo specularInfo = sourceInfo;
+		specularInfo.extent = vk::Extent3D{ SPECULAR_SIZE, SPECULAR_SIZE, 1 };
+		specularInfo.mipLevels = SPECULAR_MIP_COUNT;
+		specularInfo.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc;
+		Texture specular{ device, specularInfo, gpuAllocInfo };
+
+		// One storage view per mip (all the faces)
+		std::vector<vk::raii::ImageView> specularMipViews;
+		for (uint32_t mip = 0; mip < SPECULAR_MIP_COUNT; mip++)
+		{
+			vk::ImageViewCreateInfo viewInfo{
+				.image = specular.GetHandle(),
+				.viewType = vk::ImageViewType::e2DArray,
+				.format = SPECULAR_FORMAT,
+				.subresourceRange = {
+					.aspectMask = vk::ImageAspectFlagBits::eColor,
+					.baseMipLevel = mip,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 6
+				}
+			};
+			specularMipViews.emplace_back(device.GetDevice(), viewInfo);
+		}
+
+		// Read back by the host
+		VmaAllocationCreateInfo readbackAllocInfo{ .usage = VMA_MEMORY_USAGE_GPU_TO_CPU };
+		vk::BufferCreateInfo shInfo{
+			.size = sizeof(glm::vec4) * SH_COEFFICIENTS,
+			.usage = vk::BufferUsageFlagBits::eStorageBuffer
+		};
+		Buffer shBuffer{ device.GetAllocator(), shInfo, readbackAllocInfo };
+		vk::BufferCreateInfo lutInfo{
+			.size = BRDF_LUT_SIZE * BRDF_LUT_SIZE * BRDF_LUT_TEXEL_SIZE,
+			.usage = vk::BufferUsageFlagBits::eStorageBuffer
+		};
+		Buffer lutBuffer{ device.GetAllocator(), lutInfo, readbackAllocInfo };
+		vk::BufferCreateInfo specularReadbackInfo{
+			.size = GetSpecularDataSize(),
+			.usage = vk::BufferUsageFlagBits::eTransferDst
+		};
+		Buffer specularReadback{ device.GetAllocator(), specularReadbackInfo, readbackAllocInfo };
+
+		vk::SamplerCreateInfo sourceSamplerInfo{
+			.magFilter = vk::Filter::eLinear,
+			.minFilter = vk::Filter::eLinear,
+			.mipmapMode = vk::SamplerMipmapMode::eLinear,
+			.addressModeU = vk::SamplerAddressMode::eClampToEdge,
+			.addressModeV = vk::SamplerAddressMode::eClampToEdge,
+			.addressModeW = vk::SamplerAddressMode::eClampToEdge,
+			.minLod = 0.0f,
+			.maxLod = vk::LodClampNone
+		};
+		vk::raii::Sampler sourceSampler{ device.GetDevice(), sourceSamplerInfo };
+
+		// ---- Descriptors ----
+		// Binding 0 -> source cubemap
+		// Binding 1 -> specular mip (storage image, one set per mip)
+		// Binding 2 -> SH coefficients
+		// Binding 3 -> BRDF LUT
+		std::array<vk::DescriptorSetLayoutBinding, 4> bindings{
+			vk::DescriptorSetLayoutBinding{ .binding = 0, .descriptorType = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute },
+			vk::DescriptorSetLayoutBinding{ .binding = 1, .descriptorType = vk::DescriptorType::eStorageImage, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute },
+			vk::DescriptorSetLayoutBinding{ .binding = 2, .descriptorType = vk::DescriptorType::eStorageBuffer, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute },
+			vk::DescriptorSetLayoutBinding{ .binding = 3, .descriptorType = vk::DescriptorType::eStorageBuffer, .descriptorCount = 1, .stageFlags = vk::ShaderStageFlagBits::eCompute }
+		};
+		vk::raii::DescriptorSetLayout setLayout{
+			device.GetDevice(),
+			vk::DescriptorSetLayoutCreateInfo{ .bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data() }
+		};
+
+		std::array<vk::DescriptorPoolSize, 3> poolSizes{
+			vk::DescriptorPoolSize{ .type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = SPECULAR_MIP_COUNT },
+			vk::DescriptorPoolSize{ .type = vk::DescriptorType::eStorageImage, .descriptorCount = SPECULAR_MIP_COUNT },
+			vk::DescriptorPoolSize{ .type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 2 * SPECULAR_MIP_COUNT }
+		};
+		vk::raii::DescriptorPool descriptorPool{
+			device.GetDevice(),
+			vk::DescriptorPoolCreateInfo{
+				.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+				.maxSets = SPECULAR_MIP_COUNT,
+				.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+				.pPoolSizes = poolSizes.data()
+			}
+		};
+		std::vector<vk::DescriptorSetLayout> setLayouts(SPECULAR_MIP_COUNT, setLayout);
+		std::vector<vk::raii::DescriptorSet> descriptorSets = device.GetDevice().allocateDescriptorSets(vk::DescriptorSetAllocateInfo{
+			.descriptorPool = descriptorPool,
+			.descriptorSetCount = static_cast<uint32_t>(setLayouts.size()),
+			.pSetLayouts = setLayouts.data()
+		});
+
+		vk::DescriptorImageInfo sourceImageInfo{
+			.sampler = sourceSampler,
+			.imageView = source.GetImageView(),
+			.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+		};
+		vk::DescriptorBufferInfo shBufferInfo{ .buffer = shBuffer.GetHandle(), .offset = 0, .range = vk::WholeSize };
+		vk::DescriptorBufferInfo lutBufferInfo{ .buffer = lutBuffer.GetHandle(), .offset = 0, .range = vk::WholeSize };
+		for (uint32_t mip = 0; mip < SPECULAR_MIP_COUNT; mip++)
+		{
+			vk::DescriptorImageInfo mipImageInfo{
+				.imageView = specularMipViews[mip],
+				.imageLayout = vk::ImageLayout::eGeneral
+			};
+			std::array<vk::WriteDescriptorSet, 4> writes{
+				vk::WriteDescriptorSet{ .dstSet = descriptorSets[mip], .dstBinding = 0, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eCombinedImageSampler, .pImageInfo = &sourceImageInfo },
+				vk::WriteDescriptorSet{ .dstSet = descriptorSets[mip], .dstBinding = 1, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eStorageImage, .pImageInfo = &mipImageInfo },
+				vk::WriteDescriptorSet{ .dstSet = descriptorSets[mip], .dstBinding = 2, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eStorageBuffer, .pBufferInfo = &shBufferInfo },
+				vk::WriteDescriptorSet{ .dstSet = descriptorSets[mip], .dstBinding = 3, .descriptorCount = 1, .descriptorType = vk::DescriptorType::eStorageBuffer, .pBufferInfo = &lutBufferInfo }
+			};
+			device.GetDevice().updateDescriptorSets(writes, {});
+		}
+
+		// ---- Pipelines ----
+		// NOTE: same layout for the three shaders, the push constants are (mip, mip count, samples) or (LUT size)
+		vk::PushConstantRange pushConstRange{ .stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = 3 * sizeof(uint32_t) };
+		PipelineBuilder pipelineBuilder{ device };
+		auto buildPipeline = [&](const std::string& shaderPath) {
+			pipelineBuilder.Reset();
+			pipelineBuilder.SetShaderStages({ { shaderPath, vk::ShaderStageFlagBits::eCompute } });
+			pipelineBuilder.SetPipelineLayout(
+				std::vector<vk::DescriptorSetLayout>{ setLayout },
+				std::vector<vk::PushConstantRange>{ pushConstRange }
+			);
+			return pipelineBuilder.BuildComputePipeline();
+		};
+		auto [prefilterPipeline, prefilterPipelineLayout] = buildPipeline("./shaders/ibl_prefilter.comp.spv");
+		auto [irradiancePipeline, irradiancePipelineLayout] = buildPipeline("./shaders/ibl_irradiance.comp.spv");
+		auto [lutPipeline, lutPipelineLayout] = buildPipeline("./shaders/brdf_lut.comp.spv");
+
+		// ---- Commands ----
+		device.ImmediateSubmit([&](const vk::raii::CommandBuffer& cmdBuf) {
+			// Skybox (mip 0) to the source mip 0, converted to linear half floats by the blit
+			PipelineBarrier(cmdBuf, MakeImageBarrier(
+				skybox.GetHandle(), Layout::eShaderReadOnlyOptimal, Layout::eTransferSrcOptimal,
+				Stage::eFragmentShader, {}, Stage::eBlit, Access::eTransferRead, 0, 1
+			));
+			PipelineBarrier(cmdBuf, MakeImageBarrier(
+				source.GetHandle(), Layout::eUndefined, Layout::eTransferDstOptimal,
+				Stage::eNone, {}, Stage::eBlit, Access::eTransferWrite, 0, sourceMipCount
+			));
+
+			auto blit = [&](vk::Image src, uint32_t srcMip, vk::Extent3D srcExtent, uint32_t dstMip) {
+				uint32_t dstSize = std::max(SOURCE_SIZE >> dstMip, 1u);
+				vk::ImageBlit region{
+					.srcSubresource = { vk::ImageAspectFlagBits::eColor, srcMip, 0, 6 },
+					.srcOffsets = std::array<vk::Offset3D, 2>{
+						vk::Offset3D{ 0, 0, 0 },
+						vk::Offset3D{ static_cast<int32_t>(srcExtent.width), static_cast<int32_t>(srcExtent.height), 1 }
+					},
+					.dstSubresource = { vk::ImageAspectFlagBits::eColor, dstMip, 0, 6 },
+					.dstOffsets = std::array<vk::Offset3D, 2>{
+						vk::Offset3D{ 0, 0, 0 },
+						vk::Offset3D{ static_cast<int32_t>(dstSize), static_cast<int32_t>(dstSize), 1 }
+					}
+				};
+				cmdBuf.blitImage(src, Layout::eTransferSrcOptimal, source.GetHandle(), Layout::eTransferDstOptimal, region, vk::Filter::eLinear);
+			};
+			blit(skybox.GetHandle(), 0, skybox.GetExtent(), 0);
+
+			// Source mip chain, each mip downsampled from the previous one
+			for (uint32_t mip = 1; mip < sourceMipCount; mip++)
+			{
+				PipelineBarrier(cmdBuf, MakeImageBarrier(
+					source.GetHandle(), Layout::eTransferDstOptimal, Layout::eTransferSrcOptimal,
+					Stage::eBlit, Access::eTransferWrite, Stage::eBlit, Access::eTransferRead, mip - 1, 1
+				));
+				uint32_t srcSize = std::max(SOURCE_SIZE >> (mip - 1), 1u);
+				blit(source.GetHandle(), mip - 1, vk::Extent3D{ srcSize, srcSize, 1 }, mip);
+			}
+			PipelineBarrier(cmdBuf, MakeImageBarrier(
+				source.GetHandle(), Layout::eTransferDstOptimal, Layout::eTransferSrcOptimal,
+				Stage::eBlit, Access::eTransferWrite, Stage::eBlit, Access::eTransferRead, sourceMipCount - 1, 1
+			));
+			PipelineBarrier(cmdBuf, MakeImageBarrier(
+				source.GetHandle(), Layout::eTransferSrcOptimal, Layout::eShaderReadOnlyOptimal,
+				Stage::eBlit, Access::eTransferWrite, Stage::eComputeShader, Access::eShaderSampledRead, 0, sourceMipCount
+			));
+			PipelineBarrier(cmdBuf, MakeImageBarrier(
+				skybox.GetHandle(), Layout::eTransferSrcOptimal, Layout::eShaderReadOnlyOptimal,
+				Stage::eBlit, {}, Stage::eFragmentShader, Access::eShaderSampledRead, 0, 1
+			));
+			PipelineBarrier(cmdBuf, MakeImageBarrier(
+				specular.GetHandle(), Layout::eUndefined, Layout::eGeneral,
+				Stage::eNone, {}, Stage::eComputeShader, Access::eShaderStorageWrite, 0, SPECULAR_MIP_COUNT
+			));
+
+			// Specular mips, one dispatch per mip (all the faces)
+			cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, prefilterPipeline);
+			for (uint32_t mip = 0; mip < SPECULAR_MIP_COUNT; mip++)
+			{
+				cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, prefilterPipelineLayout, 0, { descriptorSets[mip] }, nullptr);
+				std::array<uint32_t, 3> pushConst{ mip, SPECULAR_MIP_COUNT, PREFILTER_SAMPLE_COUNT };
+				cmdBuf.pushConstants(*prefilterPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, vk::ArrayProxy<const uint32_t>(pushConst));
+				uint32_t mipSize = SPECULAR_SIZE >> mip;
+				cmdBuf.dispatch((mipSize + GROUP_SIZE - 1) / GROUP_SIZE, (mipSize + GROUP_SIZE - 1) / GROUP_SIZE, 6);
+			}
+
+			// Irradiance SH (single group)
+			cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, irradiancePipeline);
+			cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, irradiancePipelineLayout, 0, { descriptorSets[0] }, nullptr);
+			cmdBuf.dispatch(1, 1, 1);
+
+			// BRDF LUT
+			cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, lutPipeline);
+			cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, lutPipelineLayout, 0, { descriptorSets[0] }, nullptr);
+			uint32_t lutSize = BRDF_LUT_SIZE;
+			cmdBuf.pushConstants(*lutPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, vk::ArrayProxy<const uint32_t>(1, &lutSize));
+			cmdBuf.dispatch((BRDF_LUT_SIZE + GROUP_SIZE - 1) / GROUP_SIZE, (BRDF_LUT_SIZE + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+			// Read-back
+			PipelineBarrier(cmdBuf, MakeImageBarrier(
+				specular.GetHandle(), Layout::eGeneral, Layout::eTransferSrcOptimal,
+				Stage::eComputeShader, Access::eShaderStorageWrite, Stage::eCopy, Access::eTransferRead, 0, SPECULAR_MIP_COUNT
+			));
+			std::vector<vk::BufferImageCopy> regions;
+			vk::DeviceSize offset = 0;
+			for (uint32_t mip = 0; mip < SPECULAR_MIP_COUNT; mip++)
+			{
+				uint32_t mipSize = SPECULAR_SIZE >> mip;
+				regions.push_back(vk::BufferImageCopy{
+					.bufferOffset = offset,
+					.imageSubresource = { vk::ImageAspectFlagBits::eColor, mip, 0, 6 },
+					.imageExtent = vk::Extent3D{ mipSize, mipSize, 1 }
+				});
+				offset += static_cast<vk::DeviceSize>(mipSize) * mipSize * 6 * SPECULAR_TEXEL_SIZE;
+			}
+			cmdBuf.copyImageToBuffer(specular.GetHandle(), Layout::eTransferSrcOptimal, specularReadback.GetHandle(), regions);
+
+			vk::MemoryBarrier2 hostBarrier{
+				.srcStageMask = Stage::eComputeShader | Stage::eCopy,
+				.srcAccessMask = Access::eShaderStorageWrite | Access::eTransferWrite,
+				.dstStageMask = Stage::eHost,
+				.dstAccessMask = Access::eHostRead
+			};
+			cmdBuf.pipelineBarrier2(vk::DependencyInfo{ .memoryBarrierCount = 1, .pMemoryBarriers = &hostBarrier });
+		});
+
+		PrecomputedData data;
+		data.specular.resize(GetSpecularDataSize());
+		data.brdfLut.resize(BRDF_LUT_SIZE * BRDF_LUT_SIZE * BRDF_LUT_TEXEL_SIZE);
+		shBuffer.ReadData(data.irradianceSH.data(), sizeof(data.irradianceSH));
+		specularReadback.ReadData(data.specular.data(), data.specular.size());
+		lutBuffer.ReadData(data.brdfLut.data(), data.brdfLut.size());
+		return data;
+	}
+
+	void EnvironmentMap::Upload(const Device& device, const PrecomputedData& data)
+	{
+		using Stage = vk::PipelineStageFlagBits2;
+		using Access = vk::AccessFlagBits2;
+		using Layout = vk::ImageLayout;
+
+		vk::ImageCreateInfo specularInfo{
+			.flags = vk::ImageCreateFlagBits::eCubeCompatible,
+			.imageType = vk::ImageType::e2D,
+			.format = SPECULAR_FORMAT,
+			.extent = vk::Extent3D{ SPECULAR_SIZE, SPECULAR_SIZE, 1 },
+			.mipLevels = SPECULAR_MIP_COUNT,
+			.arrayLayers = 6,
+			.samples = vk::SampleCountFlagBits::e1,
+			.tiling = vk::ImageTiling::eOptimal,
+			.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+			.sharingMode = vk::SharingMode::eExclusive,
+			.initialLayout = vk::ImageLayout::eUndefined
+		};
+		VmaAllocationCreateInfo gpuAllocInfo{ .usage = VMA_MEMORY_USAGE_GPU_ONLY };
+		m_specularMap = std::make_unique<Texture>(device, specularInfo, gpuAllocInfo);
+
+		vk::ImageCreateInfo lutInfo = specularInfo;
+		lutInfo.flags = {};
+		lutInfo.format = BRDF_LUT_FORMAT;
+		lutInfo.extent = vk::Extent3D{ BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1 };
+		lutInfo.mipLevels = 1;
+		lutInfo.arrayLayers = 1;
+		m_brdfLut = std::make_unique<Texture>(device, lutInfo, gpuAllocInfo);
+
+		// Single staging buffer: specular mips then the LUT
+		vk::BufferCreateInfo stagingInfo{
+			.size = data.specular.size() + data.brdfLut.size(),
+			.usage = vk::BufferUsageFlagBits::eTransferSrc
+		};
+		VmaAllocationCreateInfo stagingAllocInfo{
+			.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+			.usage = VMA_MEMORY_USAGE_CPU_TO_GPU
+		};
+		Buffer stagingBuffer{ device.GetAllocator(), stagingInfo, stagingAllocInfo, true };
+		std::vector<uint8_t> stagingData(data.specular);
+		stagingData.insert(stagingData.end(), data.brdfLut.begin(), data.brdfLut.end());
+		stagingBuffer.LoadData(stagingData.data(), stagingData.size());
+
+		device.ImmediateSubmit([&](const vk::raii::CommandBuffer& cmdBuf) {
+			for (vk::Image image : { m_specularMap->GetHandle(), m_brdfLut->GetHandle() })
+			{
+				PipelineBarrier(cmdBuf, MakeImageBarrier(
+					image, Layout::eUndefined, Layout::eTransferDstOptimal,
+					Stage::eNone, {}, Stage::eCopy, Access::eTransferWrite, 0, vk::RemainingMipLevels
+				));
+			}
+
+			std::vector<vk::BufferImageCopy> regions;
+			vk::DeviceSize offset = 0;
+			for (uint32_t mip = 0; mip < SPECULAR_MIP_COUNT; mip++)
+			{
+				uint32_t mipSize = SPECULAR_SIZE >> mip;
+				regions.push_back(vk::BufferImageCopy{
+					.bufferOffset = offset,
+					.imageSubresource = { vk::ImageAspectFlagBits::eColor, mip, 0, 6 },
+					.imageExtent = vk::Extent3D{ mipSize, mipSize, 1 }
+				});
+				offset += static_cast<vk::DeviceSize>(mipSize) * mipSize * 6 * SPECULAR_TEXEL_SIZE;
+			}
+			cmdBuf.copyBufferToImage(stagingBuffer.GetHandle(), m_specularMap->GetHandle(), Layout::eTransferDstOptimal, regions);
+			cmdBuf.copyBufferToImage(stagingBuffer.GetHandle(), m_brdfLut->GetHandle(), Layout::eTransferDstOptimal, vk::BufferImageCopy{
+				.bufferOffset = offset,
+				.imageSubresource = { vk::ImageAspectFlagBits::eColor, 0, 0, 1 },
+				.imageExtent = vk::Extent3D{ BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1 }
+			});
+
+			// Sampled by the lighting passes (raster or compute)
+			for (vk::Image image : { m_specularMap->GetHandle(), m_brdfLut->GetHandle() })
+			{
+				PipelineBarrier(cmdBuf, MakeImageBarrier(
+					image, Layout::eTransferDstOptimal, Layout::eShaderReadOnlyOptimal,
+					Stage::eCopy, Access::eTransferWrite, Stage::eFragmentShader | Stage::eComputeShader, Access::eShaderSampledRead,
+					0, vk::RemainingMipLevels
+				));
+			}
+		});
+
+		// Uniform buffer (never changes afterwards)
+		EnvironmentData environmentData{};
+		for (uint32_t i = 0; i < SH_COEFFICIENTS; i++)
+			environmentData.irradianceSH[i] = data.irradianceSH[i];
+		environmentData.params = glm::vec4(static_cast<float>(SPECULAR_MIP_COUNT), 0.0f, 0.0f, 0.0f);
+		vk::BufferCreateInfo uboInfo{
+			.size = sizeof(EnvironmentData),
+			.usage = vk::BufferUsageFlagBits::eUniformBuffer
+		};
+		VmaAllocationCreateInfo uboAllocInfo{ .usage = VMA_MEMORY_USAGE_CPU_TO_GPU };
+		m_uniformBuffer = std::make_unique<Buffer>(device.GetAllocator(), uboInfo, uboAllocInfo);
+		m_uniformBuffer->LoadData(&environmentData, sizeof(environmentData));
+	}
+
+	void EnvironmentMap::CreateSampler(const Device& device)
+	{
+		vk::SamplerCreateInfo samplerCreateInfo{
+			.magFilter = vk::Filter::eLinear,
+			.minFilter = vk::Filter::eLinear,
+			.mipmapMode = vk::SamplerMipmapMode::eLinear,
+			.addressModeU = vk::SamplerAddressMode::eClampToEdge,
+			.addressModeV = vk::SamplerAddressMode::eClampToEdge,
+			.addressModeW = vk::SamplerAddressMode::eClampToEdge,
+			.mipLodBias = 0.0f,
+			.anisotropyEnable = vk::False,
+			.maxAnisotropy = 1.0f,
+			.compareEnable = vk::False,
+			.minLod = 0.0f,
+			.maxLod = vk::LodClampNone,
+			.borderColor = vk::BorderColor::eFloatOpaqueBlack,
+			.unnormalizedCoordinates = vk::False,
+		};
+		m_sampler = vk::raii::Sampler(device.GetDevice(), samplerCreateInfo);
+	}
+}
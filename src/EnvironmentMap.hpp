@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <filesystem>
+
+namespace Felina
+{
+	class Device;
+	class Texture;
+	class Buffer;
+
+	// Image-based lighting precomputed from the skybox:
+	// - specular cubemap prefiltered with GGX, one roughness level per mip
+	// - irradiance as order 2 spherical harmonics (9 RGB coefficients)
+	// - split-sum BRDF LUT (scale and bias applied to f0)
+	// The convolutions run once on the GPU, the results are read back and cached on disk (IBL_CACHE_DIR)
+	// in a file named after the skybox content hash, later loads only upload the cached data
+	class EnvironmentMap
+	{
+		public:
+			static constexpr uint32_t SPECULAR_SIZE = 128;
+			static constexpr uint32_t SPECULAR_MIP_COUNT = 6; // 128 to 4, roughness 0 to 1
+			static constexpr uint32_t PREFILTER_SAMPLE_COUNT = 64;
+			// Skybox copy (with a full mip chain) read by the convolutions
+			static constexpr uint32_t SOURCE_SIZE = 256;
+			static constexpr uint32_t BRDF_LUT_SIZE = 128;
+			// NOTE: must match IBL_SH_COEFFICIENTS in ibl.hlsli
+			static constexpr uint32_t SH_COEFFICIENTS = 9;
+			static constexpr uint32_t GROUP_SIZE = 8; // see ibl_prefilter.comp.hlsl and brdf_lut.comp.hlsl
+			static constexpr vk::Format SPECULAR_FORMAT = vk::Format::eR16G16B16A16Sfloat;
+			static constexpr vk::Format BRDF_LUT_FORMAT = vk::Format::eR16G16Sfloat;
+			// Bumped whenever the precomputation changes, older cache files are regenerated
+			static constexpr uint32_t CACHE_VERSION = 1;
+
+			// NOTE: must match EnvironmentData in ibl.hlsli
+			struct EnvironmentData
+			{
+				glm::vec4 irradianceSH[SH_COEFFICIENTS];	// rgb coefficient (convolved, divided by PI)
+				glm::vec4 params;							// x specular mip count
+			};
+
+		public:
+			// `skybox` must be in the shader read-only layout
+			// NOTE: `skyboxHash` is the key of the cache file, the content hash of the skybox texture (see ResourceManager)
+			EnvironmentMap(const Device& device, const Texture& skybox, uint64_t skyboxHash);
+			~EnvironmentMap();
+
+			uint64_t GetSkyboxHash() const { return m_skyboxHash; }
+			bool IsLoadedFromCache() const { return m_isLoadedFromCache; }
+
+			const Texture& GetSpecularMap() const { return *m_specularMap; }
+			const Texture& GetBrdfLut() const { return *m_brdfLut; }
+			const Buffer& GetUniformBuffer() const { return *m_uniformBuffer; }
+			const vk::raii::Sampler& GetSampler() const { return m_sampler; }
+
+		private:
+			// Contents of a cache file (after its header)
+			struct PrecomputedData
+			{
+				std::array<glm::vec4, SH_COEFFICIENTS> irradianceSH;
+				std::vector<uint8_t> specular;	// mips in order, 6 faces each
+				std::vector<uint8_t> brdfLut;
+			};
+
+			static size_t GetSpecularDataSize();
+			std::filesystem::path GetCachePath() const;
+			bool LoadCache(PrecomputedData& data) const;
+			void SaveCache(const PrecomputedData& data) const;
+
+			PrecomputedData Generate(const Device& device, const Texture& skybox) const;
+			void Upload(const Device& device, const PrecomputedData& data);
+			void CreateSampler(const Device& device);
+
+			uint64_t m_skyboxHash;
+			bool m_isLoadedFromCache = false;
+
+			std::unique_ptr<Texture> m_specularMap = nullptr;
+			std::unique_ptr<Texture> m_brdfLut = nullptr;
+			std::unique_ptr<Buffer> m_uniformBuffer = nullptr;
+			// Trilinear, clamped (shared by the specular map and the LUT)
+			vk::raii::Sampler m_sampler = nullptr;
+	};
+}
@@ -0,0 +1,77 @@
+#include "FrameStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Felina
+{
+	static float ToMilliseconds(FrameStats::Clock::duration d)
+	{
+		return std::chrono::duration<float, std::milli>(d).count();
+	}
+
+	// Called once the CPU is allowed to start working on a new frame
+	// (i.e. after waiting for the frame in flight fence)
+	void FrameStats::BeginFrame()
+	{
+		m_frameBegin = Clock::now();
+	}
+
+	// Called right after queue submission, `queueDepth` is the number
+	// of submitted frames the GPU hasn't completed yet
+	void FrameStats::EndFrame(uint32_t queueDepth)
+	{
+		m_cpuTimes[m_head] = ToMilliseconds(Clock::now() - m_frameBegin);
+		m_queueDepth = queueDepth;
+		m_queueDepths[m_head] = queueDepth;
+	}
+
+	// Called right after the presentation request, it closes the current sample
+	void FrameStats::OnPresent()
+	{
+		Clock::time_point now = Clock::now();
+		if (!m_hasPresented)
+		{
+			// The first present only provides the reference point
+			m_lastPresent = now;
+			m_hasPresented = true;
+			return;
+		}
+
+		m_presentIntervals[m_head] = ToMilliseconds(now - m_lastPresent);
+		m_lastPresent = now;
+
+		m_head = (m_head + 1) % WINDOW_SIZE;
+		m_count = std::min(m_count + 1, WINDOW_SIZE);
+		UpdateAggregates();
+	}
+
+	void FrameStats::UpdateAggregates()
+	{
+		float sumIntervals = 0.0f;
+		float sumCpu = 0.0f;
+		float sumDepth = 0.0f;
+		float maxInterval = 0.0f;
+		for (size_t i = 0; i < m_count; i++)
+		{
+			sumIntervals += m_presentIntervals[i];
+			sumCpu += m_cpuTimes[i];
+			sumDepth += static_cast<float>(m_queueDepths[i]);
+			maxInterval = std::max(maxInterval, m_presentIntervals[i]);
+		}
+		float n = static_cast<float>(m_count);
+		m_avgFrameTime = sumIntervals / n;
+		m_avgCpuTime = sumCpu / n;
+		m_avgQueueDepth = sumDepth / n;
+		m_maxFrameTime = maxInterval;
+
+		// Jitter as the standard deviation of the present-to-present intervals
+		float variance = 0.0f;
+		for (size_t i = 0; i < m_count; i++)
+		{
+			float d = m_presentIntervals[i] - m_avgFrameTime;
+			variance += d * d;
+		}
+		m_presentJitter = std::sqrt(variance / n);
+	}
+}
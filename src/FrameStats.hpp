@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace Felina
+{
+	// Rolling window of per-frame timings collected by the renderer
+	// and displayed in the UI stats panel
+	class FrameStats
+	{
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			// Number of frames the statistics are computed on
+			static constexpr size_t WINDOW_SIZE = 240;
+
+			FrameStats() = default;
+
+			void BeginFrame();
+			void EndFrame(uint32_t queueDepth);
+			void OnPresent();
+
+			// Averages/deviation over the window (milliseconds)
+			float GetAverageFrameTime() const { return m_avgFrameTime; }
+			float GetMaxFrameTime() const { return m_maxFrameTime; }
+			float GetAverageCpuTime() const { return m_avgCpuTime; }
+			float GetPresentJitter() const { return m_presentJitter; }
+			float GetAverageQueueDepth() const { return m_avgQueueDepth; }
+			uint32_t GetQueueDepth() const { return m_queueDepth; }
+
+			// Raw history, ordered from the oldest to the newest sample
+			// starting at GetHistoryOffset() (see ImGui::PlotLines)
+			const std::array<float, WINDOW_SIZE>& GetFrameTimeHistory() const { return m_presentIntervals; }
+			size_t GetHistoryOffset() const { return m_head; }
+
+		private:
+			void UpdateAggregates();
+
+			Clock::time_point m_frameBegin{};
+			Clock::time_point m_lastPresent{};
+			bool m_hasPresented = false;
+
+			std::array<float, WINDOW_SIZE> m_presentIntervals{};
+			std::array<float, WINDOW_SIZE> m_cpuTimes{};
+			std::array<uint32_t, WINDOW_SIZE> m_queueDepths{};
+			size_t m_head = 0;
+			size_t m_count = 0;
+
+			uint32_t m_queueDepth = 0;
+			float m_avgFrameTime = 0.0f;
+			float m_maxFrameTime = 0.0f;
+			float m_avgCpuTime = 0.0f;
+			float m_presentJitter = 0.0f;
+			float m_avgQueueDepth = 0.0f;
+	};
+}
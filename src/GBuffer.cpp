@@ -7,17 +7,15 @@ namespace Felina
 	GBuffer::GBuffer(
         const Device& device,
         vk::Extent2D swapchainExtent,
-        vk::raii::DescriptorPool& descriptorPool
+        vk::raii::DescriptorPool& descriptorPool,
+        Encoding encoding,
+        bool hasVisibility,
+        bool hasLightingOutput,
+        bool hasUpscale
     )
-        : m_extent(swapchainExtent)
+        : m_extent(swapchainExtent), m_encoding(encoding), m_hasVisibility(hasVisibility), m_hasLightingOutput(hasLightingOutput || hasUpscale), m_hasUpscale(hasUpscale), m_transientAllocator(std::make_unique<TransientAllocator>(device))
 	{
-        VmaAllocationCreateInfo allocCreateInfo{};
-        allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-        CreateBaseColorAttachment(device, allocCreateInfo);
-        CreateMaterialInfoAttachment(device, allocCreateInfo);
-        CreateNormalAttachment(device, allocCreateInfo);
-        CreateDepthAttachment(device, allocCreateInfo);
+        CreateAttachments(device);
 
         CreateSampler(device);
 
@@ -25,12 +23,18 @@ namespace Felina
         CreateDescriptorSets(device, descriptorPool);
 	}
 
+    GBuffer::~GBuffer()
+    {
+        // Attachments are bound to the transient allocator memory
+        CleanUp();
+    }
+
     std::vector<vk::Format> GBuffer::GetColorAttachmentFormats() const
     {
         std::vector<vk::Format> m_formats;
         for (const auto& attachment : m_attachments)
         {
-            if (attachment.type == AttachmentType::Depth)
+            if (!IsGeometryTarget(attachment.type))
                 continue;
 
             m_formats.push_back(attachment.image->GetFormat());
@@ -48,6 +52,16 @@ namespace Felina
         throw std::runtime_error("[GBUFFER] Couldn't retrieve the G-buffer depth attachment format because there's no such attachment!");
     }
 
+    vk::Format GBuffer::GetVisibilityFormat() const
+    {
+        return GetAttachmentCreateInfo(Visibility, m_extent, m_encoding).format;
+    }
+
+    vk::Format GBuffer::GetLightingOutputFormat() const
+    {
+        return GetAttachmentCreateInfo(LightingOutput, m_extent, m_encoding).format;
+    }
+
     void GBuffer::Recreate(
         const Device& device,
         vk::Extent2D swapchainExtent,
@@ -62,98 +76,160 @@ namespace Felina
 
         // Recreate images and descriptor sets
         // NOTE: sampler and descriptor sets layout DO NOT need to be recreated
-        VmaAllocationCreateInfo allocCreateInfo{};
-        allocCreateInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-        CreateBaseColorAttachment(device, allocCreateInfo);
-        CreateMaterialInfoAttachment(device, allocCreateInfo);
-        CreateNormalAttachment(device, allocCreateInfo);
-        CreateDepthAttachment(device, allocCreateInfo);
+        CreateAttachments(device);
         CreateDescriptorSets(device, descriptorPool);
     }
 
-    void GBuffer::CreateBaseColorAttachment(const Device& device, VmaAllocationCreateInfo allocCreateInfo)
+    // In the compact encodings the normal is packed in the MaterialInfo attachment
+    std::vector<GBuffer::AttachmentType> GBuffer::GetAttachmentTypes(Encoding encoding, bool hasVisibility, bool hasLightingOutput)
     {
-        vk::ImageCreateInfo imageCreateInfo = {
-            .imageType = vk::ImageType::e2D,
-            .format = vk::Format::eR8G8B8A8Unorm,
-            .extent = vk::Extent3D{ m_extent.width, m_extent.height, 1 },
-            .mipLevels = 1,
-            .arrayLayers = 1,
-            .samples = vk::SampleCountFlagBits::e1,
-            .tiling = vk::ImageTiling::eOptimal,
-            .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
-            .sharingMode = vk::SharingMode::eExclusive,
-            .initialLayout = vk::ImageLayout::eUndefined
-        };
+        std::vector<AttachmentType> types{ BaseColor, MaterialInfo, Normal, Depth };
+        if (encoding != Encoding::Standard)
+            types = { BaseColor, MaterialInfo, Depth };
+        if (hasVisibility)
+            types.push_back(Visibility);
+        if (hasLightingOutput)
+            types.push_back(LightingOutput);
+        return types;
+    }
+
+    // Deferred path: all of the attachments are written by the geometry pass and sampled by the lighting pass
+    // Visibility buffer path: the visibility pass writes IDs and depth, the resolve pass turns the IDs into
+    // the color attachments and the lighting pass samples them
+    // Compute lighting path: the lighting output is written by the lighting pass and blitted to the swapchain right after
+    // The depth is tested by the skybox pass, right after the lighting pass or after the blit in the compute lighting path
+    // Upscale (dynamic resolution): the skybox is drawn in the lighting output, which is then upscaled to the swapchain
+    std::vector<TransientAllocator::ImageRequest> GBuffer::GetAttachmentRequests(vk::Extent2D extent, Encoding encoding, bool hasVisibility, bool hasLightingOutput, bool hasUpscale)
+    {
+        hasLightingOutput = hasLightingOutput || hasUpscale;
+        const uint32_t geometryPass = 0;
+        const uint32_t resolvePass = hasVisibility ? 1 : 0;
+        const uint32_t lightingPass = resolvePass + 1;
+        const uint32_t blitPass = lightingPass + 1;
+        const uint32_t skyboxPass = hasUpscale ? blitPass : (hasLightingOutput ? blitPass + 1 : lightingPass);
+        const uint32_t upscalePass = skyboxPass + 1;
+
+        std::vector<TransientAllocator::ImageRequest> requests;
+        for (auto type : GetAttachmentTypes(encoding, hasVisibility, hasLightingOutput))
+        {
+            uint32_t firstPass = geometryPass;
+            uint32_t lastPass = lightingPass;
+            if (type == Visibility)
+                lastPass = resolvePass;
+            else if (type == LightingOutput)
+            {
+                firstPass = lightingPass;
+                lastPass = hasUpscale ? upscalePass : blitPass;
+            }
+            else if (type == Depth)
+                lastPass = skyboxPass;
+            else
+                firstPass = resolvePass;
 
-        m_attachments.push_back({
-            AttachmentType::BaseColor,
-            std::make_unique<Texture>(device, imageCreateInfo, allocCreateInfo)
-        });
+            requests.push_back({
+                .info = GetAttachmentCreateInfo(type, extent, encoding),
+                .firstPass = firstPass,
+                .lastPass = lastPass
+            });
+        }
+        return requests;
     }
 
-    void GBuffer::CreateMaterialInfoAttachment(const Device& device, VmaAllocationCreateInfo allocCreateInfo)
+    bool GBuffer::IsEncodingSupported(const Device& device, Encoding encoding)
     {
-        vk::ImageCreateInfo imageCreateInfo{
-            .imageType = vk::ImageType::e2D,
-            .format = vk::Format::eR8G8B8A8Unorm,
-            .extent = vk::Extent3D{ m_extent.width, m_extent.height, 1 },
-            .mipLevels = 1,
-            .arrayLayers = 1,
-            .samples = vk::SampleCountFlagBits::e1,
-            .tiling = vk::ImageTiling::eOptimal,
-            .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
-            .sharingMode = vk::SharingMode::eExclusive,
-            .initialLayout = vk::ImageLayout::eUndefined
-        };
+        constexpr vk::FormatFeatureFlags requiredFeatures = vk::FormatFeatureFlagBits::eColorAttachment | vk::FormatFeatureFlagBits::eSampledImage;
 
-        m_attachments.push_back({
-            AttachmentType::MaterialInfo,
-            std::make_unique<Texture>(device, imageCreateInfo, allocCreateInfo)
-        });
+        vk::Format format = GetAttachmentCreateInfo(MaterialInfo, { 1, 1 }, encoding).format;
+        auto properties = device.GetPhysicalDevice().getFormatProperties(format);
+        return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
     }
 
-    void GBuffer::CreateNormalAttachment(const Device& device, VmaAllocationCreateInfo allocCreateInfo)
+    bool GBuffer::IsLightingOutputSupported(const Device& device)
     {
-        vk::ImageCreateInfo imageCreateInfo{
-            .imageType = vk::ImageType::e2D,
-            .format = vk::Format::eR16G16B16A16Sfloat,
-            .extent = vk::Extent3D{ m_extent.width, m_extent.height, 1 },
-            .mipLevels = 1,
-            .arrayLayers = 1,
-            .samples = vk::SampleCountFlagBits::e1,
-            .tiling = vk::ImageTiling::eOptimal,
-            .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
-            .sharingMode = vk::SharingMode::eExclusive,
-            .initialLayout = vk::ImageLayout::eUndefined
-        };
+        constexpr vk::FormatFeatureFlags requiredFeatures = vk::FormatFeatureFlagBits::eStorageImage | vk::FormatFeatureFlagBits::eBlitSrc;
 
-        m_attachments.push_back({
-            AttachmentType::Normal,
-            std::make_unique<Texture>(device, imageCreateInfo, allocCreateInfo)
-        });
+        vk::Format format = GetAttachmentCreateInfo(LightingOutput, { 1, 1 }, Encoding::Standard).format;
+        auto properties = device.GetPhysicalDevice().getFormatProperties(format);
+        return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
     }
 
-    void GBuffer::CreateDepthAttachment(const Device& device, VmaAllocationCreateInfo allocCreateInfo)
+    vk::ImageCreateInfo GBuffer::GetAttachmentCreateInfo(AttachmentType type, vk::Extent2D extent, Encoding encoding)
     {
-        vk::ImageCreateInfo imageCreateInfo{
+        vk::Format format{};
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled;
+        switch (type)
+        {
+        case BaseColor:
+            format = vk::Format::eR8G8B8A8Unorm;
+            usage |= vk::ImageUsageFlagBits::eColorAttachment;
+            break;
+        case MaterialInfo:
+            format = encoding == Encoding::Octahedral16 ? vk::Format::eR16G16B16A16Unorm : vk::Format::eR8G8B8A8Unorm;
+            usage |= vk::ImageUsageFlagBits::eColorAttachment;
+            break;
+        case Normal:
+            format = vk::Format::eR16G16B16A16Sfloat;
+            usage |= vk::ImageUsageFlagBits::eColorAttachment;
+            break;
+        case Depth:
+            format = vk::Format::eD32Sfloat;
+            usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
+            break;
+        case Visibility:
+            format = vk::Format::eR32Uint; // see visibility.hlsli
+            usage |= vk::ImageUsageFlagBits::eColorAttachment;
+            break;
+        case LightingOutput:
+            format = vk::Format::eR16G16B16A16Sfloat; // linear, the blit (or the upscale) encodes it to the swapchain format
+            // Written by the compute lighting pass or rendered to (raster lighting and skybox) with dynamic resolution
+            usage |= vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eColorAttachment;
+            break;
+        }
+
+        return vk::ImageCreateInfo{
             .imageType = vk::ImageType::e2D,
-            .format = vk::Format::eD32Sfloat,
-            .extent = vk::Extent3D{ m_extent.width, m_extent.height, 1 },
+            .format = format,
+            .extent = vk::Extent3D{ extent.width, extent.height, 1 },
             .mipLevels = 1,
             .arrayLayers = 1,
             .samples = vk::SampleCountFlagBits::e1,
             .tiling = vk::ImageTiling::eOptimal,
-            .usage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled,
+            .usage = usage,
             .sharingMode = vk::SharingMode::eExclusive,
             .initialLayout = vk::ImageLayout::eUndefined
         };
+    }
+
+    void GBuffer::CreateAttachments(const Device& device)
+    {
+        auto types = GetAttachmentTypes(m_encoding, m_hasVisibility, m_hasLightingOutput);
+        auto textures = m_transientAllocator->Allocate(GetAttachmentRequests(m_extent, m_encoding, m_hasVisibility, m_hasLightingOutput, m_hasUpscale));
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            m_attachments.push_back({
+                types[i],
+                std::move(textures[i])
+            });
+        }
+    }
+
+    // Attachment bound to each binding of the descriptor set (binding = AttachmentType)
+    // NOTE: the layout doesn't depend on the encoding, the Normal binding
+    // aliases the MaterialInfo attachment in the compact encodings
+    const GBuffer::Attachment& GBuffer::GetAttachment(AttachmentType type) const
+    {
+        for (const auto& attachment : m_attachments)
+        {
+            if (attachment.type == type)
+                return attachment;
+        }
+        throw std::runtime_error("[GBUFFER] No attachment of type #" + std::to_string(type));
+    }
 
-        m_attachments.push_back({
-            AttachmentType::Depth,
-            std::make_unique<Texture>(device, imageCreateInfo, allocCreateInfo)
-        });
+    const GBuffer::Attachment& GBuffer::GetBindingAttachment(AttachmentType binding) const
+    {
+        AttachmentType type = (binding == Normal && m_encoding != Encoding::Standard) ? MaterialInfo : binding;
+        return GetAttachment(type);
     }
 
     void GBuffer::CreateSampler(const Device& device)
@@ -176,20 +252,28 @@ namespace Felina
             .unnormalizedCoordinates = vk::False,
         };
         m_sampler = vk::raii::Sampler(device.GetDevice(), samplerCreateInfo);
+
+        // The upscale pass filters the lighting output (the shader clamps the coordinates to the rendered area)
+        if (m_hasUpscale)
+        {
+            samplerCreateInfo.magFilter = vk::Filter::eLinear;
+            samplerCreateInfo.minFilter = vk::Filter::eLinear;
+            m_upscaleSampler = vk::raii::Sampler(device.GetDevice(), samplerCreateInfo);
+        }
     }
 
     void GBuffer::CreateDescriptorSetLayout(const Device& device)
     {
         // Bindings
         std::vector<vk::DescriptorSetLayoutBinding> bindings{};
-        bindings.resize(m_attachments.size());
-        for (size_t i = 0; i < m_attachments.size(); i++)
+        bindings.resize(ATTACHMENT_COUNT);
+        for (size_t i = 0; i < bindings.size(); i++)
         {
             bindings[i] = vk::DescriptorSetLayoutBinding{
                 .binding = static_cast<uint32_t>(i),
                 .descriptorType = vk::DescriptorType::eCombinedImageSampler,
                 .descriptorCount = 1,
-                .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                .stageFlags = vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute, // raster or compute lighting
                 .pImmutableSamplers = nullptr
             };
         }
@@ -200,6 +284,60 @@ namespace Felina
             .pBindings = bindings.data()
         };
         m_descriptorSetLayout = vk::raii::DescriptorSetLayout(device.GetDevice(), layoutInfo);
+
+        if (m_hasLightingOutput)
+        {
+            // Lighting output set layout
+            // Binding 0 -> Lighting output (storage image)
+            vk::DescriptorSetLayoutBinding lightingOutputBinding{
+                .binding = 0,
+                .descriptorType = vk::DescriptorType::eStorageImage,
+                .descriptorCount = 1,
+                .stageFlags = vk::ShaderStageFlagBits::eCompute,
+                .pImmutableSamplers = nullptr
+            };
+            vk::DescriptorSetLayoutCreateInfo lightingOutputLayoutInfo{
+                .bindingCount = 1,
+                .pBindings = &lightingOutputBinding
+            };
+            m_lightingOutputDescriptorSetLayout = vk::raii::DescriptorSetLayout(device.GetDevice(), lightingOutputLayoutInfo);
+        }
+
+        if (m_hasUpscale)
+        {
+            // Upscale set layout
+            // Binding 0 -> Lighting output (sampled)
+            vk::DescriptorSetLayoutBinding upscaleBinding{
+                .binding = 0,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .descriptorCount = 1,
+                .stageFlags = vk::ShaderStageFlagBits::eFragment,
+                .pImmutableSamplers = nullptr
+            };
+            vk::DescriptorSetLayoutCreateInfo upscaleLayoutInfo{
+                .bindingCount = 1,
+                .pBindings = &upscaleBinding
+            };
+            m_upscaleDescriptorSetLayout = vk::raii::DescriptorSetLayout(device.GetDevice(), upscaleLayoutInfo);
+        }
+
+        if (!m_hasVisibility)
+            return;
+
+        // Visibility set layout
+        // Binding 0 -> Visibility attachment
+        vk::DescriptorSetLayoutBinding visibilityBinding{
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eFragment,
+            .pImmutableSamplers = nullptr
+        };
+        vk::DescriptorSetLayoutCreateInfo visibilityLayoutInfo{
+            .bindingCount = 1,
+            .pBindings = &visibilityBinding
+        };
+        m_visibilityDescriptorSetLayout = vk::raii::DescriptorSetLayout(device.GetDevice(), visibilityLayoutInfo);
     }
 
     void GBuffer::CreateDescriptorSets(const Device& device, vk::raii::DescriptorPool& descriptorPool)
@@ -212,15 +350,16 @@ namespace Felina
         };
         m_descriptorSet = std::move(device.GetDevice().allocateDescriptorSets(allocInfo)[0]);
 
-        std::vector<vk::DescriptorImageInfo> imageInfos(m_attachments.size());
-        std::vector<vk::WriteDescriptorSet> descriptorWrites(m_attachments.size());
-        for (size_t j = 0; j < m_attachments.size(); j++)
+        std::vector<vk::DescriptorImageInfo> imageInfos(ATTACHMENT_COUNT);
+        std::vector<vk::WriteDescriptorSet> descriptorWrites(ATTACHMENT_COUNT);
+        for (size_t j = 0; j < ATTACHMENT_COUNT; j++)
         {
             // DescriptorImageInfo
+            // NOTE: the depth is sampled while bound as a read-only depth attachment (see RenderGraph::Transition)
             imageInfos[j] = vk::DescriptorImageInfo{
                 .sampler = m_sampler,
-                .imageView = m_attachments[j].image->GetImageView(),
-                .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+                .imageView = GetBindingAttachment(static_cast<AttachmentType>(j)).image->GetImageView(),
+                .imageLayout = static_cast<AttachmentType>(j) == Depth ? vk::ImageLayout::eDepthReadOnlyOptimal : vk::ImageLayout::eShaderReadOnlyOptimal
             };
 
             // WriteDescriptorSet
@@ -234,11 +373,78 @@ namespace Felina
             };
         }
         device.GetDevice().updateDescriptorSets(descriptorWrites, {});
+
+        if (m_hasLightingOutput)
+        {
+            allocInfo.pSetLayouts = &*m_lightingOutputDescriptorSetLayout;
+            m_lightingOutputDescriptorSet = std::move(device.GetDevice().allocateDescriptorSets(allocInfo)[0]);
+
+            vk::DescriptorImageInfo lightingOutputInfo{
+                .sampler = nullptr,
+                .imageView = GetBindingAttachment(LightingOutput).image->GetImageView(),
+                .imageLayout = vk::ImageLayout::eGeneral
+            };
+            vk::WriteDescriptorSet lightingOutputWrite{
+                .dstSet = m_lightingOutputDescriptorSet,
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eStorageImage,
+                .pImageInfo = &lightingOutputInfo
+            };
+            device.GetDevice().updateDescriptorSets(lightingOutputWrite, {});
+        }
+
+        if (m_hasUpscale)
+        {
+            allocInfo.pSetLayouts = &*m_upscaleDescriptorSetLayout;
+            m_upscaleDescriptorSet = std::move(device.GetDevice().allocateDescriptorSets(allocInfo)[0]);
+
+            vk::DescriptorImageInfo upscaleInfo{
+                .sampler = m_upscaleSampler,
+                .imageView = GetBindingAttachment(LightingOutput).image->GetImageView(),
+                .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+            };
+            vk::WriteDescriptorSet upscaleWrite{
+                .dstSet = m_upscaleDescriptorSet,
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .pImageInfo = &upscaleInfo
+            };
+            device.GetDevice().updateDescriptorSets(upscaleWrite, {});
+        }
+
+        if (!m_hasVisibility)
+            return;
+
+        allocInfo.pSetLayouts = &*m_visibilityDescriptorSetLayout;
+        m_visibilityDescriptorSet = std::move(device.GetDevice().allocateDescriptorSets(allocInfo)[0]);
+
+        vk::DescriptorImageInfo visibilityInfo{
+            .sampler = m_sampler,
+            .imageView = GetBindingAttachment(Visibility).image->GetImageView(),
+            .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+        vk::WriteDescriptorSet visibilityWrite{
+            .dstSet = m_visibilityDescriptorSet,
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .pImageInfo = &visibilityInfo
+        };
+        device.GetDevice().updateDescriptorSets(visibilityWrite, {});
     }
 
     void GBuffer::CleanUp()
     {
+        m_upscaleDescriptorSet = nullptr;
+        m_lightingOutputDescriptorSet = nullptr;
+        m_visibilityDescriptorSet = nullptr;
         m_descriptorSet = nullptr;
         m_attachments.clear();
+        m_transientAllocator->Free();
     }
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <vk_mem_alloc.h>
 
 #include "Texture.hpp"
+#include "TransientAllocator.hpp"
 
 namespace Felina
 {
@@ -13,7 +14,20 @@ namespace Felina
 	class GBuffer
 	{
 		public:
-			enum AttachmentType { BaseColor = 0, MaterialInfo, Normal, Depth };
+			// NOTE: Visibility (object/triangle IDs) only exists in the visibility buffer path,
+			// LightingOutput (storage image) only in the compute lighting path or with dynamic
+			// resolution (upscaled to the swapchain) and neither is part of the lighting pass descriptor set
+			enum AttachmentType { BaseColor = 0, MaterialInfo, Normal, Depth, Visibility, LightingOutput };
+			static constexpr uint32_t ATTACHMENT_COUNT = 4;
+
+			// Layout of the normal and material info
+			// NOTE: must match the defines in gbuffer.hlsli
+			enum class Encoding : uint32_t
+			{
+				Standard = 0,   // RGBA8 material info + RGBA16F normal (16 bytes per pixel of color targets)
+				Octahedral16,   // RGBA16 unorm: octahedral normal + roughness/metalness (12 bytes per pixel)
+				Octahedral8     // RGBA8 unorm: octahedral normal + roughness/metalness (8 bytes per pixel)
+			};
 			struct Attachment
 			{
 				AttachmentType type;
@@ -23,15 +37,37 @@ namespace Felina
 			GBuffer(
 				const Device& device, 
 				vk::Extent2D swapchainExtent,
-				vk::raii::DescriptorPool& descriptorPool
+				vk::raii::DescriptorPool& descriptorPool,
+				Encoding encoding = Encoding::Standard,
+				bool hasVisibility = false,
+				bool hasLightingOutput = false,
+				bool hasUpscale = false
 			);
+			~GBuffer();
 
+			vk::Extent2D GetExtent() const { return m_extent; }
+			Encoding GetEncoding() const { return m_encoding; }
+			bool HasVisibility() const { return m_hasVisibility; }
+			bool HasLightingOutput() const { return m_hasLightingOutput; }
+			bool HasUpscale() const { return m_hasUpscale; }
 			const std::vector<Attachment>& GetAttachments() const { return m_attachments; }
+			const Attachment& GetAttachment(AttachmentType type) const;
 			size_t GetAttachmentsCount() const { return m_attachments.size(); }
 			std::vector<vk::Format> GetColorAttachmentFormats() const;
 			vk::Format GetDepthFormat() const;
+			vk::Format GetVisibilityFormat() const;
+			vk::Format GetLightingOutputFormat() const;
 			const vk::raii::DescriptorSetLayout& GetDescriptorSetLayout() const { return m_descriptorSetLayout; }
 			const vk::raii::DescriptorSet& GetDescriptorSet() const { return m_descriptorSet; }
+			// Visibility attachment read by the resolve pass (visibility buffer path only)
+			const vk::raii::DescriptorSetLayout& GetVisibilityDescriptorSetLayout() const { return m_visibilityDescriptorSetLayout; }
+			const vk::raii::DescriptorSet& GetVisibilityDescriptorSet() const { return m_visibilityDescriptorSet; }
+			// Lighting output written by the compute lighting pass (compute lighting path only)
+			const vk::raii::DescriptorSetLayout& GetLightingOutputDescriptorSetLayout() const { return m_lightingOutputDescriptorSetLayout; }
+			const vk::raii::DescriptorSet& GetLightingOutputDescriptorSet() const { return m_lightingOutputDescriptorSet; }
+			// Lighting output sampled (bilinear) by the upscale pass (dynamic resolution only)
+			const vk::raii::DescriptorSetLayout& GetUpscaleDescriptorSetLayout() const { return m_upscaleDescriptorSetLayout; }
+			const vk::raii::DescriptorSet& GetUpscaleDescriptorSet() const { return m_upscaleDescriptorSet; }
 
 			void Recreate(
 				const Device& device,
@@ -39,20 +75,44 @@ namespace Felina
 				vk::raii::DescriptorPool& descriptorPool
 			);
 
+			const TransientAllocator::Footprint& GetFootprint() const { return m_transientAllocator->GetFootprint(); }
+			static std::vector<TransientAllocator::ImageRequest> GetAttachmentRequests(
+				vk::Extent2D extent, Encoding encoding,
+				bool hasVisibility = false, bool hasLightingOutput = false, bool hasUpscale = false
+			);
+			static bool IsEncodingSupported(const Device& device, Encoding encoding);
+			static bool IsLightingOutputSupported(const Device& device);
+			// Targets written by the geometry (or resolve) pass and sampled by the lighting pass
+			static bool IsGeometryTarget(AttachmentType type) { return type == BaseColor || type == MaterialInfo || type == Normal; }
+
 		private:
-			void CreateBaseColorAttachment(const Device& device, VmaAllocationCreateInfo allocCreateInfo);
-			void CreateMaterialInfoAttachment(const Device& device, VmaAllocationCreateInfo allocCreateInfo);
-			void CreateNormalAttachment(const Device& device, VmaAllocationCreateInfo allocCreateInfo);
-			void CreateDepthAttachment(const Device& device, VmaAllocationCreateInfo allocCreateInfo);
+			static std::vector<AttachmentType> GetAttachmentTypes(Encoding encoding, bool hasVisibility, bool hasLightingOutput);
+			static vk::ImageCreateInfo GetAttachmentCreateInfo(AttachmentType type, vk::Extent2D extent, Encoding encoding);
+			const Attachment& GetBindingAttachment(AttachmentType binding) const;
+
+			void CreateAttachments(const Device& device);
 			void CreateSampler(const Device& device);
 			void CreateDescriptorSetLayout(const Device& device);
 			void CreateDescriptorSets(const Device& device, vk::raii::DescriptorPool& descriptorPool);
 			void CleanUp();
 
 			vk::Extent2D m_extent;
+			Encoding m_encoding;
+			bool m_hasVisibility;
+			bool m_hasLightingOutput;
+			bool m_hasUpscale;
+			// NOTE: declared before the attachments since they're bound to its memory
+			std::unique_ptr<TransientAllocator> m_transientAllocator;
 			std::vector<Attachment> m_attachments;
 			vk::raii::Sampler m_sampler = nullptr;
+			vk::raii::Sampler m_upscaleSampler = nullptr;
 			vk::raii::DescriptorSetLayout m_descriptorSetLayout = nullptr;
 			vk::raii::DescriptorSet m_descriptorSet = nullptr;
+			vk::raii::DescriptorSetLayout m_visibilityDescriptorSetLayout = nullptr;
+			vk::raii::DescriptorSet m_visibilityDescriptorSet = nullptr;
+			vk::raii::DescriptorSetLayout m_lightingOutputDescriptorSetLayout = nullptr;
+			vk::raii::DescriptorSet m_lightingOutputDescriptorSet = nullptr;
+			vk::raii::DescriptorSetLayout m_upscaleDescriptorSetLayout = nullptr;
+			vk::raii::DescriptorSet m_upscaleDescriptorSet = nullptr;
 	};
 }
\ No newline at end of file
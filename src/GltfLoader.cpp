@@ -3,83 +3,335 @@
 #include "tiny_gltf.h"
 #include <glm/gtc/type_ptr.hpp>
 
+#include <optional>
+#include <cstdio>
+#include <cfloat>
+#include <algorithm>
+#include <map>
+#include <tuple>
+
 #include "Scene.hpp"
 #include "Renderer.hpp"
 #include "ResourceManager.hpp"
+#include "MeshProcessing.hpp"
 #include "Common.hpp"
 
 namespace Felina
 {
+	// Decodes the `components` of each element of `accessor` to floats and hands them to `write(index, values)`
+	// NOTE: normalized integers follow the glTF-2.0 rules, unnormalized ones (KHR_mesh_quantization) are converted as they are
+	template<typename Write>
+	static void ReadAttribute(const tinygltf::Model& model, const tinygltf::Accessor& accessor, int components, Write write)
+	{
+		auto& bufferView = model.bufferViews[accessor.bufferView];
+		auto& buffer = model.buffers[bufferView.buffer];
+		const uint8_t* start = buffer.data.data() + bufferView.byteOffset + accessor.byteOffset;
+		size_t stride = accessor.ByteStride(bufferView);
+		size_t componentSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(accessor.componentType));
+
+		float values[4];
+		for (size_t i = 0; i < accessor.count; i++)
+		{
+			const uint8_t* element = start + i * stride;
+			for (int c = 0; c < components; c++)
+			{
+				const uint8_t* raw = element + c * componentSize;
+				switch (accessor.componentType)
+				{
+					case TINYGLTF_COMPONENT_TYPE_FLOAT:
+						values[c] = *reinterpret_cast<const float*>(raw);
+						break;
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+						values[c] = accessor.normalized ? *raw / 255.0f : static_cast<float>(*raw);
+						break;
+					case TINYGLTF_COMPONENT_TYPE_BYTE:
+					{
+						float v = static_cast<float>(*reinterpret_cast<const int8_t*>(raw));
+						values[c] = accessor.normalized ? std::max(v / 127.0f, -1.0f) : v;
+						break;
+					}
+					case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+					{
+						float v = static_cast<float>(*reinterpret_cast<const uint16_t*>(raw));
+						values[c] = accessor.normalized ? v / 65535.0f : v;
+						break;
+					}
+					case TINYGLTF_COMPONENT_TYPE_SHORT:
+					{
+						float v = static_cast<float>(*reinterpret_cast<const int16_t*>(raw));
+						values[c] = accessor.normalized ? std::max(v / 32767.0f, -1.0f) : v;
+						break;
+					}
+					default:
+						throw std::runtime_error("[GltfLoader] Unsupported vertex attribute componentType!");
+				}
+			}
+			write(i, values);
+		}
+	}
+
+	// Grid of integer positions (KHR_mesh_quantization) on which they map exactly to unorm16,
+	// so that QuantizeMesh packs them again without any loss
+	static std::optional<PositionGrid> GetPositionGrid(const tinygltf::Accessor& accessor)
+	{
+		// Decoded value = (unorm16 - bias) / divisor
+		float bias = 0.0f, divisor = 1.0f;
+		switch (accessor.componentType)
+		{
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				divisor = accessor.normalized ? 255.0f : 1.0f;
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+				divisor = accessor.normalized ? 65535.0f : 1.0f;
+				break;
+			case TINYGLTF_COMPONENT_TYPE_BYTE:
+				bias = 32768.0f;
+				divisor = accessor.normalized ? 127.0f : 1.0f;
+				break;
+			case TINYGLTF_COMPONENT_TYPE_SHORT:
+				bias = 32768.0f;
+				divisor = accessor.normalized ? 32767.0f : 1.0f;
+				break;
+			default:
+				return std::nullopt; // floats, the grid is fitted to the bounds
+		}
+		return PositionGrid{ .offset = glm::vec3(-bias / divisor), .scale = glm::vec3(65535.0f / divisor) };
+	}
+
+	// Totals of the processing steps, logged once the meshes are loaded
+	struct ProcessingStats
+	{
+		// ACMR weighted by the triangles and ATVR by the vertices
+		double triangleCount = 0.0;
+		double vertexCountBefore = 0.0, vertexCountAfter = 0.0;
+		double missesBefore = 0.0, missesAfter = 0.0;
+		// Quantized meshes and their vertex data size in both formats
+		size_t quantizedMeshCount = 0;
+		size_t floatVertexBytes = 0, quantizedVertexBytes = 0;
+		// Meshes stored with 16-bit indices (see Mesh::NarrowIndices)
+		size_t narrowIndexMeshCount = 0;
+		// Triangles of all the LODs generated (full detail excluded)
+		size_t lodCount = 0, lodTriangleCount = 0;
+		// Meshlets built and the submeshes split in them
+		size_t meshletCount = 0, meshletSubmeshCount = 0;
+		size_t submeshCount = 0;
+	};
+
+	// Processed primitives merged in the buffers of a single mesh, before the quantization
+	// NOTE: kept after the load for the static batching, which reads the full detail triangles
+	struct MeshData
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<Meshlet> meshlets;
+		std::vector<Submesh> submeshes;
+	};
+
+	// Runs the enabled processing steps on a primitive (in place) and appends it to `meshData` as a submesh drawn
+	// with `material`, its index ranges (LODs and meshlets) are offset to the mesh buffers
+	static void AppendPrimitive(
+		std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, MaterialID material,
+		const GltfLoadOptions& options, MeshData& meshData, ProcessingStats& stats
+	)
+	{
+		if (options.optimizeMeshes)
+		{
+			VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+			stats.vertexCountBefore += static_cast<double>(vertices.size());
+			OptimizeMesh(vertices, indices);
+			VertexCacheStats after = AnalyzeVertexCache(indices, vertices.size());
+			stats.vertexCountAfter += static_cast<double>(vertices.size());
+
+			double triangles = static_cast<double>(indices.size() / 3);
+			stats.triangleCount += triangles;
+			stats.missesBefore += before.acmr * triangles;
+			stats.missesAfter += after.acmr * triangles;
+		}
+
+		// Full detail triangles reordered in meshlets, before the LODs are appended after them
+		std::vector<Meshlet> meshlets;
+		if (options.buildMeshlets)
+		{
+			BuildMeshlets(vertices, indices, meshlets);
+			stats.meshletCount += meshlets.size();
+			if (!meshlets.empty())
+				stats.meshletSubmeshCount++;
+		}
+
+		// Coarser levels appended to the index buffer
+		std::vector<MeshLod> lods;
+		if (options.generateLods)
+		{
+			GenerateLods(vertices, indices, lods);
+			stats.lodCount += lods.size() - 1;
+			for (size_t l = 1; l < lods.size(); l++)
+				stats.lodTriangleCount += lods[l].indexCount / 3;
+		}
+		else
+		{
+			lods = { MeshLod{ .firstIndex = 0, .indexCount = static_cast<uint32_t>(indices.size()), .error = 0.0f } };
+		}
+
+		// Append the primitive to the mesh buffers
+		uint32_t baseVertex = static_cast<uint32_t>(meshData.vertices.size());
+		uint32_t baseIndex = static_cast<uint32_t>(meshData.indices.size());
+		meshData.vertices.insert(meshData.vertices.end(), vertices.begin(), vertices.end());
+		for (uint32_t index : indices)
+			meshData.indices.push_back(baseVertex + index);
+		for (auto& lod : lods)
+			lod.firstIndex += baseIndex;
+		for (auto& meshlet : meshlets)
+			meshlet.firstIndex += baseIndex;
+
+		meshData.submeshes.push_back(Submesh{
+			.material = material,
+			.lods = std::move(lods),
+			.firstMeshlet = static_cast<uint32_t>(meshData.meshlets.size()),
+			.meshletCount = static_cast<uint32_t>(meshlets.size())
+		});
+		meshData.meshlets.insert(meshData.meshlets.end(), meshlets.begin(), meshlets.end());
+		stats.submeshCount++;
+	}
+
+	// Creates the mesh of `meshData`, packed in 16 bytes per vertex when it fits (the quantized input is packed again on its own grid)
+	static std::unique_ptr<Mesh> CreateMesh(
+		MeshData& meshData, const std::optional<PositionGrid>& sourceGrid, const GltfLoadOptions& options, ProcessingStats& stats
+	)
+	{
+		std::unique_ptr<Mesh> mesh;
+		if (options.quantizeVertices)
+		{
+			std::vector<QuantizedVertex> quantizedVertices;
+			glm::mat4 dequantization;
+			glm::vec4 uvDequantization;
+			VertexFormat format = QuantizeMesh(meshData.vertices, sourceGrid, quantizedVertices, dequantization, uvDequantization);
+			if (format != VertexFormat::Float)
+			{
+				stats.quantizedMeshCount++;
+				stats.floatVertexBytes += meshData.vertices.size() * sizeof(Vertex);
+				stats.quantizedVertexBytes += quantizedVertices.size() * sizeof(QuantizedVertex);
+				mesh = std::make_unique<Mesh>(quantizedVertices, meshData.indices, format, dequantization, uvDequantization);
+			}
+		}
+		if (!mesh)
+			mesh = std::make_unique<Mesh>(meshData.vertices, meshData.indices);
+
+		// Meshlets first, the submeshes reference them
+		mesh->SetMeshlets(meshData.meshlets);
+		mesh->SetSubmeshes(meshData.submeshes);
+		if (mesh->GetIndexType() == vk::IndexType::eUint16)
+			stats.narrowIndexMeshCount++;
+		return mesh;
+	}
+
+	static void LogProcessingStats(const ProcessingStats& stats, const GltfLoadOptions& options)
+	{
+		if (options.optimizeMeshes && stats.triangleCount > 0.0)
+		{
+			char report[256];
+			std::snprintf(
+				report, sizeof(report),
+				"[GltfLoader] Mesh optimization: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, vertices %.0f -> %.0f",
+				stats.missesBefore / stats.triangleCount, stats.missesAfter / stats.triangleCount,
+				stats.missesBefore / stats.vertexCountBefore, stats.missesAfter / stats.vertexCountAfter,
+				stats.vertexCountBefore, stats.vertexCountAfter
+			);
+			LOG(report);
+		}
+
+		if (options.quantizeVertices)
+		{
+			LOG(
+				"[GltfLoader] Vertex quantization: " + std::to_string(stats.quantizedMeshCount) + " meshes quantized, vertex data " +
+				std::to_string(stats.floatVertexBytes / 1024) + " KB -> " + std::to_string(stats.quantizedVertexBytes / 1024) + " KB"
+			);
+		}
+
+		if (options.generateLods)
+		{
+			LOG(
+				"[GltfLoader] LOD generation: " + std::to_string(stats.lodCount) + " levels, " +
+				std::to_string(stats.lodTriangleCount) + " triangles added to the index buffers"
+			);
+		}
+
+		if (options.buildMeshlets)
+		{
+			LOG(
+				"[GltfLoader] Meshlets: " + std::to_string(stats.meshletCount) + " built for " +
+				std::to_string(stats.meshletSubmeshCount) + " submeshes"
+			);
+		}
+	}
+
 	// Load all meshes in `model` and fill `meshes` with the corresponding MeshIDs
-	static void LoadMeshes(tinygltf::Model& model, Renderer& renderer, std::unordered_map<int, MeshID>& meshes)
+	// NOTE: the primitives of a glTF mesh are processed one by one, then merged in a single vertex and index
+	// buffer with a submesh per primitive (`materials` gives their MaterialIDs)
+	// NOTE: the statistics of the enabled processing steps are logged (vertex cache before and after
+	// the optimization, vertex data saved by the quantized formats, triangles of the LOD chains, meshlets)
+	// NOTE: `meshDatas` keeps the processed data of each mesh if not null (see BuildStaticBatches)
+	static void LoadMeshes(
+		tinygltf::Model& model, Renderer& renderer, const GltfLoadOptions& options, SceneResources& resources,
+		const std::unordered_map<int, MaterialID>& materials, std::unordered_map<int, MeshID>& meshes,
+		std::unordered_map<MeshID, MeshData>* meshDatas
+	)
 	{
 		auto& rm = ResourceManager::GetInstance();
+		ProcessingStats stats;
 		
 		// Iterate through all meshes and load them
 		for (size_t i = 0; i < model.meshes.size(); i++)
 		{
 			auto& mesh = model.meshes[i];
-			for (auto& primitive : mesh.primitives)
+
+			MeshData meshData;
+			// The quantized input is packed again on its own grid only if all the primitives share it
+			std::optional<PositionGrid> meshGrid;
+			for (size_t p = 0; p < mesh.primitives.size(); p++)
 			{
+				auto& primitive = mesh.primitives[p];
+
 				// NOTE: only mode currently supported is TRIANGLE_LIST (see PipelineBuilder.cpp)
 				if (primitive.mode != TINYGLTF_MODE_TRIANGLES)
 					throw std::runtime_error("[GltfLoader] Unsupported mode required!");
 
 				// Loading vertices
 				std::vector<Vertex> vertices;
+				std::optional<PositionGrid> sourceGrid;
 				{
-					// Vertex position
 					auto& posAccessor = model.accessors[primitive.attributes["POSITION"]];
-					auto& posBufferView = model.bufferViews[posAccessor.bufferView];
-					auto& posBuffer = model.buffers[posBufferView.buffer];
-					// Vertex normal
 					auto& normAccessor = model.accessors[primitive.attributes["NORMAL"]];
-					auto& normBufferView = model.bufferViews[normAccessor.bufferView];
-					auto& normBuffer = model.buffers[normBufferView.buffer];
-					// Vertex UVs
 					auto& uvAccessor = model.accessors[primitive.attributes["TEXCOORD_0"]];
-					auto& uvBufferView = model.bufferViews[uvAccessor.bufferView];
-					auto& uvBuffer = model.buffers[uvBufferView.buffer];
 
 					// The following assertion SHOULD be guaranteed by the implementation 
 					// of the glTF-2.0 specs, so these checks are just for safety
+					// NOTE: the component types are checked while reading (KHR_mesh_quantization allows integers)
 					assert(posAccessor.type == TINYGLTF_TYPE_VEC3 && "[GltfLoader] Unexpected type found for vertex position!");
-					assert(posAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && "[GltfLoader] Unexpected componentType found for vertex position!");
 					assert(normAccessor.type == TINYGLTF_TYPE_VEC3 && "[GltfLoader] Unexpected type found for vertex normal!");
-					assert(normAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && "[GltfLoader] Unexpected componentType found for vertex normal!");
 					assert(uvAccessor.type == TINYGLTF_TYPE_VEC2 && "[GltfLoader] Unexpected type found for uv!");
-					// TODO: add unsigned byte and unsigned short component type support
-					assert(uvAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && "[GltfLoader] Unexpected componentType found for vertex normal!");
-
-					// Reading data from the buffer
-					const uint8_t* posStart = posBuffer.data.data() + posBufferView.byteOffset + posAccessor.byteOffset;
-					const uint8_t* normStart = normBuffer.data.data() + normBufferView.byteOffset + normAccessor.byteOffset;
-					const uint8_t* uvStart = uvBuffer.data.data() + uvBufferView.byteOffset + uvAccessor.byteOffset;
-					size_t posStride = posAccessor.ByteStride(posBufferView);
-					size_t normStride = normAccessor.ByteStride(normBufferView);
-					size_t uvStride = uvAccessor.ByteStride(uvBufferView);
 
 					// The following assertion SHOULD be guaranteed by the implementation as well
 					assert(posAccessor.count == normAccessor.count && "[GltfLoader] Number of vertex positions and normals differ!");
 					assert(posAccessor.count == uvAccessor.count && "[GltfLoader] Number of vertex positions and uv differ!");
-					
+
 					vertices.resize(posAccessor.count);
-					for (size_t i = 0; i < posAccessor.count; i++)
-					{
-						const float* posPtr = reinterpret_cast<const float*>(posStart + i * posStride);
-						const float* normPtr = reinterpret_cast<const float*>(normStart + i * normStride);
-						const float* uvPtr = reinterpret_cast<const float*>(uvStart + i * uvStride);
+					ReadAttribute(model, posAccessor, 3, [&vertices](size_t i, const float* v) { vertices[i].pos = glm::vec3(v[0], v[1], v[2]); });
+					ReadAttribute(model, normAccessor, 3, [&vertices](size_t i, const float* v) { vertices[i].normal = glm::vec3(v[0], v[1], v[2]); });
+					ReadAttribute(model, uvAccessor, 2, [&vertices](size_t i, const float* v) { vertices[i].uv = glm::vec2(v[0], v[1]); });
 
-						vertices[i].pos = glm::vec3(posPtr[0], posPtr[1], posPtr[2]);
-						vertices[i].normal = glm::vec3(normPtr[0], normPtr[1], normPtr[2]);
-						vertices[i].uv = glm::vec2(uvPtr[0], uvPtr[1]);
-					}
+					sourceGrid = GetPositionGrid(posAccessor);
 				}
+				if (p == 0)
+					meshGrid = sourceGrid;
+				else if (meshGrid && (!sourceGrid || sourceGrid->offset != meshGrid->offset || sourceGrid->scale != meshGrid->scale))
+					meshGrid = std::nullopt;
 
 				// TODO: properly handle loading meshes without indices, by calling the correct draw call
 				assert(primitive.indices != -1 && "[GltfLoader] Indices are not the defined!");
 
 				// Loading indices
+				// NOTE: widened to 32-bit for the processing only, the mesh stores them back
+				// in 16-bit whenever its vertex count allows it
 				std::vector<uint32_t> indices;
 				{
 					auto& accessor = model.accessors[primitive.indices];
@@ -121,16 +373,28 @@ namespace Felina
 					}
 				}
 
-				// Create and load mesh
-				MeshID id = rm.LoadMesh(std::make_unique<Mesh>(vertices, indices), mesh.name, renderer);
-				meshes.insert(std::pair<int, MeshID>(static_cast<int>(i), id));
+				MaterialID material = primitive.material != -1 ? materials.at(primitive.material) : MaterialID(-1);
+				AppendPrimitive(vertices, indices, material, options, meshData, stats);
 			}
+
+			// Create and load mesh
+			std::unique_ptr<Mesh> loadedMesh = CreateMesh(meshData, meshGrid, options, stats);
+			MeshHandle handle = rm.LoadMesh(std::move(loadedMesh), mesh.name, renderer);
+			MeshID id = handle.GetID();
+			resources.meshes.push_back(std::move(handle));
+			meshes.insert(std::pair<int, MeshID>(static_cast<int>(i), id));
+			if (meshDatas)
+				meshDatas->emplace(id, std::move(meshData));
 		}
-		LOG("[GltfLoader] Loaded " + std::to_string(meshes.size()) + " meshes");
+		LOG(
+			"[GltfLoader] Loaded " + std::to_string(meshes.size()) + " meshes, " + std::to_string(stats.submeshCount) + " submeshes (" +
+			std::to_string(stats.narrowIndexMeshCount) + " meshes with 16-bit indices)"
+		);
+		LogProcessingStats(stats, options);
 	}
 
 	// Load all textures in `model` and fill `textures` with the corresponding TextureIDs
-	static void LoadTextures(tinygltf::Model& model, Renderer& renderer, std::unordered_map<int, TextureID>& textures)
+	static void LoadTextures(tinygltf::Model& model, Renderer& renderer, SceneResources& resources, std::unordered_map<int, TextureID>& textures)
 	{
 		auto& rm = ResourceManager::GetInstance();
 		for (size_t i = 0; i < model.textures.size(); i++)
@@ -164,14 +428,19 @@ namespace Felina
 			std::unique_ptr<Texture> tex = std::make_unique<Texture>(renderer.GetDevice(), imageInfo, allocInfo);
 
 			// Load texture
-			TextureID id = rm.LoadTexture(std::move(tex), texture.name, image.image.data(), image.image.size(), renderer);
+			TextureHandle handle = rm.LoadTexture(std::move(tex), texture.name, image.image.data(), image.image.size(), renderer);
+			TextureID id = handle.GetID();
+			resources.textures.push_back(std::move(handle));
 			textures.insert(std::pair<int, TextureID>(static_cast<int>(i), id));
 		}
 		LOG("[GltfLoader] Loaded " + std::to_string(textures.size()) + " textures");
 	}
 
 	// Load all materials in `model` and fill `materials` with the corresponding MaterialIDs
-	static void LoadMaterials(tinygltf::Model& model, std::unordered_map<int, TextureID>& textures, std::unordered_map<int, MaterialID>& materials)
+	static void LoadMaterials(
+		tinygltf::Model& model, SceneResources& resources,
+		std::unordered_map<int, TextureID>& textures, std::unordered_map<int, MaterialID>& materials
+	)
 	{
 		auto& rm = ResourceManager::GetInstance();
 		for (size_t i = 0; i < model.materials.size(); i++)
@@ -201,39 +470,50 @@ namespace Felina
 				(metallicRoughnessTexIndex == -1) ? -1 : textures[metallicRoughnessTexIndex]
 			);
 			
-			MaterialID id = rm.LoadMaterial(std::move(mat), material.name);
+			MaterialHandle handle = rm.LoadMaterial(std::move(mat), material.name);
+			MaterialID id = handle.GetID();
+			resources.materials.push_back(std::move(handle));
 			materials.insert(std::pair<int, MaterialID>(static_cast<int>(i), id));
 		}
 		LOG("[GltfLoader] Loaded " + std::to_string(materials.size()) + " materials");
 	}
 
+	// Convert a KHR_lights_punctual light attached to a node with world transform `world`
+	// NOTE: lights point towards the local -Z axis (see KHR_lights_punctual specs)
+	static std::optional<Light> LoadLight(const tinygltf::Light& gltfLight, const glm::mat4& world)
+	{
+		Light light{};
+		if (gltfLight.type == "point")
+			light.type = Light::Type::Point;
+		else if (gltfLight.type == "spot")
+			light.type = Light::Type::Spot;
+		else
+			return std::nullopt; // directional lights aren't clustered
+
+		light.position = glm::vec3(world[3]);
+		light.direction = glm::normalize(glm::vec3(world * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+		if (gltfLight.color.size() == 3)
+			light.color = glm::vec3(gltfLight.color[0], gltfLight.color[1], gltfLight.color[2]);
+		light.intensity = static_cast<float>(gltfLight.intensity);
+		light.range = static_cast<float>(gltfLight.range);
+		light.innerConeAngle = static_cast<float>(gltfLight.spot.innerConeAngle);
+		light.outerConeAngle = static_cast<float>(gltfLight.spot.outerConeAngle);
+		return light;
+	}
+
 	// Create object and iterate recursively through its children
+	// NOTE: lights attached to the nodes are collected in `lights` (world space)
 	static std::unique_ptr<Object> LoadNode(
-		const tinygltf::Node& node, Object* parent,
+		const tinygltf::Node& node, Object* parent, const glm::mat4& parentWorld,
 		const tinygltf::Model& model, 
-		const std::unordered_map<int, MeshID>& meshes, const std::unordered_map<int, MaterialID>& materials
+		const std::unordered_map<int, MeshID>& meshes, std::vector<Light>& lights
 	)
 	{
-		MeshID meshId{};
-		MaterialID materialId{};
-		if (node.mesh == -1)
-		{
-			meshId = -1;
-			materialId = -1;
-		}
-		else
-		{
-			meshId = meshes.at(node.mesh);
-			const tinygltf::Mesh& mesh = model.meshes[node.mesh];
-			
-			// Here it is assumed that if a mesh has multiple primitives,
-			// they'll be all rendered with the material used by the first one
-			// TODO: add submeshes support
-			materialId = materials.at(mesh.primitives[0].material);
-		}
+		// The materials come from the submeshes of the mesh (see LoadMeshes), the object doesn't override them
+		MeshID meshId = node.mesh == -1 ? MeshID(-1) : meshes.at(node.mesh);
 
 		// Object creation
-		std::unique_ptr<Object> obj = std::make_unique<Object>(node.name, meshId, materialId, parent);
+		std::unique_ptr<Object> obj = std::make_unique<Object>(node.name, meshId, MaterialID(-1), parent);
 
 		// Apply transform
 		// Transform -> see p.18 of glTF specs
@@ -253,15 +533,175 @@ namespace Felina
 				obj->SetPosition(glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
 		}
 			
+		// Punctual light (KHR_lights_punctual)
+		const glm::mat4 world = parentWorld * obj->GetModelMatrix();
+		if (node.light != -1)
+		{
+			if (auto light = LoadLight(model.lights[node.light], world))
+				lights.push_back(*light);
+			else
+				LOG("[GltfLoader] Skipping unsupported light type: " + model.lights[node.light].type);
+		}
+			
 		// Iterate over its children
 		for (const auto childIdx : node.children)
 		{
-			std::unique_ptr<Object> child = LoadNode(model.nodes[childIdx], obj.get(), model, meshes, materials);
+			std::unique_ptr<Object> child = LoadNode(model.nodes[childIdx], obj.get(), world, model, meshes, lights);
 			obj->AddChild(std::move(child)); // Move child object ownership to the parent
 		}
 		return std::move(obj);
 	}
 
+	// Submesh of a scene object merged by the static batching
+	struct BatchInstance
+	{
+		const MeshData* meshData;
+		const Submesh* submesh;
+		glm::mat4 world;
+	};
+
+	// Objects small enough for the static batching with their world matrices, and the draws of all the objects
+	static void CollectBatchObjects(
+		Object& obj, const glm::mat4& parentWorld, const std::unordered_map<MeshID, MeshData>& meshDatas,
+		std::vector<std::pair<Object*, glm::mat4>>& batchObjects, size_t& drawCount
+	)
+	{
+		glm::mat4 world = parentWorld * obj.GetModelMatrix();
+		if (obj.GetMesh() != MeshID(-1))
+		{
+			const MeshData& meshData = meshDatas.at(obj.GetMesh());
+			drawCount += meshData.submeshes.size();
+
+			uint32_t triangleCount = 0;
+			for (const auto& submesh : meshData.submeshes)
+				triangleCount += submesh.lods[0].indexCount / 3;
+			if (triangleCount <= STATIC_BATCH_MAX_OBJECT_TRIANGLES)
+				batchObjects.push_back({ &obj, world });
+		}
+
+		for (const auto& child : obj.GetChildren())
+			CollectBatchObjects(*child, world, meshDatas, batchObjects, drawCount);
+	}
+
+	// Merge the full detail triangles of the small objects sharing a material in world-space meshes, one per chunk
+	// of the scene bounds so that the batches are still culled (and split in meshlets) locally, and flag the originals
+	// as batched: they stay in the hierarchy for the selection and editing, and are drawn instead of the batches
+	// when the static batching is disabled in the renderer
+	// NOTE: the batches go through the same processing as the meshes (see AppendPrimitive) and keep 16-bit indices
+	static void BuildStaticBatches(
+		Scene& scene, Renderer& renderer, const GltfLoadOptions& options, const std::unordered_map<MeshID, MeshData>& meshDatas
+	)
+	{
+		auto& rm = ResourceManager::GetInstance();
+
+		size_t drawCount = 0;
+		std::vector<std::pair<Object*, glm::mat4>> batchObjects;
+		for (const auto& obj : scene.GetObjects())
+			CollectBatchObjects(*obj, glm::mat4(1.0f), meshDatas, batchObjects, drawCount);
+		if (batchObjects.empty())
+			return;
+
+		// Cubic chunks over the bounds of the object centers
+		std::vector<glm::vec3> centers;
+		centers.reserve(batchObjects.size());
+		glm::vec3 minCenter(FLT_MAX), maxCenter(-FLT_MAX);
+		for (const auto& [obj, world] : batchObjects)
+		{
+			glm::vec3 center = glm::vec3(world * glm::vec4(rm.GetMesh(obj->GetMesh()).GetBoundsCenter(), 1.0f));
+			centers.push_back(center);
+			minCenter = glm::min(minCenter, center);
+			maxCenter = glm::max(maxCenter, center);
+		}
+		glm::vec3 extent = maxCenter - minCenter;
+		float chunkSize = std::max({ extent.x, extent.y, extent.z }) / static_cast<float>(STATIC_BATCH_CHUNKS_PER_AXIS);
+		if (chunkSize <= 0.0f)
+			chunkSize = 1.0f;
+
+		// Submeshes grouped per material and chunk (ordered, so that the batches are the same on every load)
+		using BatchKey = std::tuple<MaterialID, int, int, int>;
+		std::map<BatchKey, std::vector<BatchInstance>> groups;
+		size_t batchedSubmeshCount = 0;
+		for (size_t i = 0; i < batchObjects.size(); i++)
+		{
+			const auto& [obj, world] = batchObjects[i];
+			glm::ivec3 chunk = glm::min(glm::ivec3((centers[i] - minCenter) / chunkSize), glm::ivec3(STATIC_BATCH_CHUNKS_PER_AXIS - 1));
+			const MeshData& meshData = meshDatas.at(obj->GetMesh());
+			for (const auto& submesh : meshData.submeshes)
+				groups[{ submesh.material, chunk.x, chunk.y, chunk.z }].push_back({ &meshData, &submesh, world });
+			batchedSubmeshCount += meshData.submeshes.size();
+			obj->SetStaticBatched(true);
+		}
+
+		ProcessingStats stats; // not logged, the batches are reported below
+		size_t batchCount = 0;
+		for (const auto& [key, instances] : groups)
+		{
+			MaterialID material = std::get<0>(key);
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			auto createBatch = [&]() {
+				MeshData batchData;
+				AppendPrimitive(vertices, indices, material, options, batchData, stats);
+				std::string name = "StaticBatch" + std::to_string(batchCount++);
+				MeshHandle handle = rm.LoadMesh(CreateMesh(batchData, std::nullopt, options, stats), name, renderer);
+				scene.AddStaticBatch(std::make_unique<Object>(name, handle.GetID()));
+				scene.GetResources().meshes.push_back(std::move(handle));
+				vertices.clear();
+				indices.clear();
+			};
+
+			std::vector<uint32_t> remap;
+			std::vector<Vertex> instanceVertices;
+			std::vector<uint32_t> instanceIndices;
+			for (const auto& instance : instances)
+			{
+				// Bake the world transform in the vertices referenced by the full detail triangles
+				const MeshLod& lod = instance.submesh->lods[0];
+				const std::vector<Vertex>& sourceVertices = instance.meshData->vertices;
+				glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.world)));
+				remap.assign(sourceVertices.size(), UINT32_MAX);
+				instanceVertices.clear();
+				instanceIndices.clear();
+				for (uint32_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i++)
+				{
+					uint32_t index = instance.meshData->indices[i];
+					if (remap[index] == UINT32_MAX)
+					{
+						remap[index] = static_cast<uint32_t>(instanceVertices.size());
+						const Vertex& vertex = sourceVertices[index];
+						instanceVertices.push_back(Vertex{
+							.pos = glm::vec3(instance.world * glm::vec4(vertex.pos, 1.0f)),
+							.normal = glm::normalize(normalMatrix * vertex.normal),
+							.uv = vertex.uv
+						});
+					}
+					instanceIndices.push_back(remap[index]);
+				}
+				// Mirroring transforms flip the winding, restore it since the batch is drawn with an identity transform
+				if (glm::determinant(glm::mat3(instance.world)) < 0.0f)
+				{
+					for (size_t t = 0; t + 2 < instanceIndices.size(); t += 3)
+						std::swap(instanceIndices[t + 1], instanceIndices[t + 2]);
+				}
+
+				if (vertices.size() + instanceVertices.size() > STATIC_BATCH_MAX_VERTICES)
+					createBatch();
+				uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+				vertices.insert(vertices.end(), instanceVertices.begin(), instanceVertices.end());
+				for (uint32_t index : instanceIndices)
+					indices.push_back(baseVertex + index);
+			}
+			if (!indices.empty())
+				createBatch();
+		}
+
+		LOG(
+			"[GltfLoader] Static batching: " + std::to_string(batchObjects.size()) + " objects merged in " +
+			std::to_string(batchCount) + " batches, draws " + std::to_string(drawCount) + " -> " +
+			std::to_string(drawCount - batchedSubmeshCount + batchCount)
+		);
+	}
+
 	// Parse filepath (either .glb or .gltf file) into model using tinygltf
 	static void ParseFile(const std::filesystem::path& filepath, tinygltf::Model& model)
 	{
@@ -297,26 +737,38 @@ namespace Felina
 	//    - `renderer` is used to call backend functions for loading resources
 	//    - `filepath` must be a valid path to either a .gltf or .glb file, 
 	//       otherwise an exception will be raised
-	void LoadSceneFromGlTF(const std::filesystem::path& filepath, Scene& scene, Renderer& renderer)
+	void LoadSceneFromGlTF(const std::filesystem::path& filepath, Scene& scene, Renderer& renderer, const GltfLoadOptions& options)
 	{
 		// File parsing
 		tinygltf::Model model;
 		ParseFile(filepath, model); // Bottleneck D:
 
 		// Load resources
-		// NOTE: texture MUST be loaded before materials!
+		// NOTE: texture MUST be loaded before materials, and materials before meshes (referenced by the submeshes)!
 		std::unordered_map<int, MeshID>	meshes; // Look-up between glTF indices and ResourceID
 		std::unordered_map<int, TextureID> textures;
 		std::unordered_map<int, MaterialID> materials;
-		LoadMeshes(model, renderer, meshes);
-		LoadTextures(model, renderer, textures);
-		LoadMaterials(model, textures, materials);
+		std::unordered_map<MeshID, MeshData> meshDatas; // processed geometry, kept for the static batching only
+		// NOTE: the scene keeps a handle to each of them, released to the cache of the ResourceManager on unload
+		SceneResources& resources = scene.GetResources();
+		LoadTextures(model, renderer, resources, textures);
+		LoadMaterials(model, resources, textures, materials);
+		LoadMeshes(model, renderer, options, resources, materials, meshes, options.staticBatching ? &meshDatas : nullptr);
 
 		// Iterate through each top-level node (parent = nullptr)
+		std::vector<Light> lights;
 		for (const auto nodeIdx : model.scenes[model.defaultScene].nodes)
 		{
-			std::unique_ptr<Object> obj = LoadNode(model.nodes[nodeIdx], nullptr, model, meshes, materials);
+			std::unique_ptr<Object> obj = LoadNode(model.nodes[nodeIdx], nullptr, glm::mat4(1.0f), model, meshes, lights);
 			scene.AddObject(std::move(obj)); // Move top-level object ownership to the scene
 		}
+
+		// NOTE: after the hierarchy, the batches bake the world transforms
+		if (options.staticBatching)
+			BuildStaticBatches(scene, renderer, options, meshDatas);
+
+		for (const auto& light : lights)
+			scene.AddLight(light);
+		LOG("[GltfLoader] Loaded " + std::to_string(lights.size()) + " punctual lights");
 	}
 }
\ No newline at end of file
@@ -1,10 +1,31 @@
 #pragma once
 
 #include <filesystem>
+#include <cstdint>
 
 namespace Felina {
 	class Scene;
 	class Renderer;
 
-	void LoadSceneFromGlTF(const std::filesystem::path& filepath, Scene& scene, Renderer& renderer);
+	struct GltfLoadOptions
+	{
+		// Deduplicate the vertices and reorder them and the triangles (see MeshProcessing.hpp)
+		bool optimizeMeshes = true;
+		// Pack the vertices in 16 bytes when the mesh bounds allow it (see QuantizeMesh in MeshProcessing.hpp)
+		bool quantizeVertices = true;
+		// Append simplified levels of detail to the index buffers (see GenerateLods in MeshProcessing.hpp)
+		bool generateLods = true;
+		// Split the full detail triangles in meshlets culled on the GPU (see BuildMeshlets in MeshProcessing.hpp)
+		bool buildMeshlets = true;
+		// Merge the small objects sharing a material in world-space batches, per chunk of the scene (see BuildStaticBatches)
+		bool staticBatching = true;
+	};
+
+	// Static batching: objects up to this many triangles are merged, in batches of up to 65536 vertices (16-bit indices)
+	// per material and chunk, the bounds of the objects being split in up to 4x4x4 cubic chunks
+	constexpr uint32_t STATIC_BATCH_MAX_OBJECT_TRIANGLES = 4096;
+	constexpr uint32_t STATIC_BATCH_MAX_VERTICES = 65536;
+	constexpr uint32_t STATIC_BATCH_CHUNKS_PER_AXIS = 4;
+
+	void LoadSceneFromGlTF(const std::filesystem::path& filepath, Scene& scene, Renderer& renderer, const GltfLoadOptions& options = {});
 }
\ No newline at end of file
@@ -26,4 +26,10 @@ namespace Felina
 		m_mouseX = xpos;
 		m_mouseY = ypos;
 	}
+
+	void Input::OnMouseEvent()
+	{
+		if (!m_pendingMouseEventTime)
+			m_pendingMouseEventTime = std::chrono::steady_clock::now();
+	}
 }
\ No newline at end of file
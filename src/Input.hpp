@@ -1,6 +1,8 @@
 #pragma once
 
 #include <utility>
+#include <chrono>
+#include <optional>
 
 namespace Felina
 {
@@ -22,10 +24,17 @@ namespace Felina
 			inline double GetMouseScroll() { return std::exchange(m_mouseScroll, 0.0); }
 			inline void SetMouseScroll(double amount) { m_mouseScroll = amount * SCROLL_SENSITIVITY; }
 
+			// Mouse events timestamping (used to measure input-to-present latency)
+			// NOTE: only the oldest event not consumed by a frame is kept
+			void OnMouseEvent();
+			inline std::optional<std::chrono::steady_clock::time_point> ConsumeMouseEventTime() { return std::exchange(m_pendingMouseEventTime, std::nullopt); }
+
 		private:
 			// Normalized [0,1] mouse input
 			double m_mouseX{ 0.0 };
 			double m_mouseY{ 0.0 };
 			double m_mouseScroll{ 0.0 };
+
+			std::optional<std::chrono::steady_clock::time_point> m_pendingMouseEventTime;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "LatencyTracer.hpp"
+
+#include "Common.hpp"
+
+#include <fstream>
+#include <algorithm>
+
+namespace Felina
+{
+	void LatencyTracer::Record(Clock::time_point event, Clock::time_point latch, Clock::time_point present)
+	{
+		m_samples.push_back({ event, latch, present });
+	}
+
+	// Write the trace as CSV (timings in microseconds, relative to the first event)
+	// and log a short summary of the input-to-present latency
+	void LatencyTracer::Save(const std::filesystem::path& filepath) const
+	{
+		if (m_samples.empty())
+		{
+			LOG("[LatencyTracer] No mouse events recorded, nothing to save.");
+			return;
+		}
+
+		std::ofstream file(filepath);
+		if (!file.is_open())
+			throw std::runtime_error("[LatencyTracer] Failed to open file: " + filepath.string());
+
+		auto toMicroseconds = [](Clock::duration d) {
+			return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+		};
+
+		const Clock::time_point origin = m_samples.front().event;
+		std::vector<long long> latencies;
+		latencies.reserve(m_samples.size());
+
+		file << "event_us,latch_us,present_us,event_to_latch_us,event_to_present_us\n";
+		for (const auto& s : m_samples)
+		{
+			long long eventToPresent = toMicroseconds(s.present - s.event);
+			latencies.push_back(eventToPresent);
+
+			file << toMicroseconds(s.event - origin) << ','
+				<< toMicroseconds(s.latch - origin) << ','
+				<< toMicroseconds(s.present - origin) << ','
+				<< toMicroseconds(s.latch - s.event) << ','
+				<< eventToPresent << '\n';
+		}
+
+		// Summary
+		std::sort(latencies.begin(), latencies.end());
+		long long sum = 0;
+		for (auto l : latencies)
+			sum += l;
+		double mean = static_cast<double>(sum) / latencies.size();
+		long long p99 = latencies[std::min(latencies.size() - 1, (latencies.size() * 99) / 100)];
+
+		LOG("[LatencyTracer] Saved " + std::to_string(m_samples.size()) + " samples to " + filepath.string());
+		LOG("[LatencyTracer] Input-to-present latency: mean " + std::to_string(mean / 1000.0) + " ms, "
+			+ "p99 " + std::to_string(p99 / 1000.0) + " ms, "
+			+ "max " + std::to_string(latencies.back() / 1000.0) + " ms");
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <filesystem>
+
+namespace Felina
+{
+	// Records, for each frame that consumed a mouse event, the timestamps of
+	// the event itself, of the moment the camera was latched into the UBO and
+	// of the moment the frame was handed over to the presentation engine
+	class LatencyTracer
+	{
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			struct Sample
+			{
+				Clock::time_point event;
+				Clock::time_point latch;
+				Clock::time_point present;
+			};
+
+			LatencyTracer() = default;
+
+			void Record(Clock::time_point event, Clock::time_point latch, Clock::time_point present);
+			void Save(const std::filesystem::path& filepath) const;
+
+			size_t GetSampleCount() const { return m_samples.size(); }
+
+		private:
+			std::vector<Sample> m_samples;
+	};
+}
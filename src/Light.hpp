@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Felina
+{
+	// Sun light of the scene (casts the cascaded shadows, see ShadowMap)
+	struct DirectionalLight
+	{
+		glm::vec3 direction = glm::normalize(glm::vec3(1.0f, 1.0f, -1.0f)); // direction the light travels
+		glm::vec3 color = glm::vec3(1.0f);
+		float intensity = 1.0f;
+	};
+
+	// Punctual light (KHR_lights_punctual) in world space
+	struct Light
+	{
+		// NOTE: must match the LIGHT_TYPE_* defines in lights.hlsli
+		enum class Type { Point = 0, Spot };
+
+		// Radiance under which a light is considered negligible (see GetRange)
+		static constexpr float INTENSITY_CUTOFF = 0.01f;
+
+		Type type = Type::Point;
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f); // spot only
+		glm::vec3 color = glm::vec3(1.0f);
+		float intensity = 1.0f;
+		float range = 0.0f; // 0 -> infinite (glTF default)
+		// Spot cone angles (radians)
+		float innerConeAngle = 0.0f;
+		float outerConeAngle = glm::radians(45.0f);
+
+		// Lights must be bounded to be binned into clusters, an infinite range
+		// is replaced by the distance at which the inverse-square falloff reaches the cutoff
+		float GetRange() const
+		{
+			if (range > 0.0f)
+				return range;
+			float maxIntensity = std::max({ color.r, color.g, color.b }) * intensity;
+			return std::sqrt(maxIntensity / INTENSITY_CUTOFF);
+		}
+	};
+}
@@ -1,11 +1,20 @@
 #include "Application.hpp"
 
 #include <iostream>
+#include <string_view>
 
 // ENTRY POINT
-int main() 
+int main(int argc, char* argv[]) 
 {
 	Felina::Application app{ "Felina Renderer", 1280, 720 };
+
+	// Command line options
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string_view(argv[i]) == "--benchmark")
+			app.SetBenchmarkMode(true);
+	}
+
 	try 
 	{
 		app.Init();
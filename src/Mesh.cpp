@@ -3,11 +3,25 @@
 #include "Device.hpp"
 #include "Buffer.hpp"
 
+#include <algorithm>
+
 namespace Felina
 {
     Mesh::Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
         : m_vertices(vertices), m_indices(indices)
     {
+        InitData();
+    }
+
+    Mesh::Mesh(
+        std::vector<QuantizedVertex>& vertices, std::vector<uint32_t>& indices, VertexFormat format,
+        const glm::mat4& dequantization, const glm::vec4& uvDequantization
+    )
+        : m_quantizedVertices(vertices), m_indices(indices), m_vertexFormat(format),
+        m_dequantization(dequantization), m_uvDequantization(uvDequantization)
+    {
+        assert(format != VertexFormat::Float && "[Mesh] Quantized vertices need a quantized format!");
+        InitData();
     }
 
     Mesh::Mesh(Mesh::Type type)
@@ -23,6 +37,7 @@ namespace Felina
             default:
                 break;
         }
+        InitData();
     }
 
     Mesh::~Mesh()
@@ -32,14 +47,14 @@ namespace Felina
 
 	void Mesh::Load(Device& device)
 	{
-        auto vertexDataSize = m_vertices.size() * sizeof(Vertex);
-        if (!m_indices.empty())
+        auto vertexDataSize = GetVertexDataSize();
+        if (GetIndexBufferSize() > 0)
         {
             // The mesh supports indices
-            auto indexDataSize = m_indices.size() * sizeof(m_indices[0]);
+            auto indexDataSize = GetIndexDataSize();
 
             // stagingSize should be equal to vertexDataSize most of the time
-            auto stagingSize = std::max(vertexDataSize, indexDataSize);
+            auto stagingSize = std::max({ vertexDataSize, indexDataSize, m_meshlets.size() * sizeof(Meshlet) });
             CreateStagingBuffer(device, stagingSize);
             CreateVertexBuffer(device, vertexDataSize);
             CreateIndexBuffer(device, indexDataSize);
@@ -51,6 +66,18 @@ namespace Felina
             CreateVertexBuffer(device, vertexDataSize);
         }
 
+        // Positions are a subset of the vertex data, the staging buffer is big enough
+        CreatePositionBuffer(device);
+        if (!m_meshlets.empty() && m_indexBuffer)
+            CreateMeshletBuffer(device);
+
+        // Addresses used by the visibility buffer resolve to fetch the vertices
+        m_vertexBufferAddress = device.GetDevice().getBufferAddress({ .buffer = m_vertexBuffer->GetHandle() });
+        if (m_indexBuffer)
+            m_indexBufferAddress = device.GetDevice().getBufferAddress({ .buffer = m_indexBuffer->GetHandle() });
+        if (m_meshletBuffer)
+            m_meshletBufferAddress = device.GetDevice().getBufferAddress({ .buffer = m_meshletBuffer->GetHandle() });
+
         // Once this line is reached the data has been transferred
         // correctly to GPU memory, so the staging buffer can be safely destroyed
         // since it won't be needed anymore
@@ -61,6 +88,127 @@ namespace Felina
     {
         m_vertexBuffer.reset();
         m_indexBuffer.reset();
+        m_positionBuffer.reset();
+        m_meshletBuffer.reset();
+        m_vertexBufferAddress = 0;
+        m_indexBufferAddress = 0;
+        m_meshletBufferAddress = 0;
+    }
+
+    size_t Mesh::GetVertexDataSize() const
+    {
+        if (m_vertexFormat == VertexFormat::Float)
+            return m_vertices.size() * sizeof(Vertex);
+        return m_quantizedVertices.size() * sizeof(QuantizedVertex);
+    }
+
+    size_t Mesh::GetIndexDataSize() const
+    {
+        if (m_indexType == vk::IndexType::eUint16)
+            return m_indices16.size() * sizeof(uint16_t);
+        return m_indices.size() * sizeof(uint32_t);
+    }
+
+    void Mesh::InitData()
+    {
+        NarrowIndices();
+        ComputeBounds();
+        m_submeshes = { Submesh{ .lods = { MeshLod{ .firstIndex = 0, .indexCount = static_cast<uint32_t>(GetIndexBufferSize()), .error = 0.0f } } } };
+    }
+
+    void Mesh::SetSubmeshes(const std::vector<Submesh>& submeshes)
+    {
+        assert(!submeshes.empty() && "[Mesh] A mesh needs at least one submesh!");
+        for (const auto& submesh : submeshes)
+        {
+            assert(!submesh.lods.empty() && "[Mesh] A submesh needs its full detail LOD!");
+            assert(submesh.firstMeshlet + submesh.meshletCount <= m_meshlets.size() && "[Mesh] Submesh meshlets out of range, set the meshlets first!");
+        }
+        m_submeshes = submeshes;
+    }
+
+    // NOTE: the float vertices are hashed per attribute, the aligned glm::vec3 have an undefined 4th component
+    uint64_t Mesh::HashContent(size_t& size) const
+    {
+        uint32_t format = static_cast<uint32_t>(m_vertexFormat);
+        uint64_t hash = HashBytes(&format, sizeof(format));
+        if (m_vertexFormat == VertexFormat::Float)
+        {
+            std::vector<float> attributes;
+            attributes.reserve(m_vertices.size() * 8);
+            for (const auto& vertex : m_vertices)
+                attributes.insert(attributes.end(), { vertex.pos.x, vertex.pos.y, vertex.pos.z, vertex.normal.x, vertex.normal.y, vertex.normal.z, vertex.uv.x, vertex.uv.y });
+            hash = HashBytes(attributes.data(), attributes.size() * sizeof(float), hash);
+        }
+        else
+        {
+            hash = HashBytes(m_quantizedVertices.data(), GetVertexDataSize(), hash);
+            hash = HashBytes(&m_dequantization, sizeof(m_dequantization), hash);
+            hash = HashBytes(&m_uvDequantization, sizeof(m_uvDequantization), hash);
+        }
+        if (m_indexType == vk::IndexType::eUint16)
+            hash = HashBytes(m_indices16.data(), GetIndexDataSize(), hash);
+        else
+            hash = HashBytes(m_indices.data(), GetIndexDataSize(), hash);
+        hash = HashBytes(m_meshlets.data(), m_meshlets.size() * sizeof(Meshlet), hash);
+
+        for (const auto& submesh : m_submeshes)
+        {
+            uint32_t ranges[3] = { submesh.material, submesh.firstMeshlet, submesh.meshletCount };
+            hash = HashBytes(ranges, sizeof(ranges), hash);
+            hash = HashBytes(submesh.lods.data(), submesh.lods.size() * sizeof(MeshLod), hash);
+        }
+
+        size = GetVertexDataSize() + GetIndexDataSize() + m_meshlets.size() * sizeof(Meshlet);
+        return hash;
+    }
+
+    // Sphere around the bounding box, good enough for the LOD selection
+    void Mesh::ComputeBounds()
+    {
+        std::vector<glm::vec3> positions;
+        if (m_vertexFormat == VertexFormat::Float)
+        {
+            positions.reserve(m_vertices.size());
+            for (const auto& vertex : m_vertices)
+                positions.push_back(vertex.pos);
+        }
+        else
+        {
+            positions.reserve(m_quantizedVertices.size());
+            for (const auto& vertex : m_quantizedVertices)
+            {
+                glm::vec4 unorm(vertex.pos[0] / 65535.0f, vertex.pos[1] / 65535.0f, vertex.pos[2] / 65535.0f, 1.0f);
+                positions.push_back(glm::vec3(m_dequantization * unorm));
+            }
+        }
+        if (positions.empty())
+            return;
+
+        glm::vec3 minPosition = positions[0], maxPosition = positions[0];
+        for (const auto& position : positions)
+        {
+            minPosition = glm::min(minPosition, position);
+            maxPosition = glm::max(maxPosition, position);
+        }
+        m_boundsCenter = 0.5f * (minPosition + maxPosition);
+        m_boundsRadius = 0.0f;
+        for (const auto& position : positions)
+            m_boundsRadius = std::max(m_boundsRadius, glm::length(position - m_boundsCenter));
+    }
+
+    // 16-bit indices whenever every vertex can be addressed, half the index memory and fetch bandwidth
+    // NOTE: primitive restart is disabled, so 0xFFFF is a regular index
+    void Mesh::NarrowIndices()
+    {
+        size_t vertexCount = m_vertexFormat == VertexFormat::Float ? m_vertices.size() : m_quantizedVertices.size();
+        if (m_indices.empty() || vertexCount > 65536)
+            return;
+
+        m_indices16.assign(m_indices.begin(), m_indices.end());
+        m_indices.clear();
+        m_indices.shrink_to_fit();
+        m_indexType = vk::IndexType::eUint16;
     }
 
     void Mesh::CreateCubeMesh()
@@ -232,7 +380,7 @@ namespace Felina
         VkBufferCreateInfo vertexInfo{};
         vertexInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         vertexInfo.size = size;
-        vertexInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        vertexInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
         vertexInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
         VmaAllocationCreateInfo vertexAllocInfo{};
@@ -241,7 +389,10 @@ namespace Felina
         m_vertexBuffer = std::make_unique<Buffer>(device.GetAllocator(), vertexInfo, vertexAllocInfo);
 
         // Load vertex data on the staging buffer
-        m_stagingBuffer->LoadData(m_vertices.data(), size);
+        if (m_vertexFormat == VertexFormat::Float)
+            m_stagingBuffer->LoadData(m_vertices.data(), size);
+        else
+            m_stagingBuffer->LoadData(m_quantizedVertices.data(), size);
 
         // Issue request to copy vertex data loaded on the staging buffer to GPU memory
         device.CopyBuffer(*m_stagingBuffer, *m_vertexBuffer, size);
@@ -252,7 +403,7 @@ namespace Felina
         VkBufferCreateInfo indexInfo{};
         indexInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         indexInfo.size = size;
-        indexInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        indexInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
         indexInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
         VmaAllocationCreateInfo indexAllocInfo{};
@@ -261,9 +412,77 @@ namespace Felina
         m_indexBuffer = std::make_unique<Buffer>(device.GetAllocator(), indexInfo, indexAllocInfo);
 
         // Load index data on the staging buffer
-        m_stagingBuffer->LoadData(m_indices.data(), size);
+        if (m_indexType == vk::IndexType::eUint16)
+            m_stagingBuffer->LoadData(m_indices16.data(), size);
+        else
+            m_stagingBuffer->LoadData(m_indices.data(), size);
 
         // Issue request to copy index data loaded on the staging buffer to GPU memory
         device.CopyBuffer(*m_stagingBuffer, *m_indexBuffer, size);
     }
+
+    void Mesh::CreatePositionBuffer(Device& device)
+    {
+        // Same encoding as the vertex buffer, so that the depth-only passes and the
+        // geometry pass compute identical depths (EQUAL test after the pre-pass)
+        std::vector<Vertex::Position> positions;
+        std::vector<QuantizedVertex::Position> quantizedPositions;
+        const void* positionData = nullptr;
+        vk::DeviceSize size = 0;
+        if (m_vertexFormat == VertexFormat::Float)
+        {
+            positions.reserve(m_vertices.size());
+            for (const auto& vertex : m_vertices)
+                positions.emplace_back(vertex.pos);
+            positionData = positions.data();
+            size = positions.size() * sizeof(Vertex::Position);
+        }
+        else
+        {
+            quantizedPositions.reserve(m_quantizedVertices.size());
+            for (const auto& vertex : m_quantizedVertices)
+                quantizedPositions.push_back({ vertex.pos[0], vertex.pos[1], vertex.pos[2], vertex.pos[3] });
+            positionData = quantizedPositions.data();
+            size = quantizedPositions.size() * sizeof(QuantizedVertex::Position);
+        }
+
+        VkBufferCreateInfo positionInfo{};
+        positionInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        positionInfo.size = size;
+        positionInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        positionInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo positionAllocInfo{};
+        positionAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        m_positionBuffer = std::make_unique<Buffer>(device.GetAllocator(), positionInfo, positionAllocInfo);
+
+        // Load position data on the staging buffer
+        m_stagingBuffer->LoadData(positionData, size);
+
+        // Issue request to copy position data loaded on the staging buffer to GPU memory
+        device.CopyBuffer(*m_stagingBuffer, *m_positionBuffer, size);
+    }
+
+    void Mesh::CreateMeshletBuffer(Device& device)
+    {
+        vk::DeviceSize size = m_meshlets.size() * sizeof(Meshlet);
+
+        VkBufferCreateInfo meshletInfo{};
+        meshletInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        meshletInfo.size = size;
+        meshletInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+        meshletInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo meshletAllocInfo{};
+        meshletAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+        m_meshletBuffer = std::make_unique<Buffer>(device.GetAllocator(), meshletInfo, meshletAllocInfo);
+
+        // Load meshlet data on the staging buffer
+        m_stagingBuffer->LoadData(m_meshlets.data(), size);
+
+        // Issue request to copy meshlet data loaded on the staging buffer to GPU memory
+        device.CopyBuffer(*m_stagingBuffer, *m_meshletBuffer, size);
+    }
 }
\ No newline at end of file
@@ -2,13 +2,18 @@
 
 #include <vulkan/vulkan_raii.hpp>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_aligned.hpp>
 #include <vector>
+#include <array>
+
+#include "Common.hpp"
 
 namespace Felina 
 {
 	class Buffer;
 	class Device;
 
+	// NOTE: the layout is hardcoded in vertex.hlsli (vertex fetch)
 	struct Vertex
 	{
 		glm::vec3 pos;
@@ -29,6 +34,96 @@ namespace Felina
 				vk::VertexInputAttributeDescription(2, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, uv))
 			};
 		}
+
+		// Position-only stream (tightly packed) used by depth-only passes
+		using Position = glm::packed_vec3;
+
+		static vk::VertexInputBindingDescription GetPositionBindingDescription()
+		{
+			return { 0, sizeof(Position), vk::VertexInputRate::eVertex };
+		}
+
+		static std::array<vk::VertexInputAttributeDescription, 1> GetPositionAttributeDescriptions()
+		{
+			return { vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, 0) };
+		}
+	};
+
+	// Vertex buffer layout of a mesh, picked on load from its bounds (see QuantizeMesh in MeshProcessing.hpp)
+	// NOTE: must match VERTEX_FORMAT_* in vertex.hlsli, the pipelines reading vertices have one variant per format
+	enum class VertexFormat : uint32_t
+	{
+		Float = 0,			// Vertex (48 bytes)
+		Quantized,			// QuantizedVertex (16 bytes)
+		Count
+	};
+	constexpr uint32_t VERTEX_FORMAT_COUNT = static_cast<uint32_t>(VertexFormat::Count);
+
+	// NOTE: the layout is hardcoded in vertex.hlsli (vertex fetch)
+	struct QuantizedVertex
+	{
+		uint16_t pos[4];	// unorm16 in the mesh bounds, see Mesh::GetDequantization (w unused)
+		int16_t normal[2];	// snorm16 octahedral
+		uint16_t uv[2];		// unorm16 in the mesh uv bounds, see Mesh::GetUvDequantization
+
+		static vk::VertexInputBindingDescription GetBindingDescription()
+		{
+			return { 0, sizeof(QuantizedVertex), vk::VertexInputRate::eVertex };
+		}
+
+		// The shader inputs are the same as Vertex: the normal z is 0 and the normal is decoded in the shader
+		static std::array<vk::VertexInputAttributeDescription, 3> GetAttributeDescriptions()
+		{
+			return
+			{
+				vk::VertexInputAttributeDescription(0, 0, vk::Format::eR16G16B16A16Unorm, offsetof(QuantizedVertex, pos)),
+				vk::VertexInputAttributeDescription(1, 0, vk::Format::eR16G16Snorm, offsetof(QuantizedVertex, normal)),
+				vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16G16Unorm, offsetof(QuantizedVertex, uv))
+			};
+		}
+
+		// Position-only stream of the depth-only passes, same encoding as pos
+		using Position = std::array<uint16_t, 4>;
+
+		static vk::VertexInputBindingDescription GetPositionBindingDescription()
+		{
+			return { 0, sizeof(Position), vk::VertexInputRate::eVertex };
+		}
+
+		static std::array<vk::VertexInputAttributeDescription, 1> GetPositionAttributeDescriptions()
+		{
+			return { vk::VertexInputAttributeDescription(0, 0, vk::Format::eR16G16B16A16Unorm, 0) };
+		}
+	};
+
+	// Level of detail: range of the index buffer, all the levels share the vertex buffer (see GenerateLods in MeshProcessing.hpp)
+	struct MeshLod
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0.0f; // largest deviation from the full detail mesh, in mesh space
+	};
+
+	// Cluster of up to 64 vertices and 124 triangles, culled on its own by the meshlet culling pass
+	// (see BuildMeshlets in MeshProcessing.hpp), its triangles are a range of the full detail indices
+	// NOTE: must match Meshlet in meshlet_culling.comp.hlsl
+	struct Meshlet
+	{
+		glm::vec4 boundingSphere;	// xyz center, w radius (mesh space)
+		glm::vec4 cone;				// xyz axis, w cutoff: back-facing from the positions where dot(view, axis) >= cutoff
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t padding[2];
+	};
+
+	// Part of a mesh drawn with its own material (a glTF primitive), all the submeshes share the buffers of the mesh
+	// and each one is a separate draw with its own ObjectData
+	struct Submesh
+	{
+		MaterialID material = -1;		// -1 for the default material
+		std::vector<MeshLod> lods;		// full detail first, ranges of the mesh index buffer
+		uint32_t firstMeshlet = 0;		// range of the mesh meshlets splitting the full detail LOD (empty if not worth culling)
+		uint32_t meshletCount = 0;
 	};
 
 	class Mesh
@@ -37,6 +132,11 @@ namespace Felina
 			enum Type { CUBE = 0, SPHERE };
 		public:
 			Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+			// `dequantization` maps the unorm16 positions back to the mesh space, `uvDequantization` the unorm16 uvs (see QuantizeMesh)
+			Mesh(
+				std::vector<QuantizedVertex>& vertices, std::vector<uint32_t>& indices, VertexFormat format,
+				const glm::mat4& dequantization, const glm::vec4& uvDequantization
+			);
 			Mesh(Mesh::Type type); // Procedurally generate a mesh based on type
 			~Mesh();
 
@@ -51,9 +151,39 @@ namespace Felina
 				assert(m_indexBuffer && "Index buffer not initialized");
 				return *m_indexBuffer;
 			};
+			const Buffer& GetPositionBuffer() const { 
+				assert(m_positionBuffer && "Position buffer not initialized");
+				return *m_positionBuffer;
+			};
+
+			// GPU addresses of the buffers (0 if not loaded), used to fetch vertices from shaders
+			vk::DeviceAddress GetVertexBufferAddress() const { return m_vertexBufferAddress; }
+			vk::DeviceAddress GetIndexBufferAddress() const { return m_indexBufferAddress; }
+
+			VertexFormat GetVertexFormat() const { return m_vertexFormat; }
+			// Applied before the model matrix (identity for VertexFormat::Float)
+			const glm::mat4& GetDequantization() const { return m_dequantization; }
+			// Offset (xy) and scale (zw) of the uvs, applied in the shaders (identity for VertexFormat::Float)
+			const glm::vec4& GetUvDequantization() const { return m_uvDequantization; }
+			size_t GetVertexDataSize() const;
+
+			// Number of indices
+			size_t GetIndexBufferSize() const { return m_indexType == vk::IndexType::eUint16 ? m_indices16.size() : m_indices.size(); };
+			vk::IndexType GetIndexType() const { return m_indexType; };
+			size_t GetIndexDataSize() const;
 
-			size_t GetIndexBufferSize() const { return m_indices.size(); };
-			vk::IndexType GetIndexType() const { return vk::IndexType::eUint32; };
+			// A single submesh covering the whole index buffer (default material, no coarser LOD) if not set
+			void SetSubmeshes(const std::vector<Submesh>& submeshes);
+			const std::vector<Submesh>& GetSubmeshes() const { return m_submeshes; }
+			// Meshlets of all the submeshes, see Submesh::firstMeshlet
+			void SetMeshlets(const std::vector<Meshlet>& meshlets) { m_meshlets = meshlets; }
+			const std::vector<Meshlet>& GetMeshlets() const { return m_meshlets; }
+			vk::DeviceAddress GetMeshletBufferAddress() const { return m_meshletBufferAddress; }
+			// Hash of everything uploaded and drawn (buffers, format, submeshes), the bytes hashed go in `size`
+			uint64_t HashContent(size_t& size) const;
+			// Bounding sphere in mesh space (after the dequantization)
+			glm::vec3 GetBoundsCenter() const { return m_boundsCenter; }
+			float GetBoundsRadius() const { return m_boundsRadius; }
 
 		private:
 			void CreateCubeMesh();
@@ -63,12 +193,34 @@ namespace Felina
 			void DestroyStagingBuffer();
 			void CreateVertexBuffer(Device& device, vk::DeviceSize size);
 			void CreateIndexBuffer(Device& device, vk::DeviceSize size);
+			void CreatePositionBuffer(Device& device);
+			void CreateMeshletBuffer(Device& device);
+			void InitData(); // shared by the constructors
+			void NarrowIndices();
+			void ComputeBounds();
 
+			// Only one of the two is filled, depending on m_vertexFormat
 			std::vector<Vertex> m_vertices;
+			std::vector<QuantizedVertex> m_quantizedVertices;
+			// Only one of the two is filled, depending on m_indexType (see NarrowIndices)
 			std::vector<uint32_t> m_indices;
+			std::vector<uint16_t> m_indices16;
+			vk::IndexType m_indexType = vk::IndexType::eUint32;
+			VertexFormat m_vertexFormat = VertexFormat::Float;
+			glm::mat4 m_dequantization{ 1.0f };
+			glm::vec4 m_uvDequantization{ 0.0f, 0.0f, 1.0f, 1.0f };
+			std::vector<Submesh> m_submeshes;
+			glm::vec3 m_boundsCenter{ 0.0f };
+			float m_boundsRadius = 0.0f;
+			std::vector<Meshlet> m_meshlets;
 
 			std::unique_ptr<Buffer> m_stagingBuffer = nullptr;
 			std::unique_ptr<Buffer> m_vertexBuffer = nullptr;
 			std::unique_ptr<Buffer> m_indexBuffer = nullptr;
+			std::unique_ptr<Buffer> m_positionBuffer = nullptr; // positions only, see Vertex::Position
+			std::unique_ptr<Buffer> m_meshletBuffer = nullptr; // read by the meshlet culling pass through its address
+			vk::DeviceAddress m_vertexBufferAddress = 0;
+			vk::DeviceAddress m_indexBufferAddress = 0;
+			vk::DeviceAddress m_meshletBufferAddress = 0;
 	};
 }
\ No newline at end of file
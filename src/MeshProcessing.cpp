@@ -0,0 +1,234 @@
+#include "MeshProcessing.hpp"
+
+#include "Mesh.hpp"
+
+#include <meshoptimizer.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Felina
+{
+	// Octahedral encoding to [-1, 1], same mapping as encodeOctahedral in gbuffer.hlsli
+	static glm::vec2 EncodeOctahedral(glm::vec3 n)
+	{
+		n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		glm::vec2 e(n.x, n.y);
+		if (n.z < 0.0f)
+		{
+			glm::vec2 signs(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+			e = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signs;
+		}
+		return e;
+	}
+
+	static int16_t QuantizeSnorm16(float v)
+	{
+		return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		if (indices.empty() || vertexCount == 0)
+			return {};
+
+		meshopt_VertexCacheStatistics stats = meshopt_analyzeVertexCache(
+			indices.data(), indices.size(), vertexCount, VERTEX_CACHE_SIZE, 0, 0
+		);
+		return { stats.acmr, stats.atvr };
+	}
+
+	void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		if (indices.empty() || vertices.empty())
+			return;
+
+		// Deduplication, the attributes are compared separately since Vertex has padding (aligned vec3s)
+		const meshopt_Stream streams[] = {
+			{ &vertices[0].pos, sizeof(float) * 3, sizeof(Vertex) },
+			{ &vertices[0].normal, sizeof(float) * 3, sizeof(Vertex) },
+			{ &vertices[0].uv, sizeof(float) * 2, sizeof(Vertex) }
+		};
+		std::vector<uint32_t> remap(vertices.size());
+		size_t uniqueVertexCount = meshopt_generateVertexRemapMulti(
+			remap.data(), indices.data(), indices.size(), vertices.size(), streams, std::size(streams)
+		);
+
+		std::vector<Vertex> uniqueVertices(uniqueVertexCount);
+		meshopt_remapVertexBuffer(uniqueVertices.data(), vertices.data(), vertices.size(), sizeof(Vertex), remap.data());
+		meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+		vertices = std::move(uniqueVertices);
+
+		// Triangle order: vertex cache first, then overdraw on top of it
+		meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+		meshopt_optimizeOverdraw(
+			indices.data(), indices.data(), indices.size(),
+			&vertices[0].pos.x, vertices.size(), sizeof(Vertex), OVERDRAW_THRESHOLD
+		);
+
+		// Vertex order: the index buffer is rewritten to match
+		meshopt_optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+	}
+
+	void BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets)
+	{
+		meshlets.clear();
+		if (indices.size() <= MESHLET_MAX_TRIANGLES * 3 || vertices.empty())
+			return;
+
+		size_t maxMeshlets = meshopt_buildMeshletsBound(indices.size(), MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+		std::vector<meshopt_Meshlet> clusters(maxMeshlets);
+		std::vector<uint32_t> meshletVertices(maxMeshlets * MESHLET_MAX_VERTICES);
+		std::vector<uint8_t> meshletTriangles(maxMeshlets * MESHLET_MAX_TRIANGLES * 3);
+		size_t meshletCount = meshopt_buildMeshlets(
+			clusters.data(), meshletVertices.data(), meshletTriangles.data(), indices.data(), indices.size(),
+			&vertices[0].pos.x, vertices.size(), sizeof(Vertex),
+			MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, MESHLET_CONE_WEIGHT
+		);
+		if (meshletCount <= 1)
+			return;
+
+		// The meshlet local indices are turned back into mesh indices, the draws keep using the regular index buffer
+		std::vector<uint32_t> reordered;
+		reordered.reserve(indices.size());
+		meshlets.reserve(meshletCount);
+		for (size_t i = 0; i < meshletCount; i++)
+		{
+			const meshopt_Meshlet& cluster = clusters[i];
+			meshopt_Bounds bounds = meshopt_computeMeshletBounds(
+				&meshletVertices[cluster.vertex_offset], &meshletTriangles[cluster.triangle_offset], cluster.triangle_count,
+				&vertices[0].pos.x, vertices.size(), sizeof(Vertex)
+			);
+
+			meshlets.push_back(Meshlet{
+				.boundingSphere = glm::vec4(bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius),
+				.cone = glm::vec4(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2], bounds.cone_cutoff),
+				.firstIndex = static_cast<uint32_t>(reordered.size()),
+				.indexCount = cluster.triangle_count * 3,
+				.padding = { 0, 0 }
+			});
+			for (uint32_t t = 0; t < cluster.triangle_count * 3; t++)
+				reordered.push_back(meshletVertices[cluster.vertex_offset + meshletTriangles[cluster.triangle_offset + t]]);
+		}
+		indices = std::move(reordered);
+	}
+
+	void GenerateLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods)
+	{
+		lods.clear();
+		lods.push_back(MeshLod{ .firstIndex = 0, .indexCount = static_cast<uint32_t>(indices.size()), .error = 0.0f });
+		if (indices.empty() || vertices.empty())
+			return;
+
+		// meshoptimizer reports relative errors
+		float scale = meshopt_simplifyScale(&vertices[0].pos.x, vertices.size(), sizeof(Vertex));
+
+		std::vector<uint32_t> source(indices);
+		float error = 0.0f;
+		while (lods.size() < MAX_MESH_LODS)
+		{
+			size_t targetIndexCount = static_cast<size_t>(source.size() * LOD_REDUCTION) / 3 * 3;
+			std::vector<uint32_t> lod(source.size());
+			float lodError = 0.0f;
+			size_t indexCount = meshopt_simplify(
+				lod.data(), source.data(), source.size(),
+				&vertices[0].pos.x, vertices.size(), sizeof(Vertex),
+				targetIndexCount, LOD_MAX_RELATIVE_ERROR, 0, &lodError
+			);
+
+			// Stalled (error bound reached or topology locked), the level wouldn't be worth its memory
+			if (indexCount == 0 || indexCount > source.size() * (1.0f + LOD_REDUCTION) / 2.0f)
+				break;
+
+			lod.resize(indexCount);
+			meshopt_optimizeVertexCache(lod.data(), lod.data(), lod.size(), vertices.size());
+
+			// Measured against the previous level, so the deviations add up along the chain
+			error += lodError * scale;
+			lods.push_back(MeshLod{
+				.firstIndex = static_cast<uint32_t>(indices.size()),
+				.indexCount = static_cast<uint32_t>(lod.size()),
+				.error = error
+			});
+			indices.insert(indices.end(), lod.begin(), lod.end());
+			source = std::move(lod);
+		}
+	}
+
+	VertexFormat QuantizeMesh(
+		const std::vector<Vertex>& vertices, const std::optional<PositionGrid>& sourceGrid,
+		std::vector<QuantizedVertex>& quantized, glm::mat4& dequantization, glm::vec4& uvDequantization
+	)
+	{
+		quantized.clear();
+		dequantization = glm::mat4(1.0f);
+		uvDequantization = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		if (vertices.empty())
+			return VertexFormat::Float;
+
+		glm::vec3 minPosition(vertices[0].pos), maxPosition(vertices[0].pos);
+		glm::vec2 minUv(vertices[0].uv), maxUv(vertices[0].uv);
+		for (const auto& vertex : vertices)
+		{
+			minPosition = glm::min(minPosition, vertex.pos);
+			maxPosition = glm::max(maxPosition, vertex.pos);
+			minUv = glm::min(minUv, vertex.uv);
+			maxUv = glm::max(maxUv, vertex.uv);
+		}
+
+		PositionGrid grid;
+		if (sourceGrid)
+			grid = *sourceGrid;
+		else
+		{
+			// Half a step of error at most (rounding)
+			glm::vec3 extent = maxPosition - minPosition;
+			float maxError = 0.5f * std::max({ extent.x, extent.y, extent.z }) / 65535.0f;
+			if (maxError > POSITION_QUANTIZATION_MAX_ERROR)
+				return VertexFormat::Float;
+
+			// Flat meshes keep a non-zero scale, the matrix has to stay invertible for the normal matrix
+			grid.offset = minPosition;
+			grid.scale = glm::max(extent, glm::vec3(1e-6f));
+		}
+
+		// The uvs in [0, 1] keep the identity, the others are fitted to their bounds the same way as the positions
+		glm::vec2 uvOffset(0.0f), uvScale(1.0f);
+		if (glm::any(glm::lessThan(minUv, glm::vec2(0.0f))) || glm::any(glm::greaterThan(maxUv, glm::vec2(1.0f))))
+		{
+			glm::vec2 extent = maxUv - minUv;
+			float maxError = 0.5f * std::max(extent.x, extent.y) / 65535.0f;
+			if (maxError > UV_QUANTIZATION_MAX_ERROR)
+				return VertexFormat::Float;
+
+			uvOffset = minUv;
+			uvScale = glm::max(extent, glm::vec2(1e-6f));
+		}
+
+		quantized.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const Vertex& vertex = vertices[i];
+			QuantizedVertex& q = quantized[i];
+
+			glm::vec3 unorm = glm::clamp((vertex.pos - grid.offset) / grid.scale, 0.0f, 1.0f);
+			q.pos[0] = static_cast<uint16_t>(meshopt_quantizeUnorm(unorm.x, 16));
+			q.pos[1] = static_cast<uint16_t>(meshopt_quantizeUnorm(unorm.y, 16));
+			q.pos[2] = static_cast<uint16_t>(meshopt_quantizeUnorm(unorm.z, 16));
+			q.pos[3] = 0;
+
+			glm::vec2 octahedral = EncodeOctahedral(glm::normalize(vertex.normal));
+			q.normal[0] = QuantizeSnorm16(octahedral.x);
+			q.normal[1] = QuantizeSnorm16(octahedral.y);
+
+			glm::vec2 uv = glm::clamp((vertex.uv - uvOffset) / uvScale, 0.0f, 1.0f);
+			q.uv[0] = static_cast<uint16_t>(meshopt_quantizeUnorm(uv.x, 16));
+			q.uv[1] = static_cast<uint16_t>(meshopt_quantizeUnorm(uv.y, 16));
+		}
+
+		dequantization = glm::scale(glm::translate(glm::mat4(1.0f), grid.offset), grid.scale);
+		uvDequantization = glm::vec4(uvOffset, uvScale);
+		return VertexFormat::Quantized;
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <optional>
+
+namespace Felina
+{
+	struct Vertex;
+	struct QuantizedVertex;
+	struct MeshLod;
+	struct Meshlet;
+	enum class VertexFormat : uint32_t;
+
+	// Post-transform vertex cache efficiency of an indexed triangle list
+	// - ACMR: average cache miss ratio, vertices transformed per triangle (0.5 at best, 3 at worst)
+	// - ATVR: average transformed vertex ratio, vertices transformed per vertex (1 at best)
+	struct VertexCacheStats
+	{
+		float acmr = 0.0f;
+		float atvr = 0.0f;
+	};
+
+	// Simulated FIFO cache size used by the analysis, close to the post-transform cache of current GPUs
+	constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+	// Allowed ACMR degradation when reordering the triangles against overdraw
+	constexpr float OVERDRAW_THRESHOLD = 1.05f;
+	// Largest position error (mesh space units) accepted when the positions are quantized in the mesh bounds
+	constexpr float POSITION_QUANTIZATION_MAX_ERROR = 0.0005f;
+	// Largest uv error accepted when the uvs are quantized in the mesh uv bounds (a quarter of a texel at 4096)
+	constexpr float UV_QUANTIZATION_MAX_ERROR = 1.0f / 16384.0f;
+	// LOD chain: levels including the full detail one, triangles kept by each level from the previous one,
+	// and largest error of a level relative to the mesh extent (the simplification stops before it)
+	constexpr uint32_t MAX_MESH_LODS = 5;
+	constexpr float LOD_REDUCTION = 0.5f;
+	constexpr float LOD_MAX_RELATIVE_ERROR = 0.05f;
+	// Meshlet limits (the values recommended by meshoptimizer for NVIDIA hardware), and weight of the normal
+	// cones against the spatial locality when the triangles are grouped (0 ignores the cones)
+	constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+	constexpr float MESHLET_CONE_WEIGHT = 0.25f;
+
+	// Grid of the unorm16 positions: position = offset + scale * unorm
+	struct PositionGrid
+	{
+		glm::vec3 offset{ 0.0f };
+		glm::vec3 scale{ 1.0f };
+	};
+
+	VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+
+	// Mesh processing run on load (meshoptimizer), in place:
+	// 1. identical vertices are merged (exact comparison of position, normal and uv)
+	// 2. triangles are reordered for the post-transform cache
+	// 3. then reordered in clusters for overdraw, keeping the ACMR within OVERDRAW_THRESHOLD
+	// 4. vertices are reordered by first use for the vertex fetch
+	void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Splits the triangles in meshlets and rewrites `indices` in meshlet order, so that each meshlet is
+	// a contiguous range of it; `meshlets` gets their bounding spheres and normal cones (mesh space)
+	// NOTE: meshes fitting a single meshlet are left untouched, `meshlets` stays empty
+	void BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets);
+
+	// Appends the coarser levels to `indices` (edge collapses, each level simplified from the previous one)
+	// and fills `lods` with the full detail level followed by them
+	// NOTE: the chain stops early when a level doesn't remove enough triangles within the error bound
+	void GenerateLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods);
+
+	// Packs `vertices` in a QuantizedVertex format and returns it, or VertexFormat::Float (and leaves `quantized` empty)
+	// if the mesh doesn't fit: positions or uvs too far apart for POSITION_QUANTIZATION_MAX_ERROR or UV_QUANTIZATION_MAX_ERROR
+	// - `sourceGrid`: grid the positions were already quantized on (KHR_mesh_quantization), they're packed
+	//   again on it without any loss, otherwise the grid is fitted to the mesh bounds
+	// - `dequantization`: matrix turning the unorm positions back into mesh space
+	// - `uvDequantization`: offset (xy) and scale (zw) turning the unorm uvs back into the source uvs
+	VertexFormat QuantizeMesh(
+		const std::vector<Vertex>& vertices, const std::optional<PositionGrid>& sourceGrid,
+		std::vector<QuantizedVertex>& quantized, glm::mat4& dequantization, glm::vec4& uvDequantization
+	);
+}
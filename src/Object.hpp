@@ -15,8 +15,11 @@ namespace Felina
 			{}
 			
 			// Resources
+			// The material overrides the ones of the mesh submeshes, -1 draws each submesh with its own
 			void SetMaterial(MaterialID id) { m_material = id; }
 			void SetMesh(MeshID id) { m_mesh = id; }
+			// Geometry merged in a static batch of the scene, drawn by it while the static batching is enabled
+			void SetStaticBatched(bool isBatched) { m_isStaticBatched = isBatched; }
 
 			// Children
 			void AddChild(std::unique_ptr<Object> child);
@@ -26,6 +29,7 @@ namespace Felina
 			const std::string& GetName() const { return m_name; }
 			MeshID GetMesh() const { return m_mesh; }
 			MaterialID GetMaterial() const { return m_material; }
+			bool IsStaticBatched() const { return m_isStaticBatched; }
 			glm::mat4 GetModelMatrix() const { return m_transform.GetMatrix(); }
 
 			// Transform
@@ -45,6 +49,7 @@ namespace Felina
 
 			MeshID m_mesh;
 			MaterialID m_material;
+			bool m_isStaticBatched = false;
 			
 			Transform m_transform;
 
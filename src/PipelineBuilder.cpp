@@ -1,9 +1,10 @@
 #include "PipelineBuilder.hpp"
 
-#include "Mesh.hpp"
 #include "Device.hpp"
 #include "Common.hpp"
 
+#include <cassert>
+
 namespace Felina
 {
 	PipelineBuilder::PipelineBuilder(const Device& device)
@@ -14,6 +15,10 @@ namespace Felina
 
 	std::pair<vk::raii::Pipeline, vk::raii::PipelineLayout> PipelineBuilder::BuildPipeline()
 	{
+		// Specialization constants
+		for (auto& stage : m_shaderStages)
+			stage.pSpecializationInfo = m_specializationEntries.empty() ? nullptr : &m_specializationInfo;
+
 		// Create pipeline layout
 		auto pipelineLayout = vk::raii::PipelineLayout(m_device.GetDevice(), m_pipelineLayoutInfo);
 
@@ -38,6 +43,74 @@ namespace Felina
 		return { std::move(pipeline), std::move(pipelineLayout) };
 	}
 
+	std::pair<vk::raii::Pipeline, vk::raii::PipelineLayout> PipelineBuilder::BuildComputePipeline()
+	{
+		assert(m_shaderStages.size() == 1 && m_shaderStages[0].stage == vk::ShaderStageFlagBits::eCompute
+			&& "[PipelineBuilder] A compute pipeline requires exactly one compute stage!");
+
+		// Specialization constants
+		m_shaderStages[0].pSpecializationInfo = m_specializationEntries.empty() ? nullptr : &m_specializationInfo;
+
+		// Create pipeline layout
+		auto pipelineLayout = vk::raii::PipelineLayout(m_device.GetDevice(), m_pipelineLayoutInfo);
+
+		// Create compute pipeline
+		vk::ComputePipelineCreateInfo pipelineInfo{
+			.stage = m_shaderStages[0],
+			.layout = pipelineLayout
+		};
+		auto pipeline = vk::raii::Pipeline(m_device.GetDevice(), nullptr, pipelineInfo);
+
+		return { std::move(pipeline), std::move(pipelineLayout) };
+	}
+
+	std::pair<std::vector<vk::raii::Pipeline>, vk::raii::PipelineLayout> PipelineBuilder::BuildVertexFormatPipelines()
+	{
+		// Specialization constant 1 is the vertex format, the others are kept
+		std::vector<uint32_t> specializationValues = m_specializationData;
+		if (specializationValues.size() < 2)
+			specializationValues.resize(2, 0);
+
+		for (auto& stage : m_shaderStages)
+			stage.pSpecializationInfo = &m_specializationInfo;
+
+		// Create pipeline layout (shared by all the variants)
+		auto pipelineLayout = vk::raii::PipelineLayout(m_device.GetDevice(), m_pipelineLayoutInfo);
+
+		std::vector<vk::raii::Pipeline> pipelines;
+		pipelines.reserve(VERTEX_FORMAT_COUNT);
+		for (uint32_t i = 0; i < VERTEX_FORMAT_COUNT; i++)
+		{
+			VertexFormat format = static_cast<VertexFormat>(i);
+			if (m_positionOnlyVertexInput)
+				EnablePositionOnlyVertexInput(format);
+			else
+				EnableVertexInput(format);
+
+			specializationValues[1] = i;
+			SetSpecializationConstants(specializationValues);
+
+			vk::GraphicsPipelineCreateInfo pipelineInfo{
+				.pNext = &m_rendering,
+				.stageCount = static_cast<uint32_t>(m_shaderStages.size()),
+				.pStages = m_shaderStages.data(),
+				.pVertexInputState = &m_vertexInput,
+				.pInputAssemblyState = &m_inputAssembly,
+				.pViewportState = &m_viewport,
+				.pRasterizationState = &m_rasterizer,
+				.pMultisampleState = &m_multisample,
+				.pDepthStencilState = &m_depthStencil,
+				.pColorBlendState = &m_colorBlend,
+				.pDynamicState = &m_dynamic,
+				.layout = pipelineLayout,
+				.renderPass = nullptr // Because we are using dynamic rendering
+			};
+			pipelines.emplace_back(m_device.GetDevice(), nullptr, pipelineInfo);
+		}
+
+		return { std::move(pipelines), std::move(pipelineLayout) };
+	}
+
 	void PipelineBuilder::Reset()
 	{
 		// Destroy shader modules first (RAII automatically)
@@ -45,6 +118,11 @@ namespace Felina
 		m_shaderStages.clear();
 		m_shaderEntryPoints.clear();
 
+		// Specialization constants
+		m_specializationData.clear();
+		m_specializationEntries.clear();
+		m_specializationInfo = vk::SpecializationInfo{};
+
 		// Color blending
 		m_colorBlendAttachments.clear();
 		m_colorBlend.attachmentCount = 0;
@@ -137,11 +215,62 @@ namespace Felina
 		m_rendering.depthAttachmentFormat = m_depthFormat;
 	}
 
-	void PipelineBuilder::EnableVertexInput()
+	void PipelineBuilder::SetSpecializationConstants(const std::vector<uint32_t>& values)
 	{
-		m_bindingDescription = Vertex::GetBindingDescription();
-		auto arr = Vertex::GetAttributeDescriptions();
-		m_attributeDescriptions = std::vector<vk::VertexInputAttributeDescription>(arr.begin(), arr.end());
+		// create a local copy until the pipeline is built
+		m_specializationData = values;
+		m_specializationEntries.resize(values.size());
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			m_specializationEntries[i] = vk::SpecializationMapEntry{
+				.constantID = static_cast<uint32_t>(i),
+				.offset = static_cast<uint32_t>(i * sizeof(uint32_t)),
+				.size = sizeof(uint32_t)
+			};
+		}
+
+		m_specializationInfo.mapEntryCount = static_cast<uint32_t>(m_specializationEntries.size());
+		m_specializationInfo.pMapEntries = m_specializationEntries.data();
+		m_specializationInfo.dataSize = m_specializationData.size() * sizeof(uint32_t);
+		m_specializationInfo.pData = m_specializationData.data();
+	}
+
+	void PipelineBuilder::EnableVertexInput(VertexFormat format)
+	{
+		if (format == VertexFormat::Float)
+		{
+			m_bindingDescription = Vertex::GetBindingDescription();
+			auto arr = Vertex::GetAttributeDescriptions();
+			m_attributeDescriptions = std::vector<vk::VertexInputAttributeDescription>(arr.begin(), arr.end());
+		}
+		else
+		{
+			m_bindingDescription = QuantizedVertex::GetBindingDescription();
+			auto arr = QuantizedVertex::GetAttributeDescriptions();
+			m_attributeDescriptions = std::vector<vk::VertexInputAttributeDescription>(arr.begin(), arr.end());
+		}
+		m_positionOnlyVertexInput = false;
+		m_vertexInput.vertexBindingDescriptionCount = 1;
+		m_vertexInput.pVertexBindingDescriptions = &m_bindingDescription;
+		m_vertexInput.vertexAttributeDescriptionCount = m_attributeDescriptions.size();
+		m_vertexInput.pVertexAttributeDescriptions = m_attributeDescriptions.data();
+	}
+
+	void PipelineBuilder::EnablePositionOnlyVertexInput(VertexFormat format)
+	{
+		if (format == VertexFormat::Float)
+		{
+			m_bindingDescription = Vertex::GetPositionBindingDescription();
+			auto arr = Vertex::GetPositionAttributeDescriptions();
+			m_attributeDescriptions = std::vector<vk::VertexInputAttributeDescription>(arr.begin(), arr.end());
+		}
+		else
+		{
+			m_bindingDescription = QuantizedVertex::GetPositionBindingDescription();
+			auto arr = QuantizedVertex::GetPositionAttributeDescriptions();
+			m_attributeDescriptions = std::vector<vk::VertexInputAttributeDescription>(arr.begin(), arr.end());
+		}
+		m_positionOnlyVertexInput = true;
 		m_vertexInput.vertexBindingDescriptionCount = 1;
 		m_vertexInput.pVertexBindingDescriptions = &m_bindingDescription;
 		m_vertexInput.vertexAttributeDescriptionCount = m_attributeDescriptions.size();
@@ -150,6 +279,7 @@ namespace Felina
 
 	void PipelineBuilder::DisableVertexInput()
 	{
+		m_positionOnlyVertexInput = false;
 		m_vertexInput.vertexBindingDescriptionCount = 0;
 		m_vertexInput.pVertexBindingDescriptions = nullptr;
 		m_vertexInput.vertexAttributeDescriptionCount = 0;
@@ -160,6 +290,7 @@ namespace Felina
 	{
 		m_depthStencil.depthTestEnable = vk::True;
 		m_depthStencil.depthWriteEnable = vk::True;
+		m_depthStencil.depthCompareOp = vk::CompareOp::eLess;
 	}
 
 	void PipelineBuilder::DisableDepthTest()
@@ -168,6 +299,24 @@ namespace Felina
 		m_depthStencil.depthWriteEnable = vk::False;
 	}
 
+	// Depth test against a depth buffer that is already complete (e.g. after a depth pre-pass)
+	void PipelineBuilder::DisableDepthWrite()
+	{
+		m_depthStencil.depthWriteEnable = vk::False;
+	}
+
+	void PipelineBuilder::SetDepthCompareOp(vk::CompareOp compareOp)
+	{
+		m_depthStencil.depthCompareOp = compareOp;
+	}
+
+	void PipelineBuilder::EnableDepthBias(float constantFactor, float slopeFactor)
+	{
+		m_rasterizer.depthBiasEnable = vk::True;
+		m_rasterizer.depthBiasConstantFactor = constantFactor;
+		m_rasterizer.depthBiasSlopeFactor = slopeFactor;
+	}
+
 	void PipelineBuilder::EnableBackfaceCulling()
 	{
 		m_rasterizer.cullMode = vk::CullModeFlagBits::eBack;
@@ -204,6 +353,7 @@ namespace Felina
 		m_rasterizer.cullMode = vk::CullModeFlagBits::eBack; // Backface culling as DEFAULT
 		m_rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
 		m_rasterizer.depthBiasEnable = vk::False;
+		m_rasterizer.depthBiasConstantFactor = 0.0f;
 		m_rasterizer.depthBiasSlopeFactor = 1.0f;
 		m_rasterizer.lineWidth = 1.0f;
 
@@ -2,6 +2,8 @@
 
 #include <vulkan/vulkan_raii.hpp>
 
+#include "Mesh.hpp"
+
 namespace Felina
 {	
 	class Device;
@@ -27,6 +29,12 @@ namespace Felina
 			PipelineBuilder(const Device& device);
 
 			std::pair<vk::raii::Pipeline, vk::raii::PipelineLayout> BuildPipeline();
+			// Only the (single) compute stage, the pipeline layout and the specialization constants are used
+			std::pair<vk::raii::Pipeline, vk::raii::PipelineLayout> BuildComputePipeline();
+			// One pipeline per VertexFormat (indexed by it) sharing the same layout, the vertex input
+			// enabled (full or position-only) is switched to each format in turn and the format is
+			// passed as specialization constant 1 (VERTEX_FORMAT in vertex.hlsli)
+			std::pair<std::vector<vk::raii::Pipeline>, vk::raii::PipelineLayout> BuildVertexFormatPipelines();
 			void Reset();
 
 			void SetShaderStages(const std::vector<ShaderStageInfo>& shaderStageInfos);
@@ -36,11 +44,17 @@ namespace Felina
 				const std::vector<vk::PushConstantRange>& pushConstantRanges
 			);
 			void SetAttachmentsFormat(const std::vector<vk::Format>& colorAttachmentsFormat, const vk::Format depthFormat);
+			// Values of the specialization constants (constant_id = index) shared by all the stages
+			void SetSpecializationConstants(const std::vector<uint32_t>& values);
 
-			void EnableVertexInput();
+			void EnableVertexInput(VertexFormat format = VertexFormat::Float);
+			void EnablePositionOnlyVertexInput(VertexFormat format = VertexFormat::Float); // see Vertex::Position
 			void DisableVertexInput();
-			void EnableDepthTest();
+			void EnableDepthTest(); // depth writes on, LESS compare
 			void DisableDepthTest();
+			void DisableDepthWrite();
+			void SetDepthCompareOp(vk::CompareOp compareOp);
+			void EnableDepthBias(float constantFactor, float slopeFactor); // shadow maps
 			void EnableBackfaceCulling();
 			void DisableBackfaceCulling();
 
@@ -54,9 +68,14 @@ namespace Felina
 			std::vector<vk::PipelineShaderStageCreateInfo> m_shaderStages; // no default
 			std::vector<std::string> m_shaderEntryPoints;
 
+			std::vector<uint32_t> m_specializationData;
+			std::vector<vk::SpecializationMapEntry> m_specializationEntries;
+			vk::SpecializationInfo m_specializationInfo{};
+
 			vk::PipelineVertexInputStateCreateInfo m_vertexInput{}; // default
 			vk::VertexInputBindingDescription m_bindingDescription;
 			std::vector<vk::VertexInputAttributeDescription> m_attributeDescriptions;
+			bool m_positionOnlyVertexInput = false;
 
 			vk::PipelineInputAssemblyStateCreateInfo m_inputAssembly{}; // default (will be configurable)
 
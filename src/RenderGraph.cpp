@@ -0,0 +1,310 @@
+#include "RenderGraph.hpp"
+
+#include <cassert>
+
+namespace Felina
+{
+	RenderGraph::ResourceHandle RenderGraph::ImportImage(
+		const std::string& name,
+		vk::Image image,
+		vk::Format format,
+		uint32_t mipLevels,
+		uint32_t arrayLayers,
+		Usage initialUsage
+	)
+	{
+		UsageState initial = GetUsageState(initialUsage);
+		initial.layout = GetAspectLayout(initial.layout, GetAspectMask(format));
+
+		Resource resource{
+			.name = name,
+			.image = image,
+			.range = {
+				.aspectMask = GetAspectMask(format),
+				.baseMipLevel = 0,
+				.levelCount = mipLevels,
+				.baseArrayLayer = 0,
+				.layerCount = arrayLayers
+			},
+			.layout = initial.layout,
+			// Whatever happened before the graph is treated as the last write
+			.writeStages = initial.stages,
+			.writeAccesses = initial.isWrite ? initial.accesses : vk::AccessFlags2{},
+			.readStages = initial.isWrite ? vk::PipelineStageFlags2{} : initial.stages,
+			.readAccesses = initial.isWrite ? vk::AccessFlags2{} : initial.accesses
+		};
+		m_resources.push_back(resource);
+		return static_cast<ResourceHandle>(m_resources.size() - 1);
+	}
+
+	RenderGraph::ResourceHandle RenderGraph::ImportBuffer(const std::string& name, vk::Buffer buffer, Usage initialUsage)
+	{
+		UsageState initial = GetUsageState(initialUsage);
+
+		Resource resource{
+			.name = name,
+			.buffer = buffer,
+			.layout = vk::ImageLayout::eUndefined,
+			.writeStages = initial.stages,
+			.writeAccesses = initial.isWrite ? initial.accesses : vk::AccessFlags2{},
+			.readStages = initial.isWrite ? vk::PipelineStageFlags2{} : initial.stages,
+			.readAccesses = initial.isWrite ? vk::AccessFlags2{} : initial.accesses
+		};
+		m_resources.push_back(resource);
+		return static_cast<ResourceHandle>(m_resources.size() - 1);
+	}
+
+	// NOTE: passes are executed in the same order they're added
+	void RenderGraph::AddPass(const std::string& name, const std::vector<Access>& accesses, ExecuteCallback execute)
+	{
+		for (const auto& access : accesses)
+			assert(access.resource < m_resources.size() && "[RenderGraph] Pass accesses an unknown resource!");
+
+		m_passes.push_back({ .name = name, .accesses = accesses, .execute = std::move(execute) });
+	}
+
+	void RenderGraph::MarkOutput(ResourceHandle resource, Usage finalUsage)
+	{
+		assert(resource < m_resources.size() && "[RenderGraph] Unknown output resource!");
+		m_resources[resource].finalUsage = finalUsage;
+	}
+
+	void RenderGraph::Execute(const vk::raii::CommandBuffer& cmdBuf)
+	{
+		m_barrierBatchCount = 0;
+		m_imageBarrierCount = 0;
+		m_bufferBarrierCount = 0;
+
+		CullPasses();
+
+		Barriers barriers;
+		for (auto& pass : m_passes)
+		{
+			if (pass.isCulled)
+				continue;
+
+			// All the transitions required by the pass are submitted at once
+			for (const auto& access : pass.accesses)
+				Transition(m_resources[access.resource], access.usage, barriers);
+			FlushBarriers(cmdBuf, barriers);
+
+			pass.execute(cmdBuf);
+		}
+
+		// Outputs final transitions (e.g. to present)
+		for (auto& resource : m_resources)
+		{
+			if (resource.finalUsage)
+				Transition(resource, *resource.finalUsage, barriers);
+		}
+		FlushBarriers(cmdBuf, barriers);
+	}
+
+	void RenderGraph::Reset()
+	{
+		m_resources.clear();
+		m_passes.clear();
+	}
+
+	// Walk the passes backwards starting from the outputs: a pass is kept only if
+	// it accesses a resource that is needed by an output or by a pass that is kept
+	// NOTE: every access of a kept pass is considered needed since attachment writes
+	// may load the previous contents
+	void RenderGraph::CullPasses()
+	{
+		std::vector<bool> isNeeded(m_resources.size(), false);
+		for (size_t i = 0; i < m_resources.size(); i++)
+			isNeeded[i] = m_resources[i].finalUsage.has_value();
+
+		m_culledPassCount = 0;
+		for (auto it = m_passes.rbegin(); it != m_passes.rend(); ++it)
+		{
+			bool writesNeeded = false;
+			for (const auto& access : it->accesses)
+			{
+				if (GetUsageState(access.usage).isWrite && isNeeded[access.resource])
+					writesNeeded = true;
+			}
+
+			it->isCulled = !writesNeeded;
+			if (it->isCulled)
+			{
+				++m_culledPassCount;
+				continue;
+			}
+
+			for (const auto& access : it->accesses)
+				isNeeded[access.resource] = true;
+		}
+	}
+
+	void RenderGraph::Transition(Resource& resource, Usage usage, Barriers& barriers)
+	{
+		UsageState next = GetUsageState(usage);
+		// Buffers have no layout
+		if (resource.buffer)
+			next.layout = resource.layout;
+		else
+			next.layout = GetAspectLayout(next.layout, resource.range.aspectMask);
+
+		vk::ImageMemoryBarrier2 barrier{
+			.dstStageMask = next.stages,
+			.dstAccessMask = next.accesses,
+			.oldLayout = resource.layout,
+			.newLayout = next.layout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = resource.image,
+			.subresourceRange = resource.range
+		};
+
+		if (next.isWrite || next.layout != resource.layout)
+		{
+			// Write-after-write/read or layout transition: wait for everything that happened since the last write
+			barrier.srcStageMask = resource.writeStages | resource.readStages;
+			barrier.srcAccessMask = resource.writeAccesses;
+			PushBarrier(resource, barrier, barriers);
+
+			resource.layout = next.layout;
+			resource.writeStages = next.stages;
+			resource.writeAccesses = next.isWrite ? next.accesses : vk::AccessFlags2{};
+			resource.readStages = next.isWrite ? vk::PipelineStageFlags2{} : next.stages;
+			resource.readAccesses = next.isWrite ? vk::AccessFlags2{} : next.accesses;
+			return;
+		}
+
+		// Read-after-read in the same layout: only the stages/accesses
+		// that haven't been synchronized with the last write yet need a barrier
+		bool isCovered = (next.stages & ~resource.readStages) == vk::PipelineStageFlags2{}
+			&& (next.accesses & ~resource.readAccesses) == vk::AccessFlags2{};
+		if (!isCovered)
+		{
+			barrier.srcStageMask = resource.writeStages;
+			barrier.srcAccessMask = resource.writeAccesses;
+			PushBarrier(resource, barrier, barriers);
+		}
+		resource.readStages |= next.stages;
+		resource.readAccesses |= next.accesses;
+	}
+
+	void RenderGraph::PushBarrier(const Resource& resource, const vk::ImageMemoryBarrier2& barrier, Barriers& barriers)
+	{
+		if (!resource.buffer)
+		{
+			barriers.images.push_back(barrier);
+			return;
+		}
+
+		barriers.buffers.push_back({
+			.srcStageMask = barrier.srcStageMask,
+			.srcAccessMask = barrier.srcAccessMask,
+			.dstStageMask = barrier.dstStageMask,
+			.dstAccessMask = barrier.dstAccessMask,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.buffer = resource.buffer,
+			.offset = 0,
+			.size = VK_WHOLE_SIZE
+		});
+	}
+
+	void RenderGraph::FlushBarriers(const vk::raii::CommandBuffer& cmdBuf, Barriers& barriers)
+	{
+		if (barriers.images.empty() && barriers.buffers.empty())
+			return;
+
+		vk::DependencyInfo dependencyInfo{
+			.dependencyFlags = {},
+			.bufferMemoryBarrierCount = static_cast<uint32_t>(barriers.buffers.size()),
+			.pBufferMemoryBarriers = barriers.buffers.data(),
+			.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.images.size()),
+			.pImageMemoryBarriers = barriers.images.data()
+		};
+		cmdBuf.pipelineBarrier2(dependencyInfo);
+
+		++m_barrierBatchCount;
+		m_imageBarrierCount += static_cast<uint32_t>(barriers.images.size());
+		m_bufferBarrierCount += static_cast<uint32_t>(barriers.buffers.size());
+		barriers.images.clear();
+		barriers.buffers.clear();
+	}
+
+	RenderGraph::UsageState RenderGraph::GetUsageState(Usage usage)
+	{
+		using Stage = vk::PipelineStageFlagBits2;
+		using Access = vk::AccessFlagBits2;
+		using Layout = vk::ImageLayout;
+
+		switch (usage)
+		{
+		case Usage::Acquired:
+			return { Layout::eUndefined, Stage::eColorAttachmentOutput, {}, false };
+		case Usage::Aliased:
+			return { Layout::eUndefined, Stage::eAllCommands, Access::eMemoryWrite, true };
+		case Usage::ColorAttachmentWrite:
+			return { Layout::eColorAttachmentOptimal, Stage::eColorAttachmentOutput, Access::eColorAttachmentWrite | Access::eColorAttachmentRead, true };
+		case Usage::ColorAttachmentRead:
+			return { Layout::eColorAttachmentOptimal, Stage::eColorAttachmentOutput, Access::eColorAttachmentRead, false };
+		case Usage::DepthAttachmentWrite:
+			return { Layout::eDepthAttachmentOptimal, Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Access::eDepthStencilAttachmentWrite | Access::eDepthStencilAttachmentRead, true };
+		case Usage::DepthAttachmentRead:
+			return { Layout::eDepthReadOnlyOptimal, Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Access::eDepthStencilAttachmentRead, false };
+		case Usage::DepthAttachmentSampledRead:
+			return {
+				Layout::eDepthReadOnlyOptimal,
+				Stage::eEarlyFragmentTests | Stage::eLateFragmentTests | Stage::eFragmentShader,
+				Access::eDepthStencilAttachmentRead | Access::eShaderSampledRead,
+				false
+			};
+		case Usage::FragmentShaderRead:
+			return { Layout::eShaderReadOnlyOptimal, Stage::eFragmentShader, Access::eShaderSampledRead, false };
+		case Usage::ComputeShaderRead:
+			return { Layout::eShaderReadOnlyOptimal, Stage::eComputeShader, Access::eShaderSampledRead, false };
+		case Usage::ComputeShaderWrite:
+			return { Layout::eGeneral, Stage::eComputeShader, Access::eShaderStorageWrite | Access::eShaderStorageRead, true };
+		case Usage::FragmentShaderStorageRead:
+			return { Layout::eGeneral, Stage::eFragmentShader, Access::eShaderStorageRead, false };
+		case Usage::ComputeShaderStorageRead:
+			return { Layout::eGeneral, Stage::eComputeShader, Access::eShaderStorageRead, false };
+		case Usage::IndirectDrawRead:
+			return { Layout::eUndefined, Stage::eDrawIndirect | Stage::eIndexInput, Access::eIndirectCommandRead | Access::eIndexRead, false };
+		case Usage::HostRead:
+			return { Layout::eUndefined, Stage::eHost, Access::eHostRead, false };
+		case Usage::TransferSrc:
+			return { Layout::eTransferSrcOptimal, Stage::eAllTransfer, Access::eTransferRead, false };
+		case Usage::TransferDst:
+			return { Layout::eTransferDstOptimal, Stage::eAllTransfer, Access::eTransferWrite, true };
+		case Usage::Present:
+			return { Layout::ePresentSrcKHR, Stage::eBottomOfPipe, {}, false };
+		case Usage::Undefined:
+		default:
+			return { Layout::eUndefined, Stage::eNone, {}, false };
+		}
+	}
+
+	// Infer aspect from the image format
+	vk::ImageAspectFlags RenderGraph::GetAspectMask(vk::Format format)
+	{
+		switch (format)
+		{
+		case vk::Format::eD16Unorm:
+		case vk::Format::eX8D24UnormPack32:
+		case vk::Format::eD32Sfloat:
+			return vk::ImageAspectFlagBits::eDepth;
+		case vk::Format::eD16UnormS8Uint:
+		case vk::Format::eD24UnormS8Uint:
+		case vk::Format::eD32SfloatS8Uint:
+			return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+		default:
+			return vk::ImageAspectFlagBits::eColor;
+		}
+	}
+
+	// Sampled depth images stay in the layout that allows depth testing as well, without transitions in between
+	vk::ImageLayout RenderGraph::GetAspectLayout(vk::ImageLayout layout, vk::ImageAspectFlags aspectMask)
+	{
+		if (layout == vk::ImageLayout::eShaderReadOnlyOptimal && (aspectMask & vk::ImageAspectFlagBits::eDepth))
+			return vk::ImageLayout::eDepthReadOnlyOptimal;
+		return layout;
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Felina
+{
+	// Minimal frame graph: passes declare how they use the (imported) images and buffers,
+	// the graph culls the passes that don't contribute to an output, derives
+	// the image layouts and emits a single batched barrier before each pass
+	// NOTE: it's rebuilt every frame, resources are tracked as whole images/buffers
+	class RenderGraph
+	{
+		public:
+			using ResourceHandle = uint32_t;
+			using ExecuteCallback = std::function<void(const vk::raii::CommandBuffer&)>;
+
+			// How a pass accesses a resource, each usage maps to a layout, stage and access mask (see GetUsageState)
+			// NOTE: layouts are ignored for buffers, depth images are sampled in DEPTH_READ_ONLY_OPTIMAL
+			enum class Usage
+			{
+				Undefined = 0,          // contents can be discarded
+				Acquired,               // swapchain image, the acquire semaphore is waited on at the color attachment output stage
+				Aliased,                // contents can be discarded but the memory may still be accessed by previous submissions
+				ColorAttachmentWrite,
+				ColorAttachmentRead,    // blending or load op
+				DepthAttachmentWrite,
+				DepthAttachmentRead,    // depth test without writes
+				DepthAttachmentSampledRead, // depth test without writes and sampled in the fragment shader of the same pass
+				FragmentShaderRead,     // sampled in a fragment shader
+				ComputeShaderRead,      // sampled in a compute shader
+				ComputeShaderWrite,     // storage image or buffer
+				FragmentShaderStorageRead,  // storage buffer read in a fragment shader
+				ComputeShaderStorageRead,   // storage buffer read in a compute shader
+				IndirectDrawRead,       // indirect draw commands or index buffer
+				HostRead,               // read back by the CPU once the frame is completed
+				TransferSrc,
+				TransferDst,
+				Present
+			};
+
+			struct Access
+			{
+				ResourceHandle resource;
+				Usage usage;
+			};
+
+		public:
+			RenderGraph() = default;
+
+			// `initialUsage` is the last usage of the image before the graph executes
+			// (Undefined for images whose contents don't need to be preserved)
+			ResourceHandle ImportImage(
+				const std::string& name,
+				vk::Image image,
+				vk::Format format,
+				uint32_t mipLevels = 1,
+				uint32_t arrayLayers = 1,
+				Usage initialUsage = Usage::Undefined
+			);
+			// Buffers are always accessed as a whole
+			ResourceHandle ImportBuffer(const std::string& name, vk::Buffer buffer, Usage initialUsage = Usage::Undefined);
+			void AddPass(const std::string& name, const std::vector<Access>& accesses, ExecuteCallback execute);
+			// Marks a resource as an output of the frame, it will be transitioned to `finalUsage` after the last pass
+			void MarkOutput(ResourceHandle resource, Usage finalUsage);
+
+			void Execute(const vk::raii::CommandBuffer& cmdBuf);
+			void Reset();
+
+			// Statistics of the last execution
+			uint32_t GetCulledPassCount() const { return m_culledPassCount; }
+			uint32_t GetBarrierBatchCount() const { return m_barrierBatchCount; }
+			uint32_t GetImageBarrierCount() const { return m_imageBarrierCount; }
+			uint32_t GetBufferBarrierCount() const { return m_bufferBarrierCount; }
+
+		private:
+			struct UsageState
+			{
+				vk::ImageLayout layout;
+				vk::PipelineStageFlags2 stages;
+				vk::AccessFlags2 accesses;
+				bool isWrite;
+			};
+
+			struct Resource
+			{
+				std::string name;
+				vk::Image image;
+				vk::Buffer buffer;  // either an image or a buffer
+				vk::ImageSubresourceRange range;
+				vk::ImageLayout layout;
+				// Last write (or layout transition) and the reads that happened since then
+				vk::PipelineStageFlags2 writeStages;
+				vk::AccessFlags2 writeAccesses;
+				vk::PipelineStageFlags2 readStages;
+				vk::AccessFlags2 readAccesses;
+				std::optional<Usage> finalUsage;
+			};
+
+			struct Pass
+			{
+				std::string name;
+				std::vector<Access> accesses;
+				ExecuteCallback execute;
+				bool isCulled = false;
+			};
+
+			static UsageState GetUsageState(Usage usage);
+			static vk::ImageAspectFlags GetAspectMask(vk::Format format);
+			static vk::ImageLayout GetAspectLayout(vk::ImageLayout layout, vk::ImageAspectFlags aspectMask);
+
+			struct Barriers
+			{
+				std::vector<vk::ImageMemoryBarrier2> images;
+				std::vector<vk::BufferMemoryBarrier2> buffers;
+			};
+
+			void CullPasses();
+			void Transition(Resource& resource, Usage usage, Barriers& barriers);
+			// Buffers reuse the image barrier stages/accesses
+			static void PushBarrier(const Resource& resource, const vk::ImageMemoryBarrier2& barrier, Barriers& barriers);
+			void FlushBarriers(const vk::raii::CommandBuffer& cmdBuf, Barriers& barriers);
+
+			std::vector<Resource> m_resources;
+			std::vector<Pass> m_passes;
+
+			uint32_t m_culledPassCount = 0;
+			uint32_t m_barrierBatchCount = 0;
+			uint32_t m_imageBarrierCount = 0;
+			uint32_t m_bufferBarrierCount = 0;
+	};
+}
@@ -9,9 +9,11 @@
 #include "Buffer.hpp"
 #include "Texture.hpp"
 #include "GBuffer.hpp"
+#include "TransientAllocator.hpp"
 #include "Common.hpp"
 #include "PipelineBuilder.hpp"
 #include "ResourceManager.hpp"
+#include "LatencyTracer.hpp"
 
 #include <GLFW/glfw3.h>
 #include <imgui.h>
@@ -21,6 +23,8 @@
 #include <iostream>
 #include <filesystem>
 #include <cassert>
+#include <algorithm>
+#include <cmath>
 
 namespace Felina 
 {
@@ -50,12 +54,20 @@ namespace Felina
         CreateDescriptorSetLayouts();
         CreatePushConstant();
         CreatePipeline();
+        CreateLightCullingPipeline();
+        if (IsMeshletCullingSupported())
+            CreateMeshletCullingPipeline();
+        else
+            m_isMeshletCullingEnabled = false;
+        CreateShadowPipeline();
         CreateCommandPool();
         CreateCommandBuffer();
         CreateSamplers();
         CreateUniformBuffers();
         AllocateDescriptorSets();
+        CreateShadowMap();
         CreateSyncObjects();
+        CreateQueryPool();
     }
 
     Renderer::~Renderer()
@@ -67,18 +79,29 @@ namespace Felina
         for (auto& buffer : m_objectSSBOs) {
             buffer.reset();
         }
+        for (auto& buffer : m_sunUBOs) {
+            buffer.reset();
+        }
+        m_shadowMap.reset();
+        m_environmentMap.reset();
     }
 
     void Renderer::DrawFrame()
     {
         // CPU will wait until the GPU finishes rendering the previous frame (corresponding to the same swapchain image index)
         while (vk::Result::eTimeout == m_device->GetDevice().waitForFences(*m_inFlightFences[m_currentFrame], vk::True, UINT64_MAX));
-
-        // Wait for the presentation to release the semaphore
-        m_device->GetPresentQueue().waitIdle();
-
-        // Check if window has been resized/minimize before trying to acquire next image
-        if (m_app.IsFramebufferResized()) {
+        m_frameStats.BeginFrame();
+
+        // Frames complete in submission order, every frame up to this one is done
+        m_swapchain->ReleaseRetired(m_frameSerials[m_currentFrame]);
+        while (!m_retiredGBuffers.empty() && m_retiredGBuffers.front().frameSerial <= m_frameSerials[m_currentFrame])
+            m_retiredGBuffers.pop_front();
+        UpdateOverdraw();
+        UpdateGpuFrameTime();
+
+        // Check if window has been resized/minimize (or the present mode changed) before trying to acquire next image
+        bool isSwapchainOutdated = std::exchange(m_isSwapchainOutdated, false);
+        if (m_app.IsFramebufferResized() || isSwapchainOutdated) {
             UpdateOnFramebufferResized();
             return;
         }
@@ -88,9 +111,10 @@ namespace Felina
         auto result = resultStruct.result; // vulkan.hpp changed their return value from std::pair
         auto imageIndex = resultStruct.value; // to a custom struct
 
-        // Check if the surface is still compatible with the swapchain or if it was resized/minimized
-        // !!! Checking m_IsFramebufferResized guarantees prevents presentation to an invalid surface
-        if (result == vk::Result::eErrorOutOfDateKHR || m_app.IsFramebufferResized()) {
+        // Check if the surface is still compatible with the swapchain
+        // NOTE: a suboptimal swapchain can still be presented to, it'll be recreated after presentation
+        // (bailing out here would leave the image available semaphore signaled)
+        if (result == vk::Result::eErrorOutOfDateKHR) {
             UpdateOnFramebufferResized();
             return;
         }
@@ -98,12 +122,36 @@ namespace Felina
             throw std::runtime_error("Failed to acquire swapchain image!");
         }
 
+        // The G-buffer is resized lazily: the old one may still be used by the
+        // frames in flight, so it's retired until they're completed
+        if (m_gBuffer->GetExtent() != m_swapchain->GetExtent()) {
+            m_retiredGBuffers.push_back({ std::move(m_gBuffer), m_submittedFrames });
+            CreateGBuffer();
+        }
+
+        // Rendered area of the G-buffer, the whole of it without dynamic resolution
+        vk::Extent2D swapchainExtent = m_swapchain->GetExtent();
+        float renderScale = m_isDynamicResolutionEnabled ? m_dynamicResolution.GetScale() : 1.0f;
+        m_renderExtent = vk::Extent2D{
+            std::clamp(static_cast<uint32_t>(std::lround(swapchainExtent.width * renderScale)), 1u, swapchainExtent.width),
+            std::clamp(static_cast<uint32_t>(std::lround(swapchainExtent.height * renderScale)), 1u, swapchainExtent.height)
+        };
+        m_frameRenderExtents[m_currentFrame] = m_renderExtent;
+        m_frameRenderScales[m_currentFrame] = renderScale;
+
         SetupFrameData();
 
         // Record command buffer and reset draw fence
         m_device->GetDevice().resetFences(*m_inFlightFences[m_currentFrame]);
         RecordCommandBuffer(imageIndex);
 
+        // Late latching: sample the input and write the camera UBO as close as
+        // possible to the submission, the command buffer only references the
+        // UBO so it doesn't need to be re-recorded
+        auto mouseEventTime = m_app.LatchCamera();
+        auto latchTime = LatencyTracer::Clock::now();
+        UpdateCameraData();
+
         // Submit commands to the queue
         vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
         const vk::SubmitInfo submitInfo{
@@ -113,24 +161,38 @@ namespace Felina
             .commandBufferCount = 1,
             .pCommandBuffers = &*m_commandBuffers[m_currentFrame],
             .signalSemaphoreCount = 1,
-            .pSignalSemaphores = &*m_renderFinishedSemaphores[m_currentFrame]
+            .pSignalSemaphores = &*m_swapchain->GetRenderFinishedSemaphore(imageIndex)
         };
         m_device->GetGraphicsQueue().submit(submitInfo, *m_inFlightFences[m_currentFrame]);
+        m_frameSerials[m_currentFrame] = ++m_submittedFrames;
+        m_frameStats.EndFrame(GetQueueDepth());
 
         // Present to the screen
+        // NOTE: the render finished semaphore is indexed by swapchain image, the presentation engine
+        // releases it before the same image can be acquired again, so there's no need to wait for the
+        // present queue to be idle (which would cap the frame rate in MAILBOX/IMMEDIATE modes)
         const vk::PresentInfoKHR presentInfoKHR{
             .waitSemaphoreCount = 1,
-            .pWaitSemaphores = &*m_renderFinishedSemaphores[m_currentFrame],
+            .pWaitSemaphores = &*m_swapchain->GetRenderFinishedSemaphore(imageIndex),
             .swapchainCount = 1,
             .pSwapchains = &m_swapchain->GetHandle(),
             .pImageIndices = &imageIndex
         };
-        result = m_device->GetPresentQueue().presentKHR(presentInfoKHR);
+        // vk::raii reports an out of date swapchain through an exception
+        try {
+            result = m_device->GetPresentQueue().presentKHR(presentInfoKHR);
+        }
+        catch (const vk::OutOfDateKHRError&) {
+            result = vk::Result::eErrorOutOfDateKHR;
+        }
+        m_frameStats.OnPresent();
+
+        if (m_latencyTracer && mouseEventTime)
+            m_latencyTracer->Record(*mouseEventTime, latchTime, LatencyTracer::Clock::now());
 
         // Check again if presentation fails because the surface is now incompatible
         if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || m_app.IsFramebufferResized()) {
             UpdateOnFramebufferResized();
-            return;
         }
         else if (result != vk::Result::eSuccess) {
             throw std::runtime_error("Failed to present swapchain image!");
@@ -144,6 +206,154 @@ namespace Felina
         m_device->GetDevice().waitIdle();
     }
 
+    void Renderer::SetPresentMode(vk::PresentModeKHR presentMode)
+    {
+        // The swapchain will be recreated at the beginning of the next frame
+        m_swapchain->SetPresentMode(presentMode);
+        m_isSwapchainOutdated = true;
+    }
+
+    // The attachments formats (and count) change with the encoding, so the
+    // G-buffer and the pipelines using it are rebuilt after the GPU is idle
+    void Renderer::SetGBufferEncoding(GBuffer::Encoding encoding)
+    {
+        if (encoding == m_gBufferEncoding)
+            return;
+
+        if (!IsGBufferEncodingSupported(encoding))
+        {
+            LOG("[Renderer] G-buffer encoding not supported by the device, ignoring it.");
+            return;
+        }
+
+        m_gBufferEncoding = encoding;
+        RebuildGBuffer();
+    }
+
+    bool Renderer::IsGBufferEncodingSupported(GBuffer::Encoding encoding) const
+    {
+        return GBuffer::IsEncodingSupported(*m_device, encoding);
+    }
+
+    // The visibility buffer path needs the visibility attachment in the G-buffer
+    // and its own geometry/resolve pipelines, rebuilt like for the encoding
+    void Renderer::SetRenderPath(RenderPath renderPath)
+    {
+        if (renderPath == m_renderPath)
+            return;
+
+        if (!IsRenderPathSupported(renderPath))
+        {
+            LOG("[Renderer] Render path not supported by the device, ignoring it.");
+            return;
+        }
+
+        m_renderPath = renderPath;
+        RebuildGBuffer();
+    }
+
+    bool Renderer::IsRenderPathSupported(RenderPath renderPath) const
+    {
+        return renderPath == RenderPath::Deferred || m_device->IsVisibilityBufferSupported();
+    }
+
+    void Renderer::SetLightingPath(LightingPath lightingPath)
+    {
+        if (lightingPath == m_lightingPath)
+            return;
+
+        if (!IsLightingPathSupported(lightingPath))
+        {
+            LOG("[Renderer] Lighting path not supported by the device, ignoring it.");
+            return;
+        }
+
+        m_lightingPath = lightingPath;
+        RebuildGBuffer();
+    }
+
+    // The compute path needs a storage image that can be blitted to the swapchain images
+    bool Renderer::IsLightingPathSupported(LightingPath lightingPath) const
+    {
+        if (lightingPath == LightingPath::Raster)
+            return true;
+
+        auto swapchainFormatProperties = m_device->GetPhysicalDevice().getFormatProperties(m_swapchain->GetSurfaceFormat().format);
+        return GBuffer::IsLightingOutputSupported(*m_device)
+            && m_swapchain->IsTransferDstSupported()
+            && (swapchainFormatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eBlitDst);
+    }
+
+    // The shadow map is shared by the frames in flight, it's replaced after the GPU is idle
+    void Renderer::SetShadowSettings(uint32_t cascadeCount, uint32_t resolution)
+    {
+        if (cascadeCount == m_shadowMap->GetCascadeCount() && resolution == m_shadowMap->GetResolution())
+            return;
+
+        WaitIdle();
+        m_shadowCascadeCount = cascadeCount;
+        m_shadowResolution = resolution;
+        m_shadowMap.reset();
+        CreateShadowMap();
+    }
+
+    // Auto needs exact sample counts to measure the overdraw
+    bool Renderer::IsDepthPrepassModeSupported(DepthPrepassMode mode) const
+    {
+        return mode != DepthPrepassMode::Auto || m_device->IsPreciseOcclusionQuerySupported();
+    }
+
+    // NOTE: the visibility buffer path doesn't use the pre-pass, its geometry pass is already depth-only
+    bool Renderer::IsDepthPrepassActive() const
+    {
+        if (m_renderPath != RenderPath::Deferred)
+            return false;
+
+        switch (m_depthPrepassMode)
+        {
+        case DepthPrepassMode::On:
+            return true;
+        case DepthPrepassMode::Auto:
+            return m_isAutoDepthPrepassEnabled;
+        case DepthPrepassMode::Off:
+        default:
+            return false;
+        }
+    }
+
+    vk::PresentModeKHR Renderer::GetPresentMode() const
+    {
+        return m_swapchain->GetPresentMode();
+    }
+
+    const std::vector<vk::PresentModeKHR>& Renderer::GetAvailablePresentModes() const
+    {
+        return m_swapchain->GetAvailablePresentModes();
+    }
+
+    // Number of submitted frames that the GPU hasn't completed yet
+    uint32_t Renderer::GetQueueDepth() const
+    {
+        uint32_t depth = 0;
+        for (const auto& fence : m_inFlightFences)
+        {
+            if (fence.getStatus() == vk::Result::eNotReady)
+                ++depth;
+        }
+        return depth;
+    }
+
+    void Renderer::EnableLatencyTrace()
+    {
+        m_latencyTracer = std::make_unique<LatencyTracer>();
+    }
+
+    void Renderer::SaveLatencyTrace(const std::filesystem::path& filepath) const
+    {
+        if (m_latencyTracer)
+            m_latencyTracer->Save(filepath);
+    }
+
     void Renderer::LoadMesh(Mesh& mesh)
     {
         mesh.Load(*m_device);
@@ -233,7 +443,8 @@ namespace Felina
             .arrayLayers    = 6, // !
             .samples        = vk::SampleCountFlagBits::e1,
             .tiling         = vk::ImageTiling::eOptimal,
-            .usage          = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+            // Blitted into the image-based lighting source (see EnvironmentMap)
+            .usage          = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
             .sharingMode    = vk::SharingMode::eExclusive,
             .initialLayout  = vk::ImageLayout::eUndefined
         };
@@ -242,8 +453,19 @@ namespace Felina
 
         // Load texture
         // TODO: Renderer calling RM calling Renderer again, I should fix this weird process
-        ResourceManager::GetInstance().LoadTexture(std::move(texture), "Skybox", cubeMapData.data(), cubeMapSize, *this);
+        auto& rm = ResourceManager::GetInstance();
+        m_skyboxTexture = rm.LoadTexture(std::move(texture), "Skybox", cubeMapData.data(), cubeMapSize, *this);
         // TODO: free stb_image_data
+
+        // Image-based lighting: only (re)computed, or read from the disk cache, when the skybox content changes
+        // NOTE: keyed by the content hash computed by the ResourceManager (faces layout and pixels)
+        const auto& skybox = rm.GetCubemaps().At(m_skyboxTexture.GetID());
+        if (!m_environmentMap || m_environmentMap->GetSkyboxHash() != skybox.contentHash)
+        {
+            m_environmentMap.reset();
+            m_environmentMap = std::make_unique<EnvironmentMap>(*m_device, *skybox.resource, skybox.contentHash);
+            UpdateEnvironmentDescriptorSet();
+        }
     }
 
     void Renderer::UpdateDescriptorSets()
@@ -265,30 +487,26 @@ namespace Felina
            auto& rm = ResourceManager::GetInstance();
            const auto& textures = rm.GetTextures();
            std::array<vk::DescriptorImageInfo, MAX_TEXTURES> imageInfos;
-           vk::DescriptorImageInfo skyboxInfo; // Skybox doesn't count in MAX_TEXTURES
+           // Skybox doesn't count in MAX_TEXTURES, the cubemaps have their own slots (see ResourceManager)
+           vk::DescriptorImageInfo skyboxInfo{
+               .sampler = nullptr,
+               .imageView = rm.GetCubemaps().At(m_skyboxTexture.GetID()).resource->GetImageView(),
+               .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+           };
 
-           assert(textures.size() < (MAX_TEXTURES + 1) && "[Renderer] Loaded textures surpass MAX_TEXTURES!");
-           size_t i = 0;
+           // Each texture is bound at the index of its slot: the texture slot map is created with MAX_TEXTURES slots and
+           // ResourceManager::ReserveSlot frees a cached one (or throws) before a load would go beyond them
+           // NOTE: the cached textures (not referenced) aren't bound, their entries stay null
            for (const auto& [id, resource] : textures)
            {
-               // Check wether it is the skybox
-               if (resource.resource->IsCubemap())
-               {
-                   skyboxInfo = {
-                       .sampler = nullptr,
-                       .imageView = resource.resource->GetImageView(),
-                       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
-                   };
-               }
-               else
-               {
-                   imageInfos[i] = {
-                       .sampler = nullptr,
-                       .imageView = resource.resource->GetImageView(),
-                       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
-                   };
-                   ++i;
-               }
+               if (resource.refCount == 0)
+                   continue;
+
+               imageInfos[ResourceManager::GetSlot(id)] = {
+                   .sampler = nullptr,
+                   .imageView = resource.resource->GetImageView(),
+                   .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+               };
            }
 
            // Descriptor writes
@@ -370,6 +588,46 @@ namespace Felina
                 .pBufferInfo = &materialSSBOInfo
             };
             m_device->GetDevice().updateDescriptorSets(materialWrite, {});
+
+            // Light descriptor set (lights SSBO, per cluster light counts and indices)
+            std::array<vk::DescriptorBufferInfo, 3> lightInfos{
+                vk::DescriptorBufferInfo{ .buffer = m_lightSSBOs[i]->GetHandle(), .offset = 0, .range = sizeof(LightData) * MAX_LIGHTS },
+                vk::DescriptorBufferInfo{ .buffer = m_clusterLightCountBuffers[i]->GetHandle(), .offset = 0, .range = VK_WHOLE_SIZE },
+                vk::DescriptorBufferInfo{ .buffer = m_clusterLightIndexBuffers[i]->GetHandle(), .offset = 0, .range = VK_WHOLE_SIZE }
+            };
+            std::array<vk::WriteDescriptorSet, 3> lightWrites;
+            for (uint32_t binding = 0; binding < lightWrites.size(); binding++)
+            {
+                lightWrites[binding] = {
+                    .dstSet = m_lightDescriptorSets[i],
+                    .dstBinding = binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .pBufferInfo = &lightInfos[binding]
+                };
+            }
+            m_device->GetDevice().updateDescriptorSets(lightWrites, {});
+
+            // Meshlet culling descriptor set (cluster draws, indirect commands, culled indices)
+            std::array<vk::DescriptorBufferInfo, 3> meshletCullingInfos{
+                vk::DescriptorBufferInfo{ .buffer = m_clusterDrawSSBOs[i]->GetHandle(), .offset = 0, .range = sizeof(ClusterDrawData) * MAX_OBJECTS },
+                vk::DescriptorBufferInfo{ .buffer = m_drawCommandBuffers[i]->GetHandle(), .offset = 0, .range = VK_WHOLE_SIZE },
+                vk::DescriptorBufferInfo{ .buffer = m_culledIndexBuffers[i]->GetHandle(), .offset = 0, .range = VK_WHOLE_SIZE }
+            };
+            std::array<vk::WriteDescriptorSet, 3> meshletCullingWrites;
+            for (uint32_t binding = 0; binding < meshletCullingWrites.size(); binding++)
+            {
+                meshletCullingWrites[binding] = {
+                    .dstSet = m_meshletCullingDescriptorSets[i],
+                    .dstBinding = binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = vk::DescriptorType::eStorageBuffer,
+                    .pBufferInfo = &meshletCullingInfos[binding]
+                };
+            }
+            m_device->GetDevice().updateDescriptorSets(meshletCullingWrites, {});
         }
     }
 
@@ -420,65 +678,186 @@ namespace Felina
         ImGui_ImplVulkan_RenderDrawData(drawData, *m_commandBuffers[m_currentFrame]);
     }
 
-    static void UpdateObject(const Object& obj, glm::mat4 parentModelMatrix, std::vector<Renderer::ObjectData>& objectDatas)
+    void Renderer::DrawSkybox(const vk::raii::CommandBuffer& cmdBuf, vk::Extent2D extent)
+    {
+        cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_skyboxPipeline);
+        cmdBuf.setViewport(
+            0,
+            vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f)
+        );
+        cmdBuf.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), extent));
+        cmdBuf.bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics, m_skyboxPipelineLayout, 0,
+            { m_cameraDescriptorSets[m_currentFrame], m_textureDescriptorSets },
+            nullptr
+        );
+        cmdBuf.draw(3, 1, 0, 0);
+    }
+
+    // The vertex fetch in vertex.hlsli hardcodes these layouts
+    static_assert(sizeof(Vertex) == 48 && offsetof(Vertex, normal) == 16 && offsetof(Vertex, uv) == 32);
+    static_assert(sizeof(QuantizedVertex) == 16 && offsetof(QuantizedVertex, normal) == 8 && offsetof(QuantizedVertex, uv) == 12);
+    // meshlet_culling.comp.hlsl hardcodes these layouts as well
+    static_assert(sizeof(Meshlet) == 48 && sizeof(Renderer::ClusterDrawData) == 96);
+
+    // Camera state the draws are selected with (LOD, meshlet culling) and the draws collected so far
+    struct DrawSelection
+    {
+        glm::vec3 cameraPosition;
+        float nearPlane;
+        float pixelsPerUnit;    // size in pixels of a unit at unit distance (render extent height)
+        float errorThreshold;   // pixels
+        bool isMeshletCullingEnabled;
+        bool drawStaticBatches;  // instead of the objects merged in them
+        vk::DeviceAddress culledIndexAddress;
+        uint32_t drawnTriangles = 0;
+        uint32_t fullDetailTriangles = 0;
+        uint32_t clusterTriangles = 0;
+        uint32_t culledIndexCount = 0; // reserved in the culled index buffer
+        uint32_t skippedDraws = 0; // beyond MAX_OBJECTS
+        std::vector<Renderer::ObjectDraw> objectDraws;
+        std::vector<Renderer::ClusterDrawData> clusterDraws;
+    };
+
+    static float GetMaxScale(const glm::mat4& modelMatrix)
+    {
+        return std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])) });
+    }
+
+    // Coarsest LOD of the submesh whose error, projected at the closest point of the mesh bounding sphere, stays under the threshold
+    // NOTE: the sphere encloses every submesh, so the distance is conservative for each of them
+    static uint32_t SelectLod(const Mesh& mesh, const Submesh& submesh, const glm::mat4& modelMatrix, const DrawSelection& selection)
+    {
+        const auto& lods = submesh.lods;
+        float maxScale = GetMaxScale(modelMatrix);
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(mesh.GetBoundsCenter(), 1.0f));
+        float distance = std::max(glm::length(center - selection.cameraPosition) - mesh.GetBoundsRadius() * maxScale, selection.nearPlane);
+
+        uint32_t level = 0;
+        for (uint32_t i = 1; i < lods.size(); i++)
+        {
+            float projectedError = lods[i].error * maxScale * selection.pixelsPerUnit / distance;
+            if (projectedError > selection.errorThreshold)
+                break;
+            level = i;
+        }
+        return level;
+    }
+
+    static void UpdateObject(
+        const Object& obj,
+        glm::mat4 parentModelMatrix,
+        DrawSelection& selection,
+        std::vector<Renderer::ObjectData>& objectDatas
+    )
     {
         // Add current object data
         glm::mat4 modelMatrix = parentModelMatrix * obj.GetModelMatrix();
-        if (obj.GetMesh() != MeshID(-1))
+        auto& rm = ResourceManager::GetInstance();
+        if (obj.GetMesh() != MeshID(-1) && !(selection.drawStaticBatches && obj.IsStaticBatched()))
         {
-            objectDatas.emplace_back(Renderer::ObjectData{
-                .model = modelMatrix,
-                .normal = glm::transpose(glm::inverse(glm::mat3(modelMatrix)))
-                // .normal = glm::mat3(modelMatrix) (uniform scaling ONLY assumption)
-            });
+            const Mesh& mesh = rm.GetMesh(obj.GetMesh());
+            uint32_t indexSize = mesh.GetIndexType() == vk::IndexType::eUint16 ? 2u : 4u;
+            float maxScale = GetMaxScale(modelMatrix);
+
+            // One draw per submesh, they only differ by their index ranges and material
+            for (const Submesh& submesh : mesh.GetSubmeshes())
+            {
+                // The draws beyond MAX_OBJECTS are dropped (fixed size object buffers, 10 bits of object index in the
+                // visibility buffer), DrawObject stops at the same draw since both walk the scene in the same order
+                if (objectDatas.size() >= Renderer::MAX_OBJECTS)
+                {
+                    selection.skippedDraws++;
+                    continue;
+                }
+
+                // The object material overrides the submesh one, the slot of the material is its index in the storage buffer
+                // NOTE: unknown (or unloaded) materials fall back to the first slot
+                MaterialID materialId = obj.GetMaterial() != MaterialID(-1) ? obj.GetMaterial() : submesh.material;
+                uint32_t materialIndex = rm.GetMaterials().Contains(materialId) ? ResourceManager::GetSlot(materialId) : 0;
+
+                uint32_t level = SelectLod(mesh, submesh, modelMatrix, selection);
+                const MeshLod& lod = submesh.lods[level];
+                selection.drawnTriangles += lod.indexCount / 3;
+                selection.fullDetailTriangles += submesh.lods[0].indexCount / 3;
+
+                // The meshlets cover the full detail LOD, the coarser ones are small enough to be drawn whole
+                // NOTE: the submeshes beyond the culled index buffer capacity are drawn without culling
+                uint32_t clusterDraw = Renderer::NO_CLUSTER_DRAW;
+                uint32_t culledFirstIndex = 0;
+                if (selection.isMeshletCullingEnabled && level == 0 && submesh.meshletCount > 0 &&
+                    selection.culledIndexCount + lod.indexCount <= Renderer::MAX_CULLED_INDICES)
+                {
+                    clusterDraw = static_cast<uint32_t>(selection.clusterDraws.size());
+                    culledFirstIndex = selection.culledIndexCount;
+                    selection.clusterDraws.push_back(Renderer::ClusterDrawData{
+                        .model = modelMatrix,
+                        .meshletAddress = mesh.GetMeshletBufferAddress() + submesh.firstMeshlet * sizeof(Meshlet),
+                        .indexAddress = mesh.GetIndexBufferAddress(),
+                        .meshletCount = submesh.meshletCount,
+                        .indexSize = indexSize,
+                        .outputFirstIndex = culledFirstIndex,
+                        .maxScale = maxScale
+                    });
+                    selection.culledIndexCount += lod.indexCount;
+                    selection.clusterTriangles += lod.indexCount / 3;
+                }
+                selection.objectDraws.push_back(Renderer::ObjectDraw{ .lod = level, .clusterDraw = clusterDraw, .materialIndex = materialIndex });
+
+                objectDatas.emplace_back(Renderer::ObjectData{
+                    // Quantized positions are dequantized by the same matrix, the normals aren't affected
+                    .model = modelMatrix * mesh.GetDequantization(),
+                    .normal = glm::transpose(glm::inverse(glm::mat3(modelMatrix))),
+                    // .normal = glm::mat3(modelMatrix) (uniform scaling ONLY assumption)
+                    .vertexAddress = mesh.GetVertexBufferAddress(),
+                    .indexAddress = mesh.GetIndexBufferAddress(),
+                    .materialIndex = materialIndex,
+                    .vertexFormat = static_cast<uint32_t>(mesh.GetVertexFormat()),
+                    .indexSize = indexSize,
+                    .firstIndex = lod.firstIndex,
+                    .culledIndexAddress = clusterDraw != Renderer::NO_CLUSTER_DRAW ? selection.culledIndexAddress : 0,
+                    .culledFirstIndex = culledFirstIndex,
+                    .uvDequantization = mesh.GetUvDequantization()
+                });
+            }
         }
 
         // Iterate through its children
         for (const auto& childPtr : obj.GetChildren())
         {
             const Object& child = *childPtr;
-            UpdateObject(child, modelMatrix, objectDatas);
+            UpdateObject(child, modelMatrix, selection, objectDatas);
         }
     }
 
-    void Renderer::SetupFrameData()
-    {   
-        // Update camera data
-        CameraData cameraData{};
-        cameraData.position = m_scene.GetCamera().GetPosition();
-        cameraData.view = m_scene.GetCamera().GetViewMatrix();
-        cameraData.proj = m_scene.GetCamera().GetProjectionMatrix();
-        cameraData.invViewProj = m_scene.GetCamera().GetInvViewProj();
-        m_cameraUBOs[m_currentFrame]->LoadData(&cameraData, sizeof(cameraData));
-
-        // Fill the object data storage buffer
-        const std::vector<std::unique_ptr<Object>>& objects = m_scene.GetObjects();
-        std::vector<ObjectData> objectDatas;
-        for (const auto& objPtr : objects)
+    // Hash of what the shadow casters depend on (transforms and geometry buffers)
+    // NOTE: the fields are hashed one by one since ObjectData has padding bytes
+    // NOTE: the LODs selected from the camera are left out, the shadow casters are drawn at full detail
+    static uint64_t HashGeometry(const std::vector<Renderer::ObjectData>& objectDatas)
+    {
+        uint64_t hash = HashBytes(nullptr, 0); // no objects
+        for (const auto& objectData : objectDatas)
         {
-            const Object& obj = *objPtr;
-            UpdateObject(obj, glm::mat4(1.0f), objectDatas);
+            hash = HashBytes(&objectData.model, sizeof(objectData.model), hash);
+            hash = HashBytes(&objectData.vertexAddress, sizeof(objectData.vertexAddress), hash);
+            hash = HashBytes(&objectData.indexAddress, sizeof(objectData.indexAddress), hash);
         }
-        m_objectSSBOs[m_currentFrame]->LoadData(objectDatas.data(), objectDatas.size() * sizeof(ObjectData));
-        
-        // TODO: optimize by avoid doing these iterations each frame if not needed
-        // Iterate through texture to fill up the look-up table
+        return hash;
+    }
+
+    // NOTE: camera data is excluded, it is written right before submission (see UpdateCameraData)
+    void Renderer::SetupFrameData()
+    {   
+        // Fill the material data storage buffer, indexed by the material slots
+        // NOTE: the textures are bound at the index of their slot (see UpdateDescriptorSets)
         auto& rm = ResourceManager::GetInstance();
-        auto& texturesMapping = m_textureIDToArrayID[m_currentFrame];
-        uint32_t index = 0;
-        for (const auto& [id, res] : rm.GetTextures())
+        std::vector<MaterialData> materialDatas(rm.GetMaterials().GetSlotCount());
+        for (const auto& [id, res] : rm.GetMaterials())
         {
-            if (res.resource->IsCubemap())
+            // The cached materials (not referenced) aren't uploaded
+            if (res.refCount == 0)
                 continue;
-            texturesMapping[id] = index++;
-        }
 
-        // Fill the material data storage buffer
-        std::vector<MaterialData> materialDatas;
-        auto& materialsMapping = m_materialIDToSSBOID[m_currentFrame];
-        index = 0;
-        for (const auto& [id, res] : ResourceManager::GetInstance().GetMaterials())
-        {
             // Get raw pointer to the material
             const Material* mat = res.resource.get();
 
@@ -487,30 +866,146 @@ namespace Felina
             matData.baseColor = mat->GetBaseColor();
             matData.materialInfo = mat->GetMetallicRoughness();
 
-            // If the texture is defined use the mapping to get the
-            // correct texture index, else -1
+            // If the texture is defined its slot is the texture index, else -1
             TextureID texId = mat->GetBaseColorTexture();
-            matData.baseColorTex = (texId != -1) ? texturesMapping[texId] : texId;
+            matData.baseColorTex = (texId != -1) ? ResourceManager::GetSlot(texId) : texId;
 
             texId = mat->GetMetallicRoughnessTexture();
-            matData.materialInfoTex = (texId != -1) ? texturesMapping[texId] : texId;
-            
-            materialDatas.push_back(matData);
+            matData.materialInfoTex = (texId != -1) ? ResourceManager::GetSlot(texId) : texId;
 
-            // Keep track of the storage buffer IDs
-            materialsMapping[id] = index++;
+            materialDatas[ResourceManager::GetSlot(id)] = matData;
         }
         m_materialSSBOs[m_currentFrame]->LoadData(materialDatas.data(), materialDatas.size() * sizeof(MaterialData));
-    }
 
-    void Renderer::UpdateOnFramebufferResized()
-    {
-        m_swapchain->Recreate();
+        // Fill the object data storage buffer
+        // NOTE: after the materials since the objects store their material index
+        const std::vector<std::unique_ptr<Object>>& objects = m_scene.GetObjects();
+        // NOTE: the LODs are selected from the camera of this frame, like the shadow cascades
+        // (the meshlets are culled on the GPU with the latched one)
+        const Camera& camera = m_scene.GetCamera();
+        DrawSelection selection{
+            .cameraPosition = camera.GetPosition(),
+            .nearPlane = camera.GetNearPlane(),
+            .pixelsPerUnit = std::abs(camera.GetProjectionMatrix()[1][1]) * 0.5f * static_cast<float>(m_renderExtent.height),
+            .errorThreshold = m_lodErrorThreshold,
+            .isMeshletCullingEnabled = m_isMeshletCullingEnabled,
+            .drawStaticBatches = m_isStaticBatchingEnabled,
+            .culledIndexAddress = m_culledIndexAddresses[m_currentFrame]
+        };
+        std::vector<ObjectData> objectDatas;
+        for (const auto& objPtr : objects)
+        {
+            const Object& obj = *objPtr;
+            UpdateObject(obj, glm::mat4(1.0f), selection, objectDatas);
+        }
+        // NOTE: latched for DrawScene, the objects must be drawn in the same order
+        m_areStaticBatchesDrawn = selection.drawStaticBatches;
+        if (m_areStaticBatchesDrawn)
+        {
+            for (const auto& batchPtr : m_scene.GetStaticBatches())
+                UpdateObject(*batchPtr, glm::mat4(1.0f), selection, objectDatas);
+        }
+        m_drawCount = static_cast<uint32_t>(objectDatas.size());
+        if (selection.skippedDraws > 0 && selection.skippedDraws != m_skippedDrawCount)
+            LOG("[Renderer] " + std::to_string(selection.skippedDraws) + " draws beyond MAX_OBJECTS (" + std::to_string(MAX_OBJECTS) + ") skipped!");
+        m_skippedDrawCount = selection.skippedDraws;
+        m_objectDraws = std::move(selection.objectDraws);
+        m_drawnTriangleCount = selection.drawnTriangles;
+        m_fullDetailTriangleCount = selection.fullDetailTriangles;
+        m_objectSSBOs[m_currentFrame]->LoadData(objectDatas.data(), objectDatas.size() * sizeof(ObjectData));
 
-        for (size_t i = 0; i < m_gBuffers.size(); i++)
+        // Read back the triangles left by the meshlet culling of the last frame that used these buffers (already completed),
+        // then fill the draws of this one: the culling pass writes the index count of each indirect command
+        std::vector<vk::DrawIndexedIndirectCommand> previousCommands(m_frameClusterDrawCounts[m_currentFrame]);
+        if (!previousCommands.empty())
+            m_drawCommandBuffers[m_currentFrame]->ReadData(previousCommands.data(), previousCommands.size() * sizeof(vk::DrawIndexedIndirectCommand));
+        m_meshletVisibleTriangleCount = 0;
+        for (const auto& command : previousCommands)
+            m_meshletVisibleTriangleCount += command.indexCount / 3;
+        m_meshletTriangleCount = m_frameClusterTriangleCounts[m_currentFrame];
+
+        std::vector<vk::DrawIndexedIndirectCommand> drawCommands;
+        drawCommands.reserve(selection.clusterDraws.size());
+        for (const auto& clusterDraw : selection.clusterDraws)
+        {
+            drawCommands.push_back(vk::DrawIndexedIndirectCommand{
+                .indexCount = 0,
+                .instanceCount = 1,
+                .firstIndex = clusterDraw.outputFirstIndex,
+                .vertexOffset = 0,
+                .firstInstance = 0
+            });
+        }
+        if (!drawCommands.empty())
+        {
+            m_clusterDrawSSBOs[m_currentFrame]->LoadData(selection.clusterDraws.data(), selection.clusterDraws.size() * sizeof(ClusterDrawData));
+            m_drawCommandBuffers[m_currentFrame]->LoadData(drawCommands.data(), drawCommands.size() * sizeof(vk::DrawIndexedIndirectCommand));
+        }
+        m_frameClusterDrawCounts[m_currentFrame] = static_cast<uint32_t>(drawCommands.size());
+        m_frameClusterTriangleCounts[m_currentFrame] = selection.clusterTriangles;
+
+        // Fit the shadow cascades and fill the sun uniform buffer
+        // NOTE: the cascades follow the camera of this frame, not the one latched right before submission
+        // (the cascade spheres are larger than the view slices so the difference is negligible)
+        const DirectionalLight& sun = m_scene.GetSun();
+        glm::vec3 sunDirection = glm::normalize(sun.direction);
+        m_shadowMap->Update(m_scene.GetCamera(), sunDirection, HashGeometry(objectDatas));
+
+        SunData sunData{};
+        for (uint32_t i = 0; i < m_shadowMap->GetCascadeCount(); i++)
+        {
+            const ShadowMap::Cascade& cascade = m_shadowMap->GetCascade(i);
+            sunData.cascadeViewProj[i] = cascade.viewProj;
+            sunData.cascadeSplits[i] = cascade.splitDepth;
+            sunData.cascadeTexelSizes[i] = cascade.texelSize;
+        }
+        sunData.direction = glm::vec4(sunDirection, static_cast<float>(m_shadowMap->GetCascadeCount()));
+        sunData.color = glm::vec4(sun.color * sun.intensity, 1.0f / static_cast<float>(m_shadowMap->GetResolution()));
+        m_sunUBOs[m_currentFrame]->LoadData(&sunData, sizeof(sunData));
+
+        // Fill the light data storage buffer
+        // NOTE: the lights are binned into the clusters on the GPU (see RecordCommandBuffer)
+        const std::vector<Light>& lights = m_scene.GetLights();
+        m_lightCount = static_cast<uint32_t>(std::min<size_t>(lights.size(), MAX_LIGHTS));
+        std::vector<LightData> lightDatas;
+        lightDatas.reserve(m_lightCount);
+        for (uint32_t i = 0; i < m_lightCount; i++)
         {
-            m_gBuffers[i]->Recreate(*m_device, m_swapchain->GetExtent(), m_descriptorPool);
+            const Light& light = lights[i];
+
+            // Smooth falloff between the inner and outer cone (see KHR_lights_punctual specs)
+            float cosOuter = std::cos(light.outerConeAngle);
+            float cosInner = std::cos(light.innerConeAngle);
+            float angleScale = 1.0f / std::max(0.001f, cosInner - cosOuter);
+
+            LightData lightData{};
+            lightData.positionRange = glm::vec4(light.position, light.GetRange());
+            lightData.colorType = glm::vec4(light.color * light.intensity, static_cast<float>(light.type));
+            lightData.direction = glm::vec4(glm::normalize(light.direction), 0.0f);
+            lightData.spotParams = glm::vec4(angleScale, -cosOuter * angleScale, 0.0f, 0.0f);
+            lightDatas.push_back(lightData);
         }
+        if (!lightDatas.empty())
+            m_lightSSBOs[m_currentFrame]->LoadData(lightDatas.data(), lightDatas.size() * sizeof(LightData));
+    }
+
+    void Renderer::UpdateCameraData()
+    {
+        CameraData cameraData{};
+        cameraData.position = m_scene.GetCamera().GetPosition();
+        cameraData.view = m_scene.GetCamera().GetViewMatrix();
+        cameraData.proj = m_scene.GetCamera().GetProjectionMatrix();
+        cameraData.invViewProj = m_scene.GetCamera().GetInvViewProj();
+        glm::vec2 renderExtent(static_cast<float>(m_renderExtent.width), static_cast<float>(m_renderExtent.height));
+        cameraData.renderExtent = glm::vec4(renderExtent, 1.0f / renderExtent);
+        m_cameraUBOs[m_currentFrame]->LoadData(&cameraData, sizeof(cameraData));
+    }
+
+    // NOTE: no device wait here, the old swapchain is retired until the frames
+    // already submitted are completed and the G-buffers are resized lazily (see DrawFrame)
+    void Renderer::UpdateOnFramebufferResized()
+    {
+        m_swapchain->Recreate(m_submittedFrames);
     }
 
 	void Renderer::CreateInstance() 
@@ -612,27 +1107,123 @@ namespace Felina
         m_swapchain = std::make_unique<Swapchain>(*m_device, m_window, m_surface);
     }
 
+    // A single G-buffer is shared by the frames in flight: it's only used between the geometry
+    // and the lighting pass of a frame, so consecutive frames are serialized on it (see RecordCommandBuffer)
     void Renderer::CreateGBuffer()
     {
-        for (size_t i = 0; i < m_gBuffers.size(); i++)
+        m_gBuffer = std::make_unique<GBuffer>(
+            *m_device,
+            m_swapchain->GetExtent(),
+            m_descriptorPool,
+            m_gBufferEncoding,
+            m_renderPath == RenderPath::VisibilityBuffer,
+            m_lightingPath == LightingPath::ComputeTiled,
+            m_isDynamicResolutionEnabled
+        );
+
+        // Report the memory saved at 4K compared to one G-buffer per frame in flight
+        if (!m_hasReportedGBufferFootprint)
         {
-            m_gBuffers[i] = std::make_unique<GBuffer>(
+            auto footprint = TransientAllocator::EstimateFootprint(
                 *m_device,
-                m_swapchain->GetExtent(),
-                m_descriptorPool
+                GBuffer::GetAttachmentRequests(
+                    { 3840, 2160 }, m_gBufferEncoding,
+                    m_renderPath == RenderPath::VisibilityBuffer, m_lightingPath == LightingPath::ComputeTiled,
+                    m_isDynamicResolutionEnabled
+                )
             );
+            vk::DeviceSize naiveSize = footprint.requestedSize * MAX_FRAMES_IN_FLIGHT;
+            vk::DeviceSize usedSize = footprint.allocatedSize + footprint.lazySize;
+            LOG("[Renderer] G-buffer memory at 3840x2160: " + std::to_string(naiveSize / (1024 * 1024)) + " MiB with one copy per frame in flight, "
+                + std::to_string(usedSize / (1024 * 1024)) + " MiB shared/aliased ("
+                + std::to_string(footprint.lazySize / (1024 * 1024)) + " MiB lazily allocated), "
+                + std::to_string((naiveSize - footprint.allocatedSize) / (1024 * 1024)) + " MiB of VRAM saved");
+            m_hasReportedGBufferFootprint = true;
         }
     }
 
+    // The attachments (and the pipelines using them) depend on the encoding, the render path and the lighting path,
+    // so they're rebuilt after the GPU is idle
+    void Renderer::RebuildGBuffer()
+    {
+        WaitIdle();
+        m_hasReportedGBufferFootprint = false;
+        m_retiredGBuffers.clear();
+        CreateGBuffer();
+        CreatePipeline();
+    }
+
+    // Reads back the occlusion query of the frame in flight that has just completed:
+    // the samples passing the depth test in the first depth-tested pass (pre-pass or geometry pass)
+    // are the fragments the geometry pass would shade without a pre-pass
+    void Renderer::UpdateOverdraw()
+    {
+        if (!*m_overdrawQueryPool || m_frameSerials[m_currentFrame] == 0)
+            return;
+
+        auto queryResult = m_overdrawQueryPool.getResult<uint64_t>(m_currentFrame, 1, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (queryResult.result != vk::Result::eSuccess)
+            return;
+
+        vk::Extent2D extent = m_frameRenderExtents[m_currentFrame];
+        float pixelCount = static_cast<float>(std::max(extent.width * extent.height, 1u));
+        float overdraw = static_cast<float>(queryResult.value) / pixelCount;
+
+        // Smoothed to avoid reacting to single frames
+        m_overdraw = m_overdraw == 0.0f ? overdraw : 0.9f * m_overdraw + 0.1f * overdraw;
+
+        if (!m_isAutoDepthPrepassEnabled && m_overdraw > DEPTH_PREPASS_ENABLE_OVERDRAW)
+            m_isAutoDepthPrepassEnabled = true;
+        else if (m_isAutoDepthPrepassEnabled && m_overdraw < DEPTH_PREPASS_DISABLE_OVERDRAW)
+            m_isAutoDepthPrepassEnabled = false;
+    }
+
+    // Reads back the timestamps of the frame in flight that has just completed and feeds
+    // the dynamic resolution controller with its GPU time
+    void Renderer::UpdateGpuFrameTime()
+    {
+        if (!*m_timestampQueryPool || m_frameSerials[m_currentFrame] == 0)
+            return;
+
+        auto queryResult = m_timestampQueryPool.getResult<std::array<uint64_t, 2>>(
+            2 * m_currentFrame, 2, sizeof(uint64_t), vk::QueryResultFlagBits::e64
+        );
+        if (queryResult.result != vk::Result::eSuccess || queryResult.value[1] < queryResult.value[0])
+            return;
+
+        uint64_t ticks = queryResult.value[1] - queryResult.value[0];
+        m_gpuFrameTime = static_cast<float>(static_cast<double>(ticks) * m_device->GetTimestampPeriod() * 1e-6);
+        if (m_isDynamicResolutionEnabled)
+            m_dynamicResolution.Update(m_gpuFrameTime, m_frameRenderScales[m_currentFrame]);
+    }
+
+    // The lighting output (and the upscale pass) only exist with dynamic resolution,
+    // the G-buffer and the pipelines are rebuilt like for the render paths
+    void Renderer::SetDynamicResolution(bool isEnabled)
+    {
+        if (isEnabled == m_isDynamicResolutionEnabled)
+            return;
+
+        if (isEnabled && !IsDynamicResolutionSupported())
+        {
+            LOG("[Renderer] Dynamic resolution needs GPU timestamps, ignoring it.");
+            return;
+        }
+
+        m_isDynamicResolutionEnabled = isEnabled;
+        m_dynamicResolution.Reset();
+        RebuildGBuffer();
+    }
+
     void Renderer::CreateDescriptorSetLayouts()
     {
         // Camera set layout
-        // Binding 0 -> CameraData
+        // Binding 0 -> CameraData (compute stage for the light culling)
         vk::DescriptorSetLayoutBinding cameraBinding {
             .binding = 0, 
             .descriptorType = vk::DescriptorType::eUniformBuffer, 
             .descriptorCount = 1,
-            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 
+            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute, 
             .pImmutableSamplers = nullptr
         };
         vk::DescriptorSetLayoutCreateInfo cameraLayout{
@@ -642,12 +1233,12 @@ namespace Felina
         m_cameraSetLayout = vk::raii::DescriptorSetLayout(m_device->GetDevice(), cameraLayout);
 
         // Object set layout
-        // Binding 0 -> ObjectData
+        // Binding 0 -> ObjectData (fragment stage for the visibility buffer resolve)
         vk::DescriptorSetLayoutBinding objectBinding{
             .binding = 0,
             .descriptorType = vk::DescriptorType::eStorageBuffer,
             .descriptorCount = 1,
-            .stageFlags = vk::ShaderStageFlagBits::eVertex,
+            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
             .pImmutableSamplers = nullptr
         };
         vk::DescriptorSetLayoutCreateInfo objectLayout{
@@ -704,6 +1295,100 @@ namespace Felina
             .pBindings = bindings.data()
         };
         m_textureSetLayout = vk::raii::DescriptorSetLayout(m_device->GetDevice(), textureLayout);
+
+        // Light set layout (written by the light culling, read by the lighting pass)
+        // Binding 0 -> LightData
+        // Binding 1 -> Light count per cluster
+        // Binding 2 -> Light indices per cluster
+        std::array<vk::DescriptorSetLayoutBinding, 3> lightBindings;
+        for (uint32_t binding = 0; binding < lightBindings.size(); binding++)
+        {
+            lightBindings[binding] = {
+                .binding = binding,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eFragment,
+                .pImmutableSamplers = nullptr
+            };
+        }
+        vk::DescriptorSetLayoutCreateInfo lightLayout{
+            .bindingCount = static_cast<uint32_t>(lightBindings.size()),
+            .pBindings = lightBindings.data()
+        };
+        m_lightSetLayout = vk::raii::DescriptorSetLayout(m_device->GetDevice(), lightLayout);
+
+        // Shadow set layout (the shadow pass reads the cascade matrices, the lighting passes everything)
+        // Binding 0 -> SunData
+        // Binding 1 -> Shadow map (comparison sampler)
+        std::array<vk::DescriptorSetLayoutBinding, 2> shadowBindings;
+        shadowBindings[0] = {
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eUniformBuffer,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr
+        };
+        shadowBindings[1] = {
+            .binding = 1,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr
+        };
+        vk::DescriptorSetLayoutCreateInfo shadowLayout{
+            .bindingCount = static_cast<uint32_t>(shadowBindings.size()),
+            .pBindings = shadowBindings.data()
+        };
+        m_shadowSetLayout = vk::raii::DescriptorSetLayout(m_device->GetDevice(), shadowLayout);
+
+        // Environment set layout (image-based lighting, shared between frames)
+        // Binding 0 -> EnvironmentData (irradiance SH)
+        // Binding 1 -> Prefiltered specular cubemap
+        // Binding 2 -> BRDF LUT
+        std::array<vk::DescriptorSetLayoutBinding, 3> environmentBindings;
+        environmentBindings[0] = {
+            .binding = 0,
+            .descriptorType = vk::DescriptorType::eUniformBuffer,
+            .descriptorCount = 1,
+            .stageFlags = vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
+            .pImmutableSamplers = nullptr
+        };
+        for (uint32_t binding = 1; binding < environmentBindings.size(); binding++)
+        {
+            environmentBindings[binding] = {
+                .binding = binding,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .descriptorCount = 1,
+                .stageFlags = vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute,
+                .pImmutableSamplers = nullptr
+            };
+        }
+        vk::DescriptorSetLayoutCreateInfo environmentLayout{
+            .bindingCount = static_cast<uint32_t>(environmentBindings.size()),
+            .pBindings = environmentBindings.data()
+        };
+        m_environmentSetLayout = vk::raii::DescriptorSetLayout(m_device->GetDevice(), environmentLayout);
+
+        // Meshlet culling set layout (written by the CPU and the meshlet culling, the draws read the outputs as buffers)
+        // Binding 0 -> ClusterDrawData
+        // Binding 1 -> Indirect draw commands
+        // Binding 2 -> Culled indices
+        std::array<vk::DescriptorSetLayoutBinding, 3> meshletCullingBindings;
+        for (uint32_t binding = 0; binding < meshletCullingBindings.size(); binding++)
+        {
+            meshletCullingBindings[binding] = {
+                .binding = binding,
+                .descriptorType = vk::DescriptorType::eStorageBuffer,
+                .descriptorCount = 1,
+                .stageFlags = vk::ShaderStageFlagBits::eCompute,
+                .pImmutableSamplers = nullptr
+            };
+        }
+        vk::DescriptorSetLayoutCreateInfo meshletCullingLayout{
+            .bindingCount = static_cast<uint32_t>(meshletCullingBindings.size()),
+            .pBindings = meshletCullingBindings.data()
+        };
+        m_meshletCullingSetLayout = vk::raii::DescriptorSetLayout(m_device->GetDevice(), meshletCullingLayout);
     }
 
     void Renderer::CreatePushConstant()
@@ -711,11 +1396,24 @@ namespace Felina
         m_objectPushConst.stageFlags = vk::ShaderStageFlagBits::eVertex;
         m_objectPushConst.offset = 0;
         m_objectPushConst.size = sizeof(ObjectPushConst);
+
+        m_lightCountPushConst.stageFlags = vk::ShaderStageFlagBits::eCompute;
+        m_lightCountPushConst.offset = 0;
+        m_lightCountPushConst.size = sizeof(LightCountPushConst);
+
+        // NOTE: a single range, the object part is pushed by DrawObject and the cascade index after it
+        m_shadowPushConst.stageFlags = vk::ShaderStageFlagBits::eVertex;
+        m_shadowPushConst.offset = 0;
+        m_shadowPushConst.size = sizeof(ShadowPushConst);
+
+        m_upscalePushConst.stageFlags = vk::ShaderStageFlagBits::eFragment;
+        m_upscalePushConst.offset = 0;
+        m_upscalePushConst.size = sizeof(UpscalePushConst);
     }
 
     void Renderer::CreatePipeline()
     {
-        auto& gBuffer = m_gBuffers[0];
+        auto& gBuffer = m_gBuffer;
 
         // ---- GEOMETRY PASS ----
         PipelineBuilder pipelineBuilder{ *m_device };
@@ -727,17 +1425,49 @@ namespace Felina
             {"./shaders/geometry_pass.frag.spv", vk::ShaderStageFlagBits::eFragment}
         };
         pipelineBuilder.SetShaderStages(geomShaderStages);
-        pipelineBuilder.SetColorBlending(static_cast<uint32_t>(gBuffer->GetAttachmentsCount() - 1)); // Depth attachment doesn't need blending!
+        pipelineBuilder.SetSpecializationConstants({ static_cast<uint32_t>(gBuffer->GetEncoding()) }); // see gbuffer.hlsli
+        pipelineBuilder.SetColorBlending(static_cast<uint32_t>(gBuffer->GetColorAttachmentFormats().size())); // Depth attachment doesn't need blending!
 
         std::vector<vk::DescriptorSetLayout> layouts{ m_cameraSetLayout, m_objectSetLayout, m_materialSetLayout, m_textureSetLayout };
         std::vector<vk::PushConstantRange> ranges{ m_objectPushConst };
         pipelineBuilder.SetPipelineLayout(layouts, ranges);
         pipelineBuilder.SetAttachmentsFormat(gBuffer->GetColorAttachmentFormats(), gBuffer->GetDepthFormat());
 
-        auto [geomPipeline, geomPipelineLayout] = pipelineBuilder.BuildPipeline();
-        m_defGeometryPipeline = std::move(geomPipeline);
+        auto [geomPipelines, geomPipelineLayout] = pipelineBuilder.BuildVertexFormatPipelines();
+        m_defGeometryPipelines = std::move(geomPipelines);
         m_defGeometryPipelineLayout = std::move(geomPipelineLayout);
 
+        // Same pass after the depth pre-pass: only the visible fragments pass the test
+        pipelineBuilder.DisableDepthWrite();
+        pipelineBuilder.SetDepthCompareOp(vk::CompareOp::eEqual);
+
+        auto [geomPrepassedPipelines, geomPrepassedPipelineLayout] = pipelineBuilder.BuildVertexFormatPipelines();
+        m_defGeometryPrepassedPipelines = std::move(geomPrepassedPipelines);
+        m_defGeometryPrepassedPipelineLayout = std::move(geomPrepassedPipelineLayout);
+
+        // ---- DEPTH PRE-PASS ----
+        pipelineBuilder.Reset();
+        pipelineBuilder.EnablePositionOnlyVertexInput();
+        pipelineBuilder.EnableDepthTest();
+        pipelineBuilder.EnableBackfaceCulling();
+        std::vector<PipelineBuilder::ShaderStageInfo> prepassShaderStages{
+            {"./shaders/depth_prepass.vert.spv", vk::ShaderStageFlagBits::eVertex} // depth only, no fragment shader
+        };
+        pipelineBuilder.SetShaderStages(prepassShaderStages);
+        pipelineBuilder.SetColorBlending(0);
+        pipelineBuilder.SetPipelineLayout(
+            std::vector<vk::DescriptorSetLayout>{ m_cameraSetLayout, m_objectSetLayout },
+            std::vector<vk::PushConstantRange>{ m_objectPushConst }
+        );
+        pipelineBuilder.SetAttachmentsFormat(std::vector<vk::Format>{}, gBuffer->GetDepthFormat());
+
+        auto [prepassPipelines, prepassPipelineLayout] = pipelineBuilder.BuildVertexFormatPipelines();
+        m_depthPrepassPipelines = std::move(prepassPipelines);
+        m_depthPrepassPipelineLayout = std::move(prepassPipelineLayout);
+
+        // With dynamic resolution the lighting and the skybox are rendered to the lighting output, then upscaled
+        const vk::Format lightingFormat = gBuffer->HasUpscale() ? gBuffer->GetLightingOutputFormat() : m_swapchain->GetSurfaceFormat().format;
+
         // ---- LIGHTING PASS ----
         pipelineBuilder.Reset();
         std::vector<PipelineBuilder::ShaderStageInfo> lightShaderStages{
@@ -745,19 +1475,203 @@ namespace Felina
             {"./shaders/lighting_pass.frag.spv", vk::ShaderStageFlagBits::eFragment}
         };
         pipelineBuilder.SetShaderStages(lightShaderStages);
+        pipelineBuilder.SetSpecializationConstants({ static_cast<uint32_t>(gBuffer->GetEncoding()) });
         pipelineBuilder.DisableVertexInput();
-        pipelineBuilder.DisableDepthTest();
+        // The fullscreen triangle is at the far plane: GREATER rejects the background pixels before shading
+        pipelineBuilder.EnableDepthTest();
+        pipelineBuilder.DisableDepthWrite();
+        pipelineBuilder.SetDepthCompareOp(vk::CompareOp::eGreater);
         pipelineBuilder.DisableBackfaceCulling(); // To avoid culling the fullscreen triangle
-        pipelineBuilder.SetColorBlending(1); // 1 attachment -> swapchain image
+        pipelineBuilder.SetColorBlending(1); // 1 attachment -> swapchain image (or lighting output)
         pipelineBuilder.SetPipelineLayout(
-            std::vector<vk::DescriptorSetLayout>{ m_cameraSetLayout, gBuffer->GetDescriptorSetLayout(), m_textureSetLayout },
+            std::vector<vk::DescriptorSetLayout>{
+                m_cameraSetLayout, gBuffer->GetDescriptorSetLayout(), m_lightSetLayout, m_shadowSetLayout, m_environmentSetLayout
+            },
             std::vector<vk::PushConstantRange>{}
         );
-        pipelineBuilder.SetAttachmentsFormat(std::vector<vk::Format>{ m_swapchain->GetSurfaceFormat().format }, vk::Format::eUndefined); // no depth attachment
+        pipelineBuilder.SetAttachmentsFormat(std::vector<vk::Format>{ lightingFormat }, gBuffer->GetDepthFormat()); // read-only depth
         
         auto [lightPipeline, lightPipelineLayout] = pipelineBuilder.BuildPipeline();
         m_defLightingPipeline = std::move(lightPipeline);
         m_defLightingPipelineLayout = std::move(lightPipelineLayout);
+
+        // ---- SKYBOX ----
+        // Same fullscreen triangle, EQUAL only keeps the pixels where the depth is still cleared to the far plane
+        pipelineBuilder.Reset();
+        std::vector<PipelineBuilder::ShaderStageInfo> skyboxShaderStages{
+            {"./shaders/lighting_pass.vert.spv", vk::ShaderStageFlagBits::eVertex},
+            {"./shaders/skybox.frag.spv", vk::ShaderStageFlagBits::eFragment}
+        };
+        pipelineBuilder.SetShaderStages(skyboxShaderStages);
+        pipelineBuilder.DisableVertexInput();
+        pipelineBuilder.EnableDepthTest();
+        pipelineBuilder.DisableDepthWrite();
+        pipelineBuilder.SetDepthCompareOp(vk::CompareOp::eEqual);
+        pipelineBuilder.DisableBackfaceCulling();
+        pipelineBuilder.SetColorBlending(1);
+        pipelineBuilder.SetPipelineLayout(
+            std::vector<vk::DescriptorSetLayout>{ m_cameraSetLayout, m_textureSetLayout },
+            std::vector<vk::PushConstantRange>{}
+        );
+        pipelineBuilder.SetAttachmentsFormat(std::vector<vk::Format>{ lightingFormat }, gBuffer->GetDepthFormat());
+
+        auto [skyboxPipeline, skyboxPipelineLayout] = pipelineBuilder.BuildPipeline();
+        m_skyboxPipeline = std::move(skyboxPipeline);
+        m_skyboxPipelineLayout = std::move(skyboxPipelineLayout);
+
+        // ---- UPSCALE (dynamic resolution) ----
+        // Fullscreen triangle sampling the rendered area of the lighting output, the UI is drawn after it
+        m_upscalePipeline = nullptr;
+        m_upscalePipelineLayout = nullptr;
+        if (gBuffer->HasUpscale())
+        {
+            pipelineBuilder.Reset();
+            std::vector<PipelineBuilder::ShaderStageInfo> upscaleShaderStages{
+                {"./shaders/lighting_pass.vert.spv", vk::ShaderStageFlagBits::eVertex},
+                {"./shaders/upscale.frag.spv", vk::ShaderStageFlagBits::eFragment}
+            };
+            pipelineBuilder.SetShaderStages(upscaleShaderStages);
+            pipelineBuilder.DisableVertexInput();
+            pipelineBuilder.DisableDepthTest();
+            pipelineBuilder.DisableBackfaceCulling();
+            pipelineBuilder.SetColorBlending(1);
+            pipelineBuilder.SetPipelineLayout(
+                std::vector<vk::DescriptorSetLayout>{ gBuffer->GetUpscaleDescriptorSetLayout() },
+                std::vector<vk::PushConstantRange>{ m_upscalePushConst }
+            );
+            pipelineBuilder.SetAttachmentsFormat(std::vector<vk::Format>{ m_swapchain->GetSurfaceFormat().format }, vk::Format::eUndefined);
+
+            auto [upscalePipeline, upscalePipelineLayout] = pipelineBuilder.BuildPipeline();
+            m_upscalePipeline = std::move(upscalePipeline);
+            m_upscalePipelineLayout = std::move(upscalePipelineLayout);
+        }
+
+        // ---- TILED LIGHTING PASS (compute) ----
+        m_tiledLightingPipeline = nullptr;
+        m_tiledLightingPipelineLayout = nullptr;
+        if (m_lightingPath == LightingPath::ComputeTiled)
+        {
+            pipelineBuilder.Reset();
+            pipelineBuilder.SetShaderStages({ {"./shaders/tiled_lighting.comp.spv", vk::ShaderStageFlagBits::eCompute} });
+            pipelineBuilder.SetSpecializationConstants({ static_cast<uint32_t>(gBuffer->GetEncoding()) }); // see gbuffer.hlsli
+            pipelineBuilder.SetPipelineLayout(
+                std::vector<vk::DescriptorSetLayout>{
+                    m_cameraSetLayout, gBuffer->GetDescriptorSetLayout(), m_lightSetLayout,
+                    gBuffer->GetLightingOutputDescriptorSetLayout(), m_shadowSetLayout, m_environmentSetLayout
+                },
+                std::vector<vk::PushConstantRange>{ m_lightCountPushConst }
+            );
+
+            auto [tiledLightingPipeline, tiledLightingPipelineLayout] = pipelineBuilder.BuildComputePipeline();
+            m_tiledLightingPipeline = std::move(tiledLightingPipeline);
+            m_tiledLightingPipelineLayout = std::move(tiledLightingPipelineLayout);
+        }
+
+        m_visibilityPipelines.clear();
+        m_visibilityPipelineLayout = nullptr;
+        m_resolvePipeline = nullptr;
+        m_resolvePipelineLayout = nullptr;
+        if (m_renderPath != RenderPath::VisibilityBuffer)
+            return;
+
+        // ---- VISIBILITY PASS ----
+        pipelineBuilder.Reset();
+        pipelineBuilder.EnablePositionOnlyVertexInput();
+        pipelineBuilder.EnableDepthTest();
+        pipelineBuilder.EnableBackfaceCulling();
+        std::vector<PipelineBuilder::ShaderStageInfo> visibilityShaderStages{
+            {"./shaders/visibility_pass.vert.spv", vk::ShaderStageFlagBits::eVertex},
+            {"./shaders/visibility_pass.frag.spv", vk::ShaderStageFlagBits::eFragment}
+        };
+        pipelineBuilder.SetShaderStages(visibilityShaderStages);
+        pipelineBuilder.SetColorBlending(1); // 1 attachment -> visibility
+        pipelineBuilder.SetPipelineLayout(
+            std::vector<vk::DescriptorSetLayout>{ m_cameraSetLayout, m_objectSetLayout },
+            std::vector<vk::PushConstantRange>{ m_objectPushConst }
+        );
+        pipelineBuilder.SetAttachmentsFormat(std::vector<vk::Format>{ gBuffer->GetVisibilityFormat() }, gBuffer->GetDepthFormat());
+
+        auto [visibilityPipelines, visibilityPipelineLayout] = pipelineBuilder.BuildVertexFormatPipelines();
+        m_visibilityPipelines = std::move(visibilityPipelines);
+        m_visibilityPipelineLayout = std::move(visibilityPipelineLayout);
+
+        // ---- RESOLVE PASS ----
+        pipelineBuilder.Reset();
+        std::vector<PipelineBuilder::ShaderStageInfo> resolveShaderStages{
+            {"./shaders/lighting_pass.vert.spv", vk::ShaderStageFlagBits::eVertex}, // fullscreen triangle
+            {"./shaders/visibility_resolve.frag.spv", vk::ShaderStageFlagBits::eFragment}
+        };
+        pipelineBuilder.SetShaderStages(resolveShaderStages);
+        pipelineBuilder.SetSpecializationConstants({ static_cast<uint32_t>(gBuffer->GetEncoding()) }); // see gbuffer.hlsli
+        pipelineBuilder.DisableVertexInput();
+        pipelineBuilder.DisableDepthTest();
+        pipelineBuilder.DisableBackfaceCulling();
+        pipelineBuilder.SetColorBlending(static_cast<uint32_t>(gBuffer->GetColorAttachmentFormats().size()));
+        pipelineBuilder.SetPipelineLayout(
+            std::vector<vk::DescriptorSetLayout>{ 
+                m_cameraSetLayout, m_objectSetLayout, m_materialSetLayout, m_textureSetLayout, 
+                gBuffer->GetVisibilityDescriptorSetLayout() 
+            },
+            std::vector<vk::PushConstantRange>{}
+        );
+        pipelineBuilder.SetAttachmentsFormat(gBuffer->GetColorAttachmentFormats(), vk::Format::eUndefined); // depth written by the visibility pass
+
+        auto [resolvePipeline, resolvePipelineLayout] = pipelineBuilder.BuildPipeline();
+        m_resolvePipeline = std::move(resolvePipeline);
+        m_resolvePipelineLayout = std::move(resolvePipelineLayout);
+    }
+
+    // Independent of the G-buffer, it isn't rebuilt with the other pipelines
+    void Renderer::CreateLightCullingPipeline()
+    {
+        PipelineBuilder pipelineBuilder{ *m_device };
+        pipelineBuilder.SetShaderStages({ {"./shaders/light_culling.comp.spv", vk::ShaderStageFlagBits::eCompute} });
+        pipelineBuilder.SetPipelineLayout(
+            std::vector<vk::DescriptorSetLayout>{ m_cameraSetLayout, m_lightSetLayout },
+            std::vector<vk::PushConstantRange>{ m_lightCountPushConst }
+        );
+
+        auto [cullingPipeline, cullingPipelineLayout] = pipelineBuilder.BuildComputePipeline();
+        m_lightCullingPipeline = std::move(cullingPipeline);
+        m_lightCullingPipelineLayout = std::move(cullingPipelineLayout);
+    }
+
+    // Independent of the G-buffer, it isn't rebuilt with the other pipelines
+    void Renderer::CreateMeshletCullingPipeline()
+    {
+        PipelineBuilder pipelineBuilder{ *m_device };
+        pipelineBuilder.SetShaderStages({ {"./shaders/meshlet_culling.comp.spv", vk::ShaderStageFlagBits::eCompute} });
+        pipelineBuilder.SetPipelineLayout(
+            std::vector<vk::DescriptorSetLayout>{ m_cameraSetLayout, m_meshletCullingSetLayout },
+            std::vector<vk::PushConstantRange>{}
+        );
+
+        auto [cullingPipeline, cullingPipelineLayout] = pipelineBuilder.BuildComputePipeline();
+        m_meshletCullingPipeline = std::move(cullingPipeline);
+        m_meshletCullingPipelineLayout = std::move(cullingPipelineLayout);
+    }
+
+    // Independent of the G-buffer, it isn't rebuilt with the other pipelines
+    void Renderer::CreateShadowPipeline()
+    {
+        PipelineBuilder pipelineBuilder{ *m_device };
+        pipelineBuilder.EnablePositionOnlyVertexInput();
+        pipelineBuilder.EnableDepthTest();
+        // Both faces are drawn: the glTF scenes aren't guaranteed to be closed meshes
+        pipelineBuilder.DisableBackfaceCulling();
+        // Slope-scaled bias against the acne (the lighting passes add a normal offset on top of it)
+        pipelineBuilder.EnableDepthBias(1.25f, 1.75f);
+        pipelineBuilder.SetShaderStages({ {"./shaders/shadow_pass.vert.spv", vk::ShaderStageFlagBits::eVertex} }); // depth only
+        pipelineBuilder.SetColorBlending(0);
+        pipelineBuilder.SetPipelineLayout(
+            std::vector<vk::DescriptorSetLayout>{ m_shadowSetLayout, m_objectSetLayout },
+            std::vector<vk::PushConstantRange>{ m_shadowPushConst }
+        );
+        pipelineBuilder.SetAttachmentsFormat(std::vector<vk::Format>{}, ShadowMap::FORMAT);
+
+        auto [shadowPipelines, shadowPipelineLayout] = pipelineBuilder.BuildVertexFormatPipelines();
+        m_shadowPipelines = std::move(shadowPipelines);
+        m_shadowPipelineLayout = std::move(shadowPipelineLayout);
     }
 
     void Renderer::CreateCommandPool()
@@ -861,22 +1775,76 @@ namespace Felina
             VmaAllocationCreateInfo materialSsboAllocInfo{};
             materialSsboAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
             m_materialSSBOs[i] = std::make_unique<Buffer>(m_device->GetAllocator(), materialSsboInfo, materialSsboAllocInfo, true);
+
+            // Light data storage buffer creation
+            vk::BufferCreateInfo lightSsboInfo{};
+            lightSsboInfo.size = sizeof(LightData) * MAX_LIGHTS;
+            lightSsboInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+            VmaAllocationCreateInfo lightSsboAllocInfo{};
+            lightSsboAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+            m_lightSSBOs[i] = std::make_unique<Buffer>(m_device->GetAllocator(), lightSsboInfo, lightSsboAllocInfo, true);
+
+            // Sun uniform buffer creation
+            vk::BufferCreateInfo sunUboInfo{};
+            sunUboInfo.size = sizeof(SunData);
+            sunUboInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer;
+            VmaAllocationCreateInfo sunUboAllocInfo{};
+            sunUboAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+            m_sunUBOs[i] = std::make_unique<Buffer>(m_device->GetAllocator(), sunUboInfo, sunUboAllocInfo, true);
+
+            // Cluster storage buffers creation (only accessed by the GPU)
+            VmaAllocationCreateInfo clusterAllocInfo{};
+            clusterAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+            vk::BufferCreateInfo clusterCountInfo{};
+            clusterCountInfo.size = sizeof(uint32_t) * CLUSTER_COUNT;
+            clusterCountInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+            m_clusterLightCountBuffers[i] = std::make_unique<Buffer>(m_device->GetAllocator(), clusterCountInfo, clusterAllocInfo);
+            vk::BufferCreateInfo clusterIndexInfo{};
+            clusterIndexInfo.size = sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER;
+            clusterIndexInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+            m_clusterLightIndexBuffers[i] = std::make_unique<Buffer>(m_device->GetAllocator(), clusterIndexInfo, clusterAllocInfo);
+
+            // Meshlet culling buffers creation (the indirect commands are read back for the statistics)
+            vk::BufferCreateInfo clusterDrawSsboInfo{};
+            clusterDrawSsboInfo.size = sizeof(ClusterDrawData) * MAX_OBJECTS;
+            clusterDrawSsboInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+            VmaAllocationCreateInfo clusterDrawSsboAllocInfo{};
+            clusterDrawSsboAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+            m_clusterDrawSSBOs[i] = std::make_unique<Buffer>(m_device->GetAllocator(), clusterDrawSsboInfo, clusterDrawSsboAllocInfo, true);
+            vk::BufferCreateInfo drawCommandInfo{};
+            drawCommandInfo.size = sizeof(vk::DrawIndexedIndirectCommand) * MAX_OBJECTS;
+            drawCommandInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
+            VmaAllocationCreateInfo drawCommandAllocInfo{};
+            drawCommandAllocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+            m_drawCommandBuffers[i] = std::make_unique<Buffer>(m_device->GetAllocator(), drawCommandInfo, drawCommandAllocInfo, true);
+            vk::BufferCreateInfo culledIndexInfo{};
+            culledIndexInfo.size = sizeof(uint32_t) * MAX_CULLED_INDICES;
+            culledIndexInfo.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress;
+            m_culledIndexBuffers[i] = std::make_unique<Buffer>(m_device->GetAllocator(), culledIndexInfo, clusterAllocInfo);
+            m_culledIndexAddresses[i] = m_device->GetDevice().getBufferAddress({ .buffer = m_culledIndexBuffers[i]->GetHandle() });
         }
     }
 
     void Renderer::CreateDescriptorPool()
     {
-        // TODO: remove hardcoded number of attachments
         // NOTE: the pool is created before the GBuffer because it
         // uses the pool to allocate the attachments sets
-        uint32_t attachmentsCount = 3 * MAX_FRAMES_IN_FLIGHT;
-        std::array<vk::DescriptorPoolSize, 5> poolSizes {
-            vk::DescriptorPoolSize { .type = vk::DescriptorType::eUniformBuffer, .descriptorCount = MAX_FRAMES_IN_FLIGHT },
-            vk::DescriptorPoolSize { .type = vk::DescriptorType::eStorageBuffer, .descriptorCount = MAX_FRAMES_IN_FLIGHT },
+        // (the G-buffer is shared, but retired ones may be alive until the frames in flight complete)
+        // (+1 for the visibility attachment set, +1 for the upscale set)
+        uint32_t attachmentsCount = (GBuffer::ATTACHMENT_COUNT + 2) * (MAX_FRAMES_IN_FLIGHT + 1);
+        // Objects, materials, the 3 light set buffers and the 3 meshlet culling buffers per frame
+        uint32_t storageBuffersCount = (2 + 3 + 3) * MAX_FRAMES_IN_FLIGHT;
+        std::array<vk::DescriptorPoolSize, 6> poolSizes {
+            // Camera and sun (+1 for the environment)
+            vk::DescriptorPoolSize { .type = vk::DescriptorType::eUniformBuffer, .descriptorCount = 2 * MAX_FRAMES_IN_FLIGHT + 1 },
+            vk::DescriptorPoolSize { .type = vk::DescriptorType::eStorageBuffer, .descriptorCount = storageBuffersCount },
+            // G-buffer attachments and the shadow map of each frame (+2 for the environment maps)
             vk::DescriptorPoolSize { 
                 .type = vk::DescriptorType::eCombinedImageSampler,
-                .descriptorCount = attachmentsCount
+                .descriptorCount = attachmentsCount + MAX_FRAMES_IN_FLIGHT + 2
             },
+            // Lighting output of the G-buffers (compute lighting path)
+            vk::DescriptorPoolSize { .type = vk::DescriptorType::eStorageImage, .descriptorCount = MAX_FRAMES_IN_FLIGHT + 1 },
 
             // These reserved space will be used by ONE descriptor set (see below)
             vk::DescriptorPoolSize { .type = vk::DescriptorType::eSampledImage, .descriptorCount = MAX_TEXTURES + 1 },
@@ -921,6 +1889,41 @@ namespace Felina
         };
         m_materialDescriptorSets = m_device->GetDevice().allocateDescriptorSets(materialAllocInfo);
 
+        // Lights
+        std::vector<vk::DescriptorSetLayout> lightLayouts(MAX_FRAMES_IN_FLIGHT, m_lightSetLayout);
+        vk::DescriptorSetAllocateInfo lightAllocInfo{
+            .descriptorPool = m_descriptorPool,
+            .descriptorSetCount = static_cast<uint32_t>(lightLayouts.size()),
+            .pSetLayouts = lightLayouts.data()
+        };
+        m_lightDescriptorSets = m_device->GetDevice().allocateDescriptorSets(lightAllocInfo);
+
+        // Sun and shadow map (written by UpdateShadowDescriptorSets)
+        std::vector<vk::DescriptorSetLayout> shadowLayouts(MAX_FRAMES_IN_FLIGHT, m_shadowSetLayout);
+        vk::DescriptorSetAllocateInfo shadowAllocInfo{
+            .descriptorPool = m_descriptorPool,
+            .descriptorSetCount = static_cast<uint32_t>(shadowLayouts.size()),
+            .pSetLayouts = shadowLayouts.data()
+        };
+        m_shadowDescriptorSets = m_device->GetDevice().allocateDescriptorSets(shadowAllocInfo);
+
+        // Meshlet culling
+        std::vector<vk::DescriptorSetLayout> meshletCullingLayouts(MAX_FRAMES_IN_FLIGHT, m_meshletCullingSetLayout);
+        vk::DescriptorSetAllocateInfo meshletCullingAllocInfo{
+            .descriptorPool = m_descriptorPool,
+            .descriptorSetCount = static_cast<uint32_t>(meshletCullingLayouts.size()),
+            .pSetLayouts = meshletCullingLayouts.data()
+        };
+        m_meshletCullingDescriptorSets = m_device->GetDevice().allocateDescriptorSets(meshletCullingAllocInfo);
+
+        // Environment (single set, written by UpdateEnvironmentDescriptorSet)
+        vk::DescriptorSetAllocateInfo environmentAllocInfo{
+            .descriptorPool = m_descriptorPool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &*m_environmentSetLayout
+        };
+        m_environmentDescriptorSet = std::move(m_device->GetDevice().allocateDescriptorSets(environmentAllocInfo).front());
+
         // Texture and sampler
         vk::DescriptorSetAllocateInfo textureAllocInfo
         {
@@ -934,302 +1937,901 @@ namespace Felina
     void Renderer::CreateSyncObjects()
     {
         m_imageAvailableSemaphores.clear();
-        m_renderFinishedSemaphores.clear();
         m_inFlightFences.clear();
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             m_imageAvailableSemaphores.emplace_back(m_device->GetDevice(), vk::SemaphoreCreateInfo());
-            m_renderFinishedSemaphores.emplace_back(m_device->GetDevice(), vk::SemaphoreCreateInfo());
             m_inFlightFences.emplace_back(m_device->GetDevice(), vk::FenceCreateInfo{ .flags = vk::FenceCreateFlagBits::eSignaled });
         }
     }
 
-    void Renderer::DrawObject(const Object& obj, uint32_t& idx)
+    void Renderer::CreateQueryPool()
     {
-        // TODO: improve invalid ResourceIDs handling
-        // Skip drawing if the object has no mesh
-        if (obj.GetMesh() != MeshID(-1))
+        if (m_device->IsTimestampQuerySupported())
         {
-            // Draw the object
-            // Update push const
-            ObjectPushConst pc{
-                .objectIndex = idx,
-                .materialIndex = m_materialIDToSSBOID[m_currentFrame][obj.GetMaterial()]
+            vk::QueryPoolCreateInfo timestampPoolInfo{
+                .queryType = vk::QueryType::eTimestamp,
+                .queryCount = 2 * MAX_FRAMES_IN_FLIGHT
             };
-            m_commandBuffers[m_currentFrame].pushConstants(
-                *m_defGeometryPipelineLayout,
-                vk::ShaderStageFlagBits::eVertex,
-                0,
-                vk::ArrayProxy<const ObjectPushConst>(1, &pc)
-            );
+            m_timestampQueryPool = vk::raii::QueryPool(m_device->GetDevice(), timestampPoolInfo);
+        }
+
+        // Without precise queries the results are only zero/non-zero
+        if (!m_device->IsPreciseOcclusionQuerySupported())
+            return;
+
+        vk::QueryPoolCreateInfo queryPoolInfo{
+            .queryType = vk::QueryType::eOcclusion,
+            .queryCount = MAX_FRAMES_IN_FLIGHT
+        };
+        m_overdrawQueryPool = vk::raii::QueryPool(m_device->GetDevice(), queryPoolInfo);
+    }
 
-            // Bind vertex and index buffer
+    void Renderer::CreateShadowMap()
+    {
+        m_shadowMap = std::make_unique<ShadowMap>(*m_device, m_shadowCascadeCount, m_shadowResolution);
+        UpdateShadowDescriptorSets();
+    }
+
+    void Renderer::UpdateShadowDescriptorSets()
+    {
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            vk::DescriptorBufferInfo sunUBOInfo{
+                .buffer = m_sunUBOs[i]->GetHandle(),
+                .offset = 0,
+                .range = sizeof(SunData)
+            };
+            // NOTE: sampled in the depth read-only layout (see RenderGraph::Transition)
+            vk::DescriptorImageInfo shadowMapInfo{
+                .sampler = m_shadowMap->GetSampler(),
+                .imageView = m_shadowMap->GetArrayView(),
+                .imageLayout = vk::ImageLayout::eDepthReadOnlyOptimal
+            };
+            std::array<vk::WriteDescriptorSet, 2> shadowWrites;
+            shadowWrites[0] = {
+                .dstSet = m_shadowDescriptorSets[i],
+                .dstBinding = 0,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eUniformBuffer,
+                .pBufferInfo = &sunUBOInfo
+            };
+            shadowWrites[1] = {
+                .dstSet = m_shadowDescriptorSets[i],
+                .dstBinding = 1,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .pImageInfo = &shadowMapInfo
+            };
+            m_device->GetDevice().updateDescriptorSets(shadowWrites, {});
+        }
+    }
+
+    void Renderer::UpdateEnvironmentDescriptorSet()
+    {
+        vk::DescriptorBufferInfo environmentUBOInfo{
+            .buffer = m_environmentMap->GetUniformBuffer().GetHandle(),
+            .offset = 0,
+            .range = sizeof(EnvironmentMap::EnvironmentData)
+        };
+        vk::DescriptorImageInfo specularMapInfo{
+            .sampler = m_environmentMap->GetSampler(),
+            .imageView = m_environmentMap->GetSpecularMap().GetImageView(),
+            .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+        vk::DescriptorImageInfo brdfLutInfo{
+            .sampler = m_environmentMap->GetSampler(),
+            .imageView = m_environmentMap->GetBrdfLut().GetImageView(),
+            .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+        };
+        std::array<vk::WriteDescriptorSet, 3> environmentWrites;
+        environmentWrites[0] = {
+            .dstSet = m_environmentDescriptorSet,
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eUniformBuffer,
+            .pBufferInfo = &environmentUBOInfo
+        };
+        environmentWrites[1] = {
+            .dstSet = m_environmentDescriptorSet,
+            .dstBinding = 1,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .pImageInfo = &specularMapInfo
+        };
+        environmentWrites[2] = {
+            .dstSet = m_environmentDescriptorSet,
+            .dstBinding = 2,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+            .pImageInfo = &brdfLutInfo
+        };
+        m_device->GetDevice().updateDescriptorSets(environmentWrites, {});
+    }
+
+    void Renderer::DrawScene(
+        const std::vector<vk::raii::Pipeline>& pipelines, const vk::raii::PipelineLayout& pipelineLayout,
+        bool positionsOnly, bool cullMeshlets, bool fullDetail
+    )
+    {
+        uint32_t idx = 0;
+        VertexFormat boundFormat = VertexFormat::Count; // nothing bound yet
+        for (const auto& objPtr : m_scene.GetObjects())
+            DrawObject(*objPtr, idx, boundFormat, pipelines, pipelineLayout, positionsOnly, cullMeshlets, fullDetail);
+        if (m_areStaticBatchesDrawn)
+        {
+            for (const auto& batchPtr : m_scene.GetStaticBatches())
+                DrawObject(*batchPtr, idx, boundFormat, pipelines, pipelineLayout, positionsOnly, cullMeshlets, fullDetail);
+        }
+    }
+
+    void Renderer::DrawObject(
+        const Object& obj, uint32_t& idx, VertexFormat& boundFormat,
+        const std::vector<vk::raii::Pipeline>& pipelines, const vk::raii::PipelineLayout& pipelineLayout,
+        bool positionsOnly, bool cullMeshlets, bool fullDetail
+    )
+    {
+        // TODO: improve invalid ResourceIDs handling
+        // Skip drawing if the object has no mesh, or if a static batch draws it
+        if (obj.GetMesh() != MeshID(-1) && !(m_areStaticBatchesDrawn && obj.IsStaticBatched()))
+        {
             auto& mesh = ResourceManager::GetInstance().GetMesh(obj.GetMesh());
-            m_commandBuffers[m_currentFrame].bindVertexBuffers(0, mesh.GetVertexBuffer().GetHandle(), { 0 });
-            m_commandBuffers[m_currentFrame].bindIndexBuffer(mesh.GetIndexBuffer().GetHandle(), 0, mesh.GetIndexType());
 
-            // Draw call
-            m_commandBuffers[m_currentFrame].drawIndexed(mesh.GetIndexBufferSize(), 1, 0, 0, 0);
+            // Pipeline variant matching the vertex buffer layout
+            if (mesh.GetVertexFormat() != boundFormat)
+            {
+                boundFormat = mesh.GetVertexFormat();
+                m_commandBuffers[m_currentFrame].bindPipeline(vk::PipelineBindPoint::eGraphics, pipelines[static_cast<uint32_t>(boundFormat)]);
+            }
+
+            // Bind vertex buffer
+            // Depth-only passes use the packed position stream
+            const Buffer& vertexBuffer = positionsOnly ? mesh.GetPositionBuffer() : mesh.GetVertexBuffer();
+            m_commandBuffers[m_currentFrame].bindVertexBuffers(0, vertexBuffer.GetHandle(), { 0 });
 
-            // Increment index AFTER drawing the object
-            ++idx;
+            // Draw the submeshes, they share the vertex buffer
+            for (const Submesh& submesh : mesh.GetSubmeshes())
+            {
+                // The draws beyond MAX_OBJECTS weren't selected (see UpdateObject), neither are the next ones
+                if (idx >= m_objectDraws.size())
+                    return;
+
+                // Draw call (LOD, material and meshlet culling selected in SetupFrameData)
+                const ObjectDraw& draw = m_objectDraws[idx];
+
+                // Update push const
+                ObjectPushConst pc{
+                    .objectIndex = idx,
+                    .materialIndex = draw.materialIndex
+                };
+                m_commandBuffers[m_currentFrame].pushConstants(
+                    *pipelineLayout,
+                    vk::ShaderStageFlagBits::eVertex,
+                    0,
+                    vk::ArrayProxy<const ObjectPushConst>(1, &pc)
+                );
+
+                if (cullMeshlets && draw.clusterDraw != NO_CLUSTER_DRAW)
+                {
+                    // Visible triangles compacted by the meshlet culling pass, the index count is written on the GPU
+                    m_commandBuffers[m_currentFrame].bindIndexBuffer(m_culledIndexBuffers[m_currentFrame]->GetHandle(), 0, vk::IndexType::eUint32);
+                    m_commandBuffers[m_currentFrame].drawIndexedIndirect(
+                        m_drawCommandBuffers[m_currentFrame]->GetHandle(),
+                        draw.clusterDraw * sizeof(vk::DrawIndexedIndirectCommand),
+                        1,
+                        sizeof(vk::DrawIndexedIndirectCommand)
+                    );
+                }
+                else
+                {
+                    const MeshLod& lod = submesh.lods[fullDetail ? 0 : draw.lod];
+                    m_commandBuffers[m_currentFrame].bindIndexBuffer(mesh.GetIndexBuffer().GetHandle(), 0, mesh.GetIndexType());
+                    m_commandBuffers[m_currentFrame].drawIndexed(lod.indexCount, 1, lod.firstIndex, 0, 0);
+                }
+
+                // Increment index AFTER drawing the submesh
+                ++idx;
+            }
         }
 
         // Iterate through its children
         for (const auto& childPtr : obj.GetChildren())
         {
             const Object& child = *childPtr;
-            DrawObject(child, idx);
+            DrawObject(child, idx, boundFormat, pipelines, pipelineLayout, positionsOnly, cullMeshlets, fullDetail);
         }
     }
 
-    void Renderer::RecordCommandBuffer(uint32_t imageIndex)
+    // NOTE: no-op if the device doesn't support precise occlusion queries
+    void Renderer::BeginOverdrawQuery(const vk::raii::CommandBuffer& cmdBuf)
     {
-        auto& cmdBuf = m_commandBuffers[m_currentFrame];
-        auto& gBuffer = m_gBuffers[m_currentFrame];
-        vk::Extent2D swapchainExtent = m_swapchain->GetExtent();
+        if (*m_overdrawQueryPool)
+            cmdBuf.beginQuery(m_overdrawQueryPool, m_currentFrame, vk::QueryControlFlagBits::ePrecise);
+    }
 
-        cmdBuf.begin({});
-        
-        // ---- Geometry pass ----
+    void Renderer::EndOverdrawQuery(const vk::raii::CommandBuffer& cmdBuf)
+    {
+        if (*m_overdrawQueryPool)
+            cmdBuf.endQuery(m_overdrawQueryPool, m_currentFrame);
+    }
 
-        // Transition G-buffer attachments to color attachment layout
-        const GBuffer::Attachment* depthAttachment = nullptr;
+    void Renderer::RecordCommandBuffer(uint32_t imageIndex)
+    {
+        auto& gBuffer = m_gBuffer;
+        vk::Extent2D swapchainExtent = m_swapchain->GetExtent();
+        // Top-left area of the G-buffer the passes render to (dynamic resolution), then upscaled to the swapchain
+        vk::Extent2D renderExtent = m_renderExtent;
+        const bool hasUpscale = gBuffer->HasUpscale();
+
+        using Usage = RenderGraph::Usage;
+
+        // ---- Resources ----
+        // NOTE: the G-buffer is fully rewritten each frame so its previous contents are discarded,
+        // but it's shared with the previous frame in flight which may still be reading it
+        m_renderGraph.Reset();
+        std::vector<RenderGraph::ResourceHandle> colorTargets;
+        RenderGraph::ResourceHandle depthTarget = UINT32_MAX;
+        RenderGraph::ResourceHandle visibilityTarget = UINT32_MAX;
+        RenderGraph::ResourceHandle lightingOutputTarget = UINT32_MAX;
         for (auto& attachment : gBuffer->GetAttachments())
         {
-            if (attachment.type == GBuffer::AttachmentType::Depth)
-            {
-                depthAttachment = &attachment;
-                continue;
-            }
-                
-            TransitionImageLayout(
+            auto handle = m_renderGraph.ImportImage(
+                "GBuffer" + std::to_string(attachment.type), 
                 attachment.image->GetHandle(), attachment.image->GetFormat(),
-                vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal,
-                {}, vk::AccessFlagBits2::eColorAttachmentWrite,
-                vk::PipelineStageFlagBits2::eTopOfPipe, vk::PipelineStageFlagBits2::eColorAttachmentOutput
+                1, 1, Usage::Aliased
             );
+            if (attachment.type == GBuffer::AttachmentType::Depth)
+                depthTarget = handle;
+            else if (attachment.type == GBuffer::AttachmentType::Visibility)
+                visibilityTarget = handle;
+            else if (attachment.type == GBuffer::AttachmentType::LightingOutput)
+                lightingOutputTarget = handle;
+            else
+                colorTargets.push_back(handle);
         }
 
-        if(depthAttachment == nullptr)
+        if (depthTarget == UINT32_MAX)
             throw std::runtime_error("[RENDERER] Couldn't retrieve the G-buffer depth attachment because there's no such attachment!");
 
-        // Transition depth attachment as well
-        TransitionImageLayout(
-            depthAttachment->image->GetHandle(), depthAttachment->image->GetFormat(),
-            vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal,
-            {}, vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
-            vk::PipelineStageFlagBits2::eTopOfPipe, vk::PipelineStageFlagBits2::eEarlyFragmentTests
+        auto backbuffer = m_renderGraph.ImportImage(
+            "Backbuffer", 
+            m_swapchain->GetImages()[imageIndex], m_swapchain->GetSurfaceFormat().format, 
+            1, 1, Usage::Acquired
         );
-
-        // Setup rendering info (dynamic rendering)
-        // Color attachments rendering info
-        std::vector<vk::RenderingAttachmentInfo> colorAttachmentInfos;
-        for (auto& attachment : gBuffer->GetAttachments())
+        m_renderGraph.MarkOutput(backbuffer, Usage::Present);
+
+        // Per frame in flight, the previous frame using them is already completed
+        auto clusterLightCounts = m_renderGraph.ImportBuffer("ClusterLightCounts", m_clusterLightCountBuffers[m_currentFrame]->GetHandle());
+        auto clusterLightIndices = m_renderGraph.ImportBuffer("ClusterLightIndices", m_clusterLightIndexBuffers[m_currentFrame]->GetHandle());
+
+        // Meshlet culling outputs, per frame in flight as well (the index counts are read back by SetupFrameData)
+        const uint32_t clusterDrawCount = m_frameClusterDrawCounts[m_currentFrame];
+        RenderGraph::ResourceHandle drawCommands = UINT32_MAX;
+        RenderGraph::ResourceHandle culledIndices = UINT32_MAX;
+        std::vector<RenderGraph::Access> culledDrawAccesses;
+        if (clusterDrawCount > 0)
         {
-            if (attachment.type == GBuffer::AttachmentType::Depth)
-                continue;
-            colorAttachmentInfos.push_back({
-                .imageView = attachment.image->GetImageView(),
-                .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-                .loadOp = vk::AttachmentLoadOp::eClear,
-                .storeOp = vk::AttachmentStoreOp::eStore,
-                .clearValue = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f)
-            });
+            drawCommands = m_renderGraph.ImportBuffer("DrawCommands", m_drawCommandBuffers[m_currentFrame]->GetHandle());
+            culledIndices = m_renderGraph.ImportBuffer("CulledIndices", m_culledIndexBuffers[m_currentFrame]->GetHandle());
+            m_renderGraph.MarkOutput(drawCommands, Usage::HostRead);
+            culledDrawAccesses = { { drawCommands, Usage::IndirectDrawRead }, { culledIndices, Usage::IndirectDrawRead } };
         }
-        // Depth attachment rendering info
-        vk::RenderingAttachmentInfo depthAttachmentInfo{
-            .imageView = depthAttachment->image->GetImageView(),
-            .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
-            .loadOp = vk::AttachmentLoadOp::eClear,
-            .storeOp = vk::AttachmentStoreOp::eStore,
-            .clearValue = vk::ClearDepthStencilValue{1.0f, 0} // {depth, stencil} -> 1.0f - far plane
-        };
-        vk::RenderingInfo renderingInfo = {
-            .renderArea = {.offset = { 0, 0 }, .extent = swapchainExtent},
-            .layerCount = 1,
-            .colorAttachmentCount = static_cast<uint32_t>(colorAttachmentInfos.size()),
-            .pColorAttachments = colorAttachmentInfos.data(),
-            .pDepthAttachment = &depthAttachmentInfo
-        };
 
-        // Begin rendering
-        cmdBuf.beginRendering(renderingInfo);
-        
-        // Bind the graphic pipeline (the attachment will be bound to the fragment shader output)
-        m_commandBuffers[m_currentFrame].bindPipeline(vk::PipelineBindPoint::eGraphics, m_defGeometryPipeline);
-
-        // Set viewport and scissor size (dynamic rendering)
-        m_commandBuffers[m_currentFrame].setViewport(
-            0,
-            vk::Viewport(0.0f, 0.0f, static_cast<float>(swapchainExtent.width), static_cast<float>(swapchainExtent.height), 0.0f, 1.0f)
-        );
-        m_commandBuffers[m_currentFrame].setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapchainExtent));
-
-        // Bind descriptor sets (camera UBO, object SSBO, texture and sampler arrays)
-        m_commandBuffers[m_currentFrame].bindDescriptorSets(
-            vk::PipelineBindPoint::eGraphics, m_defGeometryPipelineLayout, 0,
-            {   
-                m_cameraDescriptorSets[m_currentFrame], 
-                m_objectDescriptorSets[m_currentFrame], 
-                m_materialDescriptorSets[m_currentFrame], 
-                m_textureDescriptorSets // shared between frames in flight
-            },
-            nullptr
+        // Shared by the frames in flight, the cached cascades are kept: the previous frame left it
+        // in the read usage of the lighting path (a lighting path switch waits for the GPU to be idle)
+        // NOTE: when every cascade is redrawn the contents are discarded (cleared by the shadow pass), but like the
+        // G-buffer the previous frame may still be sampling it, so the clear must wait for it (Aliased)
+        const bool hasShadowPass = m_shadowMap->GetRedrawCount() > 0;
+        const bool isShadowMapRewritten = m_shadowMap->GetRedrawCount() == m_shadowMap->GetCascadeCount();
+        const Usage shadowMapReadUsage = m_lightingPath == LightingPath::ComputeTiled ? Usage::ComputeShaderRead : Usage::FragmentShaderRead;
+        auto shadowMap = m_renderGraph.ImportImage(
+            "ShadowMap",
+            m_shadowMap->GetTexture().GetHandle(), ShadowMap::FORMAT,
+            1, m_shadowMap->GetCascadeCount(), isShadowMapRewritten ? Usage::Aliased : shadowMapReadUsage
         );
 
-        // Draw all the objects
-        // Referenced index used to point each object
-        // to the correct data it needs (depth-first traversal)
-        uint32_t idx = 0;
-        for (const auto& objPtr : m_scene.GetObjects())
+        // NOTE: declared here since the passes callbacks are invoked by m_renderGraph.Execute
+        const bool hasDepthPrepass = IsDepthPrepassActive();
+        // With dynamic resolution the lighting (and the skybox) go to the lighting output, upscaled to the backbuffer
+        const RenderGraph::ResourceHandle lightingTarget = hasUpscale ? lightingOutputTarget : backbuffer;
+        const vk::ImageView lightingTargetView = hasUpscale
+            ? *gBuffer->GetAttachment(GBuffer::AttachmentType::LightingOutput).image->GetImageView()
+            : *m_swapchain->GetImageViews()[imageIndex];
+
+        // ---- Light culling ----
+        // Bins the lights into the view-space clusters (doesn't depend on the geometry)
+        m_renderGraph.AddPass("LightCulling", { { clusterLightCounts, Usage::ComputeShaderWrite }, { clusterLightIndices, Usage::ComputeShaderWrite } }, [&](const vk::raii::CommandBuffer& cmdBuf) {
+            cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_lightCullingPipeline);
+            cmdBuf.bindDescriptorSets(
+                vk::PipelineBindPoint::eCompute, m_lightCullingPipelineLayout, 0,
+                { m_cameraDescriptorSets[m_currentFrame], m_lightDescriptorSets[m_currentFrame] },
+                nullptr
+            );
+            LightCountPushConst pushConst{ .lightCount = m_lightCount };
+            cmdBuf.pushConstants(
+                *m_lightCullingPipelineLayout,
+                vk::ShaderStageFlagBits::eCompute,
+                0,
+                vk::ArrayProxy<const LightCountPushConst>(1, &pushConst)
+            );
+            cmdBuf.dispatch((CLUSTER_COUNT + LIGHT_CULLING_GROUP_SIZE - 1) / LIGHT_CULLING_GROUP_SIZE, 1, 1);
+        });
+
+        // ---- Meshlet culling ----
+        // Compacts the triangles of the meshlets inside the frustum and not back-facing, one workgroup per cluster draw
+        // NOTE: the shadow pass draws the full meshes, the meshlets are culled against the camera only
+        if (clusterDrawCount > 0)
         {
-            const Object& obj = *objPtr;
-            DrawObject(obj, idx);
+            m_renderGraph.AddPass("MeshletCulling", { { drawCommands, Usage::ComputeShaderWrite }, { culledIndices, Usage::ComputeShaderWrite } }, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_meshletCullingPipeline);
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eCompute, m_meshletCullingPipelineLayout, 0,
+                    { m_cameraDescriptorSets[m_currentFrame], m_meshletCullingDescriptorSets[m_currentFrame] },
+                    nullptr
+                );
+                cmdBuf.dispatch(clusterDrawCount, 1, 1);
+            });
         }
 
-        cmdBuf.endRendering();
-    
-        // ---- Lighting pass ----
-        
-        // Transition G-buffer attachments to shader read layout for sampling
-        for (auto& attachment : gBuffer->GetAttachments())
+        // ---- Shadow pass ----
+        // Only the cascades flagged by ShadowMap::Update are redrawn, the cached ones are left untouched
+        if (hasShadowPass)
         {
-            TransitionImageLayout(
-                attachment.image->GetHandle(),
-                attachment.image->GetFormat(),
-                attachment.type == GBuffer::AttachmentType::Depth ? vk::ImageLayout::eDepthAttachmentOptimal : vk::ImageLayout::eColorAttachmentOptimal, 
-                vk::ImageLayout::eShaderReadOnlyOptimal,
-                attachment.type == GBuffer::AttachmentType::Depth ? vk::AccessFlagBits2::eDepthStencilAttachmentWrite : vk::AccessFlagBits2::eColorAttachmentWrite,
-                attachment.type == GBuffer::AttachmentType::Depth ? vk::AccessFlagBits2::eDepthStencilAttachmentRead : vk::AccessFlagBits2::eColorAttachmentRead,
-                attachment.type == GBuffer::AttachmentType::Depth ? vk::PipelineStageFlagBits2::eEarlyFragmentTests : vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-                vk::PipelineStageFlagBits2::eFragmentShader
-            );
+            m_renderGraph.AddPass("Shadows", { { shadowMap, Usage::DepthAttachmentWrite } }, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                uint32_t resolution = m_shadowMap->GetResolution();
+                vk::Extent2D shadowExtent{ resolution, resolution };
+                for (uint32_t cascade = 0; cascade < m_shadowMap->GetCascadeCount(); cascade++)
+                {
+                    if (!m_shadowMap->GetCascade(cascade).needsRedraw)
+                        continue;
+
+                    vk::RenderingAttachmentInfo depthAttachmentInfo{
+                        .imageView = m_shadowMap->GetCascadeView(cascade),
+                        .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+                        .loadOp = vk::AttachmentLoadOp::eClear,
+                        .storeOp = vk::AttachmentStoreOp::eStore,
+                        .clearValue = vk::ClearDepthStencilValue{1.0f, 0}
+                    };
+                    vk::RenderingInfo renderingInfo = {
+                        .renderArea = {.offset = { 0, 0 }, .extent = shadowExtent},
+                        .layerCount = 1,
+                        .colorAttachmentCount = 0,
+                        .pDepthAttachment = &depthAttachmentInfo
+                    };
+
+                    cmdBuf.beginRendering(renderingInfo);
+                    cmdBuf.setViewport(
+                        0,
+                        vk::Viewport(0.0f, 0.0f, static_cast<float>(resolution), static_cast<float>(resolution), 0.0f, 1.0f)
+                    );
+                    cmdBuf.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), shadowExtent));
+
+                    // Bind descriptor sets (sun UBO, object SSBO)
+                    cmdBuf.bindDescriptorSets(
+                        vk::PipelineBindPoint::eGraphics, m_shadowPipelineLayout, 0,
+                        { m_shadowDescriptorSets[m_currentFrame], m_objectDescriptorSets[m_currentFrame] },
+                        nullptr
+                    );
+
+                    // The object part of the push constant is written by DrawObject
+                    cmdBuf.pushConstants(
+                        *m_shadowPipelineLayout,
+                        vk::ShaderStageFlagBits::eVertex,
+                        offsetof(ShadowPushConst, cascadeIndex),
+                        vk::ArrayProxy<const uint32_t>(1, &cascade)
+                    );
+
+                    // NOTE: at full detail, the camera LODs would change the cached cascades (see HashGeometry)
+                    DrawScene(m_shadowPipelines, m_shadowPipelineLayout, true, false, true);
+
+                    cmdBuf.endRendering();
+                }
+            });
         }
 
-        // Transition swapchain image to color attachment layout
-        TransitionImageLayout(
-            m_swapchain->GetImages()[imageIndex],
-            m_swapchain->GetSurfaceFormat().format,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            {},
-            vk::AccessFlagBits2::eColorAttachmentWrite,
-            vk::PipelineStageFlagBits2::eTopOfPipe,
-            vk::PipelineStageFlagBits2::eColorAttachmentOutput
-        );
-
-        // Setup rendering info
-        vk::RenderingAttachmentInfo finalAttachmentInfo{
-            .imageView = m_swapchain->GetImageViews()[imageIndex],
-            .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-            .loadOp = vk::AttachmentLoadOp::eClear,
-            .storeOp = vk::AttachmentStoreOp::eStore,
-            .clearValue = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f)
-        };
-        vk::RenderingInfo lightingRenderingInfo = {
-            .renderArea = {.offset = { 0, 0 }, .extent = swapchainExtent},
-            .layerCount = 1,
-            .colorAttachmentCount = 1,
-            .pColorAttachments = &finalAttachmentInfo
-        };
-
-        // Rendering (computing lighting)
-        cmdBuf.beginRendering(lightingRenderingInfo);
-
-        // Bind the graphic pipeline (the attachment will be bound to the fragment shader output)
-        m_commandBuffers[m_currentFrame].bindPipeline(vk::PipelineBindPoint::eGraphics, m_defLightingPipeline);
+        // ---- Geometry pass (visibility buffer path) ----
+        if (m_renderPath == RenderPath::VisibilityBuffer)
+        {
+            std::vector<RenderGraph::Access> visibilityAccesses{ { visibilityTarget, Usage::ColorAttachmentWrite }, { depthTarget, Usage::DepthAttachmentWrite } };
+            visibilityAccesses.insert(visibilityAccesses.end(), culledDrawAccesses.begin(), culledDrawAccesses.end());
+
+            m_renderGraph.AddPass("Visibility", visibilityAccesses, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                const GBuffer::Attachment* visibilityAttachment = nullptr;
+                const GBuffer::Attachment* depthAttachment = nullptr;
+                for (auto& attachment : gBuffer->GetAttachments())
+                {
+                    if (attachment.type == GBuffer::AttachmentType::Visibility)
+                        visibilityAttachment = &attachment;
+                    else if (attachment.type == GBuffer::AttachmentType::Depth)
+                        depthAttachment = &attachment;
+                }
+
+                vk::RenderingAttachmentInfo visibilityAttachmentInfo{
+                    .imageView = visibilityAttachment->image->GetImageView(),
+                    .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                    .loadOp = vk::AttachmentLoadOp::eClear,
+                    .storeOp = vk::AttachmentStoreOp::eStore,
+                    .clearValue = vk::ClearColorValue(std::array<uint32_t, 4>{ UINT32_MAX, 0, 0, 0 }) // VISIBILITY_EMPTY
+                };
+                vk::RenderingAttachmentInfo depthAttachmentInfo{
+                    .imageView = depthAttachment->image->GetImageView(),
+                    .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+                    .loadOp = vk::AttachmentLoadOp::eClear,
+                    .storeOp = vk::AttachmentStoreOp::eStore,
+                    .clearValue = vk::ClearDepthStencilValue{1.0f, 0}
+                };
+                vk::RenderingInfo renderingInfo = {
+                    .renderArea = {.offset = { 0, 0 }, .extent = renderExtent},
+                    .layerCount = 1,
+                    .colorAttachmentCount = 1,
+                    .pColorAttachments = &visibilityAttachmentInfo,
+                    .pDepthAttachment = &depthAttachmentInfo
+                };
+
+                cmdBuf.beginRendering(renderingInfo);
+                cmdBuf.setViewport(
+                    0,
+                    vk::Viewport(0.0f, 0.0f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f)
+                );
+                cmdBuf.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), renderExtent));
+
+                // Bind descriptor sets (camera UBO, object SSBO)
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eGraphics, m_visibilityPipelineLayout, 0,
+                    { m_cameraDescriptorSets[m_currentFrame], m_objectDescriptorSets[m_currentFrame] },
+                    nullptr
+                );
+
+                // Same traversal as the geometry pass so the object indices match the object SSBO
+                BeginOverdrawQuery(cmdBuf);
+                DrawScene(m_visibilityPipelines, m_visibilityPipelineLayout, true);
+                EndOverdrawQuery(cmdBuf);
+
+                cmdBuf.endRendering();
+            });
 
-        // Set viewport and scissor size (dynamic rendering)
-        m_commandBuffers[m_currentFrame].setViewport(
-            0,
-            vk::Viewport(0.0f, 0.0f, static_cast<float>(swapchainExtent.width), static_cast<float>(swapchainExtent.height), 0.0f, 1.0f)
-        );
-        m_commandBuffers[m_currentFrame].setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapchainExtent));
+            // ---- Resolve pass ----
+            // NOTE: the background pixels are discarded, their G-buffer contents are never read
+            std::vector<RenderGraph::Access> resolveAccesses{ { visibilityTarget, Usage::FragmentShaderRead } };
+            for (auto handle : colorTargets)
+                resolveAccesses.push_back({ handle, Usage::ColorAttachmentWrite });
+            // The culled objects fetch their triangles from the meshlet culling output
+            if (clusterDrawCount > 0)
+                resolveAccesses.push_back({ culledIndices, Usage::FragmentShaderStorageRead });
+
+            m_renderGraph.AddPass("Resolve", resolveAccesses, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                std::vector<vk::RenderingAttachmentInfo> colorAttachmentInfos;
+                for (auto& attachment : gBuffer->GetAttachments())
+                {
+                    if (!GBuffer::IsGeometryTarget(attachment.type))
+                        continue;
+                    colorAttachmentInfos.push_back({
+                        .imageView = attachment.image->GetImageView(),
+                        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                        .loadOp = vk::AttachmentLoadOp::eDontCare,
+                        .storeOp = vk::AttachmentStoreOp::eStore
+                    });
+                }
+                vk::RenderingInfo renderingInfo = {
+                    .renderArea = {.offset = { 0, 0 }, .extent = renderExtent},
+                    .layerCount = 1,
+                    .colorAttachmentCount = static_cast<uint32_t>(colorAttachmentInfos.size()),
+                    .pColorAttachments = colorAttachmentInfos.data()
+                };
+
+                cmdBuf.beginRendering(renderingInfo);
+                cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_resolvePipeline);
+                cmdBuf.setViewport(
+                    0,
+                    vk::Viewport(0.0f, 0.0f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f)
+                );
+                cmdBuf.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), renderExtent));
+
+                // Bind descriptor sets (camera UBO, object and material SSBOs, textures, visibility attachment)
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eGraphics, m_resolvePipelineLayout, 0,
+                    {
+                        m_cameraDescriptorSets[m_currentFrame],
+                        m_objectDescriptorSets[m_currentFrame],
+                        m_materialDescriptorSets[m_currentFrame],
+                        m_textureDescriptorSets,
+                        gBuffer->GetVisibilityDescriptorSet()
+                    },
+                    nullptr
+                );
+
+                // Draw a triangle that covers the screen
+                cmdBuf.draw(3, 1, 0, 0);
+
+                cmdBuf.endRendering();
+            });
+        }
+        else
+        {
+            // ---- Depth pre-pass (deferred path) ----
+            if (hasDepthPrepass)
+            {
+                std::vector<RenderGraph::Access> depthPrepassAccesses{ { depthTarget, Usage::DepthAttachmentWrite } };
+                depthPrepassAccesses.insert(depthPrepassAccesses.end(), culledDrawAccesses.begin(), culledDrawAccesses.end());
+
+                m_renderGraph.AddPass("DepthPrepass", depthPrepassAccesses, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                    const GBuffer::Attachment* depthAttachment = nullptr;
+                    for (auto& attachment : gBuffer->GetAttachments())
+                    {
+                        if (attachment.type == GBuffer::AttachmentType::Depth)
+                            depthAttachment = &attachment;
+                    }
+
+                    vk::RenderingAttachmentInfo depthAttachmentInfo{
+                        .imageView = depthAttachment->image->GetImageView(),
+                        .imageLayout = vk::ImageLayout::eDepthAttachmentOptimal,
+                        .loadOp = vk::AttachmentLoadOp::eClear,
+                        .storeOp = vk::AttachmentStoreOp::eStore,
+                        .clearValue = vk::ClearDepthStencilValue{1.0f, 0}
+                    };
+                    vk::RenderingInfo renderingInfo = {
+                        .renderArea = {.offset = { 0, 0 }, .extent = renderExtent},
+                        .layerCount = 1,
+                        .colorAttachmentCount = 0,
+                        .pDepthAttachment = &depthAttachmentInfo
+                    };
+
+                    cmdBuf.beginRendering(renderingInfo);
+                    cmdBuf.setViewport(
+                        0,
+                        vk::Viewport(0.0f, 0.0f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f)
+                    );
+                    cmdBuf.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), renderExtent));
+
+                    // Bind descriptor sets (camera UBO, object SSBO)
+                    cmdBuf.bindDescriptorSets(
+                        vk::PipelineBindPoint::eGraphics, m_depthPrepassPipelineLayout, 0,
+                        { m_cameraDescriptorSets[m_currentFrame], m_objectDescriptorSets[m_currentFrame] },
+                        nullptr
+                    );
+
+                    BeginOverdrawQuery(cmdBuf);
+                    DrawScene(m_depthPrepassPipelines, m_depthPrepassPipelineLayout, true);
+                    EndOverdrawQuery(cmdBuf);
+
+                    cmdBuf.endRendering();
+                });
+            }
 
-        // Bind descriptor sets (camera UBO, G-buffer)
-        m_commandBuffers[m_currentFrame].bindDescriptorSets(
-            vk::PipelineBindPoint::eGraphics, m_defLightingPipelineLayout, 0,
-            { m_cameraDescriptorSets[m_currentFrame], gBuffer->GetDescriptorSet(), m_textureDescriptorSets }, 
-            nullptr
-        );
+            // ---- Geometry pass (deferred path) ----
+            // NOTE: after the pre-pass the depth is complete, it's only tested (EQUAL) in a read-only layout
+            std::vector<RenderGraph::Access> geometryAccesses;
+            for (auto handle : colorTargets)
+                geometryAccesses.push_back({ handle, Usage::ColorAttachmentWrite });
+            geometryAccesses.push_back({ depthTarget, hasDepthPrepass ? Usage::DepthAttachmentRead : Usage::DepthAttachmentWrite });
+            geometryAccesses.insert(geometryAccesses.end(), culledDrawAccesses.begin(), culledDrawAccesses.end());
+
+            m_renderGraph.AddPass("Geometry", geometryAccesses, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                // Setup rendering info (dynamic rendering)
+                // Color attachments rendering info
+                const GBuffer::Attachment* depthAttachment = nullptr;
+                std::vector<vk::RenderingAttachmentInfo> colorAttachmentInfos;
+                for (auto& attachment : gBuffer->GetAttachments())
+                {
+                    if (attachment.type == GBuffer::AttachmentType::Depth)
+                    {
+                        depthAttachment = &attachment;
+                        continue;
+                    }
+                    if (!GBuffer::IsGeometryTarget(attachment.type))
+                        continue;
+                    colorAttachmentInfos.push_back({
+                        .imageView = attachment.image->GetImageView(),
+                        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                        .loadOp = vk::AttachmentLoadOp::eClear,
+                        .storeOp = vk::AttachmentStoreOp::eStore,
+                        .clearValue = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f)
+                    });
+                }
+                // Depth attachment rendering info
+                vk::RenderingAttachmentInfo depthAttachmentInfo{
+                    .imageView = depthAttachment->image->GetImageView(),
+                    .imageLayout = hasDepthPrepass ? vk::ImageLayout::eDepthReadOnlyOptimal : vk::ImageLayout::eDepthAttachmentOptimal,
+                    .loadOp = hasDepthPrepass ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear,
+                    .storeOp = vk::AttachmentStoreOp::eStore,
+                    .clearValue = vk::ClearDepthStencilValue{1.0f, 0} // {depth, stencil} -> 1.0f - far plane
+                };
+                vk::RenderingInfo renderingInfo = {
+                    .renderArea = {.offset = { 0, 0 }, .extent = renderExtent},
+                    .layerCount = 1,
+                    .colorAttachmentCount = static_cast<uint32_t>(colorAttachmentInfos.size()),
+                    .pColorAttachments = colorAttachmentInfos.data(),
+                    .pDepthAttachment = &depthAttachmentInfo
+                };
+
+                // Begin rendering
+                cmdBuf.beginRendering(renderingInfo);
+            
+                // The graphic pipeline variants are bound per object by DrawObject (the attachment will be bound to the fragment shader output)
+                const auto& pipelines = hasDepthPrepass ? m_defGeometryPrepassedPipelines : m_defGeometryPipelines;
+                const auto& pipelineLayout = hasDepthPrepass ? m_defGeometryPrepassedPipelineLayout : m_defGeometryPipelineLayout;
+
+                // Set viewport and scissor size (dynamic rendering)
+                cmdBuf.setViewport(
+                    0,
+                    vk::Viewport(0.0f, 0.0f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f)
+                );
+                cmdBuf.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), renderExtent));
+
+                // Bind descriptor sets (camera UBO, object SSBO, texture and sampler arrays)
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eGraphics, pipelineLayout, 0,
+                    {   
+                        m_cameraDescriptorSets[m_currentFrame], 
+                        m_objectDescriptorSets[m_currentFrame], 
+                        m_materialDescriptorSets[m_currentFrame], 
+                        m_textureDescriptorSets // shared between frames in flight
+                    },
+                    nullptr
+                );
+
+                // Draw all the objects
+                // Referenced index used to point each object
+                // to the correct data it needs (depth-first traversal)
+                if (!hasDepthPrepass)
+                    BeginOverdrawQuery(cmdBuf);
+                DrawScene(pipelines, pipelineLayout);
+                if (!hasDepthPrepass)
+                    EndOverdrawQuery(cmdBuf);
+
+                cmdBuf.endRendering();
+            });
+        }
 
-        // Draw a triangle that covers the screen (optimization of a quad)
-        cmdBuf.draw(3, 1, 0, 0);
+        // ---- Lighting pass ----
+        if (m_lightingPath == LightingPath::ComputeTiled)
+        {
+            // Lights are culled per tile in the compute pass, the cluster buffers aren't read so the light culling pass is culled
+            std::vector<RenderGraph::Access> tiledLightingAccesses;
+            for (auto handle : colorTargets)
+                tiledLightingAccesses.push_back({ handle, Usage::ComputeShaderRead });
+            tiledLightingAccesses.push_back({ depthTarget, Usage::ComputeShaderRead });
+            tiledLightingAccesses.push_back({ lightingOutputTarget, Usage::ComputeShaderWrite });
+            tiledLightingAccesses.push_back({ shadowMap, Usage::ComputeShaderRead });
+
+            m_renderGraph.AddPass("TiledLighting", tiledLightingAccesses, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, m_tiledLightingPipeline);
+
+                // Bind descriptor sets (camera UBO, G-buffer, lights, lighting output, sun and shadow map, environment)
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eCompute, m_tiledLightingPipelineLayout, 0,
+                    {
+                        m_cameraDescriptorSets[m_currentFrame],
+                        gBuffer->GetDescriptorSet(),
+                        m_lightDescriptorSets[m_currentFrame],
+                        gBuffer->GetLightingOutputDescriptorSet(),
+                        m_shadowDescriptorSets[m_currentFrame],
+                        m_environmentDescriptorSet
+                    },
+                    nullptr
+                );
+                LightCountPushConst pushConst{ .lightCount = m_lightCount };
+                cmdBuf.pushConstants(
+                    *m_tiledLightingPipelineLayout,
+                    vk::ShaderStageFlagBits::eCompute,
+                    0,
+                    vk::ArrayProxy<const LightCountPushConst>(1, &pushConst)
+                );
+
+                // One group per tile
+                cmdBuf.dispatch(
+                    (renderExtent.width + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE,
+                    (renderExtent.height + LIGHTING_TILE_SIZE - 1) / LIGHTING_TILE_SIZE,
+                    1
+                );
+            });
 
-        // Draw Dear ImGui
-        DrawImGuiFrame(ImGui::GetDrawData());
-
-        cmdBuf.endRendering();
-
-        // After rendering, transition the swapchain image to PRESENT_SRC
-        TransitionImageLayout(
-            m_swapchain->GetImages()[imageIndex],
-            m_swapchain->GetSurfaceFormat().format,
-            vk::ImageLayout::eColorAttachmentOptimal,
-            vk::ImageLayout::ePresentSrcKHR,
-            vk::AccessFlagBits2::eColorAttachmentWrite,
-            {},
-            vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-            vk::PipelineStageFlagBits2::eBottomOfPipe
-        );
+            // ---- Blit to the swapchain ----
+            // NOTE: same extent, the blit only converts the linear output to the swapchain format
+            if (!hasUpscale)
+            {
+                m_renderGraph.AddPass("Blit", { { lightingOutputTarget, Usage::TransferSrc }, { backbuffer, Usage::TransferDst } }, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                    vk::ImageSubresourceLayers subresource{
+                        .aspectMask = vk::ImageAspectFlagBits::eColor,
+                        .mipLevel = 0,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                    };
+                    std::array<vk::Offset3D, 2> offsets{
+                        vk::Offset3D{ 0, 0, 0 },
+                        vk::Offset3D{ static_cast<int32_t>(swapchainExtent.width), static_cast<int32_t>(swapchainExtent.height), 1 }
+                    };
+                    vk::ImageBlit region{
+                        .srcSubresource = subresource,
+                        .srcOffsets = offsets,
+                        .dstSubresource = subresource,
+                        .dstOffsets = offsets
+                    };
+                    cmdBuf.blitImage(
+                        gBuffer->GetAttachment(GBuffer::AttachmentType::LightingOutput).image->GetHandle(), vk::ImageLayout::eTransferSrcOptimal,
+                        m_swapchain->GetImages()[imageIndex], vk::ImageLayout::eTransferDstOptimal,
+                        region, vk::Filter::eNearest
+                    );
+                });
+            }
 
-        cmdBuf.end();
-    }
+            // ---- Skybox and UI ----
+            m_renderGraph.AddPass("Skybox", { { depthTarget, Usage::DepthAttachmentRead }, { lightingTarget, Usage::ColorAttachmentWrite } }, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                vk::RenderingAttachmentInfo finalAttachmentInfo{
+                    .imageView = lightingTargetView,
+                    .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                    .loadOp = vk::AttachmentLoadOp::eLoad,
+                    .storeOp = vk::AttachmentStoreOp::eStore
+                };
+                vk::RenderingAttachmentInfo depthAttachmentInfo{
+                    .imageView = gBuffer->GetAttachment(GBuffer::AttachmentType::Depth).image->GetImageView(),
+                    .imageLayout = vk::ImageLayout::eDepthReadOnlyOptimal,
+                    .loadOp = vk::AttachmentLoadOp::eLoad,
+                    .storeOp = vk::AttachmentStoreOp::eNone
+                };
+                vk::RenderingInfo skyboxRenderingInfo = {
+                    .renderArea = {.offset = { 0, 0 }, .extent = renderExtent},
+                    .layerCount = 1,
+                    .colorAttachmentCount = 1,
+                    .pColorAttachments = &finalAttachmentInfo,
+                    .pDepthAttachment = &depthAttachmentInfo
+                };
+
+                cmdBuf.beginRendering(skyboxRenderingInfo);
+                DrawSkybox(cmdBuf, renderExtent);
+                if (!hasUpscale)
+                    DrawImGuiFrame(ImGui::GetDrawData());
+                cmdBuf.endRendering();
+            });
+        }
+        else
+        {
+            std::vector<RenderGraph::Access> lightingAccesses;
+            for (auto handle : colorTargets)
+                lightingAccesses.push_back({ handle, Usage::FragmentShaderRead });
+            lightingAccesses.push_back({ depthTarget, Usage::DepthAttachmentSampledRead });
+            lightingAccesses.push_back({ clusterLightCounts, Usage::FragmentShaderStorageRead });
+            lightingAccesses.push_back({ clusterLightIndices, Usage::FragmentShaderStorageRead });
+            lightingAccesses.push_back({ shadowMap, Usage::FragmentShaderRead });
+            lightingAccesses.push_back({ lightingTarget, Usage::ColorAttachmentWrite });
+
+            m_renderGraph.AddPass("Lighting", lightingAccesses, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                // Setup rendering info
+                vk::RenderingAttachmentInfo finalAttachmentInfo{
+                    .imageView = lightingTargetView,
+                    .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                    .loadOp = vk::AttachmentLoadOp::eClear,
+                    .storeOp = vk::AttachmentStoreOp::eStore,
+                    .clearValue = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f)
+                };
+                // Tested (not written) to split the geometry and the background pixels
+                vk::RenderingAttachmentInfo depthAttachmentInfo{
+                    .imageView = gBuffer->GetAttachment(GBuffer::AttachmentType::Depth).image->GetImageView(),
+                    .imageLayout = vk::ImageLayout::eDepthReadOnlyOptimal,
+                    .loadOp = vk::AttachmentLoadOp::eLoad,
+                    .storeOp = vk::AttachmentStoreOp::eNone
+                };
+                vk::RenderingInfo lightingRenderingInfo = {
+                    .renderArea = {.offset = { 0, 0 }, .extent = renderExtent},
+                    .layerCount = 1,
+                    .colorAttachmentCount = 1,
+                    .pColorAttachments = &finalAttachmentInfo,
+                    .pDepthAttachment = &depthAttachmentInfo
+                };
+
+                // Rendering (computing lighting)
+                cmdBuf.beginRendering(lightingRenderingInfo);
+
+                // Bind the graphic pipeline (the attachment will be bound to the fragment shader output)
+                cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_defLightingPipeline);
+
+                // Set viewport and scissor size (dynamic rendering)
+                cmdBuf.setViewport(
+                    0,
+                    vk::Viewport(0.0f, 0.0f, static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height), 0.0f, 1.0f)
+                );
+                cmdBuf.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), renderExtent));
+
+                // Bind descriptor sets (camera UBO, G-buffer, lights and clusters, sun and shadow map, environment)
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eGraphics, m_defLightingPipelineLayout, 0,
+                    {
+                        m_cameraDescriptorSets[m_currentFrame],
+                        gBuffer->GetDescriptorSet(),
+                        m_lightDescriptorSets[m_currentFrame],
+                        m_shadowDescriptorSets[m_currentFrame],
+                        m_environmentDescriptorSet
+                    },
+                    nullptr
+                );
+
+                // Draw a triangle that covers the screen (optimization of a quad), only the geometry pixels are shaded
+                cmdBuf.draw(3, 1, 0, 0);
+
+                // Then the background pixels
+                DrawSkybox(cmdBuf, renderExtent);
+
+                // Draw Dear ImGui
+                if (!hasUpscale)
+                    DrawImGuiFrame(ImGui::GetDrawData());
+
+                cmdBuf.endRendering();
+            });
+        }
 
-    void Renderer::TransitionImageLayout(
-        vk::Image image,
-        vk::Format imageFormat,
-        vk::ImageLayout oldLayout,
-        vk::ImageLayout newLayout,
-        vk::AccessFlags2 srcAccessMask,
-        vk::AccessFlags2 dstAccessMask,
-        vk::PipelineStageFlags2 srcStageMask,
-        vk::PipelineStageFlags2 dstStageMask
-    )
-    {
-        // Infer aspect from the image format
-        // TODO: implement appropriate function
-        vk::ImageAspectFlags aspect{};
-        switch (imageFormat)
+        // ---- Upscale and UI (dynamic resolution) ----
+        // The rendered area is stretched over the whole backbuffer, the UI is drawn at the native resolution
+        if (hasUpscale)
         {
-        case vk::Format::eD16Unorm:
-        case vk::Format::eD32Sfloat:
-            aspect = vk::ImageAspectFlagBits::eDepth;
-            break;
-        case vk::Format::eD24UnormS8Uint:
-        case vk::Format::eD32SfloatS8Uint:
-            aspect = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
-            break;
-        default:
-            aspect = vk::ImageAspectFlagBits::eColor;
-            break;
+            m_renderGraph.AddPass("Upscale", { { lightingOutputTarget, Usage::FragmentShaderRead }, { backbuffer, Usage::ColorAttachmentWrite } }, [&](const vk::raii::CommandBuffer& cmdBuf) {
+                vk::RenderingAttachmentInfo finalAttachmentInfo{
+                    .imageView = m_swapchain->GetImageViews()[imageIndex],
+                    .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                    .loadOp = vk::AttachmentLoadOp::eDontCare,
+                    .storeOp = vk::AttachmentStoreOp::eStore
+                };
+                vk::RenderingInfo upscaleRenderingInfo = {
+                    .renderArea = {.offset = { 0, 0 }, .extent = swapchainExtent},
+                    .layerCount = 1,
+                    .colorAttachmentCount = 1,
+                    .pColorAttachments = &finalAttachmentInfo
+                };
+
+                cmdBuf.beginRendering(upscaleRenderingInfo);
+                cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, m_upscalePipeline);
+                cmdBuf.setViewport(
+                    0,
+                    vk::Viewport(0.0f, 0.0f, static_cast<float>(swapchainExtent.width), static_cast<float>(swapchainExtent.height), 0.0f, 1.0f)
+                );
+                cmdBuf.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapchainExtent));
+
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eGraphics, m_upscalePipelineLayout, 0,
+                    { gBuffer->GetUpscaleDescriptorSet() },
+                    nullptr
+                );
+
+                // The lighting output has the G-buffer extent, only its top-left renderExtent part is read
+                vk::Extent2D gBufferExtent = gBuffer->GetExtent();
+                glm::vec2 texelSize(1.0f / static_cast<float>(gBufferExtent.width), 1.0f / static_cast<float>(gBufferExtent.height));
+                UpscalePushConst pushConst{
+                    .uvScale = glm::vec2(static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height)) * texelSize,
+                    .texelSize = texelSize,
+                    .sharpness = m_upscaleFilter == UpscaleFilter::Sharpen ? UPSCALE_SHARPNESS : 0.0f
+                };
+                cmdBuf.pushConstants(
+                    *m_upscalePipelineLayout,
+                    vk::ShaderStageFlagBits::eFragment,
+                    0,
+                    vk::ArrayProxy<const UpscalePushConst>(1, &pushConst)
+                );
+                cmdBuf.draw(3, 1, 0, 0);
+
+                DrawImGuiFrame(ImGui::GetDrawData());
+
+                cmdBuf.endRendering();
+            });
         }
 
-        // Create and submit barrier
-        vk::ImageMemoryBarrier2 barrier = {
-            .srcStageMask = srcStageMask,
-            .srcAccessMask = srcAccessMask,
-            .dstStageMask = dstStageMask,
-            .dstAccessMask = dstAccessMask,
-            .oldLayout = oldLayout,
-            .newLayout = newLayout,
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = image,
-            .subresourceRange = {
-                .aspectMask = aspect,
-                .baseMipLevel = 0,
-                .levelCount = 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1
-            }
-        };
-        vk::DependencyInfo dependencyInfo = {
-            .dependencyFlags = {},
-            .imageMemoryBarrierCount = 1,
-            .pImageMemoryBarriers = &barrier
-        };
-        m_commandBuffers[m_currentFrame].pipelineBarrier2(dependencyInfo);
+        // The graph emits the transitions between passes (and to PRESENT_SRC at the end)
+        auto& commandBuffer = m_commandBuffers[m_currentFrame];
+        commandBuffer.begin({});
+        if (*m_overdrawQueryPool)
+            commandBuffer.resetQueryPool(m_overdrawQueryPool, m_currentFrame, 1);
+        // GPU time of the whole frame, read back by UpdateGpuFrameTime()
+        if (*m_timestampQueryPool)
+        {
+            commandBuffer.resetQueryPool(m_timestampQueryPool, 2 * m_currentFrame, 2);
+            commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eNone, m_timestampQueryPool, 2 * m_currentFrame);
+        }
+        m_renderGraph.Execute(commandBuffer);
+        if (*m_timestampQueryPool)
+            commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, m_timestampQueryPool, 2 * m_currentFrame + 1);
+        commandBuffer.end();
     }
-}
\ No newline at end of file
+}
@@ -6,9 +6,16 @@
 
 #include <optional>
 #include <filesystem>
+#include <deque>
 
 // Required for MaterialID and MeshID definitions
 #include "ResourceManager.hpp"
+#include "FrameStats.hpp"
+#include "RenderGraph.hpp"
+#include "GBuffer.hpp"
+#include "ShadowMap.hpp"
+#include "EnvironmentMap.hpp"
+#include "DynamicResolution.hpp"
 
 struct ImGui_ImplVulkan_InitInfo;
 struct ImDrawData;
@@ -19,12 +26,12 @@ namespace Felina
 	class Application;
 	class Device;
 	class Swapchain;
-	class GBuffer;
 	class Buffer;
 	class Window;
 	class Scene;
 	class Object;
 	class Mesh;
+	class LatencyTracer;
 
 	class Renderer
 	{
@@ -35,6 +42,7 @@ namespace Felina
 				glm::mat4 view;
 				glm::mat4 proj;
 				glm::mat4 invViewProj;
+				glm::vec4 renderExtent;	// xy rendered area of the G-buffer in pixels (dynamic resolution), zw its inverse
 			};
 
 			struct MaterialData
@@ -46,10 +54,23 @@ namespace Felina
 				uint32_t materialInfoTex;
 			};
 
+			// One per submesh of each object, in draw order
 			struct ObjectData
 			{
 				glm::mat4 model;
 				glm::mat3 normal;
+
+				// Used by the visibility buffer resolve to fetch the vertices and the material
+				vk::DeviceAddress vertexAddress;
+				vk::DeviceAddress indexAddress;
+				uint32_t materialIndex;
+				uint32_t vertexFormat; // see VertexFormat
+				uint32_t indexSize; // bytes, 2 or 4 (see Mesh::GetIndexType)
+				uint32_t firstIndex; // of the selected LOD
+				// Triangles left by the meshlet culling pass (32-bit indices), 0 if the object isn't culled per meshlet
+				vk::DeviceAddress culledIndexAddress;
+				uint32_t culledFirstIndex;
+				glm::vec4 uvDequantization; // see Mesh::GetUvDequantization
 			};
 
 			struct ObjectPushConst
@@ -58,28 +79,142 @@ namespace Felina
 				uint32_t materialIndex;
 			};
 
+			// Meshlet culling: one workgroup per object split in meshlets (full detail LOD only), the triangles
+			// of its visible meshlets are compacted in its region of the culled index buffer and drawn indirectly
+			// NOTE: must match ClusterDraw in meshlet_culling.comp.hlsl
+			struct ClusterDrawData
+			{
+				glm::mat4 model;				// without the dequantization, the meshlet bounds are in mesh space
+				vk::DeviceAddress meshletAddress;
+				vk::DeviceAddress indexAddress;
+				uint32_t meshletCount;
+				uint32_t indexSize;				// bytes, 2 or 4
+				uint32_t outputFirstIndex;		// region of the culled index buffer (full detail index count)
+				float maxScale;					// largest axis scale of the model matrix (bounding spheres radius)
+			};
+
+			// Draw of an object submesh in the frame being recorded (object SSBO order)
+			struct ObjectDraw
+			{
+				uint32_t lod;
+				uint32_t clusterDraw;	// index of its ClusterDrawData and indirect command, or NO_CLUSTER_DRAW
+				uint32_t materialIndex;	// the object override or the submesh material
+			};
+			static constexpr uint32_t NO_CLUSTER_DRAW = UINT32_MAX;
+
+			// NOTE: must match LightData in lights.hlsli
+			struct LightData
+			{
+				glm::vec4 positionRange;	// xyz world position, w range
+				glm::vec4 colorType;		// rgb color * intensity, w type (see Light::Type)
+				glm::vec4 direction;		// xyz world direction (spot only)
+				glm::vec4 spotParams;		// x angle scale, y angle offset (spot only)
+			};
+
+			// Light culling and tiled lighting
+			struct LightCountPushConst
+			{
+				uint32_t lightCount;
+			};
+
+			// NOTE: must match SunData in shadows.hlsli
+			struct SunData
+			{
+				glm::mat4 cascadeViewProj[ShadowMap::MAX_CASCADES];
+				glm::vec4 cascadeSplits;		// view-space far bound of each cascade
+				glm::vec4 cascadeTexelSizes;	// world-space texel size of each cascade
+				glm::vec4 direction;			// xyz direction the light travels in, w cascade count
+				glm::vec4 color;				// rgb color * intensity, w 1 / shadow map resolution
+			};
+
+			// Upscale pass: the rendered area is a corner of the (swapchain sized) lighting output
+			struct UpscalePushConst
+			{
+				glm::vec2 uvScale;		// rendered area / lighting output extent
+				glm::vec2 texelSize;	// 1 / lighting output extent
+				float sharpness;		// 0 for plain bilinear
+			};
+
+			// Shadow pass: the cascade index follows the object push constant
+			struct ShadowPushConst
+			{
+				uint32_t objectIndex;
+				uint32_t materialIndex;
+				uint32_t cascadeIndex;
+			};
+
+			// Deferred: the geometry pass writes the G-buffer
+			// VisibilityBuffer: the geometry pass writes (object, triangle) IDs and
+			// a resolve pass fills the G-buffer evaluating the materials once per pixel
+			enum class RenderPath { Deferred = 0, VisibilityBuffer };
+
+			// Raster: fullscreen triangle shading the lights binned in the pixel cluster
+			// ComputeTiled: compute pass culling the lights per 16x16 tile, its output is blitted to the swapchain
+			enum class LightingPath { Raster = 0, ComputeTiled };
+
+			// Depth pre-pass before the deferred geometry pass (the G-buffer is then
+			// shaded once per pixel), Auto enables it when the measured overdraw is high
+			enum class DepthPrepassMode { Off = 0, On, Auto };
+
+			// Filter of the upscale pass (dynamic resolution): bilinear, or bilinear followed by a
+			// contrast adaptive sharpening that restores some of the detail lost at low render scales
+			enum class UpscaleFilter { Bilinear = 0, Sharpen };
+			static constexpr float UPSCALE_SHARPNESS = 0.5f;
+
+			// Auto mode thresholds (fragments passing the depth test per screen pixel)
+			// NOTE: the gap avoids toggling the pre-pass every frame around a single threshold
+			static constexpr float DEPTH_PREPASS_ENABLE_OVERDRAW = 1.5f;
+			static constexpr float DEPTH_PREPASS_DISABLE_OVERDRAW = 1.2f;
+
 			// NOTE: for a greater number of concurrent frames
 			// the CPU might get ahead of the GPU causing latency
 			// between frames
 			static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
-			// Max number of drawable objects
-			static constexpr uint32_t MAX_OBJECTS = 100;
+			// Max number of draws, one per submesh of each object (the ObjectData entries)
+			// NOTE: the visibility buffer stores the object index in 10 bits (see visibility.hlsli)
+			static constexpr uint32_t MAX_OBJECTS = 1000;
 
 			// Max number of materials
 			static constexpr uint32_t MAX_MATERIALS = 10;
 
+			// Max number of punctual lights (the others are ignored)
+			static constexpr uint32_t MAX_LIGHTS = 4096;
+
+			// Clustered shading: the view frustum is split in 16x9 tiles and 24 exponential
+			// depth slices, each cluster stores up to MAX_LIGHTS_PER_CLUSTER light indices
+			// NOTE: must match the defines in lights.hlsli
+			static constexpr uint32_t CLUSTER_COUNT_X = 16;
+			static constexpr uint32_t CLUSTER_COUNT_Y = 9;
+			static constexpr uint32_t CLUSTER_COUNT_Z = 24;
+			static constexpr uint32_t CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+			static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+			static constexpr uint32_t LIGHT_CULLING_GROUP_SIZE = 128; // see light_culling.comp.hlsl
+			static constexpr uint32_t LIGHTING_TILE_SIZE = 16; // see tiled_lighting.comp.hlsl
+
+			// Meshlet culling output per frame, the objects that don't fit anymore are drawn without it
+			static constexpr uint32_t MAX_CULLED_INDICES = 1 << 22;
+
 			// Max number of descriptor sets PER FRAME
 			// Current sets:
 			// - camera UBO
 			// - objects SSBO
 			// - materials SSBO
 			// - GBuffer (see GBuffer class)
+			// - G-buffer visibility attachment (see GBuffer class)
 			// - texture and sampler arrays
-			static constexpr uint32_t MAX_DESCRIPTOR_SETS = 5;
+			// - lights and clusters SSBOs
+			// - lighting output storage image (see GBuffer class)
+			// - sun UBO and shadow map
+			// - environment UBO and maps (image-based lighting)
+			// - lighting output sampled by the upscale pass (see GBuffer class)
+			// - meshlet culling SSBOs
+			static constexpr uint32_t MAX_DESCRIPTOR_SETS = 13;
 
 			static constexpr uint32_t MAX_SAMPLERS = 2;
-			static constexpr uint32_t MAX_TEXTURES = 30;
+			static constexpr uint32_t MAX_TEXTURES = 30; // NOTE: must match the define in the fragment shaders
+			// Cubemaps, not in the texture array: the skybox and the next one while it's replaced
+			static constexpr uint32_t MAX_CUBEMAPS = 2;
 
 		public:
 			Renderer(Application& app, const Window& window, const Scene& scene);
@@ -92,6 +227,82 @@ namespace Felina
 			void LoadSkybox(const std::filesystem::path& folderPath);
 			void UpdateDescriptorSets(); 
 
+			// Presentation
+			void SetPresentMode(vk::PresentModeKHR presentMode);
+			vk::PresentModeKHR GetPresentMode() const;
+			const std::vector<vk::PresentModeKHR>& GetAvailablePresentModes() const;
+			uint32_t GetQueueDepth() const;
+			const FrameStats& GetFrameStats() const { return m_frameStats; }
+
+			// G-buffer
+			void SetGBufferEncoding(GBuffer::Encoding encoding);
+			GBuffer::Encoding GetGBufferEncoding() const { return m_gBufferEncoding; }
+			bool IsGBufferEncodingSupported(GBuffer::Encoding encoding) const;
+			void SetRenderPath(RenderPath renderPath);
+			RenderPath GetRenderPath() const { return m_renderPath; }
+			bool IsRenderPathSupported(RenderPath renderPath) const;
+			void SetLightingPath(LightingPath lightingPath);
+			LightingPath GetLightingPath() const { return m_lightingPath; }
+			bool IsLightingPathSupported(LightingPath lightingPath) const;
+
+			// Depth pre-pass
+			void SetDepthPrepassMode(DepthPrepassMode mode) { m_depthPrepassMode = mode; }
+			DepthPrepassMode GetDepthPrepassMode() const { return m_depthPrepassMode; }
+			bool IsDepthPrepassModeSupported(DepthPrepassMode mode) const;
+			bool IsDepthPrepassActive() const;
+			// Fragments passing the depth test per screen pixel (0 if it can't be measured)
+			float GetOverdraw() const { return m_overdraw; }
+
+			// Dynamic resolution: the G-buffer keeps the swapchain extent, the geometry and lighting passes
+			// render to its top-left corner (scaled to meet the target GPU frame time) which is then upscaled
+			void SetDynamicResolution(bool isEnabled);
+			bool IsDynamicResolutionEnabled() const { return m_isDynamicResolutionEnabled; }
+			bool IsDynamicResolutionSupported() const { return m_device->IsTimestampQuerySupported(); }
+			void SetTargetFrameTime(float targetFrameTime) { m_dynamicResolution.SetTargetFrameTime(targetFrameTime); }
+			float GetTargetFrameTime() const { return m_dynamicResolution.GetTargetFrameTime(); }
+			void SetUpscaleFilter(UpscaleFilter filter) { m_upscaleFilter = filter; }
+			UpscaleFilter GetUpscaleFilter() const { return m_upscaleFilter; }
+			vk::Extent2D GetRenderExtent() const { return m_renderExtent; }
+			// GPU time of the last completed frame (milliseconds, 0 if timestamps aren't supported)
+			float GetGpuFrameTime() const { return m_gpuFrameTime; }
+
+			// Cascaded shadow maps of the sun
+			void SetShadowSettings(uint32_t cascadeCount, uint32_t resolution);
+			uint32_t GetShadowCascadeCount() const { return m_shadowMap->GetCascadeCount(); }
+			uint32_t GetShadowResolution() const { return m_shadowMap->GetResolution(); }
+			// Cascades redrawn in the last frame (the cached ones are skipped)
+			uint32_t GetShadowRedrawCount() const { return m_shadowMap->GetRedrawCount(); }
+
+			// Level of detail: coarsest LOD of each object whose error projects under the threshold (pixels)
+			void SetLodErrorThreshold(float threshold) { m_lodErrorThreshold = threshold; }
+			float GetLodErrorThreshold() const { return m_lodErrorThreshold; }
+			// Triangles of the selected LODs and at full detail in the last frame
+			uint32_t GetDrawnTriangleCount() const { return m_drawnTriangleCount; }
+			uint32_t GetFullDetailTriangleCount() const { return m_fullDetailTriangleCount; }
+
+			// Meshlet culling of the full detail objects (frustum and normal cones, see ClusterDrawData)
+			// NOTE: the culling shader reads the meshlets through 64-bit buffer addresses, without
+			// shaderInt64 the objects are always drawn with their plain index buffers
+			void SetMeshletCulling(bool isEnabled) { m_isMeshletCullingEnabled = isEnabled && IsMeshletCullingSupported(); }
+			bool IsMeshletCullingEnabled() const { return m_isMeshletCullingEnabled; }
+			bool IsMeshletCullingSupported() const { return m_device->IsShaderInt64Supported(); }
+			// Triangles of the objects culled per meshlet and the ones left by the culling (read back, a few frames late)
+			uint32_t GetMeshletTriangleCount() const { return m_meshletTriangleCount; }
+			uint32_t GetMeshletVisibleTriangleCount() const { return m_meshletVisibleTriangleCount; }
+
+			// Static batching: draw the scene static batches instead of the objects merged in them
+			void SetStaticBatching(bool isEnabled) { m_isStaticBatchingEnabled = isEnabled; }
+			bool IsStaticBatchingEnabled() const { return m_isStaticBatchingEnabled; }
+			// Draws per scene pass in the last frame (one per object submesh)
+			uint32_t GetDrawCount() const { return m_drawCount; }
+
+			// Punctual lights uploaded in the last frame
+			uint32_t GetLightCount() const { return m_lightCount; }
+
+			// Input-to-present latency tracing (benchmark mode)
+			void EnableLatencyTrace();
+			void SaveLatencyTrace(const std::filesystem::path& filepath) const;
+
 			const Device& GetDevice() const;
 
 			// Dear ImGui
@@ -99,8 +310,18 @@ namespace Felina
 			void DrawImGuiFrame(ImDrawData* drawData);
 
 		private:
+			struct RetiredGBuffer
+			{
+				std::unique_ptr<GBuffer> gBuffer;
+				uint64_t frameSerial;
+			};
+
 			void SetupFrameData();
+			void UpdateCameraData();
 			void UpdateOnFramebufferResized();
+			void RebuildGBuffer();
+			void UpdateOverdraw();
+			void UpdateGpuFrameTime();
 
 			void CreateInstance();
 			void CreateSurface();
@@ -109,6 +330,9 @@ namespace Felina
 			void CreateGBuffer();
 			void CreateDescriptorSetLayouts();
 			void CreatePushConstant();
+			void CreateLightCullingPipeline();
+			void CreateMeshletCullingPipeline();
+			void CreateShadowPipeline();
 			void CreatePipeline();
 			void CreateCommandPool();
 			void CreateCommandBuffer();
@@ -117,19 +341,29 @@ namespace Felina
 			void CreateDescriptorPool();
 			void AllocateDescriptorSets();
 			void CreateSyncObjects();
-
-			void DrawObject(const Object& obj, uint32_t& idx);
-			void RecordCommandBuffer(uint32_t imageIndex); // 2 passes
-			void TransitionImageLayout(
-				vk::Image image,
-				vk::Format imageFormat,
-				vk::ImageLayout oldLayout,
-				vk::ImageLayout newLayout,
-				vk::AccessFlags2 srcAccessMask,
-				vk::AccessFlags2 dstAccessMask,
-				vk::PipelineStageFlags2 srcStageMask,
-				vk::PipelineStageFlags2 dstStageMask
+			void CreateQueryPool();
+			void CreateShadowMap();
+			void UpdateShadowDescriptorSets();
+			void UpdateEnvironmentDescriptorSet();
+
+			// Draws the scene objects depth-first (the object SSBO order), one draw per submesh, `pipelines` is indexed
+			// by VertexFormat and a variant is bound only when the format changes between two objects
+			// NOTE: `cullMeshlets` draws the output of the meshlet culling pass for the objects that have one
+			// NOTE: `fullDetail` ignores the LODs selected from the camera (shadow casters, see SetupFrameData)
+			void DrawScene(
+				const std::vector<vk::raii::Pipeline>& pipelines, const vk::raii::PipelineLayout& pipelineLayout,
+				bool positionsOnly = false, bool cullMeshlets = true, bool fullDetail = false
+			);
+			void DrawObject(
+				const Object& obj, uint32_t& idx, VertexFormat& boundFormat,
+				const std::vector<vk::raii::Pipeline>& pipelines, const vk::raii::PipelineLayout& pipelineLayout,
+				bool positionsOnly, bool cullMeshlets, bool fullDetail
 			);
+			void BeginOverdrawQuery(const vk::raii::CommandBuffer& cmdBuf);
+			void EndOverdrawQuery(const vk::raii::CommandBuffer& cmdBuf);
+			void RecordCommandBuffer(uint32_t imageIndex); // passes depend on the render path (see RenderGraph)
+			// Background pixels only, inside a rendering with the G-buffer depth bound (read-only)
+			void DrawSkybox(const vk::raii::CommandBuffer& cmdBuf, vk::Extent2D extent);
 
 			// NOTE: non-const reference because
 			// Application::IsFramebufferResized cannot be const
@@ -138,10 +372,10 @@ namespace Felina
 			const Scene& m_scene;
 
 			uint32_t m_currentFrame = 0;
-			// Look-up table to match the Material ID to the physical GPU storage buffer index
-			std::array<std::unordered_map<MaterialID, uint32_t>, MAX_FRAMES_IN_FLIGHT> m_materialIDToSSBOID;
-			// Look-up table to match the Texture ID to the GPU texture array index
-			std::array<std::unordered_map<TextureID, uint32_t>, MAX_FRAMES_IN_FLIGHT> m_textureIDToArrayID;
+			// Number of frames submitted so far and serial of the last frame submitted for each frame in flight
+			uint64_t m_submittedFrames = 0;
+			std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_frameSerials{};
+			bool m_isSwapchainOutdated = false;
 
 			// Dear ImGui custom vertex shader (temporary fix for colors issue)
 			std::vector<char> m_imGuiCustomVertShaderCode;
@@ -154,34 +388,139 @@ namespace Felina
 			std::unique_ptr<Swapchain> m_swapchain = nullptr;
 			vk::raii::DescriptorPool m_descriptorPool = nullptr;
 			vk::raii::CommandPool m_commandPool = nullptr;
-			std::array<std::unique_ptr<GBuffer>, MAX_FRAMES_IN_FLIGHT> m_gBuffers;
+			// Shared by the frames in flight, G-buffers replaced on resize are kept alive until their frames are completed
+			std::unique_ptr<GBuffer> m_gBuffer = nullptr;
+			GBuffer::Encoding m_gBufferEncoding = GBuffer::Encoding::Standard;
+			RenderPath m_renderPath = RenderPath::Deferred;
+			LightingPath m_lightingPath = LightingPath::Raster;
+			DepthPrepassMode m_depthPrepassMode = DepthPrepassMode::Auto;
+			bool m_isAutoDepthPrepassEnabled = false;
+			float m_overdraw = 0.0f;
+			uint32_t m_lightCount = 0;
+			std::deque<RetiredGBuffer> m_retiredGBuffers;
+			bool m_hasReportedGBufferFootprint = false;
 
 			vk::raii::DescriptorSetLayout m_cameraSetLayout = nullptr;
 			vk::raii::DescriptorSetLayout m_materialSetLayout = nullptr;
 			vk::raii::DescriptorSetLayout m_objectSetLayout = nullptr;
 			vk::raii::DescriptorSetLayout m_textureSetLayout = nullptr;
+			vk::raii::DescriptorSetLayout m_lightSetLayout = nullptr;
+			vk::raii::DescriptorSetLayout m_shadowSetLayout = nullptr;
+			vk::raii::DescriptorSetLayout m_environmentSetLayout = nullptr;
+			vk::raii::DescriptorSetLayout m_meshletCullingSetLayout = nullptr;
 			vk::PushConstantRange m_objectPushConst;
+			vk::PushConstantRange m_lightCountPushConst;
+			vk::PushConstantRange m_shadowPushConst;
+			vk::PushConstantRange m_upscalePushConst;
 
 			vk::raii::PipelineLayout m_defGeometryPipelineLayout = nullptr;
-			vk::raii::Pipeline m_defGeometryPipeline = nullptr;
+			std::vector<vk::raii::Pipeline> m_defGeometryPipelines; // per VertexFormat
+			// Geometry pass after the depth pre-pass (EQUAL depth test, no depth writes)
+			vk::raii::PipelineLayout m_defGeometryPrepassedPipelineLayout = nullptr;
+			std::vector<vk::raii::Pipeline> m_defGeometryPrepassedPipelines; // per VertexFormat
+			vk::raii::PipelineLayout m_depthPrepassPipelineLayout = nullptr;
+			std::vector<vk::raii::Pipeline> m_depthPrepassPipelines; // per VertexFormat
 			vk::raii::PipelineLayout m_defLightingPipelineLayout = nullptr;
 			vk::raii::Pipeline m_defLightingPipeline = nullptr;
+			// Fullscreen triangle with an EQUAL depth test (both lighting paths)
+			vk::raii::PipelineLayout m_skyboxPipelineLayout = nullptr;
+			vk::raii::Pipeline m_skyboxPipeline = nullptr;
+			// Compute lighting path only
+			vk::raii::PipelineLayout m_tiledLightingPipelineLayout = nullptr;
+			vk::raii::Pipeline m_tiledLightingPipeline = nullptr;
+			// Visibility buffer path only
+			vk::raii::PipelineLayout m_visibilityPipelineLayout = nullptr;
+			std::vector<vk::raii::Pipeline> m_visibilityPipelines; // per VertexFormat
+			vk::raii::PipelineLayout m_resolvePipelineLayout = nullptr;
+			vk::raii::Pipeline m_resolvePipeline = nullptr;
+			// Bins the lights into the clusters (compute)
+			vk::raii::PipelineLayout m_lightCullingPipelineLayout = nullptr;
+			vk::raii::Pipeline m_lightCullingPipeline = nullptr;
+			// Compacts the visible meshlets triangles (compute)
+			vk::raii::PipelineLayout m_meshletCullingPipelineLayout = nullptr;
+			vk::raii::Pipeline m_meshletCullingPipeline = nullptr;
+			// Depth only, one rendering per cascade
+			vk::raii::PipelineLayout m_shadowPipelineLayout = nullptr;
+			std::vector<vk::raii::Pipeline> m_shadowPipelines; // per VertexFormat
+			// Lighting output to the swapchain (dynamic resolution only)
+			vk::raii::PipelineLayout m_upscalePipelineLayout = nullptr;
+			vk::raii::Pipeline m_upscalePipeline = nullptr;
 
 			std::vector<vk::raii::CommandBuffer> m_commandBuffers;
+			// Rebuilt every frame while recording the command buffer
+			RenderGraph m_renderGraph;
 
 			std::array<std::optional<vk::raii::Sampler>, MAX_SAMPLERS> m_samplers;
 
 			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_cameraUBOs;
 			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_objectSSBOs;
 			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_materialSSBOs;
+			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_lightSSBOs;
+			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_sunUBOs;
+			// Written by the light culling pass, read by the lighting pass (GPU only)
+			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_clusterLightCountBuffers;
+			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_clusterLightIndexBuffers;
+			// Meshlet culling: draws written by the CPU, the indirect commands index counts and the
+			// culled indices by the culling pass (GPU only, read by the draws and the visibility resolve)
+			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_clusterDrawSSBOs;
+			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_drawCommandBuffers;
+			std::array<std::unique_ptr<Buffer>, MAX_FRAMES_IN_FLIGHT> m_culledIndexBuffers;
+			std::array<vk::DeviceAddress, MAX_FRAMES_IN_FLIGHT> m_culledIndexAddresses{};
 			std::vector<vk::raii::DescriptorSet> m_cameraDescriptorSets;
 			std::vector<vk::raii::DescriptorSet> m_objectDescriptorSets;
 			std::vector<vk::raii::DescriptorSet> m_materialDescriptorSets;
+			std::vector<vk::raii::DescriptorSet> m_lightDescriptorSets;
+			std::vector<vk::raii::DescriptorSet> m_shadowDescriptorSets;
+			std::vector<vk::raii::DescriptorSet> m_meshletCullingDescriptorSets;
 			// Just one shared between frames because it will be read-only
 			vk::raii::DescriptorSet m_textureDescriptorSets = nullptr;
+			// Read-only as well, rewritten when the skybox changes
+			vk::raii::DescriptorSet m_environmentDescriptorSet = nullptr;
 
 			std::vector<vk::raii::Semaphore> m_imageAvailableSemaphores;
-			std::vector<vk::raii::Semaphore> m_renderFinishedSemaphores;
 			std::vector<vk::raii::Fence> m_inFlightFences;
+			// One occlusion query per frame in flight around the first depth-tested pass (overdraw)
+			vk::raii::QueryPool m_overdrawQueryPool = nullptr;
+			// Two timestamps per frame in flight around the whole command buffer (GPU frame time)
+			vk::raii::QueryPool m_timestampQueryPool = nullptr;
+			float m_gpuFrameTime = 0.0f;
+
+			DynamicResolution m_dynamicResolution;
+			bool m_isDynamicResolutionEnabled = false;
+			UpscaleFilter m_upscaleFilter = UpscaleFilter::Sharpen;
+			// Area of the G-buffer rendered by the frame being recorded, and by each frame in flight
+			vk::Extent2D m_renderExtent{};
+			std::array<vk::Extent2D, MAX_FRAMES_IN_FLIGHT> m_frameRenderExtents{};
+			std::array<float, MAX_FRAMES_IN_FLIGHT> m_frameRenderScales{};
+
+			float m_lodErrorThreshold = 1.0f;
+			std::vector<ObjectDraw> m_objectDraws;
+			uint32_t m_drawnTriangleCount = 0;
+			uint32_t m_fullDetailTriangleCount = 0;
+
+			bool m_isStaticBatchingEnabled = true;
+			bool m_areStaticBatchesDrawn = false; // by the frame being recorded
+			uint32_t m_drawCount = 0;
+			uint32_t m_skippedDrawCount = 0; // beyond MAX_OBJECTS, logged when it changes
+
+			bool m_isMeshletCullingEnabled = true;
+			// Cluster draws and their triangles recorded by each frame in flight (read back with the culling results)
+			std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> m_frameClusterDrawCounts{};
+			std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> m_frameClusterTriangleCounts{};
+			uint32_t m_meshletTriangleCount = 0;
+			uint32_t m_meshletVisibleTriangleCount = 0;
+
+			// Shared by the frames in flight: the cached cascades are kept across frames
+			std::unique_ptr<ShadowMap> m_shadowMap = nullptr;
+			uint32_t m_shadowCascadeCount = 3;
+			uint32_t m_shadowResolution = 2048;
+
+			// Loaded once, independently of the scenes
+			TextureHandle m_skyboxTexture;
+			// Precomputed from the skybox, kept while the skybox content is the same
+			std::unique_ptr<EnvironmentMap> m_environmentMap = nullptr;
+
+			FrameStats m_frameStats;
+			std::unique_ptr<LatencyTracer> m_latencyTracer = nullptr;
 	};
 }
\ No newline at end of file
@@ -2,76 +2,310 @@
 
 #include "Renderer.hpp"
 
+#include <algorithm>
+
 namespace Felina
 {
-	MeshID ResourceManager::LoadMesh(std::unique_ptr<Mesh> mesh, const std::string& name, Renderer& renderer)
+	// The 2D texture slots are the indices of the texture array, the cubemap slots follow them
+	// (bound on their own, see Renderer::UpdateDescriptorSets)
+	ResourceManager::ResourceManager()
+		: m_materials(Renderer::MAX_MATERIALS),
+		m_textures(Renderer::MAX_TEXTURES),
+		m_cubemaps(Renderer::MAX_CUBEMAPS, Renderer::MAX_TEXTURES)
+	{
+	}
+
+	// Slot map holding `id`
+	template<typename T>
+	SlotMap<ResourceManager::Resource<T>>& ResourceManager::GetResources(uint32_t id)
+	{
+		if constexpr (std::is_same_v<T, Mesh>)
+			return m_meshes;
+		else if constexpr (std::is_same_v<T, Material>)
+			return m_materials;
+		else
+			return m_cubemaps.IsInRange(id) ? m_cubemaps : m_textures;
+	}
+
+	template<typename T>
+	std::unordered_map<uint64_t, uint32_t>& ResourceManager::GetHashes()
+	{
+		if constexpr (std::is_same_v<T, Mesh>)
+			return m_meshHashes;
+		else if constexpr (std::is_same_v<T, Material>)
+			return m_materialHashes;
+		else
+			return m_textureHashes;
+	}
+
+	// Returns the resident resource with the same content (and takes a reference to it), if any
+	template<typename T>
+	std::optional<uint32_t> ResourceManager::FindResident(uint64_t hash, size_t size)
+	{
+		auto& hashes = GetHashes<T>();
+		auto it = hashes.find(hash);
+		if (it == hashes.end())
+			return std::nullopt;
+		auto& resource = GetResources<T>(it->second).At(it->second);
+		if (resource.contentSize != size)
+			return std::nullopt; // collision, not the same content (see RegisterHash)
+
+		m_dedupStats.reusedCount++;
+		m_dedupStats.savedBytes += size;
+		AddReference<T>(it->second);
+		return it->second;
+	}
+
+	// Makes a new resource findable by its content hash, unless a resident one of another size already has the same
+	// hash (see FindResident): the new resource is then loaded without being deduplicated
+	template<typename T>
+	void ResourceManager::RegisterHash(uint64_t hash, uint32_t id, const std::string& name)
+	{
+		auto& hashes = GetHashes<T>();
+		if (hashes.contains(hash))
+		{
+			LOG("[ResourceManager] Content hash collision, " + name + " isn't deduplicated");
+			return;
+		}
+		hashes.emplace(hash, id);
+	}
+
+	template<typename T>
+	void ResourceManager::AddReference(uint32_t id)
+	{
+		auto& resource = GetResources<T>(id).At(id);
+		if (resource.refCount++ > 0)
+			return;
+
+		// Back from the cache
+		ResourceType type = GetResourceType<T>();
+		m_cache.remove_if([type, id](const CacheEntry& entry) { return entry.type == type && entry.id == id; });
+		m_cachedBytes -= resource.contentSize;
+	}
+
+	template<typename T>
+	void ResourceManager::Release(uint32_t id)
+	{
+		auto* resource = GetResources<T>(id).Find(id);
+		if (!resource || --resource->refCount > 0)
+			return;
+
+		m_cache.push_back(CacheEntry{ GetResourceType<T>(), id });
+		m_cachedBytes += resource->contentSize;
+		TrimCache();
+	}
+
+	// Unloads the least recently released resource of `resources` when all its slots are taken
+	template<typename T>
+	void ResourceManager::ReserveSlot(SlotMap<Resource<T>>& resources)
 	{
+		if (!resources.IsFull())
+			return;
+
+		ResourceType type = GetResourceType<T>();
+		auto it = std::find_if(m_cache.begin(), m_cache.end(), [type, &resources](const CacheEntry& entry) {
+			return entry.type == type && resources.IsInRange(entry.id);
+		});
+		if (it != m_cache.end())
+			Unload<T>(it->id);
+		if (resources.IsFull())
+			throw std::runtime_error("[RESOURCE MANAGER] All the " + std::to_string(resources.GetCapacity()) + " slots are referenced!");
+	}
+
+	// Unloads a cached resource and the cached ones depending on it
+	template<typename T>
+	void ResourceManager::Unload(uint32_t id)
+	{
+		auto& resources = GetResources<T>(id);
+		auto* resource = resources.Find(id);
+		if (!resource || resource->refCount > 0)
+			return;
+
+		ResourceType type = GetResourceType<T>();
+		m_cache.remove_if([type, id](const CacheEntry& entry) { return entry.type == type && entry.id == id; });
+		m_cachedBytes -= resource->contentSize;
+		// NOTE: the hash may map to another resource if this one collided with it (see RegisterHash)
+		auto& hashes = GetHashes<T>();
+		auto hashIt = hashes.find(resource->contentHash);
+		if (hashIt != hashes.end() && hashIt->second == id)
+			hashes.erase(hashIt);
+		resources.Erase(id); // the IDs still held (e.g. by the cached materials) are now stale
+
+		std::vector<uint32_t> dependents;
+		if constexpr (std::is_same_v<T, Texture>)
+		{
+			for (const auto& [materialId, material] : m_materials)
+			{
+				if (material.resource->GetBaseColorTexture() == id || material.resource->GetMetallicRoughnessTexture() == id)
+					dependents.push_back(materialId);
+			}
+			for (uint32_t materialId : dependents)
+				Unload<Material>(materialId);
+		}
+		else if constexpr (std::is_same_v<T, Material>)
+		{
+			for (const auto& [meshId, mesh] : m_meshes)
+			{
+				for (const auto& submesh : mesh.resource->GetSubmeshes())
+				{
+					if (submesh.material == id)
+					{
+						dependents.push_back(meshId);
+						break;
+					}
+				}
+			}
+			for (uint32_t meshId : dependents)
+				Unload<Mesh>(meshId);
+		}
+	}
+
+	void ResourceManager::TrimCache()
+	{
+		while (m_cachedBytes > m_cacheBudget && !m_cache.empty())
+		{
+			CacheEntry entry = m_cache.front();
+			switch (entry.type)
+			{
+				case ResourceType::Mesh: Unload<Mesh>(entry.id); break;
+				case ResourceType::Material: Unload<Material>(entry.id); break;
+				case ResourceType::Texture: Unload<Texture>(entry.id); break;
+			}
+		}
+	}
+
+	void ResourceManager::SetCacheBudget(size_t bytes)
+	{
+		m_cacheBudget = bytes;
+		TrimCache();
+	}
+
+	MeshHandle ResourceManager::LoadMesh(std::unique_ptr<Mesh> mesh, const std::string& name, Renderer& renderer)
+	{
+		size_t size = 0;
+		uint64_t hash = mesh->HashContent(size);
+		if (auto id = FindResident<Mesh>(hash, size))
+			return MeshHandle(*id);
+
 		// Request the renderer to load mesh data on the GPU
+		ReserveSlot<Mesh>(m_meshes);
 		renderer.LoadMesh(*mesh);
 
-		// Store (and move ownership) of the mesh into the map
-		auto id = m_meshID++;
-		m_meshes.emplace(id, Resource<Mesh>{ name, std::move(mesh) });
-		return id;
+		// Store (and move ownership) of the mesh into its slot
+		auto id = m_meshes.Insert(Resource<Mesh>{ name, std::move(mesh), hash, size });
+		RegisterHash<Mesh>(hash, id, name);
+		return MeshHandle(id);
 	}
 
-	MaterialID ResourceManager::LoadMaterial(std::unique_ptr<Material> material, const std::string& name)
+	MaterialHandle ResourceManager::LoadMaterial(std::unique_ptr<Material> material, const std::string& name)
 	{
-		auto id = m_materialID++;
-		m_materials.emplace(id, Resource<Material>{ name, std::move(material) });
-		return id;
+		// NOTE: the base color is hashed per component, the aligned glm::vec3 has an undefined 4th one
+		glm::vec3 baseColor = material->GetBaseColor();
+		glm::vec4 metallicRoughness = material->GetMetallicRoughness();
+		float factors[7] = { baseColor.x, baseColor.y, baseColor.z, metallicRoughness.x, metallicRoughness.y, metallicRoughness.z, metallicRoughness.w };
+		TextureID textures[2] = { material->GetBaseColorTexture(), material->GetMetallicRoughnessTexture() };
+		uint64_t hash = HashBytes(factors, sizeof(factors));
+		hash = HashBytes(textures, sizeof(textures), hash);
+		if (auto id = FindResident<Material>(hash, 0))
+			return MaterialHandle(*id);
+
+		ReserveSlot<Material>(m_materials);
+		auto id = m_materials.Insert(Resource<Material>{ name, std::move(material), hash, 0 });
+		RegisterHash<Material>(hash, id, name);
+		return MaterialHandle(id);
 	}
 
-	TextureID ResourceManager::LoadTexture(std::unique_ptr<Texture> texture, const std::string& name,
+	TextureHandle ResourceManager::LoadTexture(std::unique_ptr<Texture> texture, const std::string& name,
 		const void* rawImageData, size_t rawImageSize,
 		Renderer& renderer
 	)
 	{
+		// The same pixels in another image layout (e.g. a cubemap) are a different texture
+		vk::Extent3D extent = texture->GetExtent();
+		uint32_t layout[5] = { extent.width, extent.height, extent.depth, static_cast<uint32_t>(texture->GetFormat()), texture->IsCubemap() ? 1u : 0u };
+		uint64_t hash = HashBytes(layout, sizeof(layout));
+		hash = HashBytes(rawImageData, rawImageSize, hash);
+		if (auto id = FindResident<Texture>(hash, rawImageSize))
+			return TextureHandle(*id);
+
 		// Request the renderer to load image data on the GPU
+		auto& textures = texture->IsCubemap() ? m_cubemaps : m_textures;
+		ReserveSlot<Texture>(textures);
 		renderer.LoadTexture(*texture, rawImageData, rawImageSize);
 
-		// Store (and move ownership) of the texture to the corresponding map
-		auto id = m_textureID++;
-		m_textures.emplace(id, Resource<Texture>{ name, std::move(texture) });
-		return id;
+		// Store (and move ownership) of the texture into its slot
+		auto id = textures.Insert(Resource<Texture>{ name, std::move(texture), hash, rawImageSize });
+		RegisterHash<Texture>(hash, id, name);
+		return TextureHandle(id);
 	}
 
 	void ResourceManager::UnloadAll()
 	{
-		m_meshes.clear();
-		m_textures.clear();
-		m_materials.clear();
+		// NOTE: cleared slot by slot, the generations are kept so that the remaining handles are stale
+		m_meshes.Clear();
+		m_textures.Clear();
+		m_cubemaps.Clear();
+		m_materials.Clear();
+		m_meshHashes.clear();
+		m_textureHashes.clear();
+		m_materialHashes.clear();
+		m_cache.clear();
+		m_cachedBytes = 0;
+	}
+
+	void ResourceManager::BeginSceneLoad()
+	{
+		m_dedupStats = {};
+	}
+
+	void ResourceManager::EndSceneLoad()
+	{
+		LOG(
+			"[ResourceManager] Deduplication: " + std::to_string(m_dedupStats.reusedCount) + " loads reused a resident resource, " +
+			std::to_string(m_dedupStats.savedBytes / 1024) + " KB not uploaded"
+		);
+		LOG(
+			"[ResourceManager] Cache: " + std::to_string(m_cache.size()) + " unreferenced resources, " +
+			std::to_string(m_cachedBytes >> 20) + " / " + std::to_string(m_cacheBudget >> 20) + " MB"
+		);
 	}
 
+	template void ResourceManager::AddReference<Mesh>(uint32_t id);
+	template void ResourceManager::AddReference<Material>(uint32_t id);
+	template void ResourceManager::AddReference<Texture>(uint32_t id);
+	template void ResourceManager::Release<Mesh>(uint32_t id);
+	template void ResourceManager::Release<Material>(uint32_t id);
+	template void ResourceManager::Release<Texture>(uint32_t id);
+
 	const Mesh& ResourceManager::GetMesh(MeshID id) const
 	{
-		auto it = m_meshes.find(id);
-		if (it == m_meshes.end())
-			throw std::runtime_error("[RESOURCE MANAGER] Mesh with ID " + std::to_string(id) + "not found!");
-		return *(it->second.resource);
+		auto* resource = m_meshes.Find(id);
+		if (!resource)
+			throw std::runtime_error("[RESOURCE MANAGER] Mesh with ID " + std::to_string(id) + " not found or unloaded!");
+		return *(resource->resource);
 	}
 
 	const std::string& ResourceManager::GetMeshName(MeshID id) const
 	{
-		auto it = m_meshes.find(id);
-		if(it == m_meshes.end())
-			throw std::runtime_error("[RESOURCE MANAGER] Mesh with ID " + std::to_string(id) + "not found!");
-		return (it->second.name);
+		auto* resource = m_meshes.Find(id);
+		if (!resource)
+			throw std::runtime_error("[RESOURCE MANAGER] Mesh with ID " + std::to_string(id) + " not found or unloaded!");
+		return (resource->name);
 	}
 
 	const Material& ResourceManager::GetMaterial(MaterialID id) const
 	{
-		auto it = m_materials.find(id);
-		if (it == m_materials.end())
-			throw std::runtime_error("[RESOURCE MANAGER] Material with ID " + std::to_string(id) + "not found!");
-		return *(it->second.resource);
+		auto* resource = m_materials.Find(id);
+		if (!resource)
+			throw std::runtime_error("[RESOURCE MANAGER] Material with ID " + std::to_string(id) + " not found or unloaded!");
+		return *(resource->resource);
 	}
 
 	const std::string& ResourceManager::GetMaterialName(MaterialID id) const
 	{
-		auto it = m_materials.find(id);
-		if (it == m_materials.end())
-			throw std::runtime_error("[RESOURCE MANAGER] Material with ID " + std::to_string(id) + "not found!");
-		return (it->second.name);
+		auto* resource = m_materials.Find(id);
+		if (!resource)
+			throw std::runtime_error("[RESOURCE MANAGER] Material with ID " + std::to_string(id) + " not found or unloaded!");
+		return (resource->name);
 	}
 }
\ No newline at end of file
@@ -4,13 +4,44 @@
 #include "Material.hpp"
 #include "Texture.hpp"
 #include "Common.hpp"
+#include "SlotMap.hpp"
 
 #include <unordered_map>
+#include <optional>
+#include <list>
+#include <type_traits>
 
 namespace Felina
 {
 	class Renderer;
 
+	// Reference to a resident resource of the ResourceManager: copies take another reference and the resource
+	// goes to the cache of the unreferenced ones when the last handle is destroyed (see ResourceManager)
+	// NOTE: releasing a resource that was already unloaded (e.g. by UnloadAll) is a no-op, its ID is stale
+	template<typename T>
+	class ResourceHandle
+	{
+		public:
+			ResourceHandle() = default;
+			ResourceHandle(const ResourceHandle& other);
+			ResourceHandle(ResourceHandle&& other) noexcept : m_id(other.m_id) { other.m_id = uint32_t(-1); }
+			ResourceHandle& operator=(ResourceHandle other) noexcept { std::swap(m_id, other.m_id); return *this; }
+			~ResourceHandle() { Reset(); }
+
+			void Reset();
+			uint32_t GetID() const { return m_id; }
+			bool IsValid() const { return m_id != uint32_t(-1); }
+
+		private:
+			friend class ResourceManager;
+			explicit ResourceHandle(uint32_t id) : m_id(id) {} // adopts a reference already counted
+
+			uint32_t m_id = uint32_t(-1);
+	};
+	using MeshHandle = ResourceHandle<Mesh>;
+	using MaterialHandle = ResourceHandle<Material>;
+	using TextureHandle = ResourceHandle<Texture>;
+
 	class ResourceManager
 	{
 		public:
@@ -18,44 +49,128 @@ namespace Felina
 			struct Resource {
 				std::string name;
 				std::unique_ptr<T> resource;
+				uint64_t contentHash = 0;
+				size_t contentSize = 0; // bytes uploaded (meshes and textures), the VRAM counted by the cache
+				uint32_t refCount = 1; // live handles, 0 while in the cache
+			};
+
+			// Loads that returned an already resident resource, and the bytes they didn't upload
+			struct DedupStats {
+				size_t reusedCount = 0;
+				size_t savedBytes = 0;
 			};
 
+			// VRAM kept by the unreferenced resources by default, the least recently released are unloaded beyond it
+			static constexpr size_t DEFAULT_CACHE_BUDGET = size_t(256) << 20;
+
 		public:
 			ResourceManager(const ResourceManager&) = delete; // Delete copy constructor
 			ResourceManager& operator=(const ResourceManager&) = delete; // Delete assignment operator
-			
+
 			static ResourceManager& GetInstance()
 			{
 				static ResourceManager instance;
 				return instance;
 			}
 
-			MeshID LoadMesh(std::unique_ptr<Mesh> mesh, const std::string& name, Renderer& renderer);
-			MaterialID LoadMaterial(std::unique_ptr<Material> material, const std::string& name);
-			TextureID LoadTexture(std::unique_ptr<Texture> texture, const std::string& name,
+			// The payloads are hashed: if the same content is already resident (referenced or cached) a new handle to it
+			// is returned and the new resource is dropped before being uploaded
+			// NOTE: 64-bit hashes of the content and its size, collisions aren't checked
+			MeshHandle LoadMesh(std::unique_ptr<Mesh> mesh, const std::string& name, Renderer& renderer);
+			MaterialHandle LoadMaterial(std::unique_ptr<Material> material, const std::string& name);
+			TextureHandle LoadTexture(std::unique_ptr<Texture> texture, const std::string& name,
 				const void* rawImageData, size_t rawImageSize,
 				Renderer& renderer
 			);
 			void UnloadAll();
 
+			// Deduplication statistics of a scene load, logged by EndSceneLoad with the cache state
+			void BeginSceneLoad();
+			void EndSceneLoad();
+
+			// Cache of the unreferenced resources: they stay resident, so that reloading the same scene or one sharing
+			// its assets reuses them, until their VRAM exceeds the budget (least recently released unloaded first)
+			// NOTE: a cached resource is unloaded with the cached ones depending on it (materials of a texture,
+			// meshes of a material) since they can't be matched anymore; the GPU must not be using them
+			void SetCacheBudget(size_t bytes);
+			size_t GetCacheBudget() const { return m_cacheBudget; }
+			size_t GetCachedBytes() const { return m_cachedBytes; }
+
+			// The IDs are generational (see SlotMap): their slot is the index of the resource in the GPU arrays
+			// (material buffer, texture array) while it's resident, and the getters throw on the IDs of unloaded ones
+			// NOTE: the cubemaps have their own slots after the 2D textures ones, they aren't in the texture array
+			// NOTE: the slot maps include the cached resources (refCount == 0), not drawn nor bound
+			static uint32_t GetSlot(uint32_t id) { return SlotMap<Resource<Mesh>>::GetSlot(id); }
 			const Mesh& GetMesh(MeshID id) const;
 			const std::string& GetMeshName(MeshID id) const;
-			const std::unordered_map<MeshID, Resource<Mesh>>& GetMeshes() const { return m_meshes; }
+			const SlotMap<Resource<Mesh>>& GetMeshes() const { return m_meshes; }
 			const Material& GetMaterial(MaterialID id) const;
 			const std::string& GetMaterialName(MaterialID id) const;
-			const std::unordered_map<MaterialID, Resource<Material>>& GetMaterials() const { return m_materials; }
-			const std::unordered_map<TextureID, Resource<Texture>>& GetTextures() const { return m_textures; }
+			const SlotMap<Resource<Material>>& GetMaterials() const { return m_materials; }
+			const SlotMap<Resource<Texture>>& GetTextures() const { return m_textures; }
+			const SlotMap<Resource<Texture>>& GetCubemaps() const { return m_cubemaps; }
 		private:
-			ResourceManager(){} // Private constructor
+			ResourceManager(); // Private constructor
+
+			enum class ResourceType { Mesh, Material, Texture };
+			template<typename T>
+			static constexpr ResourceType GetResourceType()
+			{
+				if constexpr (std::is_same_v<T, Mesh>)
+					return ResourceType::Mesh;
+				else if constexpr (std::is_same_v<T, Material>)
+					return ResourceType::Material;
+				else
+					return ResourceType::Texture;
+			}
+
+			template<typename T> friend class ResourceHandle;
+			template<typename T> void AddReference(uint32_t id);
+			template<typename T> void Release(uint32_t id);
+
+			template<typename T> SlotMap<Resource<T>>& GetResources(uint32_t id);
+			template<typename T> std::unordered_map<uint64_t, uint32_t>& GetHashes();
+			template<typename T> std::optional<uint32_t> FindResident(uint64_t hash, size_t size);
+			template<typename T> void RegisterHash(uint64_t hash, uint32_t id, const std::string& name);
+			template<typename T> void ReserveSlot(SlotMap<Resource<T>>& resources);
+			template<typename T> void Unload(uint32_t id);
+			void TrimCache();
 
-			// Resources
-			std::unordered_map<MeshID, Resource<Mesh>> m_meshes;
-			std::unordered_map<MaterialID, Resource<Material>> m_materials;
-			std::unordered_map<TextureID, Resource<Texture>> m_textures;
+			// Resources, the materials and textures are bounded by the GPU arrays indexed by their slots
+			SlotMap<Resource<Mesh>> m_meshes;
+			SlotMap<Resource<Material>> m_materials;
+			SlotMap<Resource<Texture>> m_textures;
+			SlotMap<Resource<Texture>> m_cubemaps;
 
-			// Id counters
-			MeshID m_meshID{ 0 };
-			MaterialID m_materialID{ 0 };
-			TextureID m_textureID{ 0 };
+			// Look-up from the content hashes to the resident resources
+			std::unordered_map<uint64_t, MeshID> m_meshHashes;
+			std::unordered_map<uint64_t, MaterialID> m_materialHashes;
+			std::unordered_map<uint64_t, TextureID> m_textureHashes;
+			DedupStats m_dedupStats; // since BeginSceneLoad
+
+			// Unreferenced resources, least recently released first
+			struct CacheEntry {
+				ResourceType type;
+				uint32_t id;
+			};
+			std::list<CacheEntry> m_cache;
+			size_t m_cachedBytes = 0;
+			size_t m_cacheBudget = DEFAULT_CACHE_BUDGET;
 	};
-}
\ No newline at end of file
+
+	template<typename T>
+	ResourceHandle<T>::ResourceHandle(const ResourceHandle& other)
+		: m_id(other.m_id)
+	{
+		if (IsValid())
+			ResourceManager::GetInstance().AddReference<T>(m_id);
+	}
+
+	template<typename T>
+	void ResourceHandle<T>::Reset()
+	{
+		if (IsValid())
+			ResourceManager::GetInstance().Release<T>(m_id);
+		m_id = uint32_t(-1);
+	}
+}
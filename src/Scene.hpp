@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Camera.hpp"
+#include "Light.hpp"
 #include "Mesh.hpp"
 #include "Object.hpp"
 
@@ -10,6 +11,13 @@
 
 namespace Felina 
 {
+	// References to the resources loaded for the scene, they go to the cache of the ResourceManager when cleared
+	struct SceneResources {
+		std::vector<MeshHandle> meshes;
+		std::vector<MaterialHandle> materials;
+		std::vector<TextureHandle> textures;
+	};
+
 	class Scene
 	{
 		public:
@@ -22,10 +30,30 @@ namespace Felina
 			// TODO: update
 			void AddObject(std::unique_ptr<Object> object);
 			inline const std::vector<std::unique_ptr<Object>>& GetObjects() const { return m_objects; }
-			inline void ClearObjects() { m_objects.clear(); }
+			inline void ClearObjects() { m_objects.clear(); m_staticBatches.clear(); }
+
+			// Merged copies of the objects flagged as batched (see Object::IsStaticBatched), drawn instead of them
+			void AddStaticBatch(std::unique_ptr<Object> batch) { m_staticBatches.push_back(std::move(batch)); }
+			inline const std::vector<std::unique_ptr<Object>>& GetStaticBatches() const { return m_staticBatches; }
+
+			// Punctual lights (world space)
+			void AddLight(const Light& light) { m_lights.push_back(light); }
+			inline const std::vector<Light>& GetLights() const { return m_lights; }
+			inline void ClearLights() { m_lights.clear(); }
+
+			SceneResources& GetResources() { return m_resources; }
+			inline void ClearResources() { m_resources = {}; }
+
+			// Directional light (shadowed)
+			const DirectionalLight& GetSun() const { return m_sun; }
+			void SetSun(const DirectionalLight& sun) { m_sun = sun; }
 
 		private:
 			Camera m_camera;
 			std::vector<std::unique_ptr<Object>> m_objects; // Top-level objects
+			std::vector<std::unique_ptr<Object>> m_staticBatches; // World-space meshes, not in the hierarchy
+			std::vector<Light> m_lights;
+			DirectionalLight m_sun;
+			SceneResources m_resources;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "ShadowMap.hpp"
+
+#include "Device.hpp"
+#include "Texture.hpp"
+#include "Camera.hpp"
+#include "Common.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Felina
+{
+	ShadowMap::ShadowMap(const Device& device, uint32_t cascadeCount, uint32_t resolution)
+		: m_cascadeCount(std::clamp<uint32_t>(cascadeCount, 1, MAX_CASCADES)),
+		m_resolution(std::clamp(resolution, MIN_RESOLUTION, MAX_RESOLUTION))
+	{
+		CreateImage(device);
+		CreateSampler(device);
+	}
+
+	ShadowMap::~ShadowMap()
+	{
+		m_cascadeViews.clear();
+		m_arrayView = nullptr;
+		m_texture.reset();
+	}
+
+	void ShadowMap::Update(const Camera& camera, glm::vec3 lightDirection, uint64_t geometryHash)
+	{
+		// Everything rendered so far is stale
+		if (lightDirection != m_lightDirection || geometryHash != m_geometryHash)
+		{
+			for (auto& cascade : m_cascades)
+				cascade.isValid = false;
+			m_lightDirection = lightDirection;
+			m_geometryHash = geometryHash;
+		}
+
+		// The light view only depends on the direction, the cascades are translated in light space
+		glm::vec3 up = std::abs(glm::dot(lightDirection, WORLD_UP)) > 0.99f ? WORLD_FORWARD : WORLD_UP;
+		glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+
+		// View-space extent of the frustum at unit distance (the Y axis is flipped in the projection)
+		glm::mat4 invView = glm::inverse(camera.GetViewMatrix());
+		glm::mat4 proj = camera.GetProjectionMatrix();
+		glm::vec2 tanHalfFov = 1.0f / glm::abs(glm::vec2(proj[0][0], proj[1][1]));
+
+		float nearPlane = camera.GetNearPlane();
+		float farPlane = std::min(camera.GetFarPlane(), SHADOW_DISTANCE);
+		float sliceNear = nearPlane;
+		m_redrawCount = 0;
+		for (uint32_t i = 0; i < m_cascadeCount; i++)
+		{
+			Cascade& cascade = m_cascades[i];
+
+			// Practical split scheme (GPU Gems 3, chapter 10)
+			float ratio = static_cast<float>(i + 1) / static_cast<float>(m_cascadeCount);
+			float logSplit = nearPlane * std::pow(farPlane / nearPlane, ratio);
+			float uniformSplit = nearPlane + (farPlane - nearPlane) * ratio;
+			float sliceFar = SPLIT_LAMBDA * logSplit + (1.0f - SPLIT_LAMBDA) * uniformSplit;
+
+			// Bounding sphere of the slice, its radius only depends on the projection and the splits
+			std::array<glm::vec3, 8> corners;
+			glm::vec3 center(0.0f);
+			for (uint32_t c = 0; c < corners.size(); c++)
+			{
+				float depth = (c & 4) ? sliceFar : sliceNear;
+				glm::vec3 corner((c & 1) ? tanHalfFov.x : -tanHalfFov.x, (c & 2) ? tanHalfFov.y : -tanHalfFov.y, -1.0f);
+				corners[c] = glm::vec3(invView * glm::vec4(corner * depth, 1.0f));
+				center += corners[c] / static_cast<float>(corners.size());
+			}
+			float radius = 0.0f;
+			for (const auto& corner : corners)
+				radius = std::max(radius, glm::length(corner - center));
+			radius = std::ceil(radius * 16.0f) / 16.0f; // absorbs the floating point noise
+
+			cascade.splitDepth = sliceFar;
+			cascade.isCached = i >= (m_cascadeCount + 1) / 2; // the far half
+			sliceNear = sliceFar;
+
+			// A cached cascade is kept as long as the sphere is still inside the box it was rendered with
+			glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+			if (cascade.isCached && cascade.isValid && cascade.radius == radius
+				&& glm::all(glm::greaterThanEqual(lightCenter - radius, cascade.boxMin))
+				&& glm::all(glm::lessThanEqual(lightCenter + radius, cascade.boxMax)))
+			{
+				cascade.needsRedraw = false;
+				continue;
+			}
+
+			// Moving the box by whole texels keeps the rasterization of the casters identical
+			float halfExtent = cascade.isCached ? radius * CACHE_PADDING : radius;
+			float texelSize = 2.0f * halfExtent / static_cast<float>(m_resolution);
+			glm::vec2 snappedCenter = glm::floor(glm::vec2(lightCenter) / texelSize) * texelSize;
+			cascade.boxMin = glm::vec3(snappedCenter - halfExtent, lightCenter.z - halfExtent);
+			cascade.boxMax = glm::vec3(snappedCenter + halfExtent, lightCenter.z + halfExtent);
+
+			// Light space looks down -Z, the near plane is pushed towards the light to keep the casters in front
+			glm::mat4 lightProj = glm::ortho(
+				cascade.boxMin.x, cascade.boxMax.x, cascade.boxMin.y, cascade.boxMax.y,
+				-(cascade.boxMax.z + CASTER_MARGIN), -cascade.boxMin.z
+			);
+			cascade.viewProj = lightProj * lightView;
+			cascade.texelSize = texelSize;
+			cascade.radius = radius;
+			cascade.isValid = true;
+			cascade.needsRedraw = true;
+			++m_redrawCount;
+		}
+	}
+
+	void ShadowMap::CreateImage(const Device& device)
+	{
+		vk::ImageCreateInfo imageInfo{
+			.imageType = vk::ImageType::e2D,
+			.format = FORMAT,
+			.extent = vk::Extent3D{ m_resolution, m_resolution, 1 },
+			.mipLevels = 1,
+			.arrayLayers = m_cascadeCount,
+			.samples = vk::SampleCountFlagBits::e1,
+			.tiling = vk::ImageTiling::eOptimal,
+			.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled,
+			.sharingMode = vk::SharingMode::eExclusive,
+			.initialLayout = vk::ImageLayout::eUndefined
+		};
+		VmaAllocationCreateInfo allocInfo{ .usage = VMA_MEMORY_USAGE_GPU_ONLY };
+		m_texture = std::make_unique<Texture>(device, imageInfo, allocInfo);
+
+		// The texture view is 2D for a single cascade, the shaders always sample an array
+		vk::ImageViewCreateInfo viewInfo{
+			.image = m_texture->GetHandle(),
+			.viewType = vk::ImageViewType::e2DArray,
+			.format = FORMAT,
+			.subresourceRange = {
+				.aspectMask = vk::ImageAspectFlagBits::eDepth,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = m_cascadeCount
+			}
+		};
+		m_arrayView = vk::raii::ImageView(device.GetDevice(), viewInfo);
+
+		// One attachment view per cascade
+		viewInfo.viewType = vk::ImageViewType::e2D;
+		viewInfo.subresourceRange.layerCount = 1;
+		for (uint32_t i = 0; i < m_cascadeCount; i++)
+		{
+			viewInfo.subresourceRange.baseArrayLayer = i;
+			m_cascadeViews.emplace_back(device.GetDevice(), viewInfo);
+		}
+
+		LOG("[ShadowMap] " + std::to_string(m_cascadeCount) + " cascades of " + std::to_string(m_resolution) + "x" + std::to_string(m_resolution));
+	}
+
+	void ShadowMap::CreateSampler(const Device& device)
+	{
+		// Bilinear comparison filters 2x2 texels per tap for free when supported
+		auto formatProperties = device.GetPhysicalDevice().getFormatProperties(FORMAT);
+		bool isLinearSupported = static_cast<bool>(formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear);
+		vk::Filter filter = isLinearSupported ? vk::Filter::eLinear : vk::Filter::eNearest;
+
+		vk::SamplerCreateInfo samplerCreateInfo{
+			.magFilter = filter,
+			.minFilter = filter,
+			.mipmapMode = vk::SamplerMipmapMode::eNearest,
+			.addressModeU = vk::SamplerAddressMode::eClampToEdge,
+			.addressModeV = vk::SamplerAddressMode::eClampToEdge,
+			.addressModeW = vk::SamplerAddressMode::eClampToEdge,
+			.mipLodBias = 0.0f,
+			.anisotropyEnable = vk::False,
+			.maxAnisotropy = 1.0f,
+			.compareEnable = vk::True,
+			.compareOp = vk::CompareOp::eLessOrEqual, // lit if the receiver isn't farther than the caster
+			.minLod = 0.0f,
+			.maxLod = 0.0f,
+			.borderColor = vk::BorderColor::eFloatOpaqueWhite,
+			.unnormalizedCoordinates = vk::False,
+		};
+		m_sampler = vk::raii::Sampler(device.GetDevice(), samplerCreateInfo);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace Felina
+{
+	class Device;
+	class Texture;
+	class Camera;
+
+	// Cascaded shadow map of the sun, one layer of a depth array per cascade
+	// Each cascade is fitted to the bounding sphere of a slice of the view frustum (its size doesn't
+	// change when the camera rotates) and snapped to the texel grid in light space, so static shadows don't shimmer
+	// The far cascades are cached: they're fitted with some padding and only redrawn when the camera
+	// leaves it or when the light direction or the scene geometry changes
+	class ShadowMap
+	{
+		public:
+			// NOTE: must match MAX_SHADOW_CASCADES in shadows.hlsli
+			static constexpr uint32_t MAX_CASCADES = 4;
+			static constexpr uint32_t MIN_RESOLUTION = 512;
+			static constexpr uint32_t MAX_RESOLUTION = 4096;
+			static constexpr vk::Format FORMAT = vk::Format::eD32Sfloat;
+
+			// View distance covered by the cascades (clamped to the camera far plane)
+			static constexpr float SHADOW_DISTANCE = 60.0f;
+			// Split distances blend between logarithmic (1) and uniform (0) distributions
+			static constexpr float SPLIT_LAMBDA = 0.8f;
+			// Extra depth towards the light so that the casters outside the cascade sphere aren't clipped
+			static constexpr float CASTER_MARGIN = 50.0f;
+			// Cached cascades are this much larger than their sphere (lower texel density, fewer redraws)
+			static constexpr float CACHE_PADDING = 1.25f;
+
+			struct Cascade
+			{
+				glm::mat4 viewProj{ 1.0f };
+				float splitDepth = 0.0f;    // view-space distance of the far bound of the slice
+				float texelSize = 0.0f;     // world-space size of a shadow map texel
+				bool isCached = false;
+				bool needsRedraw = true;
+
+				// Light-space box rendered the last time the cascade was drawn
+				bool isValid = false;
+				float radius = 0.0f;
+				glm::vec3 boxMin{ 0.0f };
+				glm::vec3 boxMax{ 0.0f };
+			};
+
+		public:
+			ShadowMap(const Device& device, uint32_t cascadeCount, uint32_t resolution);
+			~ShadowMap();
+
+			// Fits the cascades to the camera and flags the ones that must be redrawn this frame
+			// `geometryHash` changes whenever the scene geometry is modified (see Renderer::SetupFrameData)
+			void Update(const Camera& camera, glm::vec3 lightDirection, uint64_t geometryHash);
+
+			uint32_t GetCascadeCount() const { return m_cascadeCount; }
+			uint32_t GetResolution() const { return m_resolution; }
+			const Cascade& GetCascade(uint32_t index) const { return m_cascades[index]; }
+			// Cascades drawn by the last update (all of them: the previous contents can be discarded)
+			uint32_t GetRedrawCount() const { return m_redrawCount; }
+
+			const Texture& GetTexture() const { return *m_texture; }
+			const vk::raii::ImageView& GetArrayView() const { return m_arrayView; }
+			const vk::raii::ImageView& GetCascadeView(uint32_t index) const { return m_cascadeViews[index]; }
+			const vk::raii::Sampler& GetSampler() const { return m_sampler; }
+
+		private:
+			void CreateImage(const Device& device);
+			void CreateSampler(const Device& device);
+
+			uint32_t m_cascadeCount;
+			uint32_t m_resolution;
+			std::array<Cascade, MAX_CASCADES> m_cascades;
+			uint32_t m_redrawCount = 0;
+
+			// Invalidate the cached cascades when they change
+			glm::vec3 m_lightDirection{ 0.0f };
+			uint64_t m_geometryHash = 0;
+
+			std::unique_ptr<Texture> m_texture = nullptr;
+			vk::raii::ImageView m_arrayView = nullptr;
+			std::vector<vk::raii::ImageView> m_cascadeViews;
+			// Comparison sampler (hardware PCF when linear filtering of depth is supported)
+			vk::raii::Sampler m_sampler = nullptr;
+	};
+}
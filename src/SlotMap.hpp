@@ -0,0 +1,141 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+#include <string>
+#include <cstdint>
+
+namespace Felina
+{
+	// Dense storage addressed by generational IDs: the low bits of an ID are its slot, stable while the element lives
+	// (and reused by the next insertions once erased, lowest first), the high bits are the generation of the slot,
+	// incremented on erase so that the IDs of the erased elements are detected instead of aliasing the new ones
+	// NOTE: the elements are packed in insertion order (the last one fills the hole of an erased one), the iteration
+	// gives (ID, element) pairs like an std::unordered_map
+	// NOTE: generations wrap after 2^16 reuses of the same slot
+	// NOTE: the slots can start after `firstSlot`, so that the IDs of several maps don't overlap
+	template<typename T>
+	class SlotMap
+	{
+		public:
+			static constexpr uint32_t SLOT_BITS = 16;
+			static constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+			static constexpr uint32_t MAX_CAPACITY = SLOT_MASK; // the last slot is left out, its IDs could be -1
+			static constexpr uint32_t INVALID_ID = uint32_t(-1);
+
+			static uint32_t GetSlot(uint32_t id) { return id & SLOT_MASK; }
+			static uint32_t GetGeneration(uint32_t id) { return id >> SLOT_BITS; }
+
+		public:
+			explicit SlotMap(uint32_t capacity = MAX_CAPACITY, uint32_t firstSlot = 0)
+				: m_capacity(std::min(capacity, MAX_CAPACITY - std::min(firstSlot, MAX_CAPACITY))), m_firstSlot(firstSlot)
+			{
+			}
+
+			uint32_t Insert(T value)
+			{
+				if (IsFull())
+					throw std::runtime_error("[SlotMap] Capacity of " + std::to_string(m_capacity) + " slots reached!");
+
+				uint32_t slot;
+				if (!m_freeSlots.empty())
+				{
+					slot = m_freeSlots.top();
+					m_freeSlots.pop();
+				}
+				else
+				{
+					slot = static_cast<uint32_t>(m_slots.size());
+					m_slots.push_back({});
+				}
+
+				uint32_t id = (m_slots[slot].generation << SLOT_BITS) | (m_firstSlot + slot);
+				m_slots[slot].denseIndex = static_cast<uint32_t>(m_elements.size());
+				m_elements.emplace_back(id, std::move(value));
+				return id;
+			}
+
+			void Erase(uint32_t id)
+			{
+				if (!Contains(id))
+					return;
+				uint32_t slot = GetLocalSlot(id);
+				uint32_t denseIndex = m_slots[slot].denseIndex;
+				if (denseIndex + 1 != m_elements.size())
+				{
+					m_elements[denseIndex] = std::move(m_elements.back());
+					m_slots[GetLocalSlot(m_elements[denseIndex].first)].denseIndex = denseIndex;
+				}
+				m_elements.pop_back();
+
+				m_slots[slot].generation = (m_slots[slot].generation + 1) & SLOT_MASK;
+				m_slots[slot].denseIndex = NO_ELEMENT;
+				m_freeSlots.push(slot);
+			}
+
+			void Clear()
+			{
+				while (!m_elements.empty())
+					Erase(m_elements.back().first);
+			}
+
+			// Whether the slot of `id` is in the range of this map, even if its element was erased
+			bool IsInRange(uint32_t id) const { return id != INVALID_ID && GetSlot(id) >= m_firstSlot && GetSlot(id) - m_firstSlot < m_capacity; }
+			bool Contains(uint32_t id) const
+			{
+				if (!IsInRange(id))
+					return false;
+				uint32_t slot = GetLocalSlot(id);
+				return slot < m_slots.size() && m_slots[slot].denseIndex != NO_ELEMENT && m_slots[slot].generation == GetGeneration(id);
+			}
+
+			T* Find(uint32_t id) { return Contains(id) ? &m_elements[m_slots[GetLocalSlot(id)].denseIndex].second : nullptr; }
+			const T* Find(uint32_t id) const { return Contains(id) ? &m_elements[m_slots[GetLocalSlot(id)].denseIndex].second : nullptr; }
+
+			T& At(uint32_t id)
+			{
+				if (T* value = Find(id))
+					return *value;
+				throw std::runtime_error("[SlotMap] Stale or unknown ID " + std::to_string(id) + "!");
+			}
+			const T& At(uint32_t id) const
+			{
+				if (const T* value = Find(id))
+					return *value;
+				throw std::runtime_error("[SlotMap] Stale or unknown ID " + std::to_string(id) + "!");
+			}
+
+			size_t Size() const { return m_elements.size(); }
+			bool IsEmpty() const { return m_elements.empty(); }
+			bool IsFull() const { return m_elements.size() >= m_capacity; }
+			uint32_t GetCapacity() const { return m_capacity; }
+			uint32_t GetFirstSlot() const { return m_firstSlot; }
+			// Highest slot used so far + 1, the size of an array indexed by the slots
+			uint32_t GetSlotCount() const { return m_firstSlot + static_cast<uint32_t>(m_slots.size()); }
+
+			auto begin() { return m_elements.begin(); }
+			auto end() { return m_elements.end(); }
+			auto begin() const { return m_elements.cbegin(); }
+			auto end() const { return m_elements.cend(); }
+
+		private:
+			static constexpr uint32_t NO_ELEMENT = uint32_t(-1);
+
+			uint32_t GetLocalSlot(uint32_t id) const { return GetSlot(id) - m_firstSlot; }
+
+			struct Slot {
+				uint32_t generation = 0;
+				uint32_t denseIndex = NO_ELEMENT;
+			};
+
+			std::vector<std::pair<uint32_t, T>> m_elements; // (ID, element), packed
+			std::vector<Slot> m_slots;
+			std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> m_freeSlots;
+			uint32_t m_capacity;
+			uint32_t m_firstSlot;
+	};
+}
@@ -12,9 +12,12 @@ namespace Felina
 	{
 		Create();
         CreateImageViews();
+        CreateSemaphores();
 	}
 
-    void Swapchain::Recreate() 
+    // Recreation doesn't stall the GPU: the current swapchain is handed over to the new
+    // one as `oldSwapchain` and destroyed later on (see ReleaseRetired)
+    void Swapchain::Recreate(uint64_t frameSerial) 
     {
         // Handling minimization
         int width = 0, height = 0;
@@ -25,19 +28,45 @@ namespace Felina
             glfwWaitEvents(); // "Pausing" when minimized
         }
 
-        m_device.GetDevice().waitIdle();
+        m_retiredSwapchains.push_back(RetiredSwapchain{
+            .swapchain = std::move(m_swapchain),
+            .imageViews = std::move(m_swapchainImageViews),
+            .renderFinishedSemaphores = std::move(m_renderFinishedSemaphores),
+            .frameSerial = frameSerial
+        });
+        m_swapchain = nullptr;
+        m_swapchainImageViews.clear();
+        m_renderFinishedSemaphores.clear();
 
-        CleanUp();
-        Create();
+        Create(*m_retiredSwapchains.back().swapchain);
         CreateImageViews();
+        CreateSemaphores();
+    }
+
+    // Destroy the retired swapchains that are no longer in use
+    // NOTE: the present semaphore wait of the last frame of a retired swapchain isn't tracked by any fence,
+    // waiting for a frame submitted on the newer swapchain to complete is used as a conservative bound
+    void Swapchain::ReleaseRetired(uint64_t completedFrameSerial)
+    {
+        while (!m_retiredSwapchains.empty() && m_retiredSwapchains.front().frameSerial < completedFrameSerial)
+            m_retiredSwapchains.pop_front();
     }
 
     vk::ResultValue<uint32_t> Swapchain::AcquireNextImage(const vk::Semaphore& s)
     {
-        return m_swapchain.acquireNextImage(UINT64_MAX, s, nullptr);
+        // vk::raii reports an out of date swapchain through an exception,
+        // convert it back to a result so it can be handled like a suboptimal one
+        try
+        {
+            return m_swapchain.acquireNextImage(UINT64_MAX, s, nullptr);
+        }
+        catch (const vk::OutOfDateKHRError&)
+        {
+            return vk::ResultValue<uint32_t>(vk::Result::eErrorOutOfDateKHR, 0);
+        }
     }
 
-	void Swapchain::Create()
+	void Swapchain::Create(vk::SwapchainKHR oldSwapchain)
 	{
         const auto& physicalDevice = m_device.GetPhysicalDevice();
 
@@ -46,11 +75,12 @@ namespace Felina
         // Query for surface format (pixel format, color space)
         std::vector<vk::SurfaceFormatKHR> availableFormats = physicalDevice.getSurfaceFormatsKHR(m_surface);
         // Query for available presentation modes
-        std::vector<vk::PresentModeKHR> availablePresentModes = physicalDevice.getSurfacePresentModesKHR(m_surface);
+        m_availablePresentModes = physicalDevice.getSurfacePresentModesKHR(m_surface);
 
         // Choose suitable surface format and extent
         m_swapchainSurfaceFormat = ChooseSurfaceFormat(availableFormats);
         m_swapchainExtent = ChooseExtent(surfaceCapabilities);
+        m_presentMode = ChoosePresentMode(m_availablePresentModes);
 
         // Choose how many images to have in the swapchain
         auto minImageCount = std::max(3u, surfaceCapabilities.minImageCount);
@@ -58,9 +88,13 @@ namespace Felina
             ? surfaceCapabilities.maxImageCount
             : minImageCount;
 
+        // Images rendered elsewhere (e.g. by the compute lighting pass) are blitted to the swapchain
+        m_supportsTransferDst = static_cast<bool>(surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst);
+        vk::ImageUsageFlags imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+        if (m_supportsTransferDst)
+            imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+
         // SwapChainCreateInfo
-        // If rendering to a separate image (e.g. to apply post-processing effects) and then
-        // presenting to the screen imageUsage should be set to VK_IMAGE_USAGE_TRANSFER_DST_BIT
         vk::SwapchainCreateInfoKHR swapchainCreateInfo
         {
             .flags = vk::SwapchainCreateFlagsKHR(),
@@ -70,13 +104,13 @@ namespace Felina
             .imageColorSpace = m_swapchainSurfaceFormat.colorSpace,
             .imageExtent = m_swapchainExtent,
             .imageArrayLayers = 1,
-            .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
+            .imageUsage = imageUsage,
             .imageSharingMode = vk::SharingMode::eExclusive, // NOTE: assuming graphics and presentation queue family is the same
             .preTransform = surfaceCapabilities.currentTransform,
             .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
-            .presentMode = ChoosePresentMode(availablePresentModes),
+            .presentMode = m_presentMode,
             .clipped = true,
-            .oldSwapchain = nullptr
+            .oldSwapchain = oldSwapchain // allows the presentation engine to reuse resources
         };
 
         // Create swap chain
@@ -84,12 +118,6 @@ namespace Felina
         m_swapchainImages = m_swapchain.getImages();
 	}
 
-    void Swapchain::CleanUp()
-    {
-        m_swapchainImageViews.clear();
-        m_swapchain = nullptr;
-    }
-
     void Swapchain::CreateImageViews()
     {
         m_swapchainImageViews.clear();
@@ -110,6 +138,13 @@ namespace Felina
         }
     }
 
+    void Swapchain::CreateSemaphores()
+    {
+        m_renderFinishedSemaphores.clear();
+        for (size_t i = 0; i < m_swapchainImages.size(); i++)
+            m_renderFinishedSemaphores.emplace_back(m_device.GetDevice(), vk::SemaphoreCreateInfo());
+    }
+
     vk::SurfaceFormatKHR Swapchain::ChooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats)
     {
         for (const auto& availableFormat : availableFormats) {
@@ -135,12 +170,12 @@ namespace Felina
 
     vk::PresentModeKHR Swapchain::ChoosePresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes)
     {
-        // NOTE: it should be using mailbox but I want vsync rn
+        // Use the mode requested at runtime (FIFO by default, i.e. vsync)
         for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == vk::PresentModeKHR::eFifo)
+            if (availablePresentMode == m_requestedPresentMode)
                 return availablePresentMode;
         }
-        // The only mode guaranteed to be available (may result in visible tearing)
+        // The only mode guaranteed to be available
         return vk::PresentModeKHR::eFifo;
     }
 }
\ No newline at end of file
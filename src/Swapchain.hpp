@@ -2,6 +2,8 @@
 
 #include <vulkan/vulkan_raii.hpp>
 
+#include <deque>
+
 namespace Felina
 {
 	// Fwd declarations
@@ -13,7 +15,10 @@ namespace Felina
 		public:
 			Swapchain(const Device& device, const Window& window, const vk::raii::SurfaceKHR& surface);
 
-			void Recreate();
+			// NOTE: `frameSerial` is the serial of the last frame submitted on the current swapchain,
+			// `completedFrameSerial` the serial of the last frame completed by the GPU
+			void Recreate(uint64_t frameSerial);
+			void ReleaseRetired(uint64_t completedFrameSerial);
 			vk::ResultValue<uint32_t> AcquireNextImage(const vk::Semaphore& s);
 
 			const vk::SwapchainKHR& GetHandle() const { return *m_swapchain; }
@@ -21,11 +26,30 @@ namespace Felina
 			const vk::Extent2D& GetExtent() const { return m_swapchainExtent; }
 			const std::vector<vk::Image>& GetImages() const { return m_swapchainImages; }
 			const std::vector<vk::raii::ImageView>& GetImageViews() const { return m_swapchainImageViews; }
+			// Whether the images can be the destination of copies/blits
+			bool IsTransferDstSupported() const { return m_supportsTransferDst; }
+			const vk::raii::Semaphore& GetRenderFinishedSemaphore(uint32_t imageIndex) const { return m_renderFinishedSemaphores[imageIndex]; }
+
+			// Present mode
+			// NOTE: the requested mode is applied the next time the swapchain is (re)created,
+			// if it isn't supported by the surface FIFO is used instead
+			void SetPresentMode(vk::PresentModeKHR presentMode) { m_requestedPresentMode = presentMode; }
+			vk::PresentModeKHR GetPresentMode() const { return m_presentMode; }
+			const std::vector<vk::PresentModeKHR>& GetAvailablePresentModes() const { return m_availablePresentModes; }
 
 		private:
-			void Create();
-			void CleanUp();
+			// Swapchain replaced by a newer one, kept alive until the frames using it are completed
+			struct RetiredSwapchain
+			{
+				vk::raii::SwapchainKHR swapchain;
+				std::vector<vk::raii::ImageView> imageViews;
+				std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
+				uint64_t frameSerial;
+			};
+
+			void Create(vk::SwapchainKHR oldSwapchain = nullptr);
 			void CreateImageViews();
+			void CreateSemaphores();
 		
 			vk::SurfaceFormatKHR ChooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats);
 			vk::Extent2D ChooseExtent(const vk::SurfaceCapabilitiesKHR& capabilities);
@@ -38,8 +62,16 @@ namespace Felina
 			vk::raii::SwapchainKHR m_swapchain = nullptr;
 			std::vector<vk::Image> m_swapchainImages;
 			std::vector<vk::raii::ImageView> m_swapchainImageViews;
+			// One per swapchain image: the presentation engine releases it before the image can be acquired again
+			std::vector<vk::raii::Semaphore> m_renderFinishedSemaphores;
+			std::deque<RetiredSwapchain> m_retiredSwapchains;
 
 			vk::SurfaceFormatKHR m_swapchainSurfaceFormat;
 			vk::Extent2D m_swapchainExtent;
+			bool m_supportsTransferDst = false;
+
+			vk::PresentModeKHR m_requestedPresentMode = vk::PresentModeKHR::eFifo;
+			vk::PresentModeKHR m_presentMode = vk::PresentModeKHR::eFifo;
+			std::vector<vk::PresentModeKHR> m_availablePresentModes;
 	};
 }
\ No newline at end of file
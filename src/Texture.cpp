@@ -7,7 +7,7 @@
 namespace Felina
 {
 	Texture::Texture(const Device& device, const vk::ImageCreateInfo& imageInfo, const VmaAllocationCreateInfo& allocInfo)
-		: m_allocator(device.GetAllocator())
+		: m_allocator(device.GetAllocator()), m_device(device.GetDevice())
 	{
 		// Image
 		VkImage raw = VK_NULL_HANDLE;
@@ -29,12 +29,38 @@ namespace Felina
 		CreateImageView(device);
 	}
 
+	Texture::Texture(const Device& device, const vk::ImageCreateInfo& imageInfo, VmaAllocation aliasedAllocation, vk::DeviceSize allocationOffset)
+		: m_allocator(device.GetAllocator()), m_device(device.GetDevice()), m_allocation(aliasedAllocation), m_isAliased(true)
+	{
+		// Image
+		VkImage raw = VK_NULL_HANDLE;
+		VkResult res = vmaCreateAliasingImage2(
+			m_allocator,
+			m_allocation,
+			allocationOffset,
+			reinterpret_cast<const VkImageCreateInfo*>(&imageInfo),
+			&raw
+		);
+		if (res != VK_SUCCESS)
+			throw std::runtime_error("[Texture] vmaCreateAliasingImage2: " + std::to_string(res));
+
+		m_imageCreateInfo = imageInfo;
+		m_image = vk::Image(raw);
+
+		// Image View
+		CreateImageView(device);
+	}
+
 	Texture::~Texture()
 	{
 		if (m_image && m_allocation)
 		{
 			m_imageView = nullptr;
-			vmaDestroyImage(m_allocator, m_image, m_allocation);
+			// The memory of aliased images is freed by its owner
+			if (m_isAliased)
+				m_device.getDispatcher()->vkDestroyImage(static_cast<VkDevice>(*m_device), static_cast<VkImage>(m_image), nullptr);
+			else
+				vmaDestroyImage(m_allocator, m_image, m_allocation);
 			m_image = nullptr;
 			m_allocation = VK_NULL_HANDLE;
 		}
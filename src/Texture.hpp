@@ -14,6 +14,13 @@ namespace Felina
 				const vk::ImageCreateInfo& imageInfo,
 				const VmaAllocationCreateInfo& allocInfo
 			);
+			// Image bound to (a region of) an allocation owned by someone else,
+			// see TransientAllocator
+			Texture(const Device& device,
+				const vk::ImageCreateInfo& imageInfo,
+				VmaAllocation aliasedAllocation,
+				vk::DeviceSize allocationOffset
+			);
 			~Texture();
 
 			const bool IsCubemap() {
@@ -31,9 +38,11 @@ namespace Felina
 			void CreateImageView(const Device& device);
 
 			const VmaAllocator& m_allocator;
+			const vk::raii::Device& m_device;
 			vk::Image m_image; // no RAII because of VMA
 			vk::raii::ImageView m_imageView = nullptr;
-			VmaAllocation m_allocation;
+			VmaAllocation m_allocation = VK_NULL_HANDLE;
+			bool m_isAliased = false; // the allocation isn't owned
 
 			vk::ImageCreateInfo m_imageCreateInfo;
 			vk::ImageViewCreateInfo m_imageViewCreateInfo;
@@ -0,0 +1,179 @@
+#include "TransientAllocator.hpp"
+
+#include "Device.hpp"
+#include "Texture.hpp"
+#include "Common.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+
+namespace Felina
+{
+	static std::string ToMiB(vk::DeviceSize size)
+	{
+		return std::to_string(static_cast<double>(size) / (1024.0 * 1024.0)) + " MiB";
+	}
+
+	static bool IsAttachmentOnly(vk::ImageUsageFlags usage)
+	{
+		constexpr vk::ImageUsageFlags attachmentUsages =
+			vk::ImageUsageFlagBits::eColorAttachment
+			| vk::ImageUsageFlagBits::eDepthStencilAttachment
+			| vk::ImageUsageFlagBits::eInputAttachment
+			| vk::ImageUsageFlagBits::eTransientAttachment;
+		return (usage & ~attachmentUsages) == vk::ImageUsageFlags{};
+	}
+
+	TransientAllocator::TransientAllocator(const Device& device)
+		: m_device(device)
+	{
+	}
+
+	TransientAllocator::~TransientAllocator()
+	{
+		Free();
+	}
+
+	std::vector<std::unique_ptr<Texture>> TransientAllocator::Allocate(const std::vector<ImageRequest>& requests)
+	{
+		Free();
+
+		Placement placement = Place(m_device, requests);
+		for (auto& block : placement.blocks)
+		{
+			VkMemoryRequirements memoryRequirements = block.requirements;
+			VmaAllocationCreateInfo allocCreateInfo{};
+			allocCreateInfo.usage = block.isLazy ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY;
+
+			VkResult res = vmaAllocateMemory(m_device.GetAllocator(), &memoryRequirements, &allocCreateInfo, &block.allocation, nullptr);
+			if (res != VK_SUCCESS)
+				throw std::runtime_error("[TransientAllocator] vmaAllocateMemory: " + std::to_string(res));
+		}
+		m_blocks = std::move(placement.blocks);
+		m_footprint = placement.footprint;
+
+		std::vector<std::unique_ptr<Texture>> textures;
+		textures.reserve(requests.size());
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			const Block& block = m_blocks[placement.imageBlocks[i]];
+			textures.push_back(std::make_unique<Texture>(m_device, placement.infos[i], block.allocation, 0));
+		}
+
+		LOG("[TransientAllocator] " + std::to_string(requests.size()) + " images in " + std::to_string(m_blocks.size()) + " blocks: "
+			+ ToMiB(m_footprint.requestedSize) + " requested, "
+			+ ToMiB(m_footprint.allocatedSize) + " allocated, "
+			+ ToMiB(m_footprint.lazySize) + " lazily allocated");
+
+		return textures;
+	}
+
+	void TransientAllocator::Free()
+	{
+		for (auto& block : m_blocks)
+		{
+			if (block.allocation != VK_NULL_HANDLE)
+				vmaFreeMemory(m_device.GetAllocator(), block.allocation);
+		}
+		m_blocks.clear();
+		m_footprint = {};
+	}
+
+	TransientAllocator::Footprint TransientAllocator::EstimateFootprint(const Device& device, const std::vector<ImageRequest>& requests)
+	{
+		return Place(device, requests).footprint;
+	}
+
+	// Greedy interval packing: images are placed from the biggest to the smallest
+	// in the first block whose images are all dead (or not yet alive) during their lifetime
+	TransientAllocator::Placement TransientAllocator::Place(const Device& device, const std::vector<ImageRequest>& requests)
+	{
+		Placement placement;
+		placement.infos.reserve(requests.size());
+		placement.imageBlocks.resize(requests.size());
+
+		std::vector<vk::MemoryRequirements> memoryRequirements;
+		std::vector<bool> isLazy;
+		for (const auto& request : requests)
+		{
+			vk::ImageCreateInfo info = request.info;
+
+			// Attachments that are never sampled, copied or stored to can live in tile memory only
+			bool attachmentOnly = IsAttachmentOnly(info.usage);
+			if (attachmentOnly)
+				info.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+
+			vk::MemoryRequirements requirements = device.GetDevice().getImageMemoryRequirements(
+				vk::DeviceImageMemoryRequirements{ .pCreateInfo = &info }
+			).memoryRequirements;
+
+			bool lazy = false;
+			if (attachmentOnly)
+			{
+				VmaAllocationCreateInfo lazyCreateInfo{};
+				lazyCreateInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+				uint32_t memoryTypeIndex = 0;
+				lazy = vmaFindMemoryTypeIndex(device.GetAllocator(), requirements.memoryTypeBits, &lazyCreateInfo, &memoryTypeIndex) == VK_SUCCESS;
+			}
+
+			placement.infos.push_back(info);
+			memoryRequirements.push_back(requirements);
+			isLazy.push_back(lazy);
+			placement.footprint.requestedSize += requirements.size;
+		}
+
+		std::vector<uint32_t> order(requests.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return memoryRequirements[a].size > memoryRequirements[b].size;
+		});
+
+		for (uint32_t i : order)
+		{
+			const auto& request = requests[i];
+			const auto& requirements = memoryRequirements[i];
+
+			auto overlaps = [&](const std::pair<uint32_t, uint32_t>& lifetime) {
+				return request.firstPass <= lifetime.second && lifetime.first <= request.lastPass;
+			};
+
+			// Lazily allocated images don't need to be aliased
+			std::optional<size_t> blockIndex;
+			for (size_t b = 0; b < placement.blocks.size() && !isLazy[i]; b++)
+			{
+				const Block& block = placement.blocks[b];
+				if (block.isLazy || (block.requirements.memoryTypeBits & requirements.memoryTypeBits) == 0)
+					continue;
+				if (std::none_of(block.lifetimes.begin(), block.lifetimes.end(), overlaps))
+				{
+					blockIndex = b;
+					break;
+				}
+			}
+
+			if (!blockIndex)
+			{
+				placement.blocks.push_back({ .requirements = requirements, .isLazy = isLazy[i] });
+				blockIndex = placement.blocks.size() - 1;
+			}
+
+			Block& block = placement.blocks[*blockIndex];
+			block.requirements.size = std::max(block.requirements.size, requirements.size);
+			block.requirements.alignment = std::max(block.requirements.alignment, requirements.alignment);
+			block.requirements.memoryTypeBits &= requirements.memoryTypeBits;
+			block.lifetimes.push_back({ request.firstPass, request.lastPass });
+			placement.imageBlocks[i] = static_cast<uint32_t>(*blockIndex);
+		}
+
+		for (const auto& block : placement.blocks)
+		{
+			if (block.isLazy)
+				placement.footprint.lazySize += block.requirements.size;
+			else
+				placement.footprint.allocatedSize += block.requirements.size;
+		}
+
+		return placement;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <vk_mem_alloc.h>
+
+#include <memory>
+#include <vector>
+
+namespace Felina
+{
+	class Device;
+	class Texture;
+
+	// Allocates render targets that only live within a frame:
+	// - attachment-only images are marked as transient and placed in lazily allocated memory when the device exposes it
+	// - images whose lifetimes (first to last pass using them) don't overlap share the same memory
+	// NOTE: aliased images don't preserve their contents, users must discard them
+	// (UNDEFINED layout) the first time they are accessed within a frame
+	class TransientAllocator
+	{
+		public:
+			struct ImageRequest
+			{
+				vk::ImageCreateInfo info;
+				// Lifetime as the range of passes (inclusive) the image is used by
+				uint32_t firstPass;
+				uint32_t lastPass;
+			};
+
+			// Memory footprint of a set of requests
+			struct Footprint
+			{
+				vk::DeviceSize requestedSize = 0;   // sum of the sizes of all the images
+				vk::DeviceSize allocatedSize = 0;   // memory actually allocated after aliasing (lazily allocated images excluded)
+				vk::DeviceSize lazySize = 0;        // memory requested by images in lazily allocated memory
+			};
+
+		public:
+			TransientAllocator(const Device& device);
+			~TransientAllocator();
+
+			TransientAllocator(const TransientAllocator&) = delete;
+			TransientAllocator& operator=(const TransientAllocator&) = delete;
+
+			// Returns the images in the same order of the requests
+			// NOTE: the textures must be destroyed before the allocator
+			std::vector<std::unique_ptr<Texture>> Allocate(const std::vector<ImageRequest>& requests);
+			void Free();
+
+			const Footprint& GetFootprint() const { return m_footprint; }
+
+			// Same placement as Allocate without allocating anything
+			static Footprint EstimateFootprint(const Device& device, const std::vector<ImageRequest>& requests);
+
+		private:
+			// Memory shared by images with disjoint lifetimes
+			struct Block
+			{
+				vk::MemoryRequirements requirements;
+				std::vector<std::pair<uint32_t, uint32_t>> lifetimes;
+				bool isLazy = false;
+				VmaAllocation allocation = VK_NULL_HANDLE;
+			};
+
+			struct Placement
+			{
+				std::vector<vk::ImageCreateInfo> infos;	// possibly patched with the transient usage
+				std::vector<uint32_t> imageBlocks;		// block index for each request
+				std::vector<Block> blocks;
+				Footprint footprint;
+			};
+
+			static Placement Place(const Device& device, const std::vector<ImageRequest>& requests);
+
+			const Device& m_device;
+			std::vector<Block> m_blocks;
+			Footprint m_footprint;
+	};
+}
@@ -2,6 +2,7 @@
 
 #include "Application.hpp"
 #include "Scene.hpp"
+#include "Renderer.hpp"
 #include "Common.hpp"
 
 #include <imgui.h>
@@ -9,6 +10,10 @@
 #include <backends/imgui_impl_vulkan.h>
 #include <tinyfiledialogs.h>
 
+#include <algorithm>
+#include <random>
+#include <cmath>
+
 namespace Felina
 {
 	UI::UI()
@@ -28,6 +33,7 @@ namespace Felina
 		// Custom UI
 		DrawSceneWindow(scene, app);
 		DrawInspectorWindow();
+		DrawStatsWindow(app);
 
 		ImGui::Render();
 	}
@@ -42,10 +48,23 @@ namespace Felina
 			auto selectedFilePath = OpenFileDialog(ASSETS_DIR, { "*.glb", "*.gltf" });
 			if (!selectedFilePath.empty())
 			{
-				app.LoadScene(selectedFilePath);
+				app.LoadScene(selectedFilePath, m_loadOptions);
 				m_hierarchySelection = nullptr; // This pointer may point to an old object
 			}
 		}
+		// Applied to the next load (ACMR/ATVR reported in the log)
+		ImGui::Checkbox("Optimize meshes", &m_loadOptions.optimizeMeshes);
+		ImGui::Checkbox("Quantize vertices", &m_loadOptions.quantizeVertices);
+		ImGui::Checkbox("Generate LODs", &m_loadOptions.generateLods);
+		ImGui::Checkbox("Build meshlets", &m_loadOptions.buildMeshlets);
+		ImGui::Checkbox("Static batching", &m_loadOptions.staticBatching);
+
+		// Resources released by the previous scenes, kept resident for the next loads
+		auto& rm = ResourceManager::GetInstance();
+		int cacheBudget = static_cast<int>(rm.GetCacheBudget() >> 20);
+		if (ImGui::SliderInt("Resource cache", &cacheBudget, 0, 2048, "%d MB"))
+			rm.SetCacheBudget(size_t(cacheBudget) << 20);
+		ImGui::Text("Cached: %zu MB", rm.GetCachedBytes() >> 20);
 
 		// Draw scene hierarchy
 		ImGui::SeparatorText("Hierarchy");
@@ -61,6 +80,13 @@ namespace Felina
 		glm::vec3 target = scene.GetCamera().GetTarget();
 		ImGui::TextDisabled("Camera: (%.2f, %.2f, %.2f)", pos.x, pos.y, pos.z);
 		ImGui::TextDisabled("Target: (%.2f, %.2f, %.2f)", target.x, target.y, target.z);		
+
+		// Rendering options
+		ImGui::SeparatorText("Rendering");
+		bool isOnDemand = app.IsOnDemandRendering();
+		if (ImGui::Checkbox("On-demand rendering", &isOnDemand))
+			app.SetOnDemandRendering(isOnDemand);
+		ImGui::SetItemTooltip("Redraw only when input, UI, resize or scene loading invalidate the frame");
 		
 		ImGui::End();
 	}
@@ -107,6 +133,8 @@ namespace Felina
 		if (m_hierarchySelection)
 		{
 			ImGui::SeparatorText(m_hierarchySelection->GetName().c_str());
+			if (m_hierarchySelection->IsStaticBatched())
+				ImGui::TextDisabled("Merged in a static batch: edits show with the static batches disabled");
 
 			// Transform
 			// TODO: highlight in the UI that this is the transform-dedicated section
@@ -144,6 +172,8 @@ namespace Felina
 
 					for (auto& [id, mesh] : rm.GetMeshes())
 					{
+						if (mesh.refCount == 0) // cached, may be unloaded
+							continue;
 						auto& name = rm.GetMeshName(id);
 						const bool isSelected = (id == selectedMesh);
 						if (filter.PassFilter(name.c_str()))
@@ -154,8 +184,11 @@ namespace Felina
 				}
 
 				// Material
+				// Overrides the materials of the submeshes (see Object::SetMaterial)
 				MaterialID selectedMaterial = m_hierarchySelection->GetMaterial();
-				if (ImGui::BeginCombo("Material", rm.GetMaterialName(selectedMaterial).c_str(), 0))
+				const char* submeshMaterials = "Per submesh";
+				const char* preview = selectedMaterial == MaterialID(-1) ? submeshMaterials : rm.GetMaterialName(selectedMaterial).c_str();
+				if (ImGui::BeginCombo("Material", preview, 0))
 				{
 					static ImGuiTextFilter filter;
 					if (ImGui::IsWindowAppearing())
@@ -166,8 +199,12 @@ namespace Felina
 					ImGui::SetNextItemShortcut(ImGuiMod_Ctrl | ImGuiKey_F);
 					filter.Draw("##Filter", -FLT_MIN);
 
+					if (ImGui::Selectable(submeshMaterials, selectedMaterial == MaterialID(-1)))
+						m_hierarchySelection->SetMaterial(-1);
 					for (auto& [id, material] : rm.GetMaterials())
 					{
+						if (material.refCount == 0) // cached, may be unloaded
+							continue;
 						auto& name = rm.GetMaterialName(id);
 						const bool isSelected = (id == selectedMaterial);
 						if (filter.PassFilter(name.c_str()))
@@ -181,6 +218,349 @@ namespace Felina
 		ImGui::End();
 	}
 
+	static const char* PresentModeName(vk::PresentModeKHR mode)
+	{
+		switch (mode)
+		{
+			case vk::PresentModeKHR::eFifo: return "FIFO (vsync)";
+			case vk::PresentModeKHR::eFifoRelaxed: return "FIFO relaxed";
+			case vk::PresentModeKHR::eMailbox: return "Mailbox";
+			case vk::PresentModeKHR::eImmediate: return "Immediate";
+			default: return "Other";
+		}
+	}
+
+	static const char* GBufferEncodingName(GBuffer::Encoding encoding)
+	{
+		switch (encoding)
+		{
+			case GBuffer::Encoding::Standard: return "Standard (16 B/px)";
+			case GBuffer::Encoding::Octahedral16: return "Octahedral RG16 (12 B/px)";
+			case GBuffer::Encoding::Octahedral8: return "Octahedral RG8 (8 B/px)";
+			default: return "Other";
+		}
+	}
+
+	static const char* RenderPathName(Renderer::RenderPath renderPath)
+	{
+		switch (renderPath)
+		{
+			case Renderer::RenderPath::Deferred: return "Deferred";
+			case Renderer::RenderPath::VisibilityBuffer: return "Visibility buffer";
+			default: return "Other";
+		}
+	}
+
+	// Random point lights above the ground plane (Z-up) to stress the clustered shading
+	static void AddTestLights(Scene& scene, uint32_t count)
+	{
+		static std::mt19937 generator{ 42 };
+		std::uniform_real_distribution<float> horizontal(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> vertical(0.2f, 4.0f);
+		std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Light light{};
+			light.type = Light::Type::Point;
+			light.position = glm::vec3(horizontal(generator), horizontal(generator), vertical(generator));
+			light.color = glm::vec3(channel(generator), channel(generator), channel(generator));
+			light.intensity = 2.0f;
+			light.range = 2.0f;
+			scene.AddLight(light);
+		}
+	}
+
+	static const char* DepthPrepassModeName(Renderer::DepthPrepassMode mode)
+	{
+		switch (mode)
+		{
+			case Renderer::DepthPrepassMode::Off: return "Off";
+			case Renderer::DepthPrepassMode::On: return "On";
+			case Renderer::DepthPrepassMode::Auto: return "Auto (overdraw)";
+			default: return "Other";
+		}
+	}
+
+	static const char* LightingPathName(Renderer::LightingPath lightingPath)
+	{
+		switch (lightingPath)
+		{
+			case Renderer::LightingPath::Raster: return "Raster (clustered)";
+			case Renderer::LightingPath::ComputeTiled: return "Compute (tiled)";
+			default: return "Other";
+		}
+	}
+
+	static const char* UpscaleFilterName(Renderer::UpscaleFilter filter)
+	{
+		switch (filter)
+		{
+			case Renderer::UpscaleFilter::Bilinear: return "Bilinear";
+			case Renderer::UpscaleFilter::Sharpen: return "Bilinear + sharpen";
+			default: return "Other";
+		}
+	}
+
+	void UI::DrawStatsWindow(Application& app)
+	{
+		ImGui::Begin("Stats");
+		Renderer& renderer = app.GetRenderer();
+
+		// Presentation settings
+		ImGui::SeparatorText("Presentation");
+		vk::PresentModeKHR currentMode = renderer.GetPresentMode();
+		if (ImGui::BeginCombo("Present mode", PresentModeName(currentMode), 0))
+		{
+			constexpr std::array<vk::PresentModeKHR, 4> selectableModes{
+				vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eFifoRelaxed,
+				vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate
+			};
+			const auto& availableModes = renderer.GetAvailablePresentModes();
+			for (auto mode : selectableModes)
+			{
+				// Unsupported modes are listed but can't be selected
+				bool isAvailable = std::find(availableModes.begin(), availableModes.end(), mode) != availableModes.end();
+				if (ImGui::Selectable(PresentModeName(mode), mode == currentMode, isAvailable ? 0 : ImGuiSelectableFlags_Disabled))
+				{
+					renderer.SetPresentMode(mode);
+					app.RequestRedraw();
+				}
+			}
+			ImGui::EndCombo();
+		}
+
+		int frameRateLimit = static_cast<int>(app.GetFrameRateLimit());
+		if (ImGui::SliderInt("FPS limit", &frameRateLimit, 0, 480, frameRateLimit == 0 ? "Off" : "%d"))
+			app.SetFrameRateLimit(static_cast<uint32_t>(frameRateLimit));
+
+		// G-buffer layout (color targets only, depth excluded)
+		ImGui::SeparatorText("G-buffer");
+		Renderer::RenderPath currentPath = renderer.GetRenderPath();
+		if (ImGui::BeginCombo("Render path", RenderPathName(currentPath), 0))
+		{
+			constexpr std::array<Renderer::RenderPath, 2> renderPaths{
+				Renderer::RenderPath::Deferred, Renderer::RenderPath::VisibilityBuffer
+			};
+			for (auto renderPath : renderPaths)
+			{
+				bool isSupported = renderer.IsRenderPathSupported(renderPath);
+				if (ImGui::Selectable(RenderPathName(renderPath), renderPath == currentPath, isSupported ? 0 : ImGuiSelectableFlags_Disabled))
+				{
+					renderer.SetRenderPath(renderPath);
+					app.RequestRedraw();
+				}
+			}
+			ImGui::EndCombo();
+		}
+
+		GBuffer::Encoding currentEncoding = renderer.GetGBufferEncoding();
+		if (ImGui::BeginCombo("Encoding", GBufferEncodingName(currentEncoding), 0))
+		{
+			constexpr std::array<GBuffer::Encoding, 3> encodings{
+				GBuffer::Encoding::Standard, GBuffer::Encoding::Octahedral16, GBuffer::Encoding::Octahedral8
+			};
+			for (auto encoding : encodings)
+			{
+				bool isSupported = renderer.IsGBufferEncodingSupported(encoding);
+				if (ImGui::Selectable(GBufferEncodingName(encoding), encoding == currentEncoding, isSupported ? 0 : ImGuiSelectableFlags_Disabled))
+				{
+					renderer.SetGBufferEncoding(encoding);
+					app.RequestRedraw();
+				}
+			}
+			ImGui::EndCombo();
+		}
+
+		// Depth pre-pass (deferred path only)
+		Renderer::DepthPrepassMode currentPrepassMode = renderer.GetDepthPrepassMode();
+		if (ImGui::BeginCombo("Depth pre-pass", DepthPrepassModeName(currentPrepassMode), 0))
+		{
+			constexpr std::array<Renderer::DepthPrepassMode, 3> prepassModes{
+				Renderer::DepthPrepassMode::Off, Renderer::DepthPrepassMode::On, Renderer::DepthPrepassMode::Auto
+			};
+			for (auto mode : prepassModes)
+			{
+				bool isSupported = renderer.IsDepthPrepassModeSupported(mode);
+				if (ImGui::Selectable(DepthPrepassModeName(mode), mode == currentPrepassMode, isSupported ? 0 : ImGuiSelectableFlags_Disabled))
+				{
+					renderer.SetDepthPrepassMode(mode);
+					app.RequestRedraw();
+				}
+			}
+			ImGui::EndCombo();
+		}
+		ImGui::Text("Overdraw: %.2f fragments/pixel (pre-pass %s)", renderer.GetOverdraw(), renderer.IsDepthPrepassActive() ? "active" : "inactive");
+
+		// Punctual lights (clustered shading)
+		ImGui::SeparatorText("Lights");
+		ImGui::Text("Punctual lights: %u / %u", renderer.GetLightCount(), Renderer::MAX_LIGHTS);
+		if (ImGui::Button("Add 1024 test lights"))
+		{
+			AddTestLights(app.GetScene(), 1024);
+			app.RequestRedraw();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Clear lights"))
+		{
+			app.GetScene().ClearLights();
+			app.RequestRedraw();
+		}
+
+		// Compare both paths with the frame time below
+		Renderer::LightingPath currentLightingPath = renderer.GetLightingPath();
+		if (ImGui::BeginCombo("Lighting path", LightingPathName(currentLightingPath), 0))
+		{
+			constexpr std::array<Renderer::LightingPath, 2> lightingPaths{
+				Renderer::LightingPath::Raster, Renderer::LightingPath::ComputeTiled
+			};
+			for (auto lightingPath : lightingPaths)
+			{
+				bool isSupported = renderer.IsLightingPathSupported(lightingPath);
+				if (ImGui::Selectable(LightingPathName(lightingPath), lightingPath == currentLightingPath, isSupported ? 0 : ImGuiSelectableFlags_Disabled))
+				{
+					renderer.SetLightingPath(lightingPath);
+					app.RequestRedraw();
+				}
+			}
+			ImGui::EndCombo();
+		}
+
+		// Sun and its cascaded shadow map
+		ImGui::SeparatorText("Shadows");
+		DirectionalLight sun = app.GetScene().GetSun();
+		// Z-up: the angles locate the sun, the light travels the opposite way
+		float elevation = glm::degrees(std::asin(std::clamp(-sun.direction.z, -1.0f, 1.0f)));
+		float azimuth = glm::degrees(std::atan2(-sun.direction.y, -sun.direction.x));
+		bool isSunChanged = ImGui::SliderFloat("Sun azimuth", &azimuth, -180.0f, 180.0f, "%.0f deg");
+		isSunChanged |= ImGui::SliderFloat("Sun elevation", &elevation, 5.0f, 90.0f, "%.0f deg");
+		if (isSunChanged)
+		{
+			float cosElevation = std::cos(glm::radians(elevation));
+			sun.direction = -glm::vec3(
+				cosElevation * std::cos(glm::radians(azimuth)),
+				cosElevation * std::sin(glm::radians(azimuth)),
+				std::sin(glm::radians(elevation))
+			);
+			app.GetScene().SetSun(sun);
+			app.RequestRedraw();
+		}
+
+		int cascadeCount = static_cast<int>(renderer.GetShadowCascadeCount());
+		if (ImGui::SliderInt("Cascades", &cascadeCount, 1, static_cast<int>(ShadowMap::MAX_CASCADES)))
+		{
+			renderer.SetShadowSettings(static_cast<uint32_t>(cascadeCount), renderer.GetShadowResolution());
+			app.RequestRedraw();
+		}
+
+		uint32_t currentResolution = renderer.GetShadowResolution();
+		if (ImGui::BeginCombo("Resolution", std::to_string(currentResolution).c_str(), 0))
+		{
+			for (uint32_t resolution = ShadowMap::MIN_RESOLUTION; resolution <= ShadowMap::MAX_RESOLUTION; resolution *= 2)
+			{
+				if (ImGui::Selectable(std::to_string(resolution).c_str(), resolution == currentResolution))
+				{
+					renderer.SetShadowSettings(renderer.GetShadowCascadeCount(), resolution);
+					app.RequestRedraw();
+				}
+			}
+			ImGui::EndCombo();
+		}
+		// The cached cascades are only redrawn when the camera leaves them
+		ImGui::Text("Cascades redrawn: %u / %u", renderer.GetShadowRedrawCount(), renderer.GetShadowCascadeCount());
+
+		// LODs selected per object from their projected error (0 -> always full detail)
+		ImGui::SeparatorText("Level of detail");
+		float lodErrorThreshold = renderer.GetLodErrorThreshold();
+		if (ImGui::SliderFloat("Error threshold", &lodErrorThreshold, 0.0f, 8.0f, "%.1f px"))
+		{
+			renderer.SetLodErrorThreshold(lodErrorThreshold);
+			app.RequestRedraw();
+		}
+		uint32_t drawnTriangles = renderer.GetDrawnTriangleCount();
+		uint32_t fullDetailTriangles = renderer.GetFullDetailTriangleCount();
+		ImGui::Text("Triangles: %u / %u (%u saved)", drawnTriangles, fullDetailTriangles, fullDetailTriangles - drawnTriangles);
+
+		// Frustum and normal cone culling of the meshlets (full detail objects, meshlets built on load, needs shaderInt64)
+		ImGui::SeparatorText("Meshlet culling");
+		bool isMeshletCullingEnabled = renderer.IsMeshletCullingEnabled();
+		ImGui::BeginDisabled(!renderer.IsMeshletCullingSupported());
+		if (ImGui::Checkbox("Cull meshlets", &isMeshletCullingEnabled))
+		{
+			renderer.SetMeshletCulling(isMeshletCullingEnabled);
+			app.RequestRedraw();
+		}
+		ImGui::EndDisabled();
+		uint32_t meshletTriangles = renderer.GetMeshletTriangleCount();
+		uint32_t visibleTriangles = renderer.GetMeshletVisibleTriangleCount();
+		ImGui::Text("Triangles: %u / %u (%u culled)", visibleTriangles, meshletTriangles, meshletTriangles - visibleTriangles);
+
+		ImGui::SeparatorText("Static batching");
+		bool isStaticBatchingEnabled = renderer.IsStaticBatchingEnabled();
+		if (ImGui::Checkbox("Draw static batches", &isStaticBatchingEnabled))
+		{
+			renderer.SetStaticBatching(isStaticBatchingEnabled);
+			app.RequestRedraw();
+		}
+		ImGui::Text("Draw calls: %u per pass", renderer.GetDrawCount());
+
+		// Render scale driven by the GPU frame time (needs timestamp queries)
+		ImGui::SeparatorText("Dynamic resolution");
+		bool isDynamicResolutionEnabled = renderer.IsDynamicResolutionEnabled();
+		ImGui::BeginDisabled(!renderer.IsDynamicResolutionSupported());
+		if (ImGui::Checkbox("Enabled", &isDynamicResolutionEnabled))
+		{
+			renderer.SetDynamicResolution(isDynamicResolutionEnabled);
+			app.RequestRedraw();
+		}
+		ImGui::EndDisabled();
+
+		float targetFrameTime = renderer.GetTargetFrameTime();
+		if (ImGui::SliderFloat("Target GPU time", &targetFrameTime, 4.0f, 33.3f, "%.1f ms"))
+		{
+			renderer.SetTargetFrameTime(targetFrameTime);
+			app.RequestRedraw();
+		}
+
+		Renderer::UpscaleFilter currentFilter = renderer.GetUpscaleFilter();
+		if (ImGui::BeginCombo("Upscale filter", UpscaleFilterName(currentFilter), 0))
+		{
+			constexpr std::array<Renderer::UpscaleFilter, 2> filters{
+				Renderer::UpscaleFilter::Bilinear, Renderer::UpscaleFilter::Sharpen
+			};
+			for (auto filter : filters)
+			{
+				if (ImGui::Selectable(UpscaleFilterName(filter), filter == currentFilter))
+				{
+					renderer.SetUpscaleFilter(filter);
+					app.RequestRedraw();
+				}
+			}
+			ImGui::EndCombo();
+		}
+		vk::Extent2D renderExtent = renderer.GetRenderExtent();
+		ImGui::Text("Render extent: %ux%u", renderExtent.width, renderExtent.height);
+
+		// Frame timings
+		ImGui::SeparatorText("Timings");
+		const FrameStats& stats = renderer.GetFrameStats();
+		float avgFrameTime = stats.GetAverageFrameTime();
+		ImGui::Text("Frame time: %.2f ms (%.1f FPS)", avgFrameTime, avgFrameTime > 0.0f ? 1000.0f / avgFrameTime : 0.0f);
+		ImGui::Text("Max frame time: %.2f ms", stats.GetMaxFrameTime());
+		ImGui::Text("CPU time: %.2f ms", stats.GetAverageCpuTime());
+		if (renderer.IsDynamicResolutionSupported())
+			ImGui::Text("GPU time: %.2f ms", renderer.GetGpuFrameTime());
+		ImGui::Text("Present jitter: %.3f ms", stats.GetPresentJitter());
+		ImGui::Text("Queue depth: %u (avg %.2f)", stats.GetQueueDepth(), stats.GetAverageQueueDepth());
+
+		const auto& history = stats.GetFrameTimeHistory();
+		ImGui::PlotLines("##FrameTimes", history.data(), static_cast<int>(history.size()),
+			static_cast<int>(stats.GetHistoryOffset()), "Present-to-present (ms)",
+			0.0f, 2.0f * avgFrameTime, ImVec2(-FLT_MIN, 60.0f));
+
+		ImGui::End();
+	}
+
 	std::filesystem::path UI::OpenFileDialog(const std::filesystem::path& defaultPath, const std::vector<const char *>& filters) const
 	{
 		const char* selectedPath = tinyfd_openFileDialog(
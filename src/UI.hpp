@@ -3,6 +3,8 @@
 #include <glm/glm.hpp>
 #include <filesystem>
 
+#include "GltfLoader.hpp"
+
 namespace Felina
 {
 	class Object;
@@ -19,6 +21,7 @@ namespace Felina
 			void DrawSceneWindow(Scene& scene, Application& app);
 			void DrawHierarchyObject(Object* object, size_t& idx);
 			void DrawInspectorWindow();
+			void DrawStatsWindow(Application& app);
 			void DrawInfoTab();
 
 			std::filesystem::path OpenFileDialog (const std::filesystem::path& defaultPath, const std::vector<const char *>& filters) const;
@@ -27,6 +30,7 @@ namespace Felina
 			bool ButtonCenteredOnLine(const char* label, float alignment = 0.5f);
 
 			Object* m_hierarchySelection = nullptr;
+			GltfLoadOptions m_loadOptions;
 			glm::vec3 m_displayedPosition;
 			glm::vec3 m_displayedRotation;
 			glm::vec3 m_displayedScale;